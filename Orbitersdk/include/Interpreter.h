@@ -43,10 +43,101 @@ extern "C" {
 
 class VESSEL;
 class MFD2;
+struct LuaArena;
+
+// ======================================================================
+// class LuaCallback
+// Reference to a script function stored in a table field (usually a global
+// function). The table and the field name are anchored in the registry, so
+// that the function can be pushed without creating or hashing the name
+// string. The field is looked up on every call, so that assigning a new
+// value to it takes effect immediately.
+// The class is implemented inline, so that modules which only have
+// access to the Lua state (e.g. via oapiGetLua) can use it without
+// linking against LuaInterpreter.
+
+class LuaCallback {
+public:
+	LuaCallback (): L(0), kref(LUA_NOREF), tref(LUA_NOREF) { name[0] = '\0'; }
+
+	/**
+	 * \brief Bind the callback to a table field.
+	 * \param _L Lua state
+	 * \param tidx stack index of the table containing the function
+	 *   (e.g. LUA_GLOBALSINDEX)
+	 * \param _name field name
+	 * \note The field does not need to be defined yet.
+	 */
+	void Bind (lua_State *_L, int tidx, const char *_name)
+	{
+		Release();
+		L = _L;
+		strncpy (name, _name, 63); name[63] = '\0';
+		lua_pushvalue (L, tidx);
+		tref = luaL_ref (L, LUA_REGISTRYINDEX);
+		lua_pushstring (L, name);
+		kref = luaL_ref (L, LUA_REGISTRYINDEX);
+	}
+
+	/**
+	 * \brief Release the registry references.
+	 * \note Not required if the Lua state is closed.
+	 */
+	void Release ()
+	{
+		if (L) {
+			luaL_unref (L, LUA_REGISTRYINDEX, kref);
+			luaL_unref (L, LUA_REGISTRYINDEX, tref);
+			kref = tref = LUA_NOREF;
+			L = 0;
+		}
+	}
+
+	/**
+	 * \brief Push the function onto the stack.
+	 * \return true if the field contains a function. Otherwise, the field
+	 *   value (usually nil) is pushed and false is returned.
+	 * \note The field is read with a raw lookup. Only if it is not set in
+	 *   the table itself is the lookup repeated with metamethods (e.g. for
+	 *   an environment table inheriting from the globals).
+	 */
+	bool Push ()
+	{
+		lua_rawgeti (L, LUA_REGISTRYINDEX, tref);
+		lua_rawgeti (L, LUA_REGISTRYINDEX, kref);
+		lua_rawget (L, -2);
+		if (lua_isnil (L, -1)) {
+			lua_pop (L, 1);
+			lua_rawgeti (L, LUA_REGISTRYINDEX, kref);
+			lua_gettable (L, -2);
+		}
+		lua_remove (L, -2);
+		return lua_isfunction (L, -1) != 0;
+	}
+
+	/**
+	 * \brief Returns true if the field currently contains a function.
+	 */
+	bool IsDefined ()
+	{
+		bool def = Push();
+		lua_pop (L, 1);
+		return def;
+	}
+
+	inline const char *Name () const { return name; }
+
+private:
+	lua_State *L;      // Lua state
+	char name[64];     // field name
+	int kref;          // registry reference to the field name
+	int tref;          // registry reference to the table containing the field
+};
 
 struct AirfoilContext {
 	lua_State *L;
 	char funcname[128];
+	LuaCallback func;  // the callback function
 };
 
 // ======================================================================
@@ -55,6 +146,88 @@ struct AirfoilContext {
 // converts the vector at stack position 'idx' into a VECTOR3
 INTERPRETERLIB VECTOR3 lua_tovector (lua_State *L, int idx);
 
+// ======================================================================
+// Asynchronous script commands (see Interpreter::PostCmd)
+// A posted command is represented by a SCRIPTCMD record, which serves as
+// completion handle. Records are allocated from the process heap, so that
+// clients can query and release them with the inline functions below
+// without linking against LuaInterpreter.
+
+struct SCRIPTCMD;
+
+/**
+ * \brief Completion callback for asynchronous commands.
+ * \param hCmd command handle
+ * \param status execution status (see ScriptCmdDone)
+ * \param context context pointer passed to Interpreter::PostCmd
+ * \note The callback is invoked on the thread that runs the interpreter
+ *   (Interpreter::RunQueue).
+ */
+typedef void (*SCRIPTCMDCLBK)(SCRIPTCMD *hCmd, int status, void *context);
+
+struct SCRIPTCMD {
+	SCRIPTCMD *next;     // queue link
+	SCRIPTCMDCLBK clbk;  // completion callback (or NULL)
+	void *context;       // callback context
+	volatile LONG refs;  // reference count (queue + client handle)
+	volatile LONG done;  // completion flag
+	int status;          // execution status (valid once done is set)
+	char cmd[1];         // command string (allocated to size)
+};
+
+/**
+ * \brief Checks an asynchronous command for completion.
+ * \param hCmd command handle returned by Interpreter::PostCmd
+ * \param status receives the execution status if the command has completed:
+ *   0 on success, a Lua error code on failure, or -1 if the command was
+ *   discarded without being executed.
+ * \return \e true if the command has completed.
+ * \note Can be called from any thread.
+ */
+inline bool ScriptCmdDone (const SCRIPTCMD *hCmd, int *status = 0)
+{
+	if (!hCmd->done) return false;
+	if (status) *status = hCmd->status;
+	return true;
+}
+
+/**
+ * \brief Releases a command handle returned by Interpreter::PostCmd.
+ * \note The handle must not be used after this call. Releasing a handle
+ *   before the command has completed does not cancel the command.
+ */
+inline void ScriptCmdRelease (SCRIPTCMD *hCmd)
+{
+	if (!InterlockedDecrement (&hCmd->refs))
+		HeapFree (GetProcessHeap(), 0, hCmd);
+}
+
+// ======================================================================
+// Execution budget statistics (see Interpreter::SetBudget)
+
+struct BUDGETSTATS {
+	DWORD ncycle;     ///< number of interpreter cycles executed
+	DWORD noverrun;   ///< number of cycles that exceeded the budget
+	DWORD npreempt;   ///< number of tasks or jobs suspended by the budget
+	double tlast;     ///< execution time of the last cycle [ms]
+	double tmax;      ///< longest cycle execution time [ms]
+};
+
+// ======================================================================
+// Memory and garbage collector statistics (see Interpreter::SetGC)
+
+struct MEMSTATS {
+	double kbinuse;   ///< memory in use [kB]
+	double kbpeak;    ///< peak memory in use [kB]
+	double kbcycle;   ///< memory allocated since the previous cycle [kB]
+	double kbtotal;   ///< memory allocated since the interpreter was created [kB]
+	DWORD nalloc;     ///< number of allocations since the interpreter was created
+	DWORD ngc;        ///< number of collection cycles completed by per-cycle GC steps
+	double tgclast;   ///< time of the last per-cycle GC step [ms]
+	double tgcmax;    ///< longest per-cycle GC step [ms]
+	double tgc;       ///< accumulated time of the per-cycle GC steps [ms]
+};
+
 // ======================================================================
 // class Interpreter
 
@@ -110,6 +283,8 @@ public:
 	 * \brief Wait for thread execution.
 	 * \note This is called by either the orbiter thread or the interpreter
 	 *   thread when they are waiting to regain execution control.
+	 * \note Only required by clients that run the interpreter in a separate
+	 *   thread. Clients using StartChunk and Resume do not need to call it.
 	 */
 	virtual void WaitExec (DWORD timeout = INFINITE);
 
@@ -120,6 +295,8 @@ public:
 	 * \note This is called by either the orbiter thread or the interpreter
 	 *   thread after finishing a cycle to hand control over to the other
 	 *   thread.
+	 * \note Only required by clients that run the interpreter in a separate
+	 *   thread. Clients using StartChunk and Resume do not need to call it.
 	 */
 	virtual void EndExec ();
 
@@ -148,9 +325,120 @@ public:
 	 * \param chunk command line string
 	 * \param n string length
 	 * \return Execution status as returned by lua_pcall (0=no error)
+	 * \note The chunk runs on the main Lua thread. proc.skip hands control
+	 *   over with WaitExec/EndExec, which only suspends the chunk if the
+	 *   interpreter runs in a thread of its own. Otherwise the chunk runs to
+	 *   completion.
 	 */
 	virtual int RunChunk (const char *chunk, int n);
 
+	/**
+	 * \brief Starts a command or script as a cooperative task.
+	 * \param chunk command line string
+	 * \param n string length
+	 * \return 0 on success, or the error code returned by luaL_loadbuffer
+	 * \note The task runs as a Lua coroutine on the thread that calls
+	 *   Resume. It does not execute before the next call to Resume.
+	 * \note A task that is still pending is discarded.
+	 */
+	int StartChunk (const char *chunk, int n);
+
+	/**
+	 * \brief Executes one interpreter cycle on the calling thread.
+	 * \return LUA_YIELD if the task has suspended itself until the next
+	 *   cycle, the execution status as returned by lua_resume (0=no error)
+	 *   if the task has finished, or -1 if no task was pending and the
+	 *   background jobs were executed instead.
+	 * \note A pending task runs until it returns or calls proc.skip (directly
+	 *   or via one of the proc.wait_xxx functions). The built-in pcall and
+	 *   xpcall block the suspension; proc.pcall and proc.xpcall (defined in
+	 *   oapi_init.lua) pass it on. The task cannot be suspended from a
+	 *   metamethod, a 'for' iterator or a Lua function called from C.
+	 *   proc.skip raises an error there.
+	 * \note Clients should call this once per simulation step while
+	 *   IsBusy() is true or nJobs() > 0. This replaces the interpreter thread
+	 *   and the WaitExec/EndExec handover.
+	 */
+	int Resume ();
+
+	/**
+	 * \brief Queues a command for asynchronous execution.
+	 * \param cmd command string (copied)
+	 * \param clbk optional completion callback
+	 * \param context context pointer passed to the callback
+	 * \param handle if \e true, a completion handle is returned
+	 * \return completion handle, or NULL if no handle was requested or the
+	 *   command could not be queued.
+	 * \note Can be called from any thread. The command queue is lock-free:
+	 *   the caller never waits for the interpreter.
+	 * \note A returned handle must be released with ScriptCmdRelease.
+	 * \note Queued commands are executed in order by RunQueue.
+	 */
+	SCRIPTCMD *PostCmd (const char *cmd, SCRIPTCMDCLBK clbk = 0, void *context = 0, bool handle = false);
+
+	/**
+	 * \brief Executes one interpreter cycle, including queued commands.
+	 * \return as Resume
+	 * \note All commands posted since the last call are collected in one
+	 *   batch. Each command runs as a task. Commands that run to completion
+	 *   are followed by the next command in the same cycle, until a
+	 *   command suspends itself or the execution budget is exceeded.
+	 * \note Clients that use PostCmd should call this once per simulation
+	 *   step instead of Resume. It must not be called concurrently with
+	 *   other interpreter methods.
+	 */
+	int RunQueue ();
+
+	/**
+	 * \brief Sets the execution budget of an interpreter cycle.
+	 * \param ninstr max. number of Lua instructions per cycle (0=unlimited)
+	 * \param tmax max. execution time per cycle [ms] (0=unlimited)
+	 * \note The budget is checked by a Lua count hook every few thousand
+	 *   instructions. A task or background job exceeding the budget is
+	 *   suspended and continues in the next cycle, as if it had called
+	 *   proc.skip. Code called from a C function (e.g. via pcall rather
+	 *   than proc.pcall) or from a metamethod cannot be suspended and runs
+	 *   until it returns.
+	 * \note Chunks executed with RunChunk are never suspended, but their
+	 *   overruns are counted.
+	 * \note Scripts can change the budget with proc.set_budget.
+	 */
+	void SetBudget (DWORD ninstr, double tmax);
+
+	/**
+	 * \brief Returns the execution budget statistics.
+	 * \note Scripts can query the statistics with proc.get_budgetstats.
+	 */
+	const BUDGETSTATS &GetBudgetStats () const { return bstats; }
+
+	/**
+	 * \brief Sets the garbage collector parameters.
+	 * \param pause collector pause [%] (0=unchanged). A new collection
+	 *   cycle starts when memory use reaches this percentage of the use
+	 *   after the previous collection (Lua default: 200).
+	 * \param stepmul collector speed relative to allocation [%]
+	 *   (0=unchanged, Lua default: 200)
+	 * \param tstep max. time of the incremental GC step executed at the end
+	 *   of each interpreter cycle [ms] (0=no per-cycle step)
+	 * \note The per-cycle step starts a collection once memory use has grown
+	 *   by half the pause margin, and runs it in slices of up to tstep per
+	 *   cycle, limited by the remaining time budget (see SetBudget). The
+	 *   collection usually completes before the automatic collector would
+	 *   start it from an allocation during script execution, which turns
+	 *   collection spikes into bounded work per cycle.
+	 * \note Scripts can change the parameters with proc.set_gc.
+	 */
+	void SetGC (int pause, int stepmul, double tstep);
+
+	/**
+	 * \brief Returns the memory and garbage collector statistics.
+	 * \note The statistics are updated at the end of each cycle. Allocation
+	 *   counts are only available if the interpreter uses its own allocator
+	 *   (which is the default).
+	 * \note Scripts can query the statistics with proc.get_memstats.
+	 */
+	const MEMSTATS &GetMemStats () const { return mstats; }
+
 	/**
 	 * \brief Copies a string to the terminal.
 	 * \param str string to be displayed.
@@ -187,6 +475,24 @@ public:
 	 */
 	static void lua_pushsketchpad (lua_State *L, oapi::Sketchpad *skp);
 
+	/**
+	 * \brief Load a script file as a Lua function, using the bytecode cache.
+	 * \param L Lua interpreter instance
+	 * \param fname script file name
+	 * \return 0 on success, or an error code as returned by luaL_loadfile
+	 * \note On success, the compiled chunk is pushed on the stack, otherwise
+	 *   the error message.
+	 * \note Compiled chunks are stored in Cache\Lua, together with the full
+	 *   path, size and modification time of the source file. The source is
+	 *   only parsed if no matching cache entry exists, and the cache entry is
+	 *   renewed. Entries are replaced as a whole, so a concurrent or
+	 *   interrupted write leaves either the old or the new entry.
+	 * \note The interpreter replaces the global loadfile function with a
+	 *   version that uses this loader, so that scripts loaded with run,
+	 *   run_global or loadfile are cached as well.
+	 */
+	static int lua_loadfilecached (lua_State *L, const char *fname);
+
 	void term_setverbosity (int level) { term_verbose = level; }
 
 protected:
@@ -218,23 +524,33 @@ protected:
 	// This also handles vector and nil entries.
 	static const char *lua_tostringex (lua_State *L, int idx, char *cbuf = 0);
 
-	// pushes vector 'vec' into a table on top of the stack
+	// pushes vector 'vec' as a vector object on top of the stack
 	static void lua_pushvector (lua_State *L, const VECTOR3 &vec);
 
-	// returns 1 if stack entry idx is a vector, 0 otherwise
+	// returns 1 if stack entry idx is a vector object or a table with
+	// x, y, z fields, 0 otherwise
 	static int lua_isvector (lua_State *L, int idx);
 
-	// pushes matrix 'mat' into a table on top of the stack
+	// pushes matrix 'mat' as a matrix object on top of the stack
 	static void lua_pushmatrix (lua_State *L, const MATRIX3 &mat);
 
 	// converts the matrix at stack position 'idx' into a MATRIX3
 	static MATRIX3 lua_tomatrix (lua_State *L, int idx);
 
-	// returns 1 if stack entry idx is a matrix, 0 otherwise
+	// returns 1 if stack entry idx is a matrix object or a table with
+	// m11 ... m33 fields, 0 otherwise
 	static int lua_ismatrix (lua_State *L, int idx);
 
 	static COLOUR4 lua_torgba (lua_State *L, int idx);
 
+	// fills the state table at stack position 'sidx' with the quantities
+	// listed in the query table at 'qidx' for object hObj. v is the vessel
+	// interface of hObj, or NULL if hObj is not a vessel. Vessel-specific
+	// quantities are set to nil for non-vessel objects. Vector and matrix
+	// objects already stored in the state table are updated in place.
+	// Returns false if the query contains an unknown key.
+	static bool lua_getstate (lua_State *L, int qidx, int sidx, OBJHANDLE hObj, VESSEL *v);
+
 	// pops an OBJHANDLE from the stack
 	static OBJHANDLE lua_toObject (lua_State *L, int idx=-1);
 
@@ -256,6 +572,7 @@ protected:
 	// global functions
 	static int help (lua_State *L);
 	static int help_api (lua_State *L);
+	static int loadfile (lua_State *L);
 
 	// vector library functions
 	static int vec_set (lua_State *L);
@@ -273,8 +590,31 @@ protected:
 	static int mat_tmul (lua_State *L);
 	static int mat_mmul (lua_State *L);
 
+	// vector and matrix object metamethods
+	static int vec_index (lua_State *L);
+	static int vec_newindex (lua_State *L);
+	static int vec_unm (lua_State *L);
+	static int vec_eq (lua_State *L);
+	static int vec_tostring (lua_State *L); // also used for matrix objects
+	static int mat_index (lua_State *L);
+	static int mat_newindex (lua_State *L);
+	static int mat_mulop (lua_State *L);
+	static int mat_eq (lua_State *L);
+
+	// mesh vertex buffer methods (see oapi.map_meshgroup)
+	static int vtx_size (lua_State *L);
+	static int vtx_read (lua_State *L);
+	static int vtx_write (lua_State *L);
+	static int vtx_commit (lua_State *L);
+
 	// process library functions
 	static int procFrameskip (lua_State *L);
+	static int procPreemptible (lua_State *L);
+	static int procOverrun (lua_State *L);
+	static int procSetBudget (lua_State *L);
+	static int procGetBudgetStats (lua_State *L);
+	static int procSetGC (lua_State *L);
+	static int procGetMemStats (lua_State *L);
 
 	// -------------------------------------------
 	// oapi library functions
@@ -314,6 +654,7 @@ protected:
 	static int oapi_get_globalvel (lua_State *L);
 	static int oapi_get_relativepos (lua_State *L);
 	static int oapi_get_relativevel (lua_State *L);
+	static int oapi_get_state (lua_State *L);
 
 	// Vessel functions
 	static int oapi_get_propellanthandle (lua_State *L);
@@ -357,6 +698,9 @@ protected:
 	static int oapi_create_animationcomponent (lua_State *L);
 	static int oapi_del_animationcomponent (lua_State *L);
 
+	// mesh functions
+	static int oapi_map_meshgroup (lua_State *L);
+
 	// instrument panel functions
 	static int oapi_open_mfd (lua_State *L);
 	static int oapi_set_hudmode (lua_State *L);
@@ -494,6 +838,7 @@ protected:
 	static int v_get_relativepos (lua_State *L);
 	static int v_get_relativevel (lua_State *L);
 	static int v_get_rotationmatrix (lua_State *L);
+	static int v_get_state (lua_State *L);
 
 	// atmospheric parameters
 	static int v_get_atmref (lua_State *L);
@@ -598,6 +943,7 @@ protected:
 	static int v_shift_mesh (lua_State *L);
 	static int v_shift_meshes (lua_State *L);
 	static int v_get_meshoffset (lua_State *L);
+	static int v_get_devmesh (lua_State *L);
 
 	// animation methods
 	static int v_create_animation (lua_State *L);
@@ -663,6 +1009,41 @@ private:
 	bool bExecLocal;   // flag for locally created mutexes
 	bool bWaitLocal;
 
+	LuaCallback cbNbranch;   // _nbranch: number of background jobs
+	LuaCallback cbIdle;      // _idle: background job cycle
+	void EndTask ();         // release the current task thread
+	int ResumeTask ();       // Resume without starting a new cycle (see RunQueue)
+	lua_State *task;         // coroutine of the pending task (or NULL)
+	int taskref;             // registry reference anchoring the task coroutine
+
+	void FetchCmds ();       // move posted commands to the pending list
+	static void CompleteCmd (SCRIPTCMD *hCmd, int status);
+	SCRIPTCMD * volatile cmdpost; // posted commands (lock-free LIFO, newest first)
+	SCRIPTCMD *cmdfirst;     // pending commands in order of posting
+	SCRIPTCMD *cmdlast;
+	SCRIPTCMD *cmdcur;       // command running as the current task
+
+	static void BudgetHook (lua_State *L, lua_Debug *ar);
+	void BeginCycle ();      // reset the budget for a new cycle
+	void EndCycle ();        // update the budget statistics
+	bool OverBudget () const;
+	DWORD bninstr;           // instruction budget per cycle (0=unlimited)
+	LONGLONG btmax;          // time budget per cycle [ticks] (0=unlimited)
+	DWORD bstep;             // instructions between budget hook events
+	DWORD binstr;            // instructions executed in the current cycle (hook resolution)
+	LONGLONG bt0;            // start time of the current cycle [ticks]
+	bool boverrun;           // current cycle has exceeded the budget
+	BUDGETSTATS bstats;      // budget statistics
+
+	static void *LuaAlloc (void *ud, void *ptr, size_t osize, size_t nsize);
+	LuaArena *arena;         // per-interpreter allocator (NULL: Lua default allocator)
+	void StepGC ();          // per-cycle incremental GC step
+	LONGLONG gctmax;         // time limit of the per-cycle GC step [ticks] (0=disabled)
+	int gcpause;             // collector pause [%]
+	double gckb0;            // memory in use after the last completed collection [kB]
+	bool gcactive;           // collection started by the per-cycle step in progress
+	MEMSTATS mstats;         // memory statistics
+
 	static NOTEHANDLE hnote; // screen note (shared between all instances)
 	int status;              // interpreter status
 	bool is_busy;            // interpreter busy (running a script)
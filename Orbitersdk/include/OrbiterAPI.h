@@ -4165,6 +4165,10 @@ OAPIFUNC int oapiDelInterpreter (INTERPRETERHANDLE hInterp);
 	* \param cmd Lua command to be executed
 	* \return \e false on error (interpreter library not found, or command error)
 	* \note This function returns as soon as the command has been executed.
+	* \note The command runs to completion on the calling thread and cannot be
+	*   suspended. proc.skip and the proc.wait_xxx functions return without
+	*   advancing the simulation, so a command waiting for a simulation time or
+	*   state never returns. Use oapiAsyncScriptCmd for such commands.
 	* \sa oapiAsyncScriptCmd, oapiCreateInterpreter, oapiDelInterpreter
 	*/
 OAPIFUNC bool oapiExecScriptCmd (INTERPRETERHANDLE hInterp, const char *cmd);
@@ -17,6 +17,8 @@
 #include "PlBayOp.h"
 #include "AscentAP.h"
 #include "DlgCtrl.h"
+#include "Common\Profile\FrameProf.h"
+#include "Common\Aero\AeroTable.h"
 #include "meshres.h"
 #include "meshres_vc.h"
 #include "resource.h"
@@ -349,6 +351,37 @@ void Atlantis::CreateAirfoils ()
 	CreateVariableDragElement (&ldoor_drag, 7, _V(-2.9,0,10));  // right cargo door drag
 }
 
+// --------------------------------------------------------------
+// Airfoil coefficient tables
+// --------------------------------------------------------------
+static AeroTable vlift; // lift and moment coefficients vs. angle of attack
+static AeroTable hlift; // lift coefficient vs. slip angle
+
+static void InitAirfoilTables ()
+{
+	int i;
+	static const int vnabsc = 25;
+	static const double VCL[vnabsc] = {0.1, 0.17, 0.2, 0.2, 0.17, 0.1, 0, -0.11, -0.24, -0.38,  -0.5,  -0.5, -0.02, 0.6355,    0.63,   0.46, 0.28, 0.13, 0.0, -0.16, -0.26, -0.29, -0.24, -0.1, 0.1};
+	static const double VCM[vnabsc] = {  0,    0,   0,   0,    0,   0, 0,     0,    0,0.002,0.004, 0.0025,0.0012,      0,-0.0012,-0.0007,    0,    0,   0,     0,     0,     0,     0,    0,   0};
+	// lift and moment coefficients from -180 to 180 in 15 degree steps.
+	// This uses a documented lift slope of 0.0437/deg, everything else is rather ad-hoc
+	double aoa[vnabsc], vc[vnabsc*2];
+	for (i = 0; i < vnabsc; i++) {
+		aoa[i] = (i*15.0-180.0)*RAD;
+		vc[i*2]   = VCL[i];
+		vc[i*2+1] = VCM[i];
+	}
+	vlift.Define (vnabsc, aoa, 2, vc, AEROTABLE_LINEAR | AEROTABLE_PERIODIC);
+
+	static const int hnabsc = 17;
+	static const double HCL[hnabsc] = {0, 0.2, 0.3, 0.2, 0, -0.2, -0.3, -0.2, 0, 0.2, 0.3, 0.2, 0, -0.2, -0.3, -0.2, 0};
+	// lift coefficient from -180 to 180 in 22.5 degree steps
+	double beta[hnabsc];
+	for (i = 0; i < hnabsc; i++)
+		beta[i] = (i*22.5-180.0)*RAD;
+	hlift.Define (hnabsc, beta, 1, HCL, AEROTABLE_LINEAR | AEROTABLE_PERIODIC);
+}
+
 // --------------------------------------------------------------
 // Airfoil coefficient function
 // Return lift, moment and zero-lift drag coefficients as a
@@ -357,19 +390,10 @@ void Atlantis::CreateAirfoils ()
 // --------------------------------------------------------------
 void Atlantis::VLiftCoeff (double aoa, double M, double Re, double *cl, double *cm, double *cd)
 {
-	static const double step = RAD*15.0;
-	static const double istep = 1.0/step;
-	static const int nabsc = 25;
-	static const double CL[nabsc] = {0.1, 0.17, 0.2, 0.2, 0.17, 0.1, 0, -0.11, -0.24, -0.38,  -0.5,  -0.5, -0.02, 0.6355,    0.63,   0.46, 0.28, 0.13, 0.0, -0.16, -0.26, -0.29, -0.24, -0.1, 0.1};
-	static const double CM[nabsc] = {  0,    0,   0,   0,    0,   0, 0,     0,    0,0.002,0.004, 0.0025,0.0012,      0,-0.0012,-0.0007,    0,    0,   0,     0,     0,     0,     0,    0,   0};
-	// lift and moment coefficients from -180 to 180 in 15 degree steps.
-	// This uses a documented lift slope of 0.0437/deg, everything else is rather ad-hoc
-
-	aoa += PI;
-	int idx = max (0, min (23, (int)(aoa*istep)));
-	double d = aoa*istep - idx;
-	*cl = CL[idx] + (CL[idx+1]-CL[idx])*d;
-	*cm = CM[idx] + (CM[idx+1]-CM[idx])*d;
+	double c[2];
+	vlift.Eval (aoa, c);
+	*cl = c[0];
+	*cm = c[1];
 	*cd = 0.06 + oapiGetInducedDrag (*cl, 2.266, 0.6);
 }
 
@@ -381,15 +405,7 @@ void Atlantis::VLiftCoeff (double aoa, double M, double Re, double *cl, double *
 // --------------------------------------------------------------
 void Atlantis::HLiftCoeff (double beta, double M, double Re, double *cl, double *cm, double *cd)
 {
-	static const double step = RAD*22.5;
-	static const double istep = 1.0/step;
-	static const int nabsc = 17;
-	static const double CL[nabsc] = {0, 0.2, 0.3, 0.2, 0, -0.2, -0.3, -0.2, 0, 0.2, 0.3, 0.2, 0, -0.2, -0.3, -0.2, 0};
-
-	beta += PI;
-	int idx = max (0, min (15, (int)(beta*istep)));
-	double d = beta*istep - idx;
-	*cl = CL[idx] + (CL[idx+1]-CL[idx])*d;
+	hlift.Eval (beta, cl);
 	*cm = 0.0;
 	*cd = 0.02 + oapiGetInducedDrag (*cl, 1.5, 0.6);
 }
@@ -1499,6 +1515,7 @@ void Atlantis::clbkFocusChanged (bool getfocus, OBJHANDLE newv, OBJHANDLE oldv)
 // --------------------------------------------------------------
 void Atlantis::clbkPreStep (double simt, double simdt, double mjd)
 {
+	FRAMEPROF_CALLBACK ("Atlantis::clbkPreStep");
 	ascap->Update (simt);
 	if (ascentApDlg) ascentApDlg->Update (simt);
 
@@ -2184,6 +2201,9 @@ DLLCLBK void InitModule (HINSTANCE hModule)
 
 	// allocate GDI resources
 	g_Param.font[0] = CreateFont (-11, 0, 0, 0, 400, 0, 0, 0, 0, 0, 0, 0, 0, "Arial");
+
+	// airfoil coefficient tables
+	InitAirfoilTables ();
 }
 
 DLLCLBK void ExitModule (HINSTANCE hModule)
@@ -0,0 +1,349 @@
+// ==============================================================
+//              ORBITER MODULE: Common aerodynamics tools
+//                  Part of the ORBITER SDK
+//          Copyright (C) 2001-2015 Martin Schweiger
+//                   All rights reserved
+//
+// AeroTable.cpp
+// Implementation for class AeroTable:
+//   Precomputed aerodynamic coefficient tables
+// ==============================================================
+
+#include "AeroTable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+// ==============================================================
+
+AeroTable::AeroTable ()
+{
+	ndim = nval = 0;
+	flags = 0;
+	period = 0.0;
+	memset (ax, 0, sizeof(ax));
+	coef = 0;
+}
+
+AeroTable::~AeroTable ()
+{
+	Clear ();
+}
+
+void AeroTable::Clear ()
+{
+	for (DWORD d = 0; d < AEROTABLE_MAXDIM; d++) {
+		if (ax[d].x) delete []ax[d].x;
+		if (ax[d].ih) delete []ax[d].ih;
+	}
+	memset (ax, 0, sizeof(ax));
+	if (coef) {
+		delete []coef;
+		coef = 0;
+	}
+	ndim = nval = 0;
+}
+
+// ==============================================================
+
+bool AeroTable::Define (DWORD _ndim, const DWORD *n, const double *const *axis,
+	DWORD _nval, const double *data, DWORD _flags)
+{
+	DWORD d, i;
+
+	if (!_ndim || _ndim > AEROTABLE_MAXDIM || !_nval || _nval > AEROTABLE_MAXVAL)
+		return false;
+	for (d = 0; d < _ndim; d++) {
+		if (n[d] < 2) return false;
+		for (i = 1; i < n[d]; i++)
+			if (!(axis[d][i] > axis[d][i-1])) return false; // not increasing
+	}
+
+	Clear ();
+	ndim = _ndim;
+	nval = _nval;
+	flags = _flags;
+	for (d = 0; d < ndim; d++) {
+		Axis &a = ax[d];
+		a.n = n[d];
+		a.x = new double[a.n];
+		a.ih = new double[a.n-1];
+		memcpy (a.x, axis[d], a.n*sizeof(double));
+		double range = a.x[a.n-1]-a.x[0];
+		double step = range/(a.n-1);
+		bool uniform = true;
+		for (i = 0; i < a.n-1; i++) {
+			double h = a.x[i+1]-a.x[i];
+			a.ih[i] = 1.0/h;
+			if (fabs (h-step) > 1e-9*range) uniform = false;
+		}
+		a.istep = (uniform ? 1.0/step : 0.0);
+	}
+	period = ax[0].x[ax[0].n-1]-ax[0].x[0];
+	Segments (data);
+	return true;
+}
+
+bool AeroTable::Define (DWORD n, const double *x, DWORD _nval, const double *data, DWORD _flags)
+{
+	return Define (1, &n, &x, _nval, data, _flags);
+}
+
+// --------------------------------------------------------------
+// Compute the interpolation polynomials of all segments of the
+// first axis, for each value and each grid line spanned by the
+// other axes. A segment is evaluated as
+//   c0 + t*(c1 + t*(c2 + t*c3)),  t in [0,1]
+// The monotone cubic uses the Fritsch-Butland node slopes: zero at
+// local extrema, a weighted harmonic mean of the adjacent secant
+// slopes otherwise.
+// --------------------------------------------------------------
+
+void AeroTable::Segments (const double *data)
+{
+	const Axis &a = ax[0];
+	DWORD n = a.n, nseg = n-1;
+	DWORD nline = 1, d, i, l, v;
+	for (d = 1; d < ndim; d++) nline *= ax[d].n;
+	coef = new double[nline*nseg*nval*4];
+
+	std::vector<double> y(n), m(n), s(nseg), h(nseg);
+	for (i = 0; i < nseg; i++) h[i] = a.x[i+1]-a.x[i];
+	bool periodic = (flags & AEROTABLE_PERIODIC) != 0;
+
+	for (l = 0; l < nline; l++) {
+		for (v = 0; v < nval; v++) {
+			for (i = 0; i < n; i++)
+				y[i] = data[(l*n + i)*nval + v];
+			for (i = 0; i < nseg; i++)
+				s[i] = (y[i+1]-y[i])/h[i];
+
+			if (flags & AEROTABLE_CUBIC) {
+				for (i = 1; i < nseg; i++) {
+					if (s[i-1]*s[i] <= 0.0) m[i] = 0.0;
+					else {
+						double w1 = 2.0*h[i]+h[i-1], w2 = h[i]+2.0*h[i-1];
+						m[i] = (w1+w2)/(w1/s[i-1] + w2/s[i]);
+					}
+				}
+				if (periodic) {
+					// the end node is interior to the wrapped axis
+					double sp = s[nseg-1], sn = s[0];
+					if (sp*sn <= 0.0) m[0] = 0.0;
+					else {
+						double w1 = 2.0*h[0]+h[nseg-1], w2 = h[0]+2.0*h[nseg-1];
+						m[0] = (w1+w2)/(w1/sp + w2/sn);
+					}
+					m[nseg] = m[0];
+				} else if (nseg == 1) {
+					m[0] = m[1] = s[0];
+				} else {
+					// shape-preserving three-point end slopes
+					for (int e = 0; e < 2; e++) {
+						DWORD k0 = (e ? nseg-1 : 0), k1 = (e ? nseg-2 : 1);
+						double me = ((2.0*h[k0]+h[k1])*s[k0] - h[k0]*s[k1])/(h[k0]+h[k1]);
+						if (me*s[k0] <= 0.0) me = 0.0;
+						else if (s[k0]*s[k1] <= 0.0 && fabs(me) > fabs(3.0*s[k0])) me = 3.0*s[k0];
+						m[e ? nseg : 0] = me;
+					}
+				}
+			}
+
+			double *c = coef + l*nseg*nval*4 + v*4;
+			for (i = 0; i < nseg; i++, c += nval*4) {
+				double dy = y[i+1]-y[i];
+				c[0] = y[i];
+				if (flags & AEROTABLE_CUBIC) {
+					c[1] = h[i]*m[i];
+					c[2] = 3.0*dy - h[i]*(2.0*m[i] + m[i+1]);
+					c[3] = -2.0*dy + h[i]*(m[i] + m[i+1]);
+				} else {
+					c[1] = dy;
+					c[2] = c[3] = 0.0;
+				}
+			}
+		}
+	}
+}
+
+// ==============================================================
+
+DWORD AeroTable::Axis::Find (double v, double &t) const
+{
+	DWORD i;
+	if (!(v > x[0])) { t = 0.0; return 0; }  // also catches NaN
+	if (v >= x[n-1]) { t = 1.0; return n-2; }
+	if (istep) {
+		double s = (v-x[0])*istep;
+		i = (DWORD)s;
+		if (i > n-2) i = n-2;
+		t = s-i;
+	} else {
+		DWORD i1 = n-1;
+		i = 0;
+		while (i1-i > 1) {
+			DWORD im = (i+i1) >> 1;
+			if (x[im] <= v) i = im;
+			else            i1 = im;
+		}
+		t = (v-x[i])*ih[i];
+	}
+	return i;
+}
+
+void AeroTable::Eval (double x0, double x1, double x2, double *val) const
+{
+	DWORD v, l;
+	double t0;
+
+	if (flags & AEROTABLE_PERIODIC) {
+		double r = fmod (x0-ax[0].x[0], period);
+		x0 = ax[0].x[0] + (r < 0.0 ? r+period : r);
+	}
+	DWORD nseg = ax[0].n-1;
+	DWORD i = ax[0].Find (x0, t0);
+
+	if (ndim == 1) {
+		const double *c = coef + i*nval*4;
+		for (v = 0; v < nval; v++, c += 4)
+			val[v] = c[0] + t0*(c[1] + t0*(c[2] + t0*c[3]));
+		return;
+	}
+
+	// grid lines of the cell and their weights
+	DWORD line[4];
+	double w[4], t1, t2;
+	DWORD nl = 2;
+	DWORD j = ax[1].Find (x1, t1);
+	line[0] = j;   w[0] = 1.0-t1;
+	line[1] = j+1; w[1] = t1;
+	if (ndim > 2) {
+		DWORD k = ax[2].Find (x2, t2);
+		DWORD n1 = ax[1].n;
+		for (l = 0; l < 2; l++) {
+			line[l+2] = line[l] + (k+1)*n1; w[l+2] = w[l]*t2;
+			line[l]  += k*n1;               w[l]  *= 1.0-t2;
+		}
+		nl = 4;
+	}
+
+	for (v = 0; v < nval; v++) val[v] = 0.0;
+	for (l = 0; l < nl; l++) {
+		if (!w[l]) continue;
+		const double *c = coef + (line[l]*nseg + i)*nval*4;
+		for (v = 0; v < nval; v++, c += 4)
+			val[v] += w[l]*(c[0] + t0*(c[1] + t0*(c[2] + t0*c[3])));
+	}
+}
+
+// ==============================================================
+// Data file loader
+
+// case-insensitive keyword match
+static bool KeyIs (const char *key, const char *name)
+{
+	for (; *key && *name; key++, name++)
+		if (toupper(*key) != *name) return false;
+	return !*key && !*name;
+}
+
+// split a line into whitespace-separated tokens (modifies the line)
+static DWORD Tokens (char *line, char **tok, DWORD maxtok)
+{
+	DWORD n = 0;
+	for (char *c = strtok (line, " \t"); c && n < maxtok; c = strtok (NULL, " \t"))
+		tok[n++] = c;
+	return n;
+}
+
+bool AeroTable::Load (const char *fname)
+{
+	FILE *f = fopen (fname, "rt");
+	if (!f) return false;
+
+	const double RAD = 3.14159265358979323846/180.0;
+	char line[1024], *tok[AEROTABLE_MAXDIM+AEROTABLE_MAXVAL];
+	DWORD ld = 0, lv = 0, lflags = AEROTABLE_LINEAR, d, i;
+	bool deg = false, indata = false, ok = true;
+	std::vector<double> row;
+
+	while (ok && fgets (line, 1024, f)) {
+		char *c = strchr (line, ';');
+		if (c) *c = '\0';
+		for (c = line + strlen(line); c > line && isspace((unsigned char)c[-1]); c--);
+		*c = '\0';
+		for (c = line; isspace((unsigned char)*c); c++);
+		if (!*c) continue;
+
+		if (indata) {
+			if (KeyIs (c, "END_DATA")) { indata = false; continue; }
+			DWORD nt = Tokens (c, tok, ld+lv);
+			if (nt != ld+lv) { ok = false; break; }
+			for (i = 0; i < nt; i++) {
+				char *e;
+				row.push_back (strtod (tok[i], &e));
+				if (*e) ok = false;
+			}
+		} else if (KeyIs (c, "BEGIN_DATA")) {
+			if (!ld || !lv) ok = false;
+			indata = true;
+		} else {
+			char *eq = strchr (c, '=');
+			if (!eq) { ok = false; break; }
+			*eq = '\0';
+			for (char *k = eq; k > c && isspace((unsigned char)k[-1]); k--) k[-1] = '\0';
+			char *item = eq+1;
+			if (KeyIs (c, "AXES")) {
+				ld = Tokens (item, tok, AEROTABLE_MAXDIM+1);
+				if (!ld || ld > AEROTABLE_MAXDIM) ok = false;
+			} else if (KeyIs (c, "VALUES")) {
+				lv = Tokens (item, tok, AEROTABLE_MAXVAL+1);
+				if (!lv || lv > AEROTABLE_MAXVAL) ok = false;
+			} else if (KeyIs (c, "INTERP")) {
+				if (Tokens (item, tok, 1) && KeyIs (tok[0], "CUBIC")) lflags |= AEROTABLE_CUBIC;
+			} else if (KeyIs (c, "ANGLE")) {
+				deg = (Tokens (item, tok, 1) && KeyIs (tok[0], "DEG"));
+			} else if (KeyIs (c, "PERIODIC")) {
+				if (Tokens (item, tok, 1) && KeyIs (tok[0], "TRUE")) lflags |= AEROTABLE_PERIODIC;
+			}
+		}
+	}
+	fclose (f);
+	if (!ok || indata || !ld || !lv || row.empty()) return false;
+
+	// collect the grid coordinates of each axis
+	DWORD nrow = row.size()/(ld+lv), n[AEROTABLE_MAXDIM], nnode = 1;
+	std::vector<double> x[AEROTABLE_MAXDIM];
+	for (d = 0; d < ld; d++) {
+		for (i = 0; i < nrow; i++)
+			x[d].push_back (row[i*(ld+lv)+d]);
+		std::sort (x[d].begin(), x[d].end());
+		x[d].erase (std::unique (x[d].begin(), x[d].end()), x[d].end());
+		n[d] = x[d].size();
+		nnode *= n[d];
+	}
+	if (nnode != nrow) return false; // incomplete grid or duplicate nodes
+
+	// sort the rows into the node array
+	std::vector<double> data(nnode*lv);
+	std::vector<bool> set(nnode, false);
+	for (i = 0; i < nrow; i++) {
+		const double *r = &row[i*(ld+lv)];
+		DWORD idx = 0;
+		for (d = ld; d-- > 0;)
+			idx = idx*n[d] + (std::lower_bound (x[d].begin(), x[d].end(), r[d]) - x[d].begin());
+		if (set[idx]) return false;
+		set[idx] = true;
+		memcpy (&data[idx*lv], r+ld, lv*sizeof(double));
+	}
+
+	if (deg)
+		for (i = 0; i < n[0]; i++) x[0][i] *= RAD;
+	const double *axis[AEROTABLE_MAXDIM];
+	for (d = 0; d < ld; d++) axis[d] = &x[d][0];
+	return Define (ld, n, axis, lv, &data[0], lflags);
+}
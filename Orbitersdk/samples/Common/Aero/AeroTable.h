@@ -0,0 +1,144 @@
+// ==============================================================
+//              ORBITER MODULE: Common aerodynamics tools
+//                  Part of the ORBITER SDK
+//          Copyright (C) 2001-2015 Martin Schweiger
+//                   All rights reserved
+//
+// AeroTable.h
+// Interface for class AeroTable:
+//   Precomputed aerodynamic coefficient tables for airfoil
+//   callbacks.
+//
+// A table holds one or more coefficients (e.g. cl, cm, cd) on a
+// rectilinear grid of up to three axes, usually angle of attack
+// (or slip angle), Mach number and Reynolds number. All
+// coefficients share the same grid. Node values are stored with
+// the first axis varying fastest.
+//
+// Lookup is O(1) on uniformly spaced axes and a binary search
+// otherwise. Along the first axis, the table is interpolated
+// either linearly or with a monotone (shape-preserving) cubic,
+// which does not overshoot between nodes. Along the remaining
+// axes it is interpolated linearly. The interpolation segments
+// are precomputed when the table is defined, so an evaluation
+// consists of the index lookups and one polynomial per value and
+// grid line. Arguments outside the table range are clamped, or
+// wrapped for a periodic first axis.
+//
+// Table data files are text files of the form
+//
+//   ; DeltaGlider wing (comments start with ';')
+//   AXES = AOA MACH
+//   VALUES = CL CM
+//   INTERP = CUBIC          ; or LINEAR (default)
+//   ANGLE = DEG             ; first axis in degrees (default: RAD)
+//   PERIODIC = TRUE         ; first axis wraps around (default: FALSE)
+//   BEGIN_DATA
+//   ; aoa  mach  cl    cm
+//   -180   0.0   0     0
+//   ...
+//   END_DATA
+//
+// Each data line lists the axis coordinates of a node followed by
+// its values. The lines may be given in any order, but must cover
+// the full grid spanned by the coordinates that occur.
+// ==============================================================
+
+#ifndef __AEROTABLE_H
+#define __AEROTABLE_H
+
+#include <windows.h>
+
+const DWORD AEROTABLE_MAXDIM = 3;  ///< max. number of table axes
+const DWORD AEROTABLE_MAXVAL = 8;  ///< max. number of values per node
+
+// Table flags
+
+#define AEROTABLE_LINEAR    0x0000  ///< linear interpolation along the first axis
+#define AEROTABLE_CUBIC     0x0001  ///< monotone cubic interpolation along the first axis
+#define AEROTABLE_PERIODIC  0x0002  ///< first axis is periodic (last node repeats the first)
+
+class AeroTable {
+public:
+	AeroTable ();
+	~AeroTable ();
+
+	/**
+	 * \brief Define the table from node data.
+	 * \param ndim number of axes (1 to AEROTABLE_MAXDIM)
+	 * \param n number of nodes along each axis (at least 2)
+	 * \param axis node coordinates of each axis, in strictly increasing order
+	 * \param nval number of values per node (1 to AEROTABLE_MAXVAL)
+	 * \param data node values, first axis varying fastest:
+	 *   data[((k*n[1] + j)*n[0] + i)*nval + v]
+	 * \param flags interpolation flags (AEROTABLE_xxx)
+	 * \return false if the parameters are invalid
+	 * \note The data are copied.
+	 */
+	bool Define (DWORD ndim, const DWORD *n, const double *const *axis,
+		DWORD nval, const double *data, DWORD flags = AEROTABLE_LINEAR);
+
+	/**
+	 * \brief Define a one-dimensional table.
+	 * \param n number of nodes
+	 * \param x node coordinates
+	 * \param nval number of values per node
+	 * \param data node values (data[i*nval + v])
+	 * \param flags interpolation flags (AEROTABLE_xxx)
+	 */
+	bool Define (DWORD n, const double *x, DWORD nval, const double *data,
+		DWORD flags = AEROTABLE_LINEAR);
+
+	/**
+	 * \brief Load the table from a data file.
+	 * \param fname file name (relative to the Orbiter root folder)
+	 * \return false if the file could not be read or is not a valid table
+	 * \note See the file header for the file format.
+	 */
+	bool Load (const char *fname);
+
+	/**
+	 * \brief Release the table data.
+	 */
+	void Clear ();
+
+	inline bool IsDefined () const { return coef != 0; }
+	inline DWORD nDim () const { return ndim; }
+	inline DWORD nVal () const { return nval; }
+
+	/**
+	 * \brief Evaluate all table values at a point.
+	 * \param x0 first axis argument (e.g. angle of attack [rad])
+	 * \param x1 second axis argument (e.g. Mach number)
+	 * \param x2 third axis argument (e.g. Reynolds number)
+	 * \param val array receiving nVal() values
+	 * \note Arguments for axes the table does not have are ignored.
+	 */
+	void Eval (double x0, double x1, double x2, double *val) const;
+	inline void Eval (double x0, double x1, double *val) const { Eval (x0, x1, 0.0, val); }
+	inline void Eval (double x0, double *val) const { Eval (x0, 0.0, 0.0, val); }
+
+private:
+	AeroTable (const AeroTable&);             // not copyable
+	AeroTable &operator= (const AeroTable&);
+
+	struct Axis {
+		DWORD n;          // number of nodes
+		double *x;        // node coordinates
+		double *ih;       // inverse node intervals
+		double istep;     // inverse node interval of a uniform axis (0: not uniform)
+		DWORD Find (double v, double &t) const;
+	};
+
+	void Segments (const double *data); // compute the first-axis segment polynomials
+
+	DWORD ndim;           // number of axes
+	DWORD nval;           // values per node
+	DWORD flags;          // interpolation flags
+	double period;        // period of a periodic first axis
+	Axis ax[AEROTABLE_MAXDIM];
+	double *coef;         // segment polynomials: 4 coefficients per value,
+	                      // segment and grid line of the first axis
+};
+
+#endif // !__AEROTABLE_H
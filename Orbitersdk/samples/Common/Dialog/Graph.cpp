@@ -19,11 +19,11 @@ using namespace std;
 
 static COLORREF plotcol[MAXPLOT] = {0x0000ff, 0xff0000, 0x00ff00};
 
-Graph::Graph (int _nplot): nplot(_nplot)
+Graph::Graph (int _nplot, int _ndata): nplot(_nplot), capacity(_ndata > 2 ? _ndata : 2)
 {
-	data = new float*[nplot];
-	for (int i = 0; i < nplot; i++)
-		data[i] = new float[NDATA];
+	data = new float[capacity*nplot];
+	qmin = new MonoQueue (capacity, false);
+	qmax = new MonoQueue (capacity, true);
 	ResetData();
 	title = 0;
 	xlabel = 0;
@@ -34,9 +34,9 @@ Graph::Graph (int _nplot): nplot(_nplot)
 
 Graph::~Graph()
 {
-	for (int i = 0; i < nplot; i++)
-		delete []data[i];
 	delete []data;
+	delete qmin;
+	delete qmax;
 
 	if (title) delete []title;
 	if (xlabel) delete []xlabel;
@@ -107,26 +107,46 @@ void Graph::SetLegend (const char *_legend)
 void Graph::ResetData ()
 {
 	ndata = idx = 0;
+	seq = 0;
+	qmin->Reset();
+	qmax->Reset();
 	vmin = vmax = data_tickmin = 0.0;
 	data_dtick = 1.0;
 }
 
 void Graph::AppendDataPoint (float val)
 {
-	data[0][idx] = val;
-	idx = (idx+1)%NDATA;
-	if (ndata < NDATA) ndata++;
-	float vmn = vmin, vmx = vmax;
-	SetAutoRange ();
-	if (vmn != vmin || vmx != vmax) SetAutoTicks();
+	float *d = data + idx*nplot;
+	for (int p = 0; p < nplot; p++)
+		d[p] = val;
+	Append();
 }
 
 void Graph::AppendDataPoints (float *val)
 {
-	for (int p = 0; p < nplot; p++)
-		data[p][idx] = val[p];
-	idx = (idx+1)%NDATA;
-	if (ndata < NDATA) ndata++;
+	memcpy (data + idx*nplot, val, nplot*sizeof(float));
+	Append();
+}
+
+void Graph::Append ()
+{
+	// update the window extrema with the new sample
+	const float *d = data + idx*nplot;
+	float dmin = d[0], dmax = d[0];
+	for (int p = 1; p < nplot; p++) {
+		if (d[p] < dmin) dmin = d[p];
+		else if (d[p] > dmax) dmax = d[p];
+	}
+	qmin->Push (seq, dmin);
+	qmax->Push (seq, dmax);
+	seq++;
+	if (seq > (DWORD)capacity) {
+		qmin->Expire (seq-capacity);
+		qmax->Expire (seq-capacity);
+	}
+
+	idx = (idx+1)%capacity;
+	if (ndata < capacity) ndata++;
 	float vmn = vmin, vmx = vmax;
 	SetAutoRange ();
 	if (vmn != vmin || vmx != vmax) SetAutoTicks();
@@ -134,17 +154,8 @@ void Graph::AppendDataPoints (float *val)
 
 void Graph::SetAutoRange ()
 {
-	int p, i;
-
-	vmin = (ndata ? data[0][0] : 0.0f);
-	vmax = (ndata ? data[0][0] : 0.0f);
-
-	for (p = 0; p < nplot; p++) {
-		for (i = 0; i < ndata; i++) {
-			if (data[p][i] < vmin) vmin = data[p][i];
-			if (data[p][i] > vmax) vmax = data[p][i];
-		}
-	}
+	vmin = (ndata ? qmin->Front() : 0.0f);
+	vmax = (ndata ? qmax->Front() : 0.0f);
 
 	if (vmax-vmin < 1e-6) vmin -= 0.5f, vmax += 0.5f;
 }
@@ -211,11 +222,40 @@ void Graph::Refresh (HDC hDC, int w, int h)
 		// draw data
 		for (p = 0; p < nplot; p++) {
 			SelectObject (hDC, gdi.pen[(p%MAXPLOT)+2]);
-			int j, i = idx-1; if (i < 0) i += NDATA;
-			MoveToEx (hDC, x1, y0 - (int)((data[p][i]-vmin)*ys+0.5), NULL);
-			for (j = 1; j < ndata; j++) {
-				i = idx-j-1; if (i < 0) i += NDATA;
-				LineTo (hDC, x1 - (dx*j)/NDATA, y0 - (int)((data[p][i]-vmin)*ys+0.5));
+			int j, i = idx-1; if (i < 0) i += capacity;
+			MoveToEx (hDC, x1, y0 - (int)((data[i*nplot+p]-vmin)*ys+0.5), NULL);
+			if (capacity <= dx) {
+				for (j = 1; j < ndata; j++) {
+					i = idx-j-1; if (i < 0) i += capacity;
+					LineTo (hDC, x1 - (dx*j)/capacity, y0 - (int)((data[i*nplot+p]-vmin)*ys+0.5));
+				}
+			} else {
+				// more samples than pixel columns: draw the first, min, max and
+				// last sample of each column
+				float v = 0.0f, vfirst = 0.0f, vlast = 0.0f, vlo = 0.0f, vhi = 0.0f;
+				int x, xc = -1;
+				for (j = 1; j <= ndata; j++) {
+					if (j < ndata) {
+						i = idx-j-1; if (i < 0) i += capacity;
+						v = data[i*nplot+p];
+						x = x1 - (int)(((double)dx*j)/capacity);
+					} else x = -1; // flush last column
+					if (x != xc) {
+						if (xc >= 0) {
+							LineTo (hDC, xc, y0 - (int)((vfirst-vmin)*ys+0.5));
+							LineTo (hDC, xc, y0 - (int)((vlo-vmin)*ys+0.5));
+							LineTo (hDC, xc, y0 - (int)((vhi-vmin)*ys+0.5));
+							LineTo (hDC, xc, y0 - (int)((vlast-vmin)*ys+0.5));
+						}
+						if (x < 0) break;
+						xc = x;
+						vfirst = vlast = vlo = vhi = v;
+					} else {
+						vlast = v;
+						if (v < vlo) vlo = v;
+						else if (v > vhi) vhi = v;
+					}
+				}
 			}
 		}
 	}
@@ -250,4 +290,47 @@ void Graph::Refresh (HDC hDC, int w, int h)
 	SelectObject (hDC, pfont);
 }
 
-GDIres Graph::gdi = {0,0,0};
\ No newline at end of file
+GDIres Graph::gdi = {0,0,0};
+
+// ==============================================================
+// class Graph::MonoQueue
+
+Graph::MonoQueue::MonoQueue (int _size, bool _ismax): size(_size), ismax(_ismax)
+{
+	q = new Entry[size];
+	Reset();
+}
+
+Graph::MonoQueue::~MonoQueue ()
+{
+	delete []q;
+}
+
+void Graph::MonoQueue::Reset ()
+{
+	head = count = 0;
+}
+
+void Graph::MonoQueue::Push (DWORD seq, float v)
+{
+	// drop entries that can no longer become the window extremum
+	while (count) {
+		float vb = q[(head+count-1)%size].v;
+		if (ismax ? vb > v : vb < v) break;
+		count--;
+	}
+	// the queue never holds more entries than the window length
+	if (count == size) head = (head+1)%size, count--;
+	Entry &e = q[(head+count)%size];
+	e.seq = seq;
+	e.v = v;
+	count++;
+}
+
+void Graph::MonoQueue::Expire (DWORD seq0)
+{
+	// remove entries older than seq0 (the front entry is the oldest);
+	// the newest entry is always retained
+	while (count > 1 && (int)(q[head].seq-seq0) < 0)
+		head = (head+1)%size, count--;
+}
\ No newline at end of file
@@ -14,7 +14,7 @@
 #include "windows.h"
 
 const int MAXPLOT = 3;
-const int NDATA = 200;
+const int NDATA = 200;   // default number of samples per plot
 
 struct GDIres {
 	HFONT font[2];
@@ -24,7 +24,15 @@ struct GDIres {
 
 class Graph {
 public:
-	Graph (int _nplot = 1);
+	/**
+	 * \brief Create a graph.
+	 * \param _nplot number of plots
+	 * \param _ndata number of samples retained per plot
+	 * \note Appending a sample is O(1) independent of the number of retained
+	 *   samples. When the graph is drawn, samples are decimated to one min/max
+	 *   pair per pixel column.
+	 */
+	Graph (int _nplot = 1, int _ndata = NDATA);
 	~Graph();
 	static void InitGDI ();
 	static void FreeGDI ();
@@ -36,14 +44,42 @@ public:
 	void AppendDataPoint (float val);
 	void AppendDataPoints (float *val);
 	void Refresh (HDC hDC, int w, int h);
+	inline int Capacity () const { return capacity; }
 
 protected:
 	void SetAutoRange ();
 	void SetAutoTicks ();
 
 private:
+	void Append ();
+
+	/**
+	 * \brief Monotonic queue of sample extrema for sliding-window min/max
+	 *   tracking.
+	 * \note Values are kept in increasing (min queue) or decreasing (max queue)
+	 *   order, so the front entry is the extremum of the current window.
+	 */
+	class MonoQueue {
+	public:
+		MonoQueue (int _size, bool _ismax);
+		~MonoQueue ();
+		void Reset ();
+		void Push (DWORD seq, float v);
+		void Expire (DWORD seq0);
+		inline float Front () const { return q[head].v; }
+	private:
+		struct Entry { DWORD seq; float v; };
+		Entry *q;
+		int size, head, count;
+		bool ismax;
+	};
+
 	int nplot;
-	float **data;
+	int capacity;        // samples per plot
+	float *data;         // ring buffer: capacity samples x nplot values
+	MonoQueue *qmin;     // window minimum over all plots
+	MonoQueue *qmax;     // window maximum over all plots
+	DWORD seq;           // number of samples appended since reset
 	float vmin, vmax;
 	float data_tickscale;
 	float data_dtick;
@@ -0,0 +1,222 @@
+// ==============================================================
+//                 ORBITER MODULE: Framerate
+//                  Part of the ORBITER SDK
+//          Copyright (C) 2003-2015 Martin Schweiger
+//                   All rights reserved
+//
+// FrameProf.h
+// Client interface for named frame profiler scopes.
+//
+// Any module can time sections of its code and have them show up
+// in the frame trace exported by the Performance Meter (Framerate
+// plugin). The functions are resolved from the Framerate module at
+// runtime, so modules do not need to link against it. If the
+// Framerate plugin is not active, all calls are no-ops. The module
+// is looked up on each call, so clients keep working when the
+// plugin is activated, deactivated or reloaded while they are
+// loaded.
+//
+// Usage:
+//   static FrameProfScopeRef scope ("MyModule::Update");
+//   ...
+//   {
+//      FrameProfScope fps (scope);  // timed until end of block
+//      ...
+//   }
+//
+// Scopes can be recorded from any thread. Recording does not
+// take a lock.
+//
+// Simulation callbacks (oapi::Module and VESSEL step callbacks) are
+// instrumented with the FRAMEPROF_CALLBACK macro at the top of the
+// callback body, which attributes the callback cost to the named
+// module or vessel class in the performance meter's callback view.
+// Accumulated costs can be queried with FrameProfQuery.
+// ==============================================================
+
+#ifndef __FRAMEPROF_H
+#define __FRAMEPROF_H
+
+#include <windows.h>
+#include <string.h>
+
+#define FRAMEPROF_MODULE "Framerate.dll"
+
+/**
+ * \brief Accumulated cost of a profiler scope over an evaluation window
+ */
+struct FRAMEPROF_SCOPESTATS {
+	char   name[64];     ///< scope name
+	DWORD  calls;        ///< number of calls in the window
+	double total;        ///< accumulated wall time [ms]
+	double max;          ///< longest single call [ms]
+	double perframe;     ///< mean wall time per frame [ms]
+	double share;        ///< fraction of the total frame time in the window
+};
+
+/**
+ * \brief Entry points of the Framerate module
+ * \note Resolved by FrameProfLink. The session identifier changes each time
+ *   the profiler is created, i.e. whenever the Framerate module is loaded.
+ */
+struct FRAMEPROF_LINK {
+	int   (*reg)(const char*);                         ///< fpRegisterScope
+	void  (*rec)(int, LONGLONG);                       ///< fpRecordScope
+	int   (*query)(FRAMEPROF_SCOPESTATS*, int, double); ///< fpQueryScopes
+	DWORD (*session)();                                ///< fpSession
+};
+
+/**
+ * \brief Returns the Framerate entry points, or NULL if the module is not loaded.
+ * \note The module is looked up on every call, so profiling starts when the
+ *   Framerate plugin is activated and stops when it is deactivated. The entry
+ *   points are resolved again whenever the module handle changes.
+ */
+inline const FRAMEPROF_LINK *FrameProfLink ()
+{
+	static FRAMEPROF_LINK link;
+	static HMODULE volatile hLink = 0;
+	HMODULE hModule = GetModuleHandle (FRAMEPROF_MODULE);
+	if (!hModule) return 0;
+	if (hModule != hLink) {
+		FRAMEPROF_LINK l;
+		l.reg     = (int(*)(const char*))GetProcAddress (hModule, "fpRegisterScope");
+		l.rec     = (void(*)(int, LONGLONG))GetProcAddress (hModule, "fpRecordScope");
+		l.query   = (int(*)(FRAMEPROF_SCOPESTATS*, int, double))GetProcAddress (hModule, "fpQueryScopes");
+		l.session = (DWORD(*)())GetProcAddress (hModule, "fpSession");
+		if (!l.reg || !l.rec || !l.query || !l.session) return 0;
+		link = l;
+		hLink = hModule;   // publish after the entry points
+	}
+	return &link;
+}
+
+/**
+ * \brief Register a named profiler scope.
+ * \param name scope name (copied)
+ * \return scope identifier, or -1 if the profiler is not available
+ * \note Registering an existing name returns the existing identifier.
+ * \note The identifier is only valid until the Framerate module is
+ *   unloaded. Modules that record scopes should use FrameProfScopeRef,
+ *   which registers the scope again with each new profiler session.
+ */
+inline int FrameProfRegisterScope (const char *name)
+{
+	const FRAMEPROF_LINK *link = FrameProfLink ();
+	return (link ? link->reg (name) : -1);
+}
+
+/**
+ * \brief Returns the current profiler timestamp (performance counter ticks).
+ */
+inline LONGLONG FrameProfTime ()
+{
+	LARGE_INTEGER t;
+	QueryPerformanceCounter (&t);
+	return t.QuadPart;
+}
+
+/**
+ * \brief Record a completed scope.
+ * \param scope scope identifier returned by FrameProfRegisterScope
+ * \param t0 scope start time, as returned by FrameProfTime
+ * \note The scope end time is the time of the call.
+ */
+inline void FrameProfRecord (int scope, LONGLONG t0)
+{
+	if (scope < 0) return;
+	const FRAMEPROF_LINK *link = FrameProfLink ();
+	if (link) link->rec (scope, t0);
+}
+
+/**
+ * \brief Query the accumulated cost of all profiler scopes.
+ * \param stats array receiving up to nmax entries, in order of decreasing cost
+ * \param nmax size of the stats array
+ * \param window evaluation window ending at the current time [s]
+ * \return number of entries written, or -1 if the profiler is not available
+ */
+inline int FrameProfQuery (FRAMEPROF_SCOPESTATS *stats, int nmax, double window = 1.0)
+{
+	const FRAMEPROF_LINK *link = FrameProfLink ();
+	return (link ? link->query (stats, nmax, window) : -1);
+}
+
+/**
+ * \brief A named profiler scope that follows the Framerate module.
+ * \note The scope is registered when it is first used with a profiler
+ *   session, and again whenever the Framerate module has been reloaded,
+ *   so an identifier of an earlier session is never recorded.
+ */
+class FrameProfScopeRef {
+public:
+	FrameProfScopeRef (const char *_name = 0): id(-1), session(0) { SetName (_name); }
+
+	/**
+	 * \brief Set the scope name.
+	 * \param _name scope name (copied, truncated to 63 characters)
+	 */
+	void SetName (const char *_name)
+	{
+		name[0] = '\0';
+		if (_name) strncat (name, _name, sizeof(name)-1);
+		id = -1;
+		session = 0;
+	}
+
+	/**
+	 * \brief Returns the scope identifier in the current profiler session,
+	 *   or -1 if the profiler is not available.
+	 */
+	int Id ()
+	{
+		const FRAMEPROF_LINK *link = FrameProfLink ();
+		DWORD s = (link && name[0] ? link->session() : 0);
+		if (s != session) {
+			id = (s ? link->reg (name) : -1);
+			session = s;
+		}
+		return id;
+	}
+
+	/**
+	 * \brief Record a completed scope.
+	 * \param t0 scope start time, as returned by FrameProfTime
+	 * \note Dropped if the profiler session has changed since the last Id() call.
+	 */
+	void Record (LONGLONG t0) const
+	{
+		const FRAMEPROF_LINK *link = FrameProfLink ();
+		if (link && id >= 0 && link->session() == session)
+			link->rec (id, t0);
+	}
+
+private:
+	char name[64];
+	int id;             // identifier in the profiler session
+	DWORD session;      // profiler session of id (0: none)
+};
+
+/**
+ * \brief Records the lifetime of the object as a profiler scope.
+ */
+class FrameProfScope {
+public:
+	FrameProfScope (FrameProfScopeRef &_ref): ref(_ref), t0(_ref.Id() >= 0 ? FrameProfTime() : 0) {}
+	~FrameProfScope () { if (t0) ref.Record (t0); }
+
+private:
+	FrameProfScopeRef &ref;
+	LONGLONG t0;
+};
+
+/**
+ * \brief Time the remainder of the enclosing block as a named scope.
+ * \param name scope name (string literal), e.g. "DeltaGlider::clbkPreStep"
+ * \note The scope is registered on first execution with each profiler session.
+ */
+#define FRAMEPROF_CALLBACK(name) \
+	static FrameProfScopeRef _fp_scope (name); \
+	FrameProfScope _fp_timer (_fp_scope)
+
+#endif // !__FRAMEPROF_H
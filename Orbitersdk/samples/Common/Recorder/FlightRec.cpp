@@ -0,0 +1,631 @@
+// ==============================================================
+//              ORBITER MODULE: Common recorder tools
+//                  Part of the ORBITER SDK
+//          Copyright (C) 2001-2015 Martin Schweiger
+//                   All rights reserved
+//
+// FlightRec.cpp
+// Implementation for classes FlightRecWriter and FlightRecReader:
+//   Binary flight recorder streams
+// ==============================================================
+
+#include "FlightRec.h"
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+#include <float.h>
+
+static const char FLIGHTREC_MAGIC[8] = "ORBREC";
+
+static DWORD NumStreamData (DWORD stream)
+{
+	switch (stream) {
+	case FRSTREAM_POS: return 6;
+	case FRSTREAM_ATT: return 3;
+	default:           return 0;
+	}
+}
+
+static void RecordSizes (DWORD stream, DWORD flags, DWORD &keysize, DWORD &recsize)
+{
+	DWORD ndata = NumStreamData (stream);
+	if (stream == FRSTREAM_EVENT) {
+		keysize = recsize = sizeof(FLIGHTREC_EVENT);
+	} else {
+		keysize = (1+ndata)*sizeof(double);
+		recsize = (flags & FLIGHTREC_DELTA ? sizeof(double) + ndata*sizeof(float) : keysize);
+	}
+}
+
+// true if n elements of elsize bytes at file offset ofs lie behind the
+// header and within a file of the given size (without overflow)
+static bool InFile (DWORD ofs, DWORD n, DWORD elsize, DWORD size)
+{
+	return ofs >= sizeof(FLIGHTREC_HEADER) && ofs <= size && n <= (size-ofs)/elsize;
+}
+
+// ==============================================================
+
+FlightRecWriter::FlightRecWriter ()
+{
+	f = NULL;
+	ok = false;
+}
+
+// --------------------------------------------------------------
+
+FlightRecWriter::~FlightRecWriter ()
+{
+	if (f) Close ();
+}
+
+// --------------------------------------------------------------
+
+bool FlightRecWriter::Open (const char *fname, DWORD stream, DWORD flags, DWORD _blocksize)
+{
+	if (f) Close ();
+	if (!(f = fopen (fname, "wb"))) return false;
+	ok = true;
+
+	memset (&hdr, 0, sizeof(FLIGHTREC_HEADER));
+	memcpy (hdr.magic, FLIGHTREC_MAGIC, 8);
+	hdr.version = FLIGHTREC_VERSION;
+	hdr.stream  = stream;
+	hdr.ndata   = NumStreamData (stream);
+	hdr.flags   = (stream == FRSTREAM_EVENT ? 0 : flags & FLIGHTREC_DELTA);
+	RecordSizes (stream, hdr.flags, hdr.keysize, hdr.recsize);
+	blocksize = max (_blocksize, (DWORD)1);
+
+	memset (&curframe, 0, sizeof(FLIGHTREC_FRAME));
+	newframe = true;
+	buf.clear();
+	block.clear();
+	frame.clear();
+	strpool.clear();
+
+	// placeholder header, rewritten on Close
+	Write (&hdr, sizeof(FLIGHTREC_HEADER));
+	return ok;
+}
+
+// --------------------------------------------------------------
+
+bool FlightRecWriter::Close ()
+{
+	if (!f) return false;
+
+	FlushBlock ();
+
+	hdr.nblock = block.size();
+	hdr.nframe = frame.size();
+	hdr.strsize = strpool.size();
+	hdr.blockofs = ftell (f);
+	if (hdr.nblock) Write (&block[0], hdr.nblock*sizeof(FLIGHTREC_BLOCK));
+	hdr.frameofs = ftell (f);
+	if (hdr.nframe) Write (&frame[0], hdr.nframe*sizeof(FLIGHTREC_FRAME));
+	hdr.strofs = ftell (f);
+	if (hdr.strsize) Write (&strpool[0], hdr.strsize);
+
+	fseek (f, 0, SEEK_SET);
+	Write (&hdr, sizeof(FLIGHTREC_HEADER));
+	if (fclose (f)) ok = false;
+	f = NULL;
+	return ok;
+}
+
+// --------------------------------------------------------------
+
+void FlightRecWriter::SetStartMJD (double mjd)
+{
+	hdr.startmjd = mjd;
+}
+
+// --------------------------------------------------------------
+
+void FlightRecWriter::SetFrame (const char *ref, const char *frm, const char *crd)
+{
+	FLIGHTREC_FRAME fr = curframe;
+	if (ref) strncpy (fr.ref, ref, sizeof(fr.ref)-1);
+	if (frm) strncpy (fr.frm, frm, sizeof(fr.frm)-1);
+	if (crd) strncpy (fr.crd, crd, sizeof(fr.crd)-1);
+	if (memcmp (&fr, &curframe, sizeof(FLIGHTREC_FRAME))) {
+		FlushBlock ();
+		curframe = fr;
+		newframe = true;
+	}
+}
+
+// --------------------------------------------------------------
+
+void FlightRecWriter::AddSample (double t, const double *data)
+{
+	if (!f || hdr.stream == FRSTREAM_EVENT) return;
+
+	buf.push_back (t);
+	buf.insert (buf.end(), data, data+hdr.ndata);
+	if (buf.size() >= blocksize*(1+hdr.ndata))
+		FlushBlock ();
+}
+
+// --------------------------------------------------------------
+
+void FlightRecWriter::AddEvent (double t, const char *event)
+{
+	if (!f || hdr.stream != FRSTREAM_EVENT) return;
+
+	// events are buffered as (time, string pool offset) pairs
+	buf.push_back (t);
+	buf.push_back ((double)strpool.size());
+	strpool.insert (strpool.end(), event, event+strlen(event)+1);
+	if (buf.size() >= blocksize*2)
+		FlushBlock ();
+}
+
+// --------------------------------------------------------------
+
+void FlightRecWriter::FlushBlock ()
+{
+	DWORD i, j, stride = (hdr.stream == FRSTREAM_EVENT ? 2 : 1+hdr.ndata);
+	DWORD n = buf.size()/stride;
+	if (!n) return;
+
+	if (newframe) {
+		frame.push_back (curframe);
+		newframe = false;
+	}
+
+	FLIGHTREC_BLOCK b;
+	b.t0    = buf[0];
+	b.t1    = buf[(n-1)*stride];
+	b.ofs   = ftell (f);
+	b.rec0  = hdr.nrec;
+	b.nrec  = n;
+	b.frame = frame.size()-1;
+	block.push_back (b);
+
+	if (hdr.stream == FRSTREAM_EVENT) {
+		for (i = 0; i < n; i++) {
+			FLIGHTREC_EVENT ev;
+			ev.t   = buf[i*2];
+			ev.ofs = (DWORD)buf[i*2+1];
+			ev.len = strlen (&strpool[ev.ofs]);
+			Write (&ev, sizeof(FLIGHTREC_EVENT));
+		}
+	} else if (hdr.flags & FLIGHTREC_DELTA) {
+		// key record in full precision, followed by offsets from the key.
+		// Sample times are kept in full precision to preserve their order.
+		Write (&buf[0], hdr.keysize);
+		float dv[FLIGHTREC_MAXDATA];
+		for (i = 1; i < n; i++) {
+			for (j = 1; j < stride; j++)
+				dv[j-1] = (float)(buf[i*stride+j] - buf[j]);
+			Write (&buf[i*stride], sizeof(double));
+			Write (dv, hdr.ndata*sizeof(float));
+		}
+	} else {
+		Write (&buf[0], n*hdr.recsize);
+	}
+
+	hdr.nrec += n;
+	buf.clear();
+}
+
+// --------------------------------------------------------------
+
+void FlightRecWriter::Write (const void *data, DWORD size)
+{
+	if (fwrite (data, 1, size, f) != size)
+		ok = false;
+}
+
+// ==============================================================
+
+FlightRecReader::FlightRecReader ()
+{
+	hFile = INVALID_HANDLE_VALUE;
+	hMap  = NULL;
+	base  = NULL;
+	size  = 0;
+	hdr   = NULL;
+	block = NULL;
+	frame = NULL;
+	strpool = NULL;
+}
+
+// --------------------------------------------------------------
+
+FlightRecReader::~FlightRecReader ()
+{
+	Close ();
+}
+
+// --------------------------------------------------------------
+
+bool FlightRecReader::Open (const char *fname)
+{
+	Close ();
+
+	hFile = CreateFile (fname, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) return false;
+	size = GetFileSize (hFile, NULL);
+	if (size >= sizeof(FLIGHTREC_HEADER) && (hMap = CreateFileMapping (hFile, NULL, PAGE_READONLY, 0, 0, NULL)))
+		base = (const BYTE*)MapViewOfFile (hMap, FILE_MAP_READ, 0, 0, 0);
+	if (!base) {
+		Close ();
+		return false;
+	}
+
+	// validate the header and table locations. A stream without samples
+	// (nrec = nblock = 0) is valid; it may also have no frame descriptor.
+	const FLIGHTREC_HEADER *h = (const FLIGHTREC_HEADER*)base;
+	DWORD keysize, recsize;
+	RecordSizes (h->stream, h->flags, keysize, recsize);
+	if (memcmp (h->magic, FLIGHTREC_MAGIC, 8) || h->version != FLIGHTREC_VERSION ||
+		h->stream < FRSTREAM_POS || h->stream > FRSTREAM_EVENT ||
+		h->flags & ~FLIGHTREC_DELTA || (h->stream == FRSTREAM_EVENT && h->flags) ||
+		h->ndata != NumStreamData (h->stream) ||
+		h->keysize != keysize || h->recsize != recsize ||
+		(h->nblock ? !h->nframe : h->nrec != 0) ||
+		!InFile (h->blockofs, h->nblock, sizeof(FLIGHTREC_BLOCK), size) ||
+		!InFile (h->frameofs, h->nframe, sizeof(FLIGHTREC_FRAME), size) ||
+		!InFile (h->strofs, h->strsize, 1, size)) {
+		Close ();
+		return false;
+	}
+
+	// validate the block table: consecutive sample ranges in time order,
+	// records within the file, valid frame indices
+	const FLIGHTREC_BLOCK *blk = (const FLIGHTREC_BLOCK*)(base + h->blockofs);
+	DWORD i, nrec = 0;
+	for (i = 0; i < h->nblock; i++) {
+		const FLIGHTREC_BLOCK *b = blk+i;
+		if (!b->nrec || b->nrec > ~nrec || b->rec0 != nrec || b->frame >= h->nframe ||
+			!InFile (b->ofs, 1, h->keysize, size) ||
+			!InFile (b->ofs + h->keysize, b->nrec-1, h->recsize, size) ||
+			!(b->t0 <= b->t1) || (i && b->t0 < blk[i-1].t1)) {
+			Close ();
+			return false;
+		}
+		nrec += b->nrec;
+	}
+	if (nrec != h->nrec) {
+		Close ();
+		return false;
+	}
+
+	hdr     = h;
+	block   = blk;
+	frame   = (const FLIGHTREC_FRAME*)(base + hdr->frameofs);
+	strpool = (const char*)(base + hdr->strofs);
+	return true;
+}
+
+// --------------------------------------------------------------
+
+void FlightRecReader::Close ()
+{
+	if (base) UnmapViewOfFile (base);
+	if (hMap) CloseHandle (hMap);
+	if (hFile != INVALID_HANDLE_VALUE) CloseHandle (hFile);
+	hFile = INVALID_HANDLE_VALUE;
+	hMap  = NULL;
+	base  = NULL;
+	size  = 0;
+	hdr   = NULL;
+	block = NULL;
+	frame = NULL;
+	strpool = NULL;
+}
+
+// --------------------------------------------------------------
+
+double FlightRecReader::T0 () const
+{
+	return (hdr->nblock ? block[0].t0 : 0.0);
+}
+
+// --------------------------------------------------------------
+
+double FlightRecReader::T1 () const
+{
+	return (hdr->nblock ? block[hdr->nblock-1].t1 : 0.0);
+}
+
+// --------------------------------------------------------------
+
+DWORD FlightRecReader::BlockOf (DWORD i) const
+{
+	// last block with rec0 <= i
+	DWORD lo = 0, hi = hdr->nblock;
+	while (hi-lo > 1) {
+		DWORD mid = (lo+hi)/2;
+		if (block[mid].rec0 <= i) lo = mid;
+		else                      hi = mid;
+	}
+	return lo;
+}
+
+// --------------------------------------------------------------
+
+const BYTE *FlightRecReader::Record (const FLIGHTREC_BLOCK *b, DWORD i) const
+{
+	return base + b->ofs + (i ? hdr->keysize + (i-1)*hdr->recsize : 0);
+}
+
+// --------------------------------------------------------------
+
+DWORD FlightRecReader::Find (double t) const
+{
+	if (!hdr->nblock) return 0;
+
+	// last block with t0 <= t
+	DWORD lo = 0, hi = hdr->nblock;
+	while (hi-lo > 1) {
+		DWORD mid = (lo+hi)/2;
+		if (block[mid].t0 <= t) lo = mid;
+		else                    hi = mid;
+	}
+	const FLIGHTREC_BLOCK *b = block+lo;
+
+	// last sample in block with time <= t
+	DWORD i0 = 0, i1 = b->nrec;
+	while (i1-i0 > 1) {
+		DWORD mid = (i0+i1)/2;
+		if (Time (b->rec0+mid) <= t) i0 = mid;
+		else                         i1 = mid;
+	}
+	return b->rec0 + i0;
+}
+
+// --------------------------------------------------------------
+
+DWORD FlightRecReader::KeyOf (DWORD i) const
+{
+	return block[BlockOf (i)].rec0;
+}
+
+// --------------------------------------------------------------
+
+double FlightRecReader::Time (DWORD i) const
+{
+	const FLIGHTREC_BLOCK *b = block + BlockOf (i);
+	i -= b->rec0;
+	return *(const double*)Record (b, i);
+}
+
+// --------------------------------------------------------------
+
+double FlightRecReader::Sample (DWORD i, double *data) const
+{
+	const FLIGHTREC_BLOCK *b = block + BlockOf (i);
+	i -= b->rec0;
+	const BYTE *rec = Record (b, i);
+	DWORD j;
+
+	if (hdr->stream == FRSTREAM_EVENT) {
+		return ((const FLIGHTREC_EVENT*)rec)->t;
+	} else if (i && (hdr->flags & FLIGHTREC_DELTA)) {
+		const double *key = (const double*)Record (b, 0);
+		const float *d = (const float*)(rec + sizeof(double));
+		for (j = 0; j < hdr->ndata; j++)
+			data[j] = key[j+1] + d[j];
+		return *(const double*)rec;
+	} else {
+		const double *d = (const double*)rec;
+		for (j = 0; j < hdr->ndata; j++)
+			data[j] = d[j+1];
+		return d[0];
+	}
+}
+
+// --------------------------------------------------------------
+
+const char *FlightRecReader::Event (DWORD i, DWORD *len) const
+{
+	if (hdr->stream != FRSTREAM_EVENT) return NULL;
+	const FLIGHTREC_BLOCK *b = block + BlockOf (i);
+	const FLIGHTREC_EVENT *ev = (const FLIGHTREC_EVENT*)Record (b, i - b->rec0);
+	if (ev->ofs >= hdr->strsize || ev->len >= hdr->strsize - ev->ofs || strpool[ev->ofs + ev->len])
+		return NULL;
+	if (len) *len = ev->len;
+	return strpool + ev->ofs;
+}
+
+// --------------------------------------------------------------
+
+const FLIGHTREC_FRAME *FlightRecReader::Frame (DWORD i) const
+{
+	return frame + block[BlockOf (i)].frame;
+}
+
+// ==============================================================
+// Text stream parser, shared by FlightRecConvert and FlightRecVerify
+
+#define TXT_SAMPLE 0    // sample or event line
+#define TXT_MJD    1    // STARTMJD header line
+#define TXT_REF    2    // REF header line
+#define TXT_FRM    3    // FRM header line
+#define TXT_CRD    4    // CRD header line
+
+struct TEXTLINE {
+	int type;                       // line type (TXT_xxx)
+	double t;                       // sample time [s], or start date [MJD]
+	double data[FLIGHTREC_MAXDATA]; // sample values
+	const char *str;                // event string, or REF/FRM/CRD value
+};
+
+static DWORD StreamOf (const char *fname)
+{
+	const char *ext = strrchr (fname, '.');
+	if (ext) {
+		if      (!_stricmp (ext, ".pos")) return FRSTREAM_POS;
+		else if (!_stricmp (ext, ".att")) return FRSTREAM_ATT;
+	}
+	return FRSTREAM_EVENT;
+}
+
+// Read the next relevant line of a text stream into tl. Blank lines,
+// non-sample lines and incomplete samples are skipped.
+// Returns false at the end of the file.
+
+static bool ReadTextLine (FILE *f, DWORD stream, char *line, int len, TEXTLINE &tl)
+{
+	char *pc, *pe;
+	DWORD i, ndata = NumStreamData (stream);
+
+	while (fgets (line, len, f)) {
+		for (pc = line + strlen(line); pc > line && isspace ((unsigned char)pc[-1]); pc--);
+		*pc = '\0';
+		for (pc = line; isspace ((unsigned char)*pc); pc++);
+		if (!*pc) continue;
+
+		if (!_strnicmp (pc, "STARTMJD", 8)) {
+			tl.type = TXT_MJD;
+			tl.t = atof (pc+8);
+			return true;
+		} else if (!_strnicmp (pc, "REF", 3) && isspace ((unsigned char)pc[3])) {
+			tl.type = TXT_REF;
+		} else if (!_strnicmp (pc, "FRM", 3) && isspace ((unsigned char)pc[3])) {
+			tl.type = TXT_FRM;
+		} else if (!_strnicmp (pc, "CRD", 3) && isspace ((unsigned char)pc[3])) {
+			tl.type = TXT_CRD;
+		} else {
+			tl.t = strtod (pc, &pe);
+			if (pe == pc) continue; // not a sample line
+			if (stream == FRSTREAM_EVENT) {
+				for (pc = pe; isspace ((unsigned char)*pc); pc++);
+				tl.str = pc;
+			} else {
+				for (i = 0; i < ndata; i++) {
+					tl.data[i] = strtod (pc = pe, &pe);
+					if (pe == pc) break;
+				}
+				if (i < ndata) continue; // incomplete sample
+			}
+			tl.type = TXT_SAMPLE;
+			return true;
+		}
+		// value of a REF/FRM/CRD line
+		for (pc += 3; isspace ((unsigned char)*pc); pc++);
+		tl.str = pc;
+		return true;
+	}
+	return false;
+}
+
+// ==============================================================
+
+int FlightRecConvert (const char *src, const char *dst, DWORD flags)
+{
+	DWORD stream = StreamOf (src);
+	FILE *f = fopen (src, "rt");
+	if (!f) return -1;
+
+	FlightRecWriter rec;
+	if (!rec.Open (dst, stream, flags)) {
+		fclose (f);
+		return -1;
+	}
+
+	char line[1024];
+	TEXTLINE tl;
+	int n = 0;
+	bool mjdset = false;
+
+	while (ReadTextLine (f, stream, line, 1024, tl)) {
+		switch (tl.type) {
+		case TXT_MJD:
+			// repeated with every header group; only the first one is kept
+			if (!mjdset) {
+				rec.SetStartMJD (tl.t);
+				mjdset = true;
+			}
+			break;
+		case TXT_REF:
+			rec.SetFrame (tl.str, NULL, NULL);
+			break;
+		case TXT_FRM:
+			rec.SetFrame (NULL, tl.str, NULL);
+			break;
+		case TXT_CRD:
+			rec.SetFrame (NULL, NULL, tl.str);
+			break;
+		case TXT_SAMPLE:
+			if (stream == FRSTREAM_EVENT) rec.AddEvent (tl.t, tl.str);
+			else                          rec.AddSample (tl.t, tl.data);
+			n++;
+			break;
+		}
+	}
+	fclose (f);
+
+	return (rec.Close() ? n : -1);
+}
+
+// --------------------------------------------------------------
+
+int FlightRecVerify (const char *src, const char *dst)
+{
+	DWORD stream = StreamOf (src);
+	FlightRecReader rec;
+	if (!rec.Open (dst) || rec.Stream() != stream) return -1;
+	FILE *f = fopen (src, "rt");
+	if (!f) return -1;
+
+	char line[1024];
+	TEXTLINE tl;
+	FLIGHTREC_FRAME fr;   // current frame, as stored by the writer
+	double data[FLIGHTREC_MAXDATA], key[FLIGHTREC_MAXDATA];
+	DWORD i = 0, j, ndata = rec.NumData();
+	bool delta = (rec.Flags() & FLIGHTREC_DELTA) != 0;
+	bool mjdset = false;
+	int nerr = 0;
+
+	memset (&fr, 0, sizeof(FLIGHTREC_FRAME));
+	while (ReadTextLine (f, stream, line, 1024, tl)) {
+		switch (tl.type) {
+		case TXT_MJD:
+			if (!mjdset) {
+				if (tl.t != rec.StartMJD()) nerr++;
+				mjdset = true;
+			}
+			break;
+		case TXT_REF:
+			strncpy (fr.ref, tl.str, sizeof(fr.ref)-1);
+			break;
+		case TXT_FRM:
+			strncpy (fr.frm, tl.str, sizeof(fr.frm)-1);
+			break;
+		case TXT_CRD:
+			strncpy (fr.crd, tl.str, sizeof(fr.crd)-1);
+			break;
+		case TXT_SAMPLE:
+			if (i < rec.NumSamples()) {
+				bool ok = (rec.Sample (i, data) == tl.t);
+				const FLIGHTREC_FRAME *rf = rec.Frame (i);
+				if (strncmp (rf->ref, fr.ref, sizeof(fr.ref)) || strncmp (rf->frm, fr.frm, sizeof(fr.frm)) ||
+					strncmp (rf->crd, fr.crd, sizeof(fr.crd)))
+					ok = false;
+				if (stream == FRSTREAM_EVENT) {
+					const char *ev = rec.Event (i);
+					if (!ev || strcmp (ev, tl.str)) ok = false;
+				} else {
+					// delta records store float offsets from the key record
+					if (delta) rec.Sample (rec.KeyOf (i), key);
+					for (j = 0; j < ndata; j++) {
+						double tol = (delta ? FLT_EPSILON*fabs (tl.data[j]-key[j]) + 4.0*DBL_EPSILON*fabs (tl.data[j]) : 0.0);
+						if (fabs (data[j]-tl.data[j]) > tol) ok = false;
+					}
+				}
+				if (!ok) nerr++;
+			} else nerr++; // missing from the binary stream
+			i++;
+			break;
+		}
+	}
+	fclose (f);
+
+	if (i < rec.NumSamples()) nerr += rec.NumSamples()-i; // not in the source
+	return nerr;
+}
@@ -0,0 +1,314 @@
+// ==============================================================
+//              ORBITER MODULE: Common recorder tools
+//                  Part of the ORBITER SDK
+//          Copyright (C) 2001-2015 Martin Schweiger
+//                   All rights reserved
+//
+// FlightRec.h
+// Interface for classes FlightRecWriter and FlightRecReader:
+//   Binary flight recorder streams with fixed-size sample records
+//   and a time-indexed block table for fast seeking. Playback
+//   streams are memory-mapped and read without copying.
+//
+// File layout:
+//   FLIGHTREC_HEADER
+//   data blocks
+//   block table  (FLIGHTREC_BLOCK x nblock)
+//   frame table  (FLIGHTREC_FRAME x nframe)
+//   string pool  (event streams only)
+//
+// Each sample record consists of the sample time followed by the
+// sample values, all in double precision. In delta-compressed
+// streams, only the first (key) record of each block stores its
+// values in full; the remaining records of the block store the
+// values as single-precision offsets from the key record. Sample
+// times are always stored in double precision.
+// ==============================================================
+
+#ifndef __FLIGHTREC_H
+#define __FLIGHTREC_H
+
+#include <windows.h>
+#include <stdio.h>
+#include <vector>
+
+// ==============================================================
+// Stream types
+
+#define FRSTREAM_POS     1    ///< position/velocity stream (.pos): 6 values per sample
+#define FRSTREAM_ATT     2    ///< attitude stream (.att): 3 values per sample
+#define FRSTREAM_EVENT   3    ///< event stream (.atc, system.dat): one string per sample
+
+// Stream flags
+
+#define FLIGHTREC_DELTA  0x0001  ///< delta-compressed sample records (lossy)
+
+const DWORD FLIGHTREC_VERSION   = 1;    ///< current file format version
+const DWORD FLIGHTREC_BLOCKSIZE = 256;  ///< default number of samples per block
+const DWORD FLIGHTREC_MAXDATA   = 6;    ///< max. number of values per sample
+
+// ==============================================================
+// File structures
+
+#pragma pack(push,4)
+
+/**
+ * \brief Stream file header
+ */
+struct FLIGHTREC_HEADER {
+	char   magic[8];     ///< file identifier ("ORBREC")
+	DWORD  version;      ///< file format version
+	DWORD  stream;       ///< stream type (FRSTREAM_POS, FRSTREAM_ATT, FRSTREAM_EVENT)
+	DWORD  flags;        ///< stream flags (FLIGHTREC_DELTA)
+	DWORD  ndata;        ///< number of values per sample
+	DWORD  keysize;      ///< size of a block key record [bytes]
+	DWORD  recsize;      ///< size of the remaining block records [bytes]
+	DWORD  nrec;         ///< total number of samples
+	DWORD  nblock;       ///< number of data blocks
+	DWORD  nframe;       ///< number of frame descriptors
+	DWORD  blockofs;     ///< file offset of block table
+	DWORD  frameofs;     ///< file offset of frame table
+	DWORD  strofs;       ///< file offset of string pool
+	DWORD  strsize;      ///< size of string pool [bytes]
+	DWORD  reserved;
+	double startmjd;     ///< recording start date [MJD]
+};
+
+/**
+ * \brief Block table entry
+ * \note Blocks are stored in order of increasing time. A block never spans
+ *   a change of reference frame.
+ */
+struct FLIGHTREC_BLOCK {
+	double t0;           ///< time of first sample in block [s]
+	double t1;           ///< time of last sample in block [s]
+	DWORD  ofs;          ///< file offset of block key record
+	DWORD  rec0;         ///< stream index of first sample in block
+	DWORD  nrec;         ///< number of samples in block
+	DWORD  frame;        ///< frame table index
+};
+
+/**
+ * \brief Frame table entry
+ * \note Corresponds to a REF/FRM/CRD header group of the text streams.
+ */
+struct FLIGHTREC_FRAME {
+	char ref[32];        ///< reference object name
+	char frm[16];        ///< frame of reference (ECLIPTIC, EQUATORIAL, HORIZON)
+	char crd[16];        ///< coordinate type (CARTESIAN, POLAR)
+};
+
+/**
+ * \brief Event record
+ */
+struct FLIGHTREC_EVENT {
+	double t;            ///< event time [s]
+	DWORD  ofs;          ///< string pool offset of event string
+	DWORD  len;          ///< length of event string (excluding terminating 0)
+};
+
+#pragma pack(pop)
+
+// ==============================================================
+
+/**
+ * \brief Writes a binary flight recorder stream.
+ *
+ * Samples are buffered until a block is complete, or until the reference
+ * frame changes, and are then written to the file. The block table, frame
+ * table and string pool are appended when the stream is closed.
+ */
+class FlightRecWriter {
+public:
+	FlightRecWriter ();
+	~FlightRecWriter ();
+
+	/**
+	 * \brief Create a new stream file.
+	 * \param fname file name
+	 * \param stream stream type (FRSTREAM_POS, FRSTREAM_ATT, FRSTREAM_EVENT)
+	 * \param flags stream flags (FLIGHTREC_DELTA)
+	 * \param blocksize max. number of samples per block
+	 * \return false if the file could not be created
+	 * \note Delta compression is ignored for event streams.
+	 */
+	bool Open (const char *fname, DWORD stream, DWORD flags = 0, DWORD blocksize = FLIGHTREC_BLOCKSIZE);
+
+	/**
+	 * \brief Finish the stream and close the file.
+	 * \return false if a write error occurred
+	 */
+	bool Close ();
+
+	void SetStartMJD (double mjd);
+
+	/**
+	 * \brief Set the reference frame for subsequent samples.
+	 * \param ref reference object name (or NULL to keep current value)
+	 * \param frm frame of reference (or NULL to keep current value)
+	 * \param crd coordinate type (or NULL to keep current value)
+	 * \note A frame change starts a new data block.
+	 */
+	void SetFrame (const char *ref, const char *frm, const char *crd);
+
+	/**
+	 * \brief Append a sample to a position or attitude stream.
+	 * \param t sample time [s]
+	 * \param data sample values (6 for position, 3 for attitude streams)
+	 * \note Samples must be added in order of non-decreasing time.
+	 */
+	void AddSample (double t, const double *data);
+
+	/**
+	 * \brief Append an event to an event stream.
+	 * \param t event time [s]
+	 * \param event event string
+	 */
+	void AddEvent (double t, const char *event);
+
+private:
+	void FlushBlock ();
+	void Write (const void *data, DWORD size);
+
+	FILE *f;                              // stream file
+	bool ok;                              // no write error occurred
+	FLIGHTREC_HEADER hdr;                 // file header
+	DWORD blocksize;                      // max. number of samples per block
+	FLIGHTREC_FRAME curframe;             // current frame descriptor
+	bool newframe;                        // curframe not yet added to frame table
+	std::vector<double> buf;              // samples of the current block (t + ndata values each)
+	std::vector<FLIGHTREC_BLOCK> block;   // block table
+	std::vector<FLIGHTREC_FRAME> frame;   // frame table
+	std::vector<char> strpool;            // event string pool
+};
+
+// ==============================================================
+
+/**
+ * \brief Reads a binary flight recorder stream.
+ *
+ * The file is mapped into memory. Samples are decoded directly from the
+ * mapped view, and time lookups use a binary search over the block table
+ * followed by a binary search within the block.
+ */
+class FlightRecReader {
+public:
+	FlightRecReader ();
+	~FlightRecReader ();
+
+	/**
+	 * \brief Map a stream file for reading.
+	 * \param fname file name
+	 * \return false if the file could not be mapped or is not a valid stream
+	 * \note The header and the complete block table are checked against the
+	 *   file size, so that no sample access can read outside the mapped view.
+	 */
+	bool Open (const char *fname);
+
+	void Close ();
+
+	inline bool IsOpen () const { return hdr != 0; }
+	inline DWORD Stream () const { return hdr->stream; }
+	inline DWORD Flags () const { return hdr->flags; }
+	inline DWORD NumData () const { return hdr->ndata; }
+	inline DWORD NumSamples () const { return hdr->nrec; }
+	inline double StartMJD () const { return hdr->startmjd; }
+
+	/**
+	 * \brief Returns the time of the first sample [s], or 0 for an empty stream.
+	 */
+	double T0 () const;
+
+	/**
+	 * \brief Returns the time of the last sample [s], or 0 for an empty stream.
+	 */
+	double T1 () const;
+
+	/**
+	 * \brief Find the sample active at a given time.
+	 * \param t time [s]
+	 * \return Index of the last sample with time <= t, or 0 if t precedes
+	 *   the first sample or the stream is empty.
+	 * \note O(log n) in the number of samples.
+	 */
+	DWORD Find (double t) const;
+
+	/**
+	 * \brief Returns the index of the key record of the block containing a sample.
+	 * \param i sample index (0 <= i < NumSamples())
+	 * \note In delta-compressed streams, the values of sample i are stored
+	 *   as offsets from this sample.
+	 */
+	DWORD KeyOf (DWORD i) const;
+
+	/**
+	 * \brief Returns the time of a sample [s].
+	 * \param i sample index (0 <= i < NumSamples())
+	 */
+	double Time (DWORD i) const;
+
+	/**
+	 * \brief Decode a sample.
+	 * \param i sample index (0 <= i < NumSamples())
+	 * \param data array receiving NumData() values
+	 * \return sample time [s]
+	 */
+	double Sample (DWORD i, double *data) const;
+
+	/**
+	 * \brief Returns an event string.
+	 * \param i sample index (0 <= i < NumSamples())
+	 * \param len receives the string length, if not NULL
+	 * \return Pointer to the event string in the mapped file (0-terminated),
+	 *   or NULL if the record does not point to a valid string.
+	 * \note Only valid for event streams.
+	 */
+	const char *Event (DWORD i, DWORD *len = 0) const;
+
+	/**
+	 * \brief Returns the frame descriptor for a sample.
+	 * \param i sample index (0 <= i < NumSamples())
+	 */
+	const FLIGHTREC_FRAME *Frame (DWORD i) const;
+
+private:
+	DWORD BlockOf (DWORD i) const;
+	const BYTE *Record (const FLIGHTREC_BLOCK *b, DWORD i) const;
+
+	HANDLE hFile;                  // file handle
+	HANDLE hMap;                   // file mapping handle
+	const BYTE *base;              // mapped file view
+	DWORD size;                    // file size [bytes]
+	const FLIGHTREC_HEADER *hdr;   // file header
+	const FLIGHTREC_BLOCK *block;  // block table
+	const FLIGHTREC_FRAME *frame;  // frame table
+	const char *strpool;           // event string pool
+};
+
+// ==============================================================
+
+/**
+ * \brief Convert a text playback stream to binary format.
+ * \param src source file name (.pos, .att, .atc or system.dat)
+ * \param dst target file name
+ * \param flags stream flags (FLIGHTREC_DELTA)
+ * \return Number of converted samples, or -1 on error
+ * \note The stream type is derived from the extension of the source file.
+ *   Files other than .pos and .att are converted as event streams.
+ */
+int FlightRecConvert (const char *src, const char *dst, DWORD flags = 0);
+
+/**
+ * \brief Compare a binary stream with the text stream it was converted from.
+ * \param src source file name (.pos, .att, .atc or system.dat)
+ * \param dst binary stream file name
+ * \return Number of mismatches, or -1 if a file could not be read
+ * \note Every source sample is compared with the corresponding binary
+ *   record: sample time, reference frame, and either the event string or
+ *   the sample values. Values must match exactly, or to within the float
+ *   rounding of the offset from the key record for delta-compressed
+ *   streams. The start date and the sample count are checked as well.
+ */
+int FlightRecVerify (const char *src, const char *dst);
+
+#endif // !__FLIGHTREC_H
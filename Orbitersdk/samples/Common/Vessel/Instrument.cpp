@@ -11,6 +11,7 @@
 
 #include "Instrument.h"
 #include "Orbitersdk.h"
+#include <algorithm>
 
 PanelElement::PanelElement (VESSEL3 *v)
 {
@@ -252,6 +253,8 @@ Subsystem::Subsystem (ComponentVessel *v)
 {
 	parent = 0;              // top-level subsystem
 	id = v->next_ssys_id++;  // assign a top-level subsystem id
+	hooks = HOOK_ALL;
+	keyed = false;
 }
 
 // --------------------------------------------------------------
@@ -261,6 +264,8 @@ Subsystem::Subsystem (Subsystem *p)
 {
 	vessel = p->vessel;
 	id = p->id;    // inherit the parent id
+	hooks = HOOK_ALL;
+	keyed = false;
 }
 
 // --------------------------------------------------------------
@@ -281,6 +286,56 @@ Subsystem::~Subsystem ()
 void Subsystem::AddSubsystem (Subsystem *subsys)
 {
 	child.push_back (subsys);
+	vessel->compiled = false;
+}
+
+// --------------------------------------------------------------
+
+void Subsystem::CollectHook (DWORD hook, std::vector<Subsystem*> &list)
+{
+	if (hooks & hook) {
+		list.push_back (this);
+	} else {
+		for (std::vector<Subsystem*>::iterator it = child.begin(); it != child.end(); ++it)
+			(*it)->CollectHook (hook, list);
+	}
+}
+
+// --------------------------------------------------------------
+
+void Subsystem::CollectParser (std::vector<Subsystem*> &list)
+{
+	if ((hooks & HOOK_PARSESCN) && !keyed) {
+		list.push_back (this);
+	} else {
+		// keyed subsystems are addressed via the keyword registry, but may
+		// have children which still need to be offered unregistered lines
+		for (std::vector<Subsystem*>::iterator it = child.begin(); it != child.end(); ++it)
+			(*it)->CollectParser (list);
+	}
+}
+
+// --------------------------------------------------------------
+
+void Subsystem::CompileDispatch ()
+{
+	prestep.clear();
+	poststep.clear();
+	parsescn.clear();
+	for (std::vector<Subsystem*>::iterator it = child.begin(); it != child.end(); ++it) {
+		(*it)->CollectHook (HOOK_PRESTEP, prestep);
+		(*it)->CollectHook (HOOK_POSTSTEP, poststep);
+		(*it)->CollectParser (parsescn);
+		(*it)->CompileDispatch ();
+	}
+}
+
+// --------------------------------------------------------------
+
+void Subsystem::RegisterScenarioTag (const char *tag)
+{
+	vessel->RegisterScenarioTag (tag, this);
+	keyed = true;
 }
 
 // --------------------------------------------------------------
@@ -316,9 +371,15 @@ void Subsystem::clbkSaveState (FILEHANDLE scn)
 
 bool Subsystem::clbkParseScenarioLine (const char *line)
 {
-	for (std::vector<Subsystem*>::iterator it = child.begin(); it != child.end(); ++it)
-		if ((*it)->clbkParseScenarioLine (line))
-			return true;
+	if (vessel->compiled) {
+		for (size_t i = 0; i < parsescn.size(); i++)
+			if (parsescn[i]->clbkParseScenarioLine (line))
+				return true;
+	} else {
+		for (std::vector<Subsystem*>::iterator it = child.begin(); it != child.end(); ++it)
+			if ((*it)->clbkParseScenarioLine (line))
+				return true;
+	}
 	return false;
 }
 
@@ -326,16 +387,26 @@ bool Subsystem::clbkParseScenarioLine (const char *line)
 
 void Subsystem::clbkPreStep (double simt, double simdt, double mjd)
 {
-	for (std::vector<Subsystem*>::iterator it = child.begin(); it != child.end(); ++it)
-		(*it)->clbkPreStep (simt, simdt, mjd);
+	if (vessel->compiled) {
+		for (size_t i = 0; i < prestep.size(); i++)
+			prestep[i]->clbkPreStep (simt, simdt, mjd);
+	} else {
+		for (std::vector<Subsystem*>::iterator it = child.begin(); it != child.end(); ++it)
+			(*it)->clbkPreStep (simt, simdt, mjd);
+	}
 }
 
 // --------------------------------------------------------------
 
 void Subsystem::clbkPostStep (double simt, double simdt, double mjd)
 {
-	for (std::vector<Subsystem*>::iterator it = child.begin(); it != child.end(); ++it)
-		(*it)->clbkPostStep (simt, simdt, mjd);
+	if (vessel->compiled) {
+		for (size_t i = 0; i < poststep.size(); i++)
+			poststep[i]->clbkPostStep (simt, simdt, mjd);
+	} else {
+		for (std::vector<Subsystem*>::iterator it = child.begin(); it != child.end(); ++it)
+			(*it)->clbkPostStep (simt, simdt, mjd);
+	}
 }
 
 // --------------------------------------------------------------
@@ -448,6 +519,7 @@ ComponentVessel::ComponentVessel (OBJHANDLE hVessel, int fmodel)
 : VESSEL4 (hVessel, fmodel)
 {
 	next_ssys_id = 0;
+	compiled = false;
 }
 
 // --------------------------------------------------------------
@@ -465,6 +537,47 @@ ComponentVessel::~ComponentVessel ()
 void ComponentVessel::AddSubsystem (Subsystem *subsys)
 {
 	ssys.push_back (subsys);
+	compiled = false;
+}
+
+// --------------------------------------------------------------
+
+void ComponentVessel::CompileDispatch ()
+{
+	prestep.clear();
+	poststep.clear();
+	parsescn.clear();
+	for (std::vector<Subsystem*>::iterator it = ssys.begin(); it != ssys.end(); ++it) {
+		(*it)->CollectHook (Subsystem::HOOK_PRESTEP, prestep);
+		(*it)->CollectHook (Subsystem::HOOK_POSTSTEP, poststep);
+		(*it)->CollectParser (parsescn);
+		(*it)->CompileDispatch ();
+	}
+	compiled = true;
+}
+
+// --------------------------------------------------------------
+
+DWORD ComponentVessel::ScnTagHash (const char *str, size_t len)
+{
+	// case-insensitive FNV-1a
+	DWORD h = 2166136261u;
+	for (size_t i = 0; i < len; i++) {
+		h ^= (DWORD)toupper ((unsigned char)str[i]);
+		h *= 16777619u;
+	}
+	return h;
+}
+
+// --------------------------------------------------------------
+
+void ComponentVessel::RegisterScenarioTag (const char *tag, Subsystem *subsys)
+{
+	ScnTag entry;
+	entry.hash = ScnTagHash (tag, strlen (tag));
+	entry.tag = tag;
+	entry.subsys = subsys;
+	scntag.insert (std::upper_bound (scntag.begin(), scntag.end(), entry, ScnTagLess), entry);
 }
 
 // --------------------------------------------------------------
@@ -483,8 +596,21 @@ void ComponentVessel::clbkSaveState (FILEHANDLE scn)
 
 bool ComponentVessel::clbkParseScenarioLine (const char *line)
 {
-	for (std::vector<Subsystem*>::iterator it = ssys.begin(); it != ssys.end(); ++it)
-		if ((*it)->clbkParseScenarioLine (line))
+	if (!compiled) CompileDispatch ();
+
+	// look up the line keyword in the registry
+	size_t len = 0;
+	while (line[len] && line[len] != ' ' && line[len] != '\t') len++;
+	ScnTag key;
+	key.hash = ScnTagHash (line, len);
+	std::vector<ScnTag>::iterator it = std::lower_bound (scntag.begin(), scntag.end(), key, ScnTagLess);
+	for (; it != scntag.end() && it->hash == key.hash; ++it)
+		if (it->tag.size() == len && !_strnicmp (it->tag.c_str(), line, len))
+			return it->subsys->clbkParseScenarioLine (line);
+
+	// offer unregistered keywords to the remaining parsers
+	for (size_t i = 0; i < parsescn.size(); i++)
+		if (parsescn[i]->clbkParseScenarioLine (line))
 			return true;
 	return false;
 }
@@ -495,6 +621,16 @@ void ComponentVessel::clbkPostCreation ()
 {
 	for (std::vector<Subsystem*>::iterator it = ssys.begin(); it != ssys.end(); ++it)
 		(*it)->clbkPostCreation ();
+
+	CompileDispatch ();
+
+	// attribute the step callbacks to the vessel class in the frame profiler
+	const char *classname = GetClassName();
+	if (classname) {
+		std::string name (classname);
+		fpscope[0].SetName ((name + "::clbkPreStep").c_str());
+		fpscope[1].SetName ((name + "::clbkPostStep").c_str());
+	}
 }
 
 // --------------------------------------------------------------
@@ -533,16 +669,22 @@ bool ComponentVessel::clbkPlaybackEvent (double simt, double event_t, const char
 
 void ComponentVessel::clbkPreStep (double simt, double simdt, double mjd)
 {
-	for (std::vector<Subsystem*>::iterator it = ssys.begin(); it != ssys.end(); ++it)
-		(*it)->clbkPreStep (simt, simdt, mjd);
+	FrameProfScope fps (fpscope[0]);
+	if (!compiled) CompileDispatch ();
+
+	for (size_t i = 0; i < prestep.size(); i++)
+		prestep[i]->clbkPreStep (simt, simdt, mjd);
 }
 
 // --------------------------------------------------------------
 
 void ComponentVessel::clbkPostStep (double simt, double simdt, double mjd)
 {
-	for (std::vector<Subsystem*>::iterator it = ssys.begin(); it != ssys.end(); ++it)
-		(*it)->clbkPostStep (simt, simdt, mjd);
+	FrameProfScope fps (fpscope[1]);
+	if (!compiled) CompileDispatch ();
+
+	for (size_t i = 0; i < poststep.size(); i++)
+		poststep[i]->clbkPostStep (simt, simdt, mjd);
 }
 
 // --------------------------------------------------------------
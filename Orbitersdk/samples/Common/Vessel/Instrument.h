@@ -16,7 +16,9 @@
 #define __INSTRUMENT_H
 
 #include "Orbitersdk.h"
+#include "..\Profile\FrameProf.h"
 #include <vector>
+#include <string>
 
 class VESSEL3;
 
@@ -100,7 +102,20 @@ class ComponentVessel;
  * passes the call on to the appropriate subsystem panel element.
  */
 class Subsystem {
+	friend class ComponentVessel;
+
 public:
+	/**
+	 * \brief Flags identifying the per-frame callbacks a subsystem implements.
+	 * \sa SetHooks
+	 */
+	enum Hook {
+		HOOK_PRESTEP  = 0x0001, ///< subsystem overrides clbkPreStep
+		HOOK_POSTSTEP = 0x0002, ///< subsystem overrides clbkPostStep
+		HOOK_PARSESCN = 0x0004, ///< subsystem overrides clbkParseScenarioLine
+		HOOK_ALL      = 0x0007  ///< all of the above
+	};
+
 	/**
 	 * \brief Create a new top-level subsystem.
 	 * \param v Vessel instance
@@ -130,6 +145,12 @@ public:
 	 */
 	inline int Id() const { return id; }
 
+	/**
+	 * \brief Returns the per-frame callbacks implemented by the subsystem.
+	 * \return Bitflags of \ref Hook values
+	 */
+	inline DWORD Hooks() const { return hooks; }
+
 	/**
 	 * \brief Add a PanelElement instance to the subsystem.
 	 * \param el Pointer to panel element instance
@@ -166,6 +187,8 @@ public:
 	 *   return true, otherwise false.
 	 * \note This method should be called within the vessel's scenario parse loop in
 	 *   VESSEL3::clbkLoadStateEx for all defined subsystems
+	 * \note Subsystems which register their keywords with RegisterScenarioTag are
+	 *   only offered lines starting with one of those keywords.
 	 */
 	virtual bool clbkParseScenarioLine (const char *line);
 
@@ -248,9 +271,63 @@ protected:
 	 */
 	void AddSubsystem (Subsystem *subsys);
 
+	/**
+	 * \brief Declare the per-frame callbacks the subsystem implements.
+	 * \param mask Bitflags of \ref Hook values
+	 * \note By default a subsystem is assumed to implement all hooks. A subsystem
+	 *   which does not override clbkPreStep or clbkPostStep can clear the
+	 *   corresponding flag. The compiled dispatch tables then bypass it and call
+	 *   its children directly.
+	 * \note A subsystem which overrides a hook must keep the corresponding flag
+	 *   set, otherwise the override is not called once the vessel has compiled
+	 *   its dispatch tables.
+	 * \note Usually called from the subsystem constructor.
+	 */
+	void SetHooks (DWORD mask) { hooks = mask; }
+
+	/**
+	 * \brief Register a scenario keyword consumed by the subsystem.
+	 * \param tag Scenario line keyword (case-insensitive)
+	 * \note Scenario lines starting with a registered keyword are passed directly
+	 *   to the clbkParseScenarioLine method of the subsystem, without being
+	 *   offered to any other subsystems.
+	 * \note Once a subsystem has registered a keyword, it is no longer offered
+	 *   lines with unregistered keywords. It must therefore register all the
+	 *   keywords it consumes.
+	 * \note Each keyword can only be registered by a single subsystem.
+	 * \note Usually called from the subsystem constructor.
+	 */
+	void RegisterScenarioTag (const char *tag);
+
 private:
+	/**
+	 * \brief Append the subsystems which implement a hook to a dispatch table.
+	 * \param hook Hook identifier
+	 * \param list Dispatch table to be extended
+	 * \note If the subsystem implements the hook itself, it is appended to the
+	 *   list. Otherwise the call is passed on to its children.
+	 */
+	void CollectHook (DWORD hook, std::vector<Subsystem*> &list);
+
+	/**
+	 * \brief Append the subsystems which parse unregistered scenario keywords
+	 *   to a dispatch table.
+	 * \param list Dispatch table to be extended
+	 */
+	void CollectParser (std::vector<Subsystem*> &list);
+
+	/**
+	 * \brief Build the dispatch tables of the subsystem and all its children.
+	 */
+	void CompileDispatch ();
+
 	Subsystem *parent;                  ///< parent systems (0 if top-level system)
 	std::vector<Subsystem*> child;      ///< list of child systems
+	std::vector<Subsystem*> prestep;    ///< compiled clbkPreStep dispatch table for children
+	std::vector<Subsystem*> poststep;   ///< compiled clbkPostStep dispatch table for children
+	std::vector<Subsystem*> parsescn;   ///< compiled clbkParseScenarioLine dispatch table for children
+	DWORD hooks;                        ///< callbacks implemented by the subsystem (bitflags of Hook)
+	bool keyed;                         ///< subsystem has registered its scenario keywords
 	std::vector<PanelElement*> element; ///< list of panel elements
 	ComponentVessel *vessel;            ///< associated vessel object
 	int id;                             ///< subsystem ID
@@ -270,6 +347,20 @@ public:
 	void AddSubsystem (Subsystem *subsys);
 	inline int NumSubsystems() const { return ssys.size(); }
 
+	/**
+	 * \brief Flatten the subsystem tree into per-callback dispatch tables.
+	 * \note After compilation, clbkPreStep and clbkPostStep are only passed to
+	 *   subsystems which implement them (see Subsystem::SetHooks), rather than
+	 *   to every node of the subsystem tree.
+	 * \note Scenario lines with unregistered keywords are only offered to
+	 *   subsystems which implement clbkParseScenarioLine and have not registered
+	 *   their keywords (see Subsystem::RegisterScenarioTag).
+	 * \note Called automatically by clbkPostCreation. Adding a subsystem
+	 *   afterwards invalidates the tables, which are then rebuilt on the next
+	 *   time step.
+	 */
+	void CompileDispatch ();
+
 	void clbkSaveState (FILEHANDLE scn);
 	bool clbkParseScenarioLine (const char *line);
 	void clbkPostCreation ();
@@ -286,7 +377,25 @@ public:
 	bool clbkVCRedrawEvent (int elid, int event, DEVMESHHANDLE hMesh, SURFHANDLE hSurf);
 
 private:
+	/**
+	 * \brief Scenario keyword registry entry
+	 */
+	struct ScnTag {
+		DWORD hash;                 // case-insensitive keyword hash
+		std::string tag;            // keyword
+		Subsystem *subsys;          // subsystem consuming the keyword
+	};
+	static bool ScnTagLess (const ScnTag &a, const ScnTag &b) { return a.hash < b.hash; }
+	static DWORD ScnTagHash (const char *str, size_t len);
+	void RegisterScenarioTag (const char *tag, Subsystem *subsys);
+
 	std::vector<Subsystem*> ssys;   // list of subsystems
+	std::vector<Subsystem*> prestep;  // compiled clbkPreStep dispatch table
+	std::vector<Subsystem*> poststep; // compiled clbkPostStep dispatch table
+	std::vector<Subsystem*> parsescn; // compiled dispatch table for unregistered scenario keywords
+	std::vector<ScnTag> scntag;     // scenario keyword registry, sorted by hash
+	bool compiled;                  // dispatch tables are valid
+	FrameProfScopeRef fpscope[2];   // frame profiler scopes for clbkPreStep/clbkPostStep
 	int next_ssys_id;               // next subsystem id to be assigned
 };
 
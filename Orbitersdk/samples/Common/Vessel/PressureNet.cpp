@@ -0,0 +1,267 @@
+// ==============================================================
+//             ORBITER MODULE: Common vessel tools
+//                  Part of the ORBITER SDK
+//          Copyright (C) 2001-2015 Martin Schweiger
+//                   All rights reserved
+//
+// PressureNet.cpp
+// Implementation of class PressureNetwork:
+//   Gas exchange in a network of lumped volumes and valves
+//
+// With volume pressures p, volumes V, the conductance matrix G
+// (the weighted Laplacian of the valve graph, restricted to the
+// volume nodes) and the reservoir inflow b, the network obeys
+//   V dp/dt = -G p + b
+// Substituting y = V^1/2 p gives dy/dt = -S y + V^-1/2 b with the
+// symmetric, positive semi-definite S = V^-1/2 G V^-1/2. In the
+// eigenbasis of S the modes decouple and are integrated exactly.
+// ==============================================================
+
+#include "PressureNet.h"
+#include <math.h>
+
+// ==============================================================
+// Eigen-decomposition of a symmetric matrix (cyclic Jacobi method)
+// a: n x n matrix (row-major), destroyed on exit
+// v: receives the eigenvectors (v[k*n+j]: component k of vector j)
+// d: receives the eigenvalues
+
+static void Jacobi (int n, double *a, double *v, double *d)
+{
+	int i, j, k, sweep;
+	double norm = 0.0;
+
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < n; j++) {
+			v[i*n+j] = (i == j ? 1.0 : 0.0);
+			norm += a[i*n+j]*a[i*n+j];
+		}
+	}
+	for (sweep = 0; sweep < 50; sweep++) {
+		double off = 0.0;
+		for (i = 0; i < n; i++)
+			for (j = i+1; j < n; j++)
+				off += a[i*n+j]*a[i*n+j];
+		if (off <= 1e-30*norm) break;
+
+		for (i = 0; i < n; i++) {
+			for (j = i+1; j < n; j++) {
+				double apq = a[i*n+j];
+				if (!apq) continue;
+				double theta = (a[j*n+j]-a[i*n+i])/(2.0*apq);
+				double t = (theta >= 0.0 ? 1.0 : -1.0)/(fabs(theta) + sqrt(theta*theta+1.0));
+				double c = 1.0/sqrt(t*t+1.0), s = t*c;
+				for (k = 0; k < n; k++) { // columns
+					double akp = a[k*n+i], akq = a[k*n+j];
+					a[k*n+i] = c*akp - s*akq;
+					a[k*n+j] = s*akp + c*akq;
+				}
+				for (k = 0; k < n; k++) { // rows
+					double apk = a[i*n+k], aqk = a[j*n+k];
+					a[i*n+k] = c*apk - s*aqk;
+					a[j*n+k] = s*apk + c*aqk;
+				}
+				for (k = 0; k < n; k++) { // eigenvectors
+					double vkp = v[k*n+i], vkq = v[k*n+j];
+					v[k*n+i] = c*vkp - s*vkq;
+					v[k*n+j] = s*vkp + c*vkq;
+				}
+			}
+		}
+	}
+	for (i = 0; i < n; i++)
+		d[i] = a[i*n+i];
+}
+
+// ==============================================================
+
+PressureNetwork::PressureNetwork ()
+{
+	dirty = true;
+}
+
+// --------------------------------------------------------------
+
+int PressureNetwork::AddVolume (double V, double p)
+{
+	Node node = {V, p};
+	nd.push_back (node);
+	dirty = true;
+	return nd.size()-1;
+}
+
+// --------------------------------------------------------------
+
+int PressureNetwork::AddReservoir (double p)
+{
+	return AddVolume (0.0, p);
+}
+
+// --------------------------------------------------------------
+
+int PressureNetwork::AddValve (int node1, int node2, double C)
+{
+	Valve valve = {node1, node2, C, 0.0, true};
+	vl.push_back (valve);
+	dirty = true;
+	return vl.size()-1;
+}
+
+// --------------------------------------------------------------
+
+void PressureNetwork::SetRegulator (int valve, double pmax)
+{
+	vl[valve].pmax = pmax;
+	dirty = true;
+}
+
+// --------------------------------------------------------------
+
+void PressureNetwork::SetConductance (int valve, double C)
+{
+	if (C != vl[valve].C) {
+		vl[valve].C = C;
+		dirty = true;
+	}
+}
+
+// --------------------------------------------------------------
+
+void PressureNetwork::SetVolume (int node, double V)
+{
+	if (V != nd[node].V) {
+		nd[node].V = V;
+		dirty = true;
+	}
+}
+
+// --------------------------------------------------------------
+
+void PressureNetwork::SetPressure (int node, double p)
+{
+	nd[node].p = p;
+}
+
+// --------------------------------------------------------------
+
+double PressureNetwork::Amount () const
+{
+	double m = 0.0;
+	for (size_t i = 0; i < nd.size(); i++)
+		m += nd[i].V*nd[i].p;
+	return m;
+}
+
+// --------------------------------------------------------------
+
+void PressureNetwork::Decompose ()
+{
+	size_t i, n;
+
+	idx.resize (nd.size());
+	vol.clear();
+	sqV.clear();
+	for (i = 0; i < nd.size(); i++) {
+		if (nd[i].V > 0.0) {
+			idx[i] = vol.size();
+			vol.push_back (i);
+			sqV.push_back (sqrt (nd[i].V));
+		} else idx[i] = -1;
+	}
+	n = vol.size();
+
+	// conductance matrix G over the volume nodes
+	std::vector<double> S(n*n, 0.0);
+	for (i = 0; i < vl.size(); i++) {
+		const Valve &v = vl[i];
+		if (!v.C || !v.open) continue;
+		int i1 = idx[v.n1], i2 = idx[v.n2];
+		if (i1 >= 0) S[i1*n+i1] += v.C;
+		if (i2 >= 0) S[i2*n+i2] += v.C;
+		if (i1 >= 0 && i2 >= 0) {
+			S[i1*n+i2] -= v.C;
+			S[i2*n+i1] -= v.C;
+		}
+	}
+	// symmetrise with the volumes
+	for (i = 0; i < n; i++)
+		for (size_t j = 0; j < n; j++)
+			S[i*n+j] /= sqV[i]*sqV[j];
+
+	Q.resize (n*n);
+	lambda.resize (n);
+	if (n) Jacobi (n, &S[0], &Q[0], &lambda[0]);
+
+	// Conserved modes (closed parts of the network) have zero eigenvalues,
+	// up to rounding noise of either sign. A positive residual would
+	// drain them at long steps, so zero everything within the noise.
+	double lmax = 0.0;
+	for (i = 0; i < n; i++)
+		if (lambda[i] > lmax) lmax = lambda[i];
+	for (i = 0; i < n; i++)
+		if (lambda[i] < 1e-12*lmax) lambda[i] = 0.0;
+	dirty = false;
+}
+
+// --------------------------------------------------------------
+
+void PressureNetwork::Step (double dt)
+{
+	size_t i, j, k;
+
+	// a regulator shuts once its target pressure is reached
+	for (i = 0; i < vl.size(); i++) {
+		Valve &v = vl[i];
+		if (v.pmax) {
+			bool open = nd[v.n2].p < v.pmax;
+			if (open != v.open) {
+				v.open = open;
+				dirty = true;
+			}
+		}
+	}
+
+	if (dirty) Decompose ();
+	size_t n = vol.size();
+	if (!n || dt <= 0.0) return;
+
+	// transformed state y = V^1/2 p and source h = V^-1/2 b
+	std::vector<double> y(n), h(n, 0.0), z(n), hz(n);
+	for (i = 0; i < n; i++)
+		y[i] = sqV[i]*nd[vol[i]].p;
+	for (i = 0; i < vl.size(); i++) {
+		const Valve &v = vl[i];
+		if (!v.C || !v.open) continue;
+		int i1 = idx[v.n1], i2 = idx[v.n2];
+		if (i1 >= 0 && i2 < 0) h[i1] += v.C*nd[v.n2].p;
+		if (i2 >= 0 && i1 < 0) h[i2] += v.C*nd[v.n1].p;
+	}
+	for (i = 0; i < n; i++)
+		h[i] /= sqV[i];
+
+	// exact solution of each mode over the step
+	for (k = 0; k < n; k++) {
+		double zk = 0.0, hk = 0.0;
+		for (i = 0; i < n; i++) {
+			zk += Q[i*n+k]*y[i];
+			hk += Q[i*n+k]*h[i];
+		}
+		double x = lambda[k]*dt;
+		double e = exp (-x);
+		double phi = (x > 1e-8 ? (1.0-e)/x : 1.0-0.5*x); // (1-exp(-x))/x
+		z[k] = zk*e + hk*dt*phi;
+	}
+	for (i = 0; i < n; i++) {
+		double yi = 0.0;
+		for (j = 0; j < n; j++)
+			yi += Q[i*n+j]*z[j];
+		nd[vol[i]].p = yi/sqV[i];
+	}
+
+	// don't let a regulator overshoot its target within the step
+	for (i = 0; i < vl.size(); i++) {
+		const Valve &v = vl[i];
+		if (v.pmax && v.open && v.C && nd[v.n2].V && nd[v.n2].p > v.pmax)
+			nd[v.n2].p = v.pmax;
+	}
+}
@@ -0,0 +1,132 @@
+// ==============================================================
+//             ORBITER MODULE: Common vessel tools
+//                  Part of the ORBITER SDK
+//          Copyright (C) 2001-2015 Martin Schweiger
+//                   All rights reserved
+//
+// PressureNet.h
+// Interface for class PressureNetwork:
+//   Gas exchange in a network of lumped volumes and valves
+//
+// The network consists of nodes and valves. A node is either a
+// volume (cabin, airlock, docked compartment, ...) whose pressure
+// evolves, or a reservoir of prescribed pressure (ambient
+// atmosphere, supply tank). A valve connects two nodes. The flow
+// through a valve is proportional to the pressure difference, so
+// the gas amount, measured as p*V [Pa m^3], moves at the rate
+// C*(p1-p2), where C [m^3/s] is the valve conductance.
+//
+// Step() integrates the resulting linear system exactly over the
+// step (via an eigen-decomposition of the conductance matrix),
+// assuming valve settings and reservoir pressures to be constant
+// during the step. It is therefore stable at any step length,
+// never overshoots the equilibrium and conserves the gas in closed
+// parts of the network. The decomposition is reused while the
+// valve settings don't change.
+// ==============================================================
+
+#ifndef __PRESSURENET_H
+#define __PRESSURENET_H
+
+#include <vector>
+
+class PressureNetwork {
+public:
+	PressureNetwork ();
+
+	/**
+	 * \brief Add a volume node.
+	 * \param V volume [m^3] (> 0)
+	 * \param p initial pressure [Pa]
+	 * \return node index
+	 */
+	int AddVolume (double V, double p);
+
+	/**
+	 * \brief Add a reservoir node of prescribed pressure.
+	 * \param p pressure [Pa]
+	 * \return node index
+	 */
+	int AddReservoir (double p);
+
+	/**
+	 * \brief Add a valve between two nodes.
+	 * \param node1 first node index
+	 * \param node2 second node index
+	 * \param C conductance [m^3/s] (0 = closed)
+	 * \return valve index
+	 */
+	int AddValve (int node1, int node2, double C = 0.0);
+
+	/**
+	 * \brief Turn a valve into a pressure regulator.
+	 * \param valve valve index
+	 * \param pmax regulated pressure [Pa]
+	 * \note A regulator only admits gas from node1 to node2 while the
+	 *   pressure in node2 is below pmax, and shuts when pmax is reached.
+	 */
+	void SetRegulator (int valve, double pmax);
+
+	/**
+	 * \brief Set the conductance of a valve.
+	 * \param valve valve index
+	 * \param C conductance [m^3/s] (0 = closed)
+	 */
+	void SetConductance (int valve, double C);
+
+	/**
+	 * \brief Switch a node between volume and reservoir.
+	 * \param node node index
+	 * \param V volume [m^3], or 0 to make the node a reservoir
+	 * \note A node turned into a volume starts at its current pressure.
+	 */
+	void SetVolume (int node, double V);
+
+	/**
+	 * \brief Set the pressure of a node.
+	 * \param node node index
+	 * \param p pressure [Pa]
+	 */
+	void SetPressure (int node, double p);
+
+	inline double Pressure (int node) const { return nd[node].p; }
+	inline double Volume (int node) const { return nd[node].V; }
+	inline bool IsReservoir (int node) const { return nd[node].V == 0.0; }
+
+	/**
+	 * \brief Total gas amount in all volume nodes [Pa m^3].
+	 */
+	double Amount () const;
+
+	/**
+	 * \brief Advance the network state.
+	 * \param dt step length [s]
+	 */
+	void Step (double dt);
+
+private:
+	struct Node {
+		double V;            // volume [m^3] (0 for reservoirs)
+		double p;            // pressure [Pa]
+	};
+	struct Valve {
+		int n1, n2;          // connected nodes
+		double C;            // conductance [m^3/s]
+		double pmax;         // regulated pressure (0: not a regulator)
+		bool open;           // regulator state at the current step
+	};
+	std::vector<Node> nd;
+	std::vector<Valve> vl;
+
+	// cached decomposition of the symmetrised conductance matrix
+	// S = V^-1/2 G V^-1/2 = Q diag(lambda) Q^T over the volume nodes
+	void Decompose ();
+	bool dirty;               // valve settings or topology changed
+	std::vector<int> idx;     // network index -> volume index (-1 for reservoirs)
+	std::vector<int> vol;     // volume index -> network index
+	std::vector<double> sqV;  // square roots of the volumes
+	std::vector<double> Q;    // eigenvectors (column-major)
+	std::vector<double> lambda; // eigenvalues
+};
+
+#endif // !__PRESSURENET_H
@@ -24,6 +24,7 @@
 AerodynCtrlSubsystem::AerodynCtrlSubsystem (DeltaGlider *v)
 : DGSubsystem (v)
 {
+	SetHooks (0);
 	// create component instances
 	AddSubsystem (selector = new AerodynSelector (this));
 	AddSubsystem (airbrake = new Airbrake (this));
@@ -65,6 +66,7 @@ const AnimState2 &AerodynCtrlSubsystem::AirbrakeState() const
 AerodynSelector::AerodynSelector (AerodynCtrlSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (0);
 	ELID_DIAL = AddElement (dial = new AerodynSelectorDial (this));
 }
 
@@ -196,6 +198,8 @@ bool AerodynSelectorDial::ProcessMouseVC (int event, VECTOR3 &p)
 Airbrake::Airbrake (AerodynCtrlSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (HOOK_POSTSTEP | HOOK_PARSESCN);
+	RegisterScenarioTag ("AIRBRAKE");
 	brake_state.SetOperatingSpeed (AIRBRAKE_OPERATING_SPEED);
 	lever_state.SetOperatingSpeed (4.0);
 	airbrake_tgt = 0;
@@ -419,6 +423,8 @@ bool AirbrakeLever::ProcessMouseVC (int event, VECTOR3 &p)
 ElevatorTrim::ElevatorTrim (AerodynCtrlSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (HOOK_PARSESCN);
+	RegisterScenarioTag ("TRIM");
 	ELID_TRIMWHEEL = AddElement (trimwheel = new ElevatorTrimWheel (this));
 
 	// Trim wheel animation
@@ -26,6 +26,7 @@
 AvionicsSubsystem::AvionicsSubsystem (DeltaGlider *v)
 : DGSubsystem (v)
 {
+	SetHooks (0);
 	extern GDIParams g_Param;
 
 	// create component instances
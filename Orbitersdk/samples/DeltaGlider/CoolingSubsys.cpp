@@ -23,6 +23,7 @@
 CoolingSubsystem::CoolingSubsystem (DeltaGlider *v)
 : DGSubsystem (v)
 {
+	SetHooks (0);
 	// create component instances
 	AddSubsystem (radiatorctrl = new RadiatorControl (this));
 }
@@ -62,6 +63,8 @@ const AnimState2 &CoolingSubsystem::RadiatorState() const
 RadiatorControl::RadiatorControl (CoolingSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (HOOK_POSTSTEP | HOOK_PARSESCN);
+	RegisterScenarioTag ("RADIATOR");
 	radiator_state.SetOperatingSpeed (RADIATOR_OPERATING_SPEED);
 	radiator_extend = false;
 
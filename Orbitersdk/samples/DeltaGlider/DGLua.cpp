@@ -33,8 +33,13 @@ int DeltaGlider::Lua_InitInterpreter (void *context)
 {
 	lua_State *L = (lua_State*)context;
 
-	// load atmospheric autopilot
-	luaL_dofile (L, "Script\\dg\\aap.lua");
+	// load atmospheric autopilot (the interpreter's loadfile uses
+	// the bytecode cache)
+	lua_getglobal (L, "loadfile");
+	lua_pushstring (L, "Script\\dg\\aap.lua");
+	lua_call (L, 1, 1);
+	if (lua_isfunction (L, -1)) lua_pcall (L, 0, 0, 0);
+	else lua_pop (L, 1);
 
 	return 0;
 }
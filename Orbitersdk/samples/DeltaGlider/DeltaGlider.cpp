@@ -28,6 +28,7 @@
 #include "LightSubsys.h"
 #include "FailureSubsys.h"
 #include "DlgCtrl.h"
+#include "..\Common\Aero\AeroTable.h"
 #include "resource.h"
 #include "meshres.h"
 #include "meshres_vc.h"
@@ -97,19 +98,35 @@ void UpdateCtrlDialog (DeltaGlider *dg, HWND hWnd = 0);
 // function of angle of attack (alpha or beta)
 // ==============================================================
 
+static AeroTable vlift; // lift and moment coefficients vs. angle of attack
+static AeroTable hlift; // lift coefficient vs. slip angle
+
+// --------------------------------------------------------------
+// Build the coefficient tables (called once from InitModule)
+// --------------------------------------------------------------
+static void InitAirfoilTables ()
+{
+	const int vnabsc = 9;
+	static const double AOA[vnabsc] = {-180*RAD,-60*RAD,-30*RAD, -2*RAD, 15*RAD,20*RAD,25*RAD,60*RAD,180*RAD};
+	static const double VC[vnabsc*2] = {   // cl, cm
+		0,0,  0,0,  -0.4,0.014,  0,0.0039,  0.7,-0.006,  1,-0.008,  0.8,-0.010,  0,0,  0,0
+	};
+	vlift.Define (vnabsc, AOA, 2, VC, AEROTABLE_LINEAR | AEROTABLE_PERIODIC);
+
+	const int hnabsc = 8;
+	static const double BETA[hnabsc] = {-180*RAD,-135*RAD,-90*RAD,-45*RAD,45*RAD,90*RAD,135*RAD,180*RAD};
+	static const double HC[hnabsc]   = {       0,    +0.3,      0,   -0.3,  +0.3,     0,   -0.3,      0};
+	hlift.Define (hnabsc, BETA, 1, HC, AEROTABLE_LINEAR | AEROTABLE_PERIODIC);
+}
+
 // 1. vertical lift component (wings and body)
 
 void VLiftCoeff (VESSEL *v, double aoa, double M, double Re, void *context, double *cl, double *cm, double *cd)
 {
-	int i;
-	const int nabsc = 9;
-	static const double AOA[nabsc] = {-180*RAD,-60*RAD,-30*RAD, -2*RAD, 15*RAD,20*RAD,25*RAD,60*RAD,180*RAD};
-	static const double CL[nabsc]  = {       0,      0,   -0.4,      0,    0.7,     1,   0.8,     0,      0};
-	static const double CM[nabsc]  = {       0,      0,  0.014, 0.0039, -0.006,-0.008,-0.010,     0,      0};
-	for (i = 0; i < nabsc-1 && AOA[i+1] < aoa; i++);
-	double f = (aoa-AOA[i]) / (AOA[i+1]-AOA[i]);
-	*cl = CL[i] + (CL[i+1]-CL[i]) * f;  // aoa-dependent lift coefficient
-	*cm = CM[i] + (CM[i+1]-CM[i]) * f;  // aoa-dependent moment coefficient
+	double c[2];
+	vlift.Eval (aoa, c);
+	*cl = c[0];  // aoa-dependent lift coefficient
+	*cm = c[1];  // aoa-dependent moment coefficient
 	double saoa = sin(aoa);
 	double pd = 0.015 + 0.4*saoa*saoa;  // profile drag
 	*cd = pd + oapiGetInducedDrag (*cl, 1.5, 0.7) + oapiGetWaveDrag (M, 0.75, 1.0, 1.1, 0.04);
@@ -120,12 +137,7 @@ void VLiftCoeff (VESSEL *v, double aoa, double M, double Re, void *context, doub
 
 void HLiftCoeff (VESSEL *v, double beta, double M, double Re, void *context, double *cl, double *cm, double *cd)
 {
-	int i;
-	const int nabsc = 8;
-	static const double BETA[nabsc] = {-180*RAD,-135*RAD,-90*RAD,-45*RAD,45*RAD,90*RAD,135*RAD,180*RAD};
-	static const double CL[nabsc]   = {       0,    +0.3,      0,   -0.3,  +0.3,     0,   -0.3,      0};
-	for (i = 0; i < nabsc-1 && BETA[i+1] < beta; i++);
-	*cl = CL[i] + (CL[i+1]-CL[i]) * (beta-BETA[i]) / (BETA[i+1]-BETA[i]);
+	hlift.Eval (beta, cl);
 	*cm = 0.0;
 	*cd = 0.015 + oapiGetInducedDrag (*cl, 1.5, 0.6) + oapiGetWaveDrag (M, 0.75, 1.0, 1.1, 0.04);
 }
@@ -1650,6 +1662,9 @@ DLLCLBK void InitModule (HINSTANCE hModule)
 	g_Param.pen[0] = CreatePen (PS_SOLID, 1, RGB(224,224,224));
 	g_Param.pen[1] = CreatePen (PS_SOLID, 3, RGB(164,164,164));
 	g_Param.surf = oapiLoadTexture ("DG\\blitsrc1.dds", true);
+
+	// airfoil coefficient tables
+	InitAirfoilTables ();
 }
 
 // --------------------------------------------------------------
@@ -21,6 +21,7 @@
 DockingCtrlSubsystem::DockingCtrlSubsystem (DeltaGlider *v)
 : DGSubsystem (v)
 {
+	SetHooks (0);
 	// create component instances
 	AddSubsystem (noseconectrl = new NoseconeCtrl (this));
 	AddSubsystem (undockctrl = new UndockCtrl (this));
@@ -91,6 +92,8 @@ void DockingCtrlSubsystem::clbkDockEvent (int dock, OBJHANDLE mate)
 NoseconeCtrl::NoseconeCtrl (DockingCtrlSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (HOOK_POSTSTEP | HOOK_PARSESCN);
+	RegisterScenarioTag ("NOSECONE");
 	ncone_state.SetOperatingSpeed (NOSE_OPERATING_SPEED);
 	nlever_state.SetOperatingSpeed (4.0);
 
@@ -402,6 +405,7 @@ bool NoseconeIndicator::RedrawVC (DEVMESHHANDLE hMesh, SURFHANDLE surf)
 UndockCtrl::UndockCtrl (DockingCtrlSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (HOOK_POSTSTEP);
 	undock_state.SetOperatingSpeed (10.0);
 	ELID_LEVER = AddElement (lever = new UndockLever (this));
 
@@ -521,6 +525,8 @@ bool UndockLever::ProcessMouseVC (int event, VECTOR3 &p)
 EscapeLadderCtrl::EscapeLadderCtrl (DockingCtrlSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (HOOK_POSTSTEP | HOOK_PARSESCN);
+	RegisterScenarioTag ("LADDER");
 	ladder_state.SetOperatingSpeed (LADDER_OPERATING_SPEED);
 	ELID_SWITCH = AddElement (sw = new LadderSwitch (this));
 	ELID_INDICATOR = AddElement (indicator = new LadderIndicator (this));
@@ -745,6 +751,7 @@ bool LadderIndicator::RedrawVC (DEVMESHHANDLE hMesh, SURFHANDLE surf)
 DocksealCtrl::DocksealCtrl (DockingCtrlSubsystem *_subsys)
 : DGSubsystem (_subsys)
 {
+	SetHooks (HOOK_POSTSTEP);
 	isDocked = false;
 	dockTime = -1e10;
 
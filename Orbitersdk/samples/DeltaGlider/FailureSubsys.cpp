@@ -18,6 +18,7 @@
 FailureSubsystem::FailureSubsystem (DeltaGlider *v)
 : DGSubsystem (v)
 {
+	SetHooks (HOOK_POSTSTEP);
 	bMWSActive = false;
 	ELID_MWS = AddElement (mws = new MwsButton (this));
 }
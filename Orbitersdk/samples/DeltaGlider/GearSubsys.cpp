@@ -23,6 +23,7 @@
 GearSubsystem::GearSubsystem (DeltaGlider *v)
 : DGSubsystem (v)
 {
+	SetHooks (0);
 	// create component instances
 	AddSubsystem (gearctrl = new GearControl (this));
 	AddSubsystem (wheelbrake = new Wheelbrake (this));
@@ -63,6 +64,8 @@ const AnimState2 &GearSubsystem::GearState() const
 GearControl::GearControl (GearSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (HOOK_POSTSTEP | HOOK_PARSESCN);
+	RegisterScenarioTag ("GEAR");
 	gear_state.SetOperatingSpeed (GEAR_OPERATING_SPEED);
 	glever_state.SetOperatingSpeed (4.0);
 
@@ -411,6 +414,7 @@ bool GearIndicator::RedrawVC (DEVMESHHANDLE hMesh, SURFHANDLE surf)
 Wheelbrake::Wheelbrake (GearSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (0);
 	ELID_LEVER = AddElement (lever = new WheelbrakeLever (this));
 }
 
@@ -24,6 +24,7 @@ static const float texw = (float)PANEL2D_TEXW; // texture width
 HoverSubsystem::HoverSubsystem (DeltaGlider *dg)
 : DGSubsystem (dg)
 {
+	SetHooks (HOOK_POSTSTEP);
 	// create the subsystem components
 	AddSubsystem (attctrl = new HoverAttitudeComponent (this));
 	AddSubsystem (holdctrl = new HoverHoldComponent (this));
@@ -89,6 +90,7 @@ void HoverSubsystem::clbkResetVC (int vcid, DEVMESHHANDLE hMesh)
 HoverSubsystemComponent::HoverSubsystemComponent (HoverSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (0);
 }
 
 
@@ -99,6 +101,8 @@ HoverSubsystemComponent::HoverSubsystemComponent (HoverSubsystem *_subsys)
 HoverAttitudeComponent::HoverAttitudeComponent (HoverSubsystem *_subsys)
 : HoverSubsystemComponent(_subsys)
 {
+	SetHooks (HOOK_POSTSTEP | HOOK_PARSESCN);
+	RegisterScenarioTag ("HOVERMODE");
 	mode = 0;
 
 	phover = phover_cmd = 0.0;
@@ -319,6 +323,8 @@ bool HoverAttitudeComponent::clbkLoadVC (int vcid)
 HoverHoldComponent::HoverHoldComponent (HoverSubsystem *_subsys)
 : HoverSubsystemComponent(_subsys)
 {
+	SetHooks (HOOK_POSTSTEP | HOOK_PARSESCN);
+	RegisterScenarioTag ("HOVERHOLD");
 	extern GDIParams g_Param;
 
 	holdalt   = 0.0;
@@ -555,6 +561,7 @@ bool HoverHoldComponent::clbkLoadVC (int vcid)
 HoverManualComponent::HoverManualComponent (HoverSubsystem *_subsys)
 : HoverSubsystemComponent(_subsys)
 {
+	SetHooks (0);
 	ELID_THROTTLE = AddElement (throttle = new HoverThrottle (this));
 
 	// Hover throttle VC animation
@@ -22,6 +22,7 @@
 HUDControl::HUDControl (DeltaGlider *vessel)
 : DGSubsystem (vessel)
 {
+	SetHooks (HOOK_POSTSTEP);
 	last_mode  = HUD_NONE;
 	hud_state.SetOperatingSpeed (HUD_OPERATING_SPEED);
 
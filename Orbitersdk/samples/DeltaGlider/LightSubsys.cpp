@@ -23,6 +23,7 @@
 LightCtrlSubsystem::LightCtrlSubsystem (DeltaGlider *v)
 : DGSubsystem (v)
 {
+	SetHooks (0);
 	// create component instances
 	AddSubsystem (instrlight = new InstrumentLight (this));
 	AddSubsystem (cockpitlight = new CockpitLight (this));
@@ -38,6 +39,8 @@ LightCtrlSubsystem::LightCtrlSubsystem (DeltaGlider *v)
 InstrumentLight::InstrumentLight (LightCtrlSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (HOOK_PARSESCN);
+	RegisterScenarioTag ("INSTRLIGHT");
 	light_on   = false;
 	brightness = 0.5;
 	light_col  = 0;
@@ -193,6 +196,8 @@ bool InstrumentBrightnessDial::ProcessMouseVC (int event, VECTOR3 &p)
 CockpitLight::CockpitLight (LightCtrlSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (HOOK_PARSESCN);
+	RegisterScenarioTag ("FLOODLIGHT");
 	light = NULL;
 	light_mode = 0;
 	brightness = 0.7;
@@ -346,6 +351,8 @@ bool CockpitBrightnessDial::ProcessMouseVC (int event, VECTOR3 &p)
 LandDockLight::LandDockLight (LightCtrlSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (HOOK_PARSESCN);
+	RegisterScenarioTag ("LANDDOCKLIGHT");
 	light_mode = 0;
 	light = NULL;
 	ELID_SWITCH = AddElement (sw = new LandDockLightSwitch (this));
@@ -482,6 +489,8 @@ void LandDockLightSwitch::ResetVC (DEVMESHHANDLE hMesh)
 StrobeLight::StrobeLight (LightCtrlSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (HOOK_PARSESCN);
+	RegisterScenarioTag ("STROBELIGHT");
 	light_on = false;
 	ELID_SWITCH = AddElement (sw = new StrobeLightSwitch (this));
 }
@@ -608,6 +617,8 @@ bool StrobeLightSwitch::ProcessMouseVC (int event, VECTOR3 &p)
 NavLight::NavLight (LightCtrlSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (HOOK_PARSESCN);
+	RegisterScenarioTag ("NAVLIGHT");
 	light_on = false;
 	ELID_SWITCH = AddElement (sw = new NavLightSwitch (this));
 }
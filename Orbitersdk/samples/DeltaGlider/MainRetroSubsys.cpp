@@ -37,6 +37,7 @@ static const float sc_y0 = 431.5f;
 MainRetroSubsystem::MainRetroSubsystem (DeltaGlider *v)
 : DGSubsystem (v)
 {
+	SetHooks (0);
 	// create component instances
 	AddSubsystem (throttle = new MainRetroThrottle (this));
 	AddSubsystem (gimbalctrl = new GimbalControl (this));
@@ -88,6 +89,7 @@ void MainRetroSubsystem::clbkResetVC (int vcid, DEVMESHHANDLE hMesh)
 MainRetroThrottle::MainRetroThrottle (MainRetroSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (0);
 	ELID_LEVERS = AddElement (levers = new MainRetroThrottleLevers (this));
 
 	// VC animation: Left main engine throttle
@@ -266,6 +268,8 @@ bool MainRetroThrottleLevers::ProcessMouseVC (int event, VECTOR3 &p)
 GimbalControl::GimbalControl (MainRetroSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (HOOK_POSTSTEP | HOOK_PARSESCN);
+	RegisterScenarioTag ("MGIMBALMODE");
 	mode = 0;
 	mpmode = mymode = 0;
 	for (int i = 0; i < 2; i++) {
@@ -964,6 +968,8 @@ bool YMainGimbalCtrl::ProcessMouseVC (int event, VECTOR3 &p)
 RetroCoverControl::RetroCoverControl (MainRetroSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (HOOK_POSTSTEP | HOOK_PARSESCN);
+	RegisterScenarioTag ("RCOVER");
 	rcover_state.SetOperatingSpeed(RCOVER_OPERATING_SPEED);
 	ELID_SWITCH = AddElement (sw = new RetroCoverSwitch (this));
 	ELID_INDICATOR = AddElement (indicator = new RetroCoverIndicator(this));
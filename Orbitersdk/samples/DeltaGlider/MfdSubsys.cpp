@@ -82,6 +82,7 @@ const int lbly[6] = {texh-467,texh-426,texh-385,texh-344,texh-303,texh-262};
 MfdSubsystem::MfdSubsystem (DeltaGlider *v, int mfdident)
 : DGSubsystem(v), mfdid(mfdident)
 {
+	SetHooks (0);
 	ELID_BTNROW = AddElement (btnrow = new MfdButtonRow (this));
 	for (int i = 0; i < 2; i++)
 		ELID_BTNCOL[i] = AddElement (btncol[i] = new MfdButtonCol (this, i));
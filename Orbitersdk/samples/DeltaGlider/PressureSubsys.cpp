@@ -27,11 +27,26 @@ double PressureSubsystem::p_target = 100e3;
 PressureSubsystem::PressureSubsystem (DeltaGlider *vessel)
 : DGSubsystem(vessel)
 {
+	SetHooks (HOOK_POSTSTEP);
 	extern GDIParams g_Param;
 
-	p_cabin = p_airlock = 100e3;
-	p_ext_hatch = p_ext_lock = 0.0;
 	docked = false;
+	v_extdock = 2.0; // for now
+
+	// outside the hatch and the outer airlock is the ambient atmosphere,
+	// or the compartment of a docked vessel behind the airlock
+	nd_cabin    = pnet.AddVolume (v_cabin, 100e3);
+	nd_airlock  = pnet.AddVolume (v_airlock, 100e3);
+	nd_exthatch = pnet.AddReservoir (0.0);
+	nd_extlock  = pnet.AddReservoir (0.0);
+	nd_supply   = pnet.AddReservoir (400e3);
+	vv_hatch    = pnet.AddValve (nd_cabin, nd_exthatch);
+	vv_ilock    = pnet.AddValve (nd_cabin, nd_airlock);
+	vv_olock    = pnet.AddValve (nd_airlock, nd_extlock);
+	vv_csupply  = pnet.AddValve (nd_supply, nd_cabin);
+	vv_asupply  = pnet.AddValve (nd_supply, nd_airlock);
+	pnet.SetRegulator (vv_csupply, p_target);
+	pnet.SetRegulator (vv_asupply, p_target);
 
 	AddSubsystem (airlockctrl = new AirlockCtrl (this));
 	AddSubsystem (hatchctrl = new TophatchCtrl (this));
@@ -134,87 +149,24 @@ void PressureSubsystem::clbkPostStep (double simt, double simdt, double mjd)
 
 	docked = DG()->DockingStatus(0) != 0;
 	double p_static = DG()->GetAtmPressure();
-	p_ext_hatch = p_static;
+	pnet.SetPressure (nd_exthatch, p_static);
 	if (!docked) {
-		p_ext_lock = p_static;
+		double p_ext_lock = p_static;
 		if (!DG()->SubsysDocking()->NconeState().IsClosed())
 			p_ext_lock += DG()->GetDynPressure() * DG()->SubsysDocking()->NconeState().State();
+		pnet.SetVolume (nd_extlock, 0.0);
+		pnet.SetPressure (nd_extlock, p_ext_lock);
 	}
-	else v_extdock = 2.0; // for now
-
-	double cs, pdiff, dvol, dpc, dpa, pc, pa;
-
-	// exchange cabin - ext.hatch
-	cs = (valve_status[1] ? 2e-4:0.0);
-	cs += 0.1*HatchState().State();
-	if (cs) {
-		pdiff = p_ext_hatch-p_cabin;
-		dvol = pdiff*cs*simdt*1e3;
-		dpc = dvol/v_cabin;
-		pc = p_cabin + dpc;
-		if (p_cabin > p_ext_hatch) pc = max(pc,p_ext_hatch);
-		else                       pc = min(pc,p_ext_hatch);
-		p_cabin = pc;
-	}
-
-	// exchange airlock - ext.lock
-	cs = (valve_status[3] ? 2e-4:0.0);
-	cs += 1.0*OLockState().State();
-	if (cs) {
-		pdiff = p_ext_lock-p_airlock;
-		dvol = pdiff*cs*simdt*1e3;
-		dpa = dvol/v_airlock;
-		pa = p_airlock + dpa;
-		if (docked) {
-			dpc = -dvol/v_extdock;
-			pc = p_ext_lock + dpc;
-			if ((p_airlock-p_ext_lock)*(pa-pc) < 0.0)
-				pa = pc = (pa*v_airlock + pc*v_extdock)/(v_airlock+v_extdock);
-			p_ext_lock = pc;
-		} else {
-			if (p_airlock > p_ext_lock) pa = max(pa,p_ext_lock);
-			else                        pa = min(pa,p_ext_lock);
-		}
-		p_airlock = pa;
-	}
+	else pnet.SetVolume (nd_extlock, v_extdock);
 
-	// exchange cabin - airlock
-	cs = (valve_status[2] ? 2e-4:0.0);
-	cs += 1.0*ILockState().State();
-	if (cs) {
-		pdiff = p_cabin-p_airlock;
-		dvol = pdiff*cs*simdt*1e3;
-		dpc = -dvol/v_cabin;
-		dpa = dvol/v_airlock;
-		pc = p_cabin + dpc;
-		pa = p_airlock + dpa;
-		if ((p_airlock-p_cabin)*(pa-pc) < 0.0)
-			pa = pc = (pa*v_airlock + pc*v_cabin)/(v_airlock+v_cabin);
-		p_cabin = pc;
-		p_airlock = pa;
-	}
-
-	// supply cabin
-	cs = (valve_status[0] ? 5e-5:0.0);
-	if (cs) {
-		pdiff = 400e3-p_cabin;
-		dvol = pdiff*cs*simdt*1e3;
-		dpc = dvol/v_cabin;
-		pc = p_cabin + dpc;
-		pc = min (pc, p_target);
-		p_cabin = pc;
-	}
+	// valve conductances [m^3/s]
+	pnet.SetConductance (vv_hatch,   1e3*((valve_status[1] ? 2e-4:0.0) + 0.1*HatchState().State()));
+	pnet.SetConductance (vv_olock,   1e3*((valve_status[3] ? 2e-4:0.0) + 1.0*OLockState().State()));
+	pnet.SetConductance (vv_ilock,   1e3*((valve_status[2] ? 2e-4:0.0) + 1.0*ILockState().State()));
+	pnet.SetConductance (vv_csupply, 1e3*(valve_status[0] ? 5e-5:0.0));
+	pnet.SetConductance (vv_asupply, 1e3*(valve_status[4] ? 5e-5:0.0));
 
-	// supply airlock
-	cs = (valve_status[4] ? 5e-5:0.0);
-	if (cs) {
-		pdiff = 400e3-p_airlock;
-		dvol = pdiff*cs*simdt*1e3;
-		dpa = dvol/v_airlock;
-		pa = p_airlock + dpa;
-		pa = min (pa, p_target);
-		p_airlock = pa;
-	}
+	pnet.Step (simdt);
 }
 
 // --------------------------------------------------------------
@@ -282,6 +234,9 @@ bool PressureSubsystem::clbkLoadVC (int vcid)
 AirlockCtrl::AirlockCtrl (PressureSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (HOOK_POSTSTEP | HOOK_PARSESCN);
+	RegisterScenarioTag ("AIRLOCK");
+	RegisterScenarioTag ("IAIRLOCK");
 	ostate.SetOperatingSpeed (AIRLOCK_OPERATING_SPEED);
 	istate.SetOperatingSpeed (AIRLOCK_OPERATING_SPEED);
 
@@ -578,6 +533,8 @@ bool InnerLockSwitch::ProcessMouseVC (int event, VECTOR3 &p)
 TophatchCtrl::TophatchCtrl (PressureSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (HOOK_POSTSTEP | HOOK_PARSESCN);
+	RegisterScenarioTag ("HATCH");
 	hatch_state.SetOperatingSpeed (HATCH_OPERATING_SPEED);
 	hatch_vent   = NULL;
 	hatchfail    = 0;
@@ -14,6 +14,7 @@
 #include "DeltaGlider.h"
 #include "DGSubsys.h"
 #include "DGSwitches.h"
+#include "..\Common\Vessel\PressureNet.h"
 
 // ==============================================================
 
@@ -30,10 +31,10 @@ class PressureSubsystem: public DGSubsystem {
 public:
 	PressureSubsystem (DeltaGlider *vessel);
 	~PressureSubsystem ();
-	inline double PCabin() const { return p_cabin; }
-	inline double PAirlock() const { return p_airlock; }
-	inline double PExtHatch() const { return p_ext_hatch; }
-	inline double PExtLock() const { return p_ext_lock; }
+	inline double PCabin() const { return pnet.Pressure (nd_cabin); }
+	inline double PAirlock() const { return pnet.Pressure (nd_airlock); }
+	inline double PExtHatch() const { return pnet.Pressure (nd_exthatch); }
+	inline double PExtLock() const { return pnet.Pressure (nd_extlock); }
 	inline int GetPValve (int i) const { return valve_status[i]; }
 	inline void SetPValve (int i, int status) { valve_status[i] = status; }
 	const AnimState2 &OLockState () const;
@@ -53,8 +54,12 @@ public:
 
 private:
 	bool docked;
-	double p_cabin, p_airlock;      // current pressure in cabin and airlock [Pa]
-	double p_ext_hatch, p_ext_lock; // current pressure outside hatch and airlock [Pa]
+	PressureNetwork pnet;           // gas exchange between the compartments
+	int nd_cabin, nd_airlock;       // network nodes: cabin and airlock
+	int nd_exthatch, nd_extlock;    // network nodes: outside hatch and airlock
+	int nd_supply;                  // network node: supply tank
+	int vv_hatch, vv_olock, vv_ilock; // network valves: hatch and airlock (including relief valves)
+	int vv_csupply, vv_asupply;     // network valves: cabin and airlock supply
 	static double v_cabin;          // cabin volume [m^3]
 	static double v_airlock;        // airlock volume [m^3]
 	double v_extdock;               // volume of compartment outside airlock
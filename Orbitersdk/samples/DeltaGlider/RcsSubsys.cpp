@@ -21,6 +21,7 @@
 RcsSubsystem::RcsSubsystem (DeltaGlider *dg)
 : DGSubsystem (dg)
 {
+	SetHooks (0);
 	// create component instances
 	AddSubsystem (modeselector = new RcsModeSelector (this));
 
@@ -88,6 +89,7 @@ bool RcsSubsystem::clbkLoadVC (int vcid)
 RcsModeSelector::RcsModeSelector (RcsSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (0);
 	ELID_DIAL = AddElement (dial = new RcsModeDial (this));
 }
 
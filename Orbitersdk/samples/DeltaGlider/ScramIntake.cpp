@@ -0,0 +1,95 @@
+// ==============================================================
+//                ORBITER MODULE: DeltaGlider
+//                  Part of the ORBITER SDK
+//          Copyright (C) 2001-2015 Martin Schweiger
+//                   All rights reserved
+//
+// ScramIntake.cpp
+// Implementation of the scramjet intake model
+// ==============================================================
+
+#include "ScramIntake.h"
+#include <math.h>
+
+// Intake map: the Mach number range ends where the pressure
+// recovery drops to zero. The map nodes are spaced ~0.05 apart,
+// which keeps the interpolated mass flow within 0.03% (of its
+// maximum) of the model (checked by ScramMapTest).
+static const double INTAKE_MMAX = 1.0 + pow (1.0/0.075, 1.0/1.35);
+static const DWORD INTAKE_NM = 161;  // total number of nodes of both segments
+
+// --------------------------------------------------------------
+// constructor
+
+ScramIntake::ScramIntake ()
+{
+	map_gamma = 0.0;   // intake map not computed yet
+	map_mpeak = 0.0;
+}
+
+// --------------------------------------------------------------
+// intake model
+
+double ScramIntake::Model (double gamma, double M)
+{
+	const double dma_scale = 2.7e-4;
+	double tr = 1.0 + 0.5*(gamma-1.0)*M*M;                 // temperature ratio
+	double pr = pow (tr, gamma/(gamma-1.0));               // diffuser/freestream pressure ratio
+	double precov = max (0.0, 1.0-0.075*pow (max(M,1.0)-1.0, 1.35)); // pressure recovery
+	return dma_scale*precov*pr;
+}
+
+// --------------------------------------------------------------
+
+double ScramIntake::MaxMach ()
+{
+	return INTAKE_MMAX;
+}
+
+// --------------------------------------------------------------
+// compute the intake map
+
+void ScramIntake::Define (double gamma) const
+{
+	// locate the mass flow peak (golden section search; the model
+	// rises up to the peak and falls beyond it)
+	const double r = 0.5*(sqrt (5.0)-1.0);
+	double a = 0.0, b = INTAKE_MMAX;
+	double m1 = b-r*(b-a), q1 = Model (gamma, m1);
+	double m2 = a+r*(b-a), q2 = Model (gamma, m2);
+	while (b-a > 1e-9) {
+		if (q1 < q2) { a = m1; m1 = m2; q1 = q2; m2 = a+r*(b-a); q2 = Model (gamma, m2); }
+		else         { b = m2; m2 = m1; q2 = q1; m1 = b-r*(b-a); q1 = Model (gamma, m1); }
+	}
+	map_mpeak = 0.5*(a+b);
+
+	// distribute the nodes over the two segments (the peak node is shared)
+	double x[INTAKE_NM], q[INTAKE_NM];
+	DWORD i, n[2];
+	n[0] = (DWORD)floor ((INTAKE_NM-1)*map_mpeak/INTAKE_MMAX + 0.5) + 1;
+	if (n[0] < 2) n[0] = 2;
+	else if (n[0] > INTAKE_NM-1) n[0] = INTAKE_NM-1;
+	n[1] = INTAKE_NM+1-n[0];
+
+	for (int k = 0; k < 2; k++) {
+		double m0 = (k ? map_mpeak : 0.0), m1 = (k ? INTAKE_MMAX : map_mpeak);
+		for (i = 0; i < n[k]; i++) {
+			x[i] = m0 + (m1-m0)*i/(n[k]-1.0);
+			q[i] = Model (gamma, x[i]);
+		}
+		map[k].Define (n[k], x, 1, q, AEROTABLE_CUBIC);
+	}
+	map_gamma = gamma;
+}
+
+// --------------------------------------------------------------
+// intake map
+
+double ScramIntake::Flow (double gamma, double M) const
+{
+	if (gamma != map_gamma) Define (gamma);  // new atmosphere: recompute the map
+	if (M >= INTAKE_MMAX) return 0.0;  // no pressure recovery
+	double q;
+	map[M < map_mpeak ? 0 : 1].Eval (M, &q);
+	return q;
+}
@@ -0,0 +1,53 @@
+// ==============================================================
+//                ORBITER MODULE: DeltaGlider
+//                  Part of the ORBITER SDK
+//          Copyright (C) 2001-2015 Martin Schweiger
+//                   All rights reserved
+//
+// ScramIntake.h
+// Interface for the scramjet intake model
+//
+// Notes:
+// The intake model (pressure recovery and diffuser compression)
+// only depends on the Mach number and the specific heat ratio of
+// the atmosphere. It contains all transcendental functions of the
+// scramjet cycle, so the engine interpolates it from a Mach number
+// map computed for the current atmosphere. The map is split at the
+// Mach number of maximum mass flow, so that the peak is a map node
+// (the monotone cubic interpolation flattens at local extrema).
+// This class has no vessel dependencies, so the map can be checked
+// against the model outside the simulator (see ScramMapTest).
+// ==============================================================
+
+#ifndef __SCRAMINTAKE_H
+#define __SCRAMINTAKE_H
+
+#include "..\Common\Aero\AeroTable.h"
+
+class ScramIntake {
+public:
+	ScramIntake ();
+	// constructor
+
+	double Flow (double gamma, double M) const;
+	// air mass flow rate per unit intake cross section and freestream
+	// pressure [kg/(s m^2 Pa)] at Mach number M, interpolated from the
+	// intake map (the map is recomputed if gamma has changed)
+
+	static double Model (double gamma, double M);
+	// full intake model, same units as Flow
+
+	static double MaxMach ();
+	// Mach number at which the pressure recovery drops to zero (the
+	// upper limit of the map)
+
+private:
+	void Define (double gamma) const;
+	// compute the intake map for specific heat ratio gamma
+
+	mutable AeroTable map[2];  // intake map: Model over Mach number, below and above the peak
+	mutable double map_gamma;  // specific heat ratio of the intake map
+	mutable double map_mpeak;  // Mach number of maximum mass flow
+};
+
+#endif // !__SCRAMINTAKE_H
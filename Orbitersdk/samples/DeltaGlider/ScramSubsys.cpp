@@ -18,7 +18,8 @@
 Scramjet::Scramjet (VESSEL *v)
 : vessel(v)
 {
-	nthdef = 0;    // no thrusters associated yet
+	nthdef = nthbuf = 0;  // no thrusters associated yet
+	usemap = true;
 }
 
 // --------------------------------------------------------------
@@ -26,7 +27,7 @@ Scramjet::Scramjet (VESSEL *v)
 
 Scramjet::~Scramjet ()
 {
-	if (nthdef) {  // delete list of thruster definitions
+	if (nthbuf) {  // delete list of thruster definitions
 		for (UINT i = 0; i < nthdef; i++)
 			delete thdef[i];
 		delete []thdef;
@@ -49,12 +50,14 @@ void Scramjet::AddThrusterDefinition (THRUSTER_HANDLE th,
 	thd->F       = 0.0;
 	for (int i = 0; i < 3; i++) thd->T[i] = 0.0;
 
-	THDEF **tmp = new THDEF*[nthdef+1];
-	if (nthdef) {
-		memcpy (tmp, thdef, nthdef*sizeof (THDEF*));
-		delete []thdef;
+	if (nthdef == nthbuf) { // grow the list
+		THDEF **tmp = new THDEF*[nthbuf += 4];
+		if (nthdef) {
+			memcpy (tmp, thdef, nthdef*sizeof (THDEF*));
+			delete []thdef;
+		}
+		thdef = tmp;
 	}
-	thdef = tmp;
 	thdef[nthdef++] = thd;
 }
 
@@ -68,21 +71,17 @@ void Scramjet::Thrust (double *F) const
 
 	if (atm) { // atmospheric parameters available
 		
-		double M, Fs, T0, Td, Tb, Tb0, Te, p0, pd, D, rho, cp, v0, ve, tr, lvl, dma, dmf, precov, dmafac;
-		const double eps = 1e-4;
-		const double dma_scale = 2.7e-4;
+		double M, Fs, T0, Td, Tb, Tb0, Te, p0, D, cp, v0, ve, tr, lvl, dma, dmf, dmafac;
 
 		M   = vessel->GetMachNumber();                     // Mach number
 		T0  = vessel->GetAtmTemperature();                 // freestream temperature
 		p0  = vessel->GetAtmPressure();                    // freestream pressure
-		rho = vessel->GetAtmDensity();                     // freestream density
 		cp  = atm->gamma * atm->R / (atm->gamma-1.0);      // specific heat (pressure)
 		v0  = M * sqrt (atm->gamma * atm->R * T0);         // freestream velocity
 		tr  = (1.0 + 0.5*(atm->gamma-1.0) * M*M);          // temperature ratio
 		Td  = T0 * tr;                                     // diffuser temperature
-		pd  = p0 * pow (Td/T0, atm->gamma/(atm->gamma-1.0)); // diffuser pressure
-		precov = max (0.0, 1.0-0.075*pow (max(M,1.0)-1.0, 1.35)); // pressure recovery
-		dmafac = dma_scale*precov*pd;
+		dmafac = p0 * (usemap ? intake.Flow (atm->gamma, M) : IntakeFlow (atm->gamma, M));
+		// air mass flow rate per intake cross section
 
 		for (UINT i = 0; i < nthdef; i++) {
 			Tb0 = thdef[i]->Tb_max;                        // max burner temperature
@@ -92,14 +91,13 @@ void Scramjet::Thrust (double *F) const
 				D   *= lvl;                                // actual fuel-to-air ratio
 
 				dma = dmafac * thdef[i]->Ai;               // air mass flow rate [kg/s]
-				//dma  = rho * v0 * thdef[i]->Ai;            // air mass flow rate
 				dmf  = D * dma;                            // fuel mass flow rate
 				if (dmf > thdef[i]->dmf_max) {             // max fuel rate exceeded
 					dmf = thdef[i]->dmf_max;
 					D = dmf/dma;
 				}
 				Tb   = (D*thdef[i]->Qr/cp + Td) / (1.0+D); // actual burner temperature
-				Te   = Tb * pow (p0/pd, (atm->gamma-1.0)/atm->gamma); // exhaust temperature
+				Te   = Tb / tr;                            // exhaust temperature (isentropic expansion from pd to p0)
 				ve   = sqrt (2.0*cp*(Tb-Te));              // exhaust velocity
 			    Fs  = (1.0+D)*ve - v0;                     // specific thrust
 				thdef[i]->F = F[i] = max (0.0, Fs*dma);    // thrust force
@@ -142,6 +140,7 @@ double Scramjet::TSFC (UINT idx) const
 ScramSubsystem::ScramSubsystem (DeltaGlider *dg)
 : DGSubsystem (dg)
 {
+	SetHooks (HOOK_POSTSTEP);
 	modelidx = dg->FlightModel();
 	scram = new Scramjet (dg);
 	hProp = dg->CreatePropellantResource (fuel_maxmass = TANK2_CAPACITY);
@@ -234,6 +233,7 @@ void ScramSubsystem::clbkPostStep (double simt, double simdt, double mjd)
 ScramThrottle::ScramThrottle (DGSubsystem *_subsys)
 : DGSubsystem(_subsys)
 {
+	SetHooks (0);
 	ELID_LEVER = AddElement (lever = new ScramThrottleLever (this));
 
 	// VC animation: Left scram engine throttle
@@ -13,6 +13,12 @@
 // It is designed to manage all ramjet/scramjet engines of a
 // vessel, so only a single instance should be created. Individual
 // engines can then be defined by the AddThrusterDefinition method.
+//
+// The transcendental part of the engine model (intake pressure
+// recovery and diffuser compression, which only depend on Mach
+// number) is interpolated from a map computed for the current
+// atmosphere (see ScramIntake.h). The remaining cycle is evaluated
+// analytically for each engine.
 // ==============================================================
 
 #ifndef __SCRAMSUBSYS_H
@@ -20,6 +26,7 @@
 
 #include "DeltaGlider.h"
 #include "DGSubsys.h"
+#include "ScramIntake.h"
 
 // ==============================================================
 // Scramjet logic
@@ -64,6 +71,16 @@ public:
 	// returns thrust-specific fuel consumption of thruster idx
 	// based on last thrust calculation
 
+	inline void UseMap (bool use) { usemap = use; }
+	// use the intake map (default), or evaluate the full intake
+	// model at each thrust calculation
+
+	static double IntakeFlow (double gamma, double M)
+	{ return ScramIntake::Model (gamma, M); }
+	// full intake model: air mass flow rate per unit intake cross
+	// section and freestream pressure [kg/(s m^2 Pa)] at Mach number
+	// M, for specific heat ratio gamma
+
 private:
 	VESSEL *vessel;
 	struct THDEF {             // list of ramjet thrusters
@@ -78,6 +95,10 @@ private:
 		double T[3];           //   temperatures                   -+
 	} **thdef;
 	UINT nthdef;               // number of ramjet thrusters
+	UINT nthbuf;               // length of the thdef list
+
+	bool usemap;               // use the intake map
+	ScramIntake intake;        // intake model and map
 };
 
 // ==============================================================
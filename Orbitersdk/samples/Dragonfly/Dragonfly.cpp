@@ -16,6 +16,7 @@
 #include <stdio.h>
 #include <math.h>
 #include "internal.h"
+#include "..\Common\Profile\FrameProf.h"
 //#include "glstuff.cpp"
 HINSTANCE hDLL; 
 double Lsim;
@@ -914,6 +915,7 @@ void Dragonfly::clbkLoadStateEx (FILEHANDLE scn, void *vs)
 
 void Dragonfly::clbkPostStep (double simt, double simdt, double mjd)
 {
+	FRAMEPROF_CALLBACK ("Dragonfly::clbkPostStep");
 	VESSEL2::clbkPostStep (simt, simdt, mjd);
 	Internals.Refresh (simt-Lsim);
 	Lsim = simt;
@@ -3,9 +3,14 @@
 #include <stdio.h>
 
 e_object::e_object()
-{next=NULL;};
+{next=NULL;SRC=NULL;rank=0;
+ Volts=0;Amperes=0;power_load=0;};
 void e_object::refresh(double dt)
 {};
+void e_object::solve()
+{};
+e_object* e_object::Switched()
+{return NULL;};
 
 void e_object::PLOAD(float amp)
 {};
@@ -19,6 +24,8 @@ void e_object::Load(FILEHANDLE scn)
 {};
 E_system::E_system()
 {List.next=NULL;
+ order=NULL;src=NULL;
+ n_obj=0;compiled=0;
 };
 
 E_system::~E_system()
@@ -29,6 +36,8 @@ while (runner) {gone=runner;
 				runner=runner->next;
 				delete gone;
 };
+if (order) delete []order;
+if (src) delete []src;
 };
 e_object* E_system::AddSystem(e_object *object)
 { e_object *runner;
@@ -36,15 +45,78 @@ e_object* E_system::AddSystem(e_object *object)
  while (runner->next) runner=runner->next;
  runner->next=object;
  object->next=NULL;
+ compiled=0;
  return object;
 };
 
-void E_system::Refresh(double dt)
+void E_system::Compile()
 { e_object *runner;
- runner=List.next;
- while (runner){ runner->refresh(dt);
-				 runner=runner->next;}
+ e_object *sw;
+ int i,r,pass,changed;
+ if (order) delete []order;
+ if (src) delete []src;
+ n_obj=0;
+ for (runner=List.next;runner;runner=runner->next) {n_obj++;runner->rank=0;};
+ order=new e_object*[n_obj];
+ src=new e_object*[n_obj];
+ //rank = longest path to the object, over source links and over the
+ //socket that reconnects it. It only depends on the connections, not on
+ //the list, and objects of one rank never read each other, so their
+ //order does not matter. In a loop the ranks keep growing: whatever is
+ //still at n_obj or more after n_obj passes has no generator.
+ for (pass=0,changed=1;changed && pass<n_obj;pass++)
+	for (changed=0,runner=List.next;runner;runner=runner->next)
+	{ if ((runner->SRC)&&(runner->SRC->rank>=runner->rank)) 
+				{runner->rank=runner->SRC->rank+1;changed=1;};
+	  sw=runner->Switched();
+	  if ((sw)&&(runner->rank>=sw->rank)) {sw->rank=runner->rank+1;changed=1;};
+	};
+ //counting sort by rank
+ int *first=new int[n_obj+2];
+ for (r=0;r<n_obj+2;r++) first[r]=0;
+ for (runner=List.next;runner;runner=runner->next)
+	{ if (runner->rank>n_obj) runner->rank=n_obj;
+	  first[runner->rank+1]++;
+	};
+ for (r=1;r<n_obj+2;r++) first[r]+=first[r-1];
+ for (runner=List.next;runner;runner=runner->next)
+	order[first[runner->rank]++]=runner;
+ delete []first;
+ for (i=0;i<n_obj;i++) src[i]=order[i]->SRC;
+ compiled=1;
+};
+
+void E_system::Refresh(double dt)
+{ int i;
+ if (!compiled) Compile();
+ //sockets first: they may reconnect buses for this step
+ for (i=0;i<n_obj;i++)
+	if (order[i]->Switched()) order[i]->refresh(dt);
+ for (i=0;i<n_obj;i++)
+	if (order[i]->SRC!=src[i]) {Compile();break;};
+ for (i=0;i<n_obj;i++)
+	if (!order[i]->Switched()) order[i]->refresh(dt);
+ Solve();
 };	
+
+void E_system::Solve()
+{ int i,pass;
+ float v,diff;
+ //the loads switched during refresh, so bring the voltages and currents
+ //in line with them. Constant current loads are exact after one pass in
+ //rank order; constant power loads (ELoad) change their current with the
+ //voltage, so repeat until the network settles.
+ for (pass=0;pass<10;pass++)
+	{ diff=0;
+	  for (i=0;i<n_obj;i++)
+		{ v=order[i]->Volts;
+		  if (order[i]->rank<n_obj) order[i]->solve();
+		  else order[i]->Volts=0;		//a loop with no generator
+		  if (fabs(order[i]->Volts-v)>diff) diff=fabs(order[i]->Volts-v);
+		};
+	  if (diff<1e-4) break;
+	};
+};
 void E_system::Save(FILEHANDLE scn)
 { e_object *runner;
  runner=List.next;
@@ -62,16 +134,18 @@ void E_system::Load(FILEHANDLE scn)
 
 Socket::Socket(e_object *i_src,e_object *tg1,e_object *tg2,e_object *tg3)
 {
-curent=-1; SRC=i_src; TRG[0]=tg1;TRG[1]=tg2;TRG[2]=tg3;
-SRC->SRC=tg1;socket_handle=-1;
+curent=-1; LOAD=i_src; TRG[0]=tg1;TRG[1]=tg2;TRG[2]=tg3;
+LOAD->SRC=tg1;socket_handle=-1;
 }
 void Socket::refresh(double dt)
 {
 if (socket_handle!=curent)
 			{curent=socket_handle;
-             if (TRG[curent+1]) SRC->connect(TRG[curent+1]);
+             if (TRG[curent+1]) LOAD->connect(TRG[curent+1]);
 			};
 };
+e_object* Socket::Switched()
+{return LOAD;};
 void Socket::Load(FILEHANDLE scn)
 {
    char *line;
@@ -246,6 +320,15 @@ case 3: //purging
 };
 //sprintf(oapiDebugString(),"%0.4f %0.4f %0.4f %0.4f", H2_flow, O2_flow,clogg,reactant);
 };
+void FCell::solve()
+{ //only while running, reaction is the fuel ratio then
+if ((status!=0)||(running)||(!reaction)) return;
+double r=power_load*28.8 / max_power / (1-log(1+clogg));
+Volts=28.8;
+if (r>1.0) Volts=28.8/r;
+Volts=Volts*reaction;
+Amperes=power_load;
+};
 
 void FCell::Cloging(double dt)
 { if (H2_flow) clogg+=(O2_flow/(reactant*H2_flow+0.01)-0.4)/100000*dt; //stuff that gets in the way
@@ -304,6 +387,11 @@ void Battery::refresh(double dt)
 				 else load_handle=-1;
 				}
 };
+void Battery::solve()
+{ if (power<0) return; //dead battery
+  Amperes=power_load;
+  Volts=28.8*c_breaker;
+};
 void Battery::Load(FILEHANDLE scn)
 {
    char *line;
@@ -377,6 +465,12 @@ void DCbus::refresh(double dt)
 
  
 
+};
+void DCbus::solve()
+{ if (tripped) return;
+  if (SRC) Volts=SRC->Volts;
+  else Volts=0.0;
+  Amperes=branch_amps;
 };
 void DCbus::Load(FILEHANDLE scn)
 {
@@ -452,6 +546,12 @@ if (!tripped){
 
 
 }
+void ACbus::solve()
+{ if (tripped) return;
+  if (SRC) Volts=(SRC->Volts)/28.8*36;
+  else Volts=0.0;
+  Amperes=branch_amps;
+};
 void ACbus::Load(FILEHANDLE scn)
 {
    char *line;
@@ -543,8 +643,35 @@ void Fan::Save(FILEHANDLE scn)
 	oapiWriteScenario_string (scn, "    FAN ", cbuf);
 }
 
-Boiler::Boiler(int i_open,int ct,float i_maxf, Valve *i_src,float temps,float i_boil, e_object *ie_SRC):Valve(i_open,ct,i_maxf,i_src)
-{trg_Temp=temps; e_SRC=ie_SRC;amp_load=0; on=1; 
+ELoad::ELoad(e_object *i_SRC)
+{ SRC=i_SRC;
+  watts=0;
+};
+void ELoad::Draw(float power)
+{ watts=power;
+  solve();
+};
+void ELoad::connect(e_object *new_src)
+{ if (SRC) SRC->PUNLOAD(Amperes);
+  SRC=new_src;
+  if (SRC) SRC->PLOAD(Amperes);
+};
+void ELoad::refresh(double dt)
+{ solve();
+};
+void ELoad::solve()
+{ float amps;
+  if (SRC) Volts=SRC->Volts;
+  else Volts=0.0;
+  amps=(Volts>0?watts/Volts:0);		//nothing is drawn from a dead bus
+  if (amps==Amperes) return;
+  if (SRC) {SRC->PUNLOAD(Amperes);
+			SRC->PLOAD(amps);};
+  Amperes=amps;
+};
+
+Boiler::Boiler(int i_open,int ct,float i_maxf, Valve *i_src,float temps,float i_boil, ELoad *ie_SRC):Valve(i_open,ct,i_maxf,i_src)
+{trg_Temp=temps; e_SRC=ie_SRC; on=1; 
  boil_Temp=i_boil;
 };
 void Boiler::refresh(double dt)
@@ -553,9 +680,7 @@ if (e_SRC->Volts)
 {  need_e=(trg_Temp>SRC->Temp?trg_Temp-SRC->Temp:0);	//delta temp in K
            need_e*=c*mass;					//convert this into Joules
 	//	   need_e*=dt;					//1 joule = 1wattsecond
-		   e_SRC->PUNLOAD(amp_load);
-		   amp_load=need_e/e_SRC->Volts;
-		   e_SRC->PLOAD(amp_load);
+		   e_SRC->Draw(need_e);
 		   energy=need_e;
 		   if (!mass) need_e=-1;	//no mass, need to unfrost first		   
 			};
@@ -16,12 +16,15 @@ class e_object:public therm_obj
 	int tripped;		//is the cric. closed
 	int atrip_handle;	//handles for auto-shut-down
 	int reset_handle;	
+	int rank;			//solve order: longest path from a generator
 	e_object *next;
 	e_object();
 	virtual void PLOAD(float amp);
 	virtual void PUNLOAD(float amp);
 	virtual void connect(e_object *new_src);
 	virtual void refresh(double dt);
+	virtual void solve();		//Volts/Amperes for the present loads, no integration
+	virtual e_object* Switched();	//object this one reconnects, if any
 	virtual void Load(FILEHANDLE scn);
 	virtual void Save(FILEHANDLE scn);
 };
@@ -35,15 +38,26 @@ class E_system
 	void Refresh(double dt);
 	void Load (FILEHANDLE scn);
 	void Save (FILEHANDLE scn);
+ private:
+	//the network is refreshed from a compiled solve order, so that every
+	//object sees the current state of its source regardless of the order
+	//of AddSystem calls. The order is rebuilt when a connection changes.
+	void Compile();
+	void Solve();
+	e_object **order;	//objects by rank, sources before their loads
+	e_object **src;		//source of each object when the order was compiled
+	int n_obj;			//number of objects in the order, rank n_obj is unpowered
+	int compiled;		//order is up to date with the list
 };
 class Socket:public e_object
 {public:
   e_object* TRG[4];
-  e_object* SRC;
+  e_object* LOAD;	//object whose source is selected
   int socket_handle;
   int curent;
   Socket(e_object *i_src,e_object *tg1,e_object *tg2,e_object *tg3);
   void refresh(double dt);
+  e_object* Switched();
   void Load (FILEHANDLE scn);
   void Save (FILEHANDLE scn);
   
@@ -72,6 +86,7 @@ class FCell:public e_object
 	virtual void PLOAD(float amp);
 	virtual void PUNLOAD(float amp);
 	virtual void refresh(double dt);
+	virtual void solve();
 	void Cloging(double dt);
 	virtual void Load(FILEHANDLE scn);
 	virtual void Save(FILEHANDLE scn);
@@ -91,6 +106,7 @@ class Battery:public e_object
 	virtual void PUNLOAD(float amp);
 	virtual void connect(e_object *new_src);
 	virtual void refresh(double dt);
+	virtual void solve();
 	virtual void Load(FILEHANDLE scn);
 	virtual void Save(FILEHANDLE scn);
 
@@ -105,6 +121,7 @@ class DCbus: public e_object
 	virtual void PUNLOAD(float amp);
 	virtual void connect(e_object *new_src);
 	virtual void refresh(double dt);
+	virtual void solve();
 	virtual void Load(FILEHANDLE scn);
 	virtual void Save(FILEHANDLE scn);
 };
@@ -117,6 +134,7 @@ class ACbus: public e_object
 	virtual void PUNLOAD(float amp);
 	virtual void connect(e_object *new_src);
 	virtual void refresh(double dt);
+	virtual void solve();
 	virtual void Load(FILEHANDLE scn);
 	virtual void Save(FILEHANDLE scn);
 };
@@ -152,14 +170,22 @@ class Fan:public e_object
   virtual void Load(FILEHANDLE scn);
   virtual void Save(FILEHANDLE scn);
 };
+class ELoad:public e_object	//constant power draw of an object outside the E_system
+{public:
+   float watts;
+   ELoad(e_object *i_SRC);
+   void Draw(float power);
+   virtual void connect(e_object *new_src);
+   virtual void refresh(double dt);
+   virtual void solve();
+};
 class Boiler:public Valve		//this in e_systems 'cause it needs a power source
 {public:
-   float amp_load;
-   e_object *e_SRC;
+   ELoad *e_SRC;				//its load node in the E_system
    float trg_Temp;				//Needed temp
    float boil_Temp;				//at 1 atm =103kPa;
    float on;					//for TB indicators when boiler is off
-   Boiler(int i_open,int ct,float i_maxf, Valve *i_src,float temps,float i_boil, e_object *ie_SRC);
+   Boiler(int i_open,int ct,float i_maxf, Valve *i_src,float temps,float i_boil, ELoad *ie_SRC);
    void refresh(double dt); //just for closing / open
    virtual double Flow(double _need,float dt);
 
@@ -605,7 +605,8 @@ void ShipInternal::Init(VESSEL *vessel)
  H_systems.AddSystem(Valves[7]=new PValve(1,5,78.3,70,120,Tanks[7]));
  H_systems.AddSystem(Valves[8]=new PValve(1,5,78.3,70,120,Tanks[8]));
  H_systems.AddSystem(Valves[13]=new PValve(1,5,290.0,280.0,120,&Man[0]->OV[2])); //reducing O2 press so we can boil it
- H_systems.AddSystem(Valves[22]=new Boiler(1,5,120,Valves[13],295.0,O2_BOILING,DC[0]));//heating it to ~22 deg
+ H_systems.AddSystem(Valves[22]=new Boiler(1,5,120,Valves[13],295.0,O2_BOILING,
+						(ELoad*)E_systems.AddSystem(new ELoad(DC[0]))));//heating it to ~22 deg
 H_systems.AddSystem(Valves[23]=new PValve(1,5,23.0,20.0,120,Valves[22])); //then finnally PP02 ~23kPA
  
 
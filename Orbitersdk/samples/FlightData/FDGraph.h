@@ -12,14 +12,14 @@
 #define __FDGRAPH_H
 
 #include "Common\Dialog\Graph.h"
-#include "stdio.h"
+#include "FDLog.h"
 
 class FlightDataGraph: public Graph {
 public:
 	FlightDataGraph (int _dtype, int _nplot = 1): Graph (_nplot), dtype(_dtype) {}
 	int DType() const { return dtype; }
-	void AppendDataPoint (FILE *f = 0);
-	void WriteHeader (FILE *f);
+	int AppendDataPoint (double *val = 0);
+	int LogColumns (FDLOG_COLUMN *col) const;
 
 private:
 	int dtype;
@@ -0,0 +1,289 @@
+// ==============================================================
+//                 ORBITER MODULE: FlightData
+//                  Part of the ORBITER SDK
+//          Copyright (C) 2003-2015 Martin Schweiger
+//                   All rights reserved
+//
+// FDLog.cpp
+// Flight data log writer implementation.
+// ==============================================================
+
+#include "FDLog.h"
+#include <process.h>
+#include <string.h>
+
+static const char *FDLOG_MAGIC = "ORBFDLOG";
+static const DWORD FDLOG_VERSION = 1;
+
+// ==============================================================
+
+FlightDataLog::FlightDataLog ()
+{
+	f = 0;
+	fmt = FDLOG_TEXT;
+	ring = 0;
+	bufsize = FDLOG_BUFSIZE;
+	flushrec = FDLOG_FLUSHREC;
+	flushms = FDLOG_FLUSHMS;
+	head = tail = dropped = quit = 0;
+	ncol = wcol = 0;
+	hThread = hWake = hSpace = 0;
+}
+
+// --------------------------------------------------------------
+
+FlightDataLog::~FlightDataLog ()
+{
+	Close();
+}
+
+// --------------------------------------------------------------
+
+void FlightDataLog::SetPolicy (DWORD _bufsize, DWORD _flushrec, DWORD _flushms)
+{
+	bufsize = (_bufsize >= 16 ? _bufsize : 16);
+	flushrec = _flushrec;
+	flushms = _flushms;
+}
+
+// --------------------------------------------------------------
+
+bool FlightDataLog::Open (const char *fname, Format _fmt, bool reset, const char *preamble)
+{
+	Close();
+
+	fmt = _fmt;
+	if (fmt == FDLOG_BINARY) {
+		if (!reset) {
+			// only append to an existing binary log with a valid header
+			FDLOG_FILEHEADER hdr;
+			FILE *ftmp = fopen (fname, "rb");
+			if (ftmp) {
+				reset = (fread (&hdr, sizeof(hdr), 1, ftmp) != 1 ||
+					memcmp (hdr.magic, FDLOG_MAGIC, 8) || hdr.version != FDLOG_VERSION);
+				fclose (ftmp);
+			} else reset = true;
+		}
+		if (!(f = fopen (fname, reset ? "wb":"ab"))) return false;
+		if (reset) {
+			FDLOG_FILEHEADER hdr;
+			memset (&hdr, 0, sizeof(hdr));
+			memcpy (hdr.magic, FDLOG_MAGIC, 8);
+			hdr.version = FDLOG_VERSION;
+			fwrite (&hdr, sizeof(hdr), 1, f);
+		}
+	} else {
+		if (!(f = fopen (fname, reset ? "wt":"at"))) return false;
+		if (reset && preamble) fputs (preamble, f);
+	}
+	setvbuf (f, NULL, _IOFBF, 0x10000);
+
+	ring = new Entry[bufsize];
+	head = tail = dropped = quit = 0;
+	ncol = wcol = 0;
+	nunflushed = 0;
+	tflush = GetTickCount();
+
+	unsigned int id;
+	hWake = CreateEvent (NULL, FALSE, FALSE, NULL);
+	hSpace = CreateEvent (NULL, FALSE, FALSE, NULL);
+	hThread = (HANDLE)_beginthreadex (NULL, 4096, &WriterThreadProc, this, 0, &id);
+	return true;
+}
+
+// --------------------------------------------------------------
+
+void FlightDataLog::Close ()
+{
+	if (!f) return;
+
+	InterlockedExchange (&quit, 1);
+	SetEvent (hWake);
+	WaitForSingleObject (hThread, INFINITE);
+	CloseHandle (hThread);
+	CloseHandle (hWake);
+	CloseHandle (hSpace);
+	hThread = hWake = hSpace = 0;
+
+	fclose (f);
+	f = 0;
+	delete []ring;
+	ring = 0;
+}
+
+// --------------------------------------------------------------
+
+FlightDataLog::Entry *FlightDataLog::Reserve (bool wait)
+{
+	while ((DWORD)(head-tail) >= bufsize) {
+		if (!wait) return 0;
+		SetEvent (hWake);
+		WaitForSingleObject (hSpace, 10);
+	}
+	return ring + ((DWORD)head % bufsize);
+}
+
+// --------------------------------------------------------------
+
+void FlightDataLog::Commit ()
+{
+	// the interlocked operation orders the entry data before the index update
+	DWORD pending = (DWORD)(InterlockedIncrement (&head) - tail);
+	if (pending >= bufsize/2) SetEvent (hWake);
+}
+
+// --------------------------------------------------------------
+
+void FlightDataLog::Start (const char *vessel, DWORD _ncol, const FDLOG_COLUMN *_col)
+{
+	if (!f) return;
+	Entry *e = Reserve (true);
+	ncol = e->ncol = (_ncol < FDLOG_MAXCOL ? _ncol : FDLOG_MAXCOL);
+	e->type = FDLOG_ITEM_START;
+	memcpy (e->col, _col, ncol*sizeof(FDLOG_COLUMN));
+	strncpy (e->vessel, vessel, 31); e->vessel[31] = '\0';
+	Commit();
+	SetEvent (hWake);
+}
+
+// --------------------------------------------------------------
+
+void FlightDataLog::Stop (const char *vessel)
+{
+	if (!f) return;
+	Entry *e = Reserve (true);
+	e->type = FDLOG_ITEM_STOP;
+	e->ncol = 0;
+	strncpy (e->vessel, vessel, 31); e->vessel[31] = '\0';
+	Commit();
+	SetEvent (hWake);
+}
+
+// --------------------------------------------------------------
+
+bool FlightDataLog::Record (double t, const double *val)
+{
+	if (!f) return false;
+	Entry *e = Reserve (false);
+	if (!e) {
+		InterlockedIncrement (&dropped);
+		return false;
+	}
+	e->type = FDLOG_ITEM_DATA;
+	e->ncol = ncol;
+	e->t = t;
+	memcpy (e->val, val, ncol*sizeof(double));
+	Commit();
+	return true;
+}
+
+// --------------------------------------------------------------
+
+void FlightDataLog::WriteEntry (const Entry &e)
+{
+	DWORD i;
+
+	if (fmt == FDLOG_BINARY) {
+		DWORD tag = e.type;
+		fwrite (&tag, sizeof(DWORD), 1, f);
+		if (e.type == FDLOG_ITEM_DATA) {
+			float v[FDLOG_MAXCOL];
+			for (i = 0; i < e.ncol; i++) v[i] = (float)e.val[i];
+			fwrite (&e.t, sizeof(double), 1, f);
+			fwrite (v, sizeof(float), e.ncol, f);
+		} else {
+			FDLOG_SEGMENT seg;
+			memset (&seg, 0, sizeof(seg));
+			strcpy (seg.vessel, e.vessel);
+			seg.ncol = e.ncol;
+			fwrite (&seg, sizeof(seg), 1, f);
+			for (i = 0; i < e.ncol; i++) {
+				FDLOG_COLDESC cd;
+				const char *label = e.col[i].label;
+				while (*label == '_') label++; // strip text column padding
+				memset (&cd, 0, sizeof(cd));
+				strncpy (cd.label, label, 15);
+				fwrite (&cd, sizeof(cd), 1, f);
+			}
+		}
+	} else {
+		switch (e.type) {
+		case FDLOG_ITEM_START:
+			fprintf (f, "# Log started for %s\n", e.vessel);
+			fprintf (f, "# ____TIME");
+			for (i = 0; i < e.ncol; i++)
+				fprintf (f, " %s", e.col[i].label);
+			fprintf (f, "\n");
+			break;
+		case FDLOG_ITEM_STOP:
+			fprintf (f, "# Log stopped for %s\n", e.vessel);
+			break;
+		case FDLOG_ITEM_DATA:
+			fprintf (f, "%10.2f", e.t);
+			for (i = 0; i < e.ncol && i < wcol; i++)
+				fprintf (f, col[i].fmt, e.val[i]);
+			fprintf (f, "\n");
+			break;
+		}
+	}
+
+	switch (e.type) {
+	case FDLOG_ITEM_START:
+		wcol = e.ncol;
+		memcpy (col, e.col, wcol*sizeof(FDLOG_COLUMN));
+		break;
+	case FDLOG_ITEM_STOP:
+		fflush (f);
+		nunflushed = 0;
+		tflush = GetTickCount();
+		break;
+	case FDLOG_ITEM_DATA:
+		if (flushrec && ++nunflushed >= flushrec) {
+			fflush (f);
+			nunflushed = 0;
+			tflush = GetTickCount();
+		}
+		break;
+	}
+}
+
+// --------------------------------------------------------------
+
+void FlightDataLog::Drain ()
+{
+	LONG n = InterlockedExchange (&dropped, 0);
+	if (n && fmt == FDLOG_TEXT)
+		fprintf (f, "# %d records dropped (log buffer full)\n", n);
+
+	LONG h = InterlockedCompareExchange (&head, 0, 0);
+	while (tail != h) {
+		WriteEntry (ring[(DWORD)tail % bufsize]);
+		InterlockedIncrement (&tail);
+	}
+	SetEvent (hSpace);
+
+	if (flushms && nunflushed && GetTickCount()-tflush >= flushms) {
+		fflush (f);
+		nunflushed = 0;
+		tflush = GetTickCount();
+	}
+}
+
+// --------------------------------------------------------------
+// Log writer thread function
+
+unsigned int WINAPI FlightDataLog::WriterThreadProc (LPVOID context)
+{
+	FlightDataLog *log = (FlightDataLog*)context;
+	DWORD timeout = (log->flushms ? log->flushms : INFINITE);
+
+	for (;;) {
+		WaitForSingleObject (log->hWake, timeout);
+		log->Drain();
+		if (log->quit) break;
+	}
+	log->Drain(); // pick up records committed after the last pass
+	fflush (log->f);
+	_endthreadex(0);
+	return 0;
+}
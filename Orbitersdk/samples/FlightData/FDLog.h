@@ -0,0 +1,181 @@
+// ==============================================================
+//                 ORBITER MODULE: FlightData
+//                  Part of the ORBITER SDK
+//          Copyright (C) 2003-2015 Martin Schweiger
+//                   All rights reserved
+//
+// FDLog.h
+// Flight data log writer interface.
+//
+// Log records are queued in a fixed-size ring buffer by the
+// simulation thread and written to file by a background thread,
+// so that logging at high sample rates does not stall the frame
+// loop. The log file is kept open between samples.
+//
+// Binary log layout (FDLOG_BINARY):
+//   FDLOG_FILEHEADER
+//   sequence of items, each starting with a DWORD item tag:
+//     FDLOG_ITEM_START: FDLOG_SEGMENT, followed by
+//                       FDLOG_COLDESC x ncol
+//     FDLOG_ITEM_STOP:  FDLOG_SEGMENT (ncol = 0)
+//     FDLOG_ITEM_DATA:  double time, followed by float x ncol
+//   Within a segment, all data items have the same fixed width.
+// ==============================================================
+
+#ifndef __FDLOG_H
+#define __FDLOG_H
+
+#include <windows.h>
+#include <stdio.h>
+
+const DWORD FDLOG_MAXCOL    = 16;     ///< max. number of data columns per record
+const DWORD FDLOG_BUFSIZE   = 4096;   ///< default ring buffer capacity [records]
+const DWORD FDLOG_FLUSHREC  = 1024;   ///< default flush threshold [records]
+const DWORD FDLOG_FLUSHMS   = 1000;   ///< default flush interval [ms]
+
+// Binary log item tags
+#define FDLOG_ITEM_START 1
+#define FDLOG_ITEM_STOP  2
+#define FDLOG_ITEM_DATA  3
+
+/**
+ * \brief Column descriptor
+ * \note The strings must remain valid for the lifetime of the log
+ *   (usually string literals).
+ */
+struct FDLOG_COLUMN {
+	const char *label;   ///< column label for text log header
+	const char *fmt;     ///< printf format for text log values
+};
+
+#pragma pack(push,4)
+
+/**
+ * \brief Binary log file header
+ */
+struct FDLOG_FILEHEADER {
+	char  magic[8];      ///< file identifier ("ORBFDLOG")
+	DWORD version;       ///< file format version
+	DWORD reserved;
+};
+
+/**
+ * \brief Binary log segment descriptor
+ */
+struct FDLOG_SEGMENT {
+	char  vessel[32];    ///< vessel name
+	DWORD ncol;          ///< number of data columns
+};
+
+/**
+ * \brief Binary log column descriptor
+ */
+struct FDLOG_COLDESC {
+	char  label[16];     ///< column label
+};
+
+#pragma pack(pop)
+
+// ==============================================================
+
+class FlightDataLog {
+public:
+	enum Format {
+		FDLOG_TEXT,      ///< formatted text columns
+		FDLOG_BINARY     ///< fixed-width binary records
+	};
+
+	FlightDataLog ();
+	~FlightDataLog ();
+
+	/**
+	 * \brief Set the ring buffer capacity and flush policy.
+	 * \param bufsize ring buffer capacity [records]
+	 * \param flushrec number of written records after which the file
+	 *   is flushed (0 = don't flush on record count)
+	 * \param flushms max. time between file flushes [ms] (0 = don't
+	 *   flush on time)
+	 * \note Only takes effect when the log is next opened.
+	 */
+	void SetPolicy (DWORD bufsize, DWORD flushrec, DWORD flushms);
+
+	/**
+	 * \brief Open the log file and start the writer thread.
+	 * \param fname file name
+	 * \param fmt file format
+	 * \param reset if true, an existing file is overwritten, otherwise
+	 *   new records are appended
+	 * \param preamble text written at the start of a new text log (or NULL)
+	 * \return false if the file could not be opened
+	 */
+	bool Open (const char *fname, Format fmt, bool reset, const char *preamble = 0);
+
+	/**
+	 * \brief Drain all pending records, stop the writer thread and close
+	 *   the file.
+	 */
+	void Close ();
+
+	inline bool IsOpen () const { return f != 0; }
+	inline Format GetFormat () const { return fmt; }
+
+	/**
+	 * \brief Start a new log segment.
+	 * \param vessel vessel name
+	 * \param ncol number of data columns in subsequent records
+	 * \param col list of ncol column descriptors
+	 */
+	void Start (const char *vessel, DWORD ncol, const FDLOG_COLUMN *col);
+
+	/**
+	 * \brief Terminate the current log segment.
+	 * \param vessel vessel name
+	 * \note The file is flushed at the end of each segment.
+	 */
+	void Stop (const char *vessel);
+
+	/**
+	 * \brief Queue a data record.
+	 * \param t sample time [s]
+	 * \param val list of column values (as defined by the last Start call)
+	 * \return false if the ring buffer was full and the record was dropped
+	 * \note Never blocks. Dropped records are reported in the log.
+	 */
+	bool Record (double t, const double *val);
+
+private:
+	struct Entry {
+		DWORD type;                  // FDLOG_ITEM_xxx
+		DWORD ncol;                  // number of columns
+		double t;                    // sample time
+		double val[FDLOG_MAXCOL];    // column values
+		FDLOG_COLUMN col[FDLOG_MAXCOL]; // column descriptors (START only)
+		char vessel[32];             // vessel name (START/STOP only)
+	};
+
+	Entry *Reserve (bool wait);
+	void Commit ();
+	void WriteEntry (const Entry &e);
+	void Drain ();
+	static unsigned int WINAPI WriterThreadProc (LPVOID context);
+
+	FILE *f;                       // log file
+	Format fmt;                    // log file format
+	Entry *ring;                   // record ring buffer
+	DWORD bufsize;                 // ring buffer capacity
+	volatile LONG head;            // next entry to be written by producer
+	volatile LONG tail;            // next entry to be read by writer thread
+	volatile LONG dropped;         // records dropped since last report
+	volatile LONG quit;            // writer thread termination request
+	DWORD flushrec, flushms;       // flush policy
+	DWORD nunflushed;              // records written since last flush
+	DWORD tflush;                  // time of last flush [ms]
+	DWORD ncol;                    // current column count (producer side)
+	FDLOG_COLUMN col[FDLOG_MAXCOL];// current column descriptors (writer side)
+	DWORD wcol;                    // current column count (writer side)
+	HANDLE hThread;                // writer thread
+	HANDLE hWake;                  // wakes the writer thread
+	HANDLE hSpace;                 // signalled when the writer frees buffer space
+};
+
+#endif // !__FDLOG_H
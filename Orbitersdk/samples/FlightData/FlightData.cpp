@@ -16,6 +16,7 @@
 #include "orbitersdk.h"
 #include "resource.h"
 #include "FDGraph.h"
+#include "Common\Profile\FrameProf.h"
 
 #define NGRAPH 9
 #define NRATE 4
@@ -33,15 +34,20 @@ double g_T = 0.0;           // sample time
 double g_DT;                // sample interval
 bool g_bRecording;          // recorder on/off
 bool g_bLogging;            // log to file on/off
+FlightDataLog g_Log;        // log file writer
+FlightDataLog::Format g_LogFmt = FlightDataLog::FDLOG_TEXT; // log file format
 static bool g_bResetLog = true;
 
 static char *desc = "Open a window to track flight parameters of a spacecraft.";
 static char *logfile = "FlightData.log";
+static char *binlogfile = "FlightData.dat";
+static char *cfgfile = "FlightData.cfg";
 
 // ==============================================================
 // Local prototypes
 
 void OpenDlgClbk (void *context);
+void ReadConfig ();
 BOOL CALLBACK MsgProc (HWND, UINT, WPARAM, LPARAM);
 long FAR PASCAL Graph_WndProc (HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
@@ -70,10 +76,12 @@ DLLCLBK void InitModule (HINSTANCE hDLL)
 	RegisterClass (&wndClass);
 
 	Graph::InitGDI();
+	ReadConfig();
 }
 
 DLLCLBK void ExitModule (HINSTANCE hDLL)
 {
+	g_Log.Close();
 	UnregisterClass ("GraphWindow", g_hInst);
 	oapiUnregisterCustomCmd (g_dwCmd);
 
@@ -82,6 +90,7 @@ DLLCLBK void ExitModule (HINSTANCE hDLL)
 
 DLLCLBK void opcPreStep (double simt, double simdt, double mjd)
 {
+	FRAMEPROF_CALLBACK ("FlightData::opcPreStep");
 	if (!g_hDlg) return; // flight data dialog not open
 	if (!g_bRecording) return; // recorder turned off
 
@@ -89,25 +98,43 @@ DLLCLBK void opcPreStep (double simt, double simdt, double mjd)
 
 	if (syst >= g_T+g_DT) {
 
-		FILE *f = 0;
-		if (g_bLogging) {
-			f = fopen (logfile, "at");
-			fprintf (f, "%10.2f", simt);
-		}
-
-		for (DWORD i = 0; i < g_nGraph; i++)
-			g_Graph[i]->AppendDataPoint (f);
-
-		if (f) {
-			fprintf (f, "\n");
-			fclose (f);
+		double val[FDLOG_MAXCOL];
+		double *v = (g_bLogging ? val : 0);
+		for (DWORD i = 0; i < g_nGraph; i++) {
+			int n = g_Graph[i]->AppendDataPoint (v);
+			if (v) v += n;
 		}
+		if (g_bLogging)
+			g_Log.Record (simt, val); // queued for the log writer thread
 
 		g_T = syst;
 		InvalidateRect (GetDlgItem (g_hDlg, IDC_GRAPH), NULL, TRUE);
 	}
 }
 
+// Read log options from Config\FlightData.cfg (optional):
+//   LOGFORMAT = TEXT | BINARY   log file format
+//   LOGBUFFER = <int>           log buffer capacity [records]
+//   LOGFLUSHRECORDS = <int>     flush log file after <int> records (0: never)
+//   LOGFLUSHINTERVAL = <int>    flush log file after <int> ms (0: never)
+
+void ReadConfig ()
+{
+	char cbuf[256];
+	int bufsize = FDLOG_BUFSIZE, flushrec = FDLOG_FLUSHREC, flushms = FDLOG_FLUSHMS;
+
+	FILEHANDLE hFile = oapiOpenFile (cfgfile, FILE_IN_ZEROONFAIL, CONFIG);
+	if (!hFile) return;
+	if (oapiReadItem_string (hFile, "LOGFORMAT", cbuf))
+		g_LogFmt = (!_strnicmp (cbuf, "BINARY", 6) ? FlightDataLog::FDLOG_BINARY : FlightDataLog::FDLOG_TEXT);
+	oapiReadItem_int (hFile, "LOGBUFFER", bufsize);
+	oapiReadItem_int (hFile, "LOGFLUSHRECORDS", flushrec);
+	oapiReadItem_int (hFile, "LOGFLUSHINTERVAL", flushms);
+	oapiCloseFile (hFile, FILE_IN);
+
+	g_Log.SetPolicy (max (bufsize, 0), max (flushrec, 0), max (flushms, 0));
+}
+
 void OpenDlgClbk (void *context)
 {
 	HWND hDlg = oapiOpenDialog (g_hInst, IDD_FLIGHTDATA, MsgProc);
@@ -213,36 +240,39 @@ void DelGraph (HWND hDlg, int which)
 
 void WriteLogHeader (bool start)
 {
-	FILE *f = fopen (logfile, g_bResetLog ? "wt":"at");
-	if (g_bResetLog) {
-		fprintf (f, "Orbiter Flight Data Log Record\n");
-		fprintf (f, "==============================\n");
-		fprintf (f, "Columns:\n");
-		fprintf (f, "\tTIME:     simulation time (seconds)\n");
-		fprintf (f, "\tALT:      altitude (km)\n");
-		fprintf (f, "\tAIRSPEED: airspeed (m/s)\n");
-		fprintf (f, "\tMACH:     Mach number\n");
-		fprintf (f, "\tTEMP:     freestream temperature (K)\n");
-		fprintf (f, "\tSTP:      static pressure (kPa)\n");
-		fprintf (f, "\tDNP:      dynamic pressure (kPa)\n");
-		fprintf (f, "\tAOA:      angle of attack (deg)\n");
-		fprintf (f, "\tSLIP:     horizontal slip angle (deg)\n");
-		fprintf (f, "\tLIFT:     total lift force (kN)\n");
-		fprintf (f, "\tDRAG:     total drag force (kN)\n");
-		fprintf (f, "\tL/D:      lift/drag ratio\n");
-		fprintf (f, "\tMASS:     vessel mass (kg)\n\n");
+	static const char *preamble =
+		"Orbiter Flight Data Log Record\n"
+		"==============================\n"
+		"Columns:\n"
+		"\tTIME:     simulation time (seconds)\n"
+		"\tALT:      altitude (km)\n"
+		"\tAIRSPEED: airspeed (m/s)\n"
+		"\tMACH:     Mach number\n"
+		"\tTEMP:     freestream temperature (K)\n"
+		"\tSTP:      static pressure (kPa)\n"
+		"\tDNP:      dynamic pressure (kPa)\n"
+		"\tAOA:      angle of attack (deg)\n"
+		"\tSLIP:     horizontal slip angle (deg)\n"
+		"\tLIFT:     total lift force (kN)\n"
+		"\tDRAG:     total drag force (kN)\n"
+		"\tL/D:      lift/drag ratio\n"
+		"\tMASS:     vessel mass (kg)\n\n";
+
+	// the log file is kept open until the dialog is closed
+	if (!g_Log.IsOpen()) {
+		const char *fname = (g_LogFmt == FlightDataLog::FDLOG_BINARY ? binlogfile : logfile);
+		if (!g_Log.Open (fname, g_LogFmt, g_bResetLog, preamble)) return;
 		g_bResetLog = false;
 	}
 	if (start) {
-		fprintf (f, "# Log started for %s\n", g_VESSEL->GetName());
-		fprintf (f, "# ____TIME");
+		FDLOG_COLUMN col[FDLOG_MAXCOL];
+		DWORD ncol = 0;
 		for (DWORD i = 0; i < g_nGraph; i++)
-			g_Graph[i]->WriteHeader (f);
-		fprintf (f, "\n");
+			ncol += g_Graph[i]->LogColumns (col+ncol);
+		g_Log.Start (g_VESSEL->GetName(), ncol, col);
 	} else {
-		fprintf (f, "# Log stopped for %s\n", g_VESSEL->GetName());
+		g_Log.Stop (g_VESSEL->GetName());
 	}
-	fclose (f);
 }
 
 // =================================================================================
@@ -271,6 +301,7 @@ BOOL CALLBACK MsgProc (HWND hDlg, UINT uMsg, WPARAM wParam, LPARAM lParam)
 		} return TRUE;
 	case WM_DESTROY:
 		if (g_bRecording && g_bLogging) WriteLogHeader (false);
+		g_Log.Close();
 		if (g_nGraph) {
 			for (DWORD i = 0; i < g_nGraph; i++) delete g_Graph[i];
 			delete []g_Graph;
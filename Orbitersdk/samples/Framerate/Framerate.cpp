@@ -14,6 +14,7 @@
 #include <stdio.h>
 #include "Orbitersdk.h"
 #include "Dialog\Graph.h"
+#include "Profiler.h"
 #include "resource.h"
 
 static char *desc = "Simulation frame rate / time step monitor";
@@ -25,12 +26,20 @@ HINSTANCE g_hInst;                  // module instance handle
 HWND g_hDlg;                        // dialog handle
 DWORD g_dwCmd;                      // custom function identifier
 Graph *g_Graph[2] = {0,0};          // frame rate/time step graphs
+FrameProfiler *g_Prof = 0;          // frame time profiler
+FRAMESTATS g_Stats;                 // frame time statistics for histogram
+bool g_bStats = false;              // g_Stats valid?
+double g_binw = 1.0;                // histogram bin width [ms]
 double g_T = 0.0;                   // sample system time
 double g_simT = 0.0;                // sample simulation time
 double g_DT = 1.0;			        // sample interval
 DWORD g_fcount;                     // frame counter
 bool bDisplay = false;              // display open?
-bool bShowGraph[2] = {true, false}; // show graphs?
+bool bShowGraph[4] = {true, false, false, false}; // show graphs/histogram/callback list?
+
+static char *tracefile = "FrameTrace.json";
+const DWORD NSTATFRAME = 4096;      // number of frames evaluated for statistics
+const int NTOPSCOPE = 64;           // max. number of entries in callback list
 
 // ==============================================================
 // Local prototypes
@@ -63,6 +72,7 @@ DLLCLBK void InitModule (HINSTANCE hDLL)
 	RegisterClass (&wndClass);
 
 	Graph::InitGDI();
+	g_Prof = new FrameProfiler;
 }
 
 DLLCLBK void ExitModule (HINSTANCE hDLL)
@@ -71,10 +81,41 @@ DLLCLBK void ExitModule (HINSTANCE hDLL)
 	oapiUnregisterCustomCmd (g_dwCmd);
 
 	Graph::FreeGDI();
+	delete g_Prof;
+	g_Prof = 0;
+}
+
+// ==============================================================
+// Profiler scope interface for other modules (see Common\Profile\FrameProf.h)
+
+DLLCLBK int fpRegisterScope (const char *name)
+{
+	return (g_Prof ? g_Prof->RegisterScope (name) : -1);
+}
+
+DLLCLBK void fpRecordScope (int scope, LONGLONG t0)
+{
+	if (g_Prof) g_Prof->RecordScope (scope, t0);
+}
+
+DLLCLBK int fpQueryScopes (FRAMEPROF_SCOPESTATS *stats, int nmax, double window)
+{
+	return (g_Prof ? g_Prof->QueryScopes (window, stats, nmax) : -1);
+}
+
+DLLCLBK DWORD fpSession ()
+{
+	return (g_Prof ? g_Prof->Session() : 0);
 }
 
+// ==============================================================
+// Local functions
+
+void UpdateCallbackList (HWND hDlg);
+
 DLLCLBK void opcPreStep (double simt, double simdt, double mjd)
 {
+	g_Prof->Frame(); // frame time stamps are recorded even if the dialog is closed
 	if (!bDisplay) return; // flight data dialog not open
 
 	double syst = oapiGetSysTime(); // ignore time acceleration for graph updates
@@ -96,6 +137,20 @@ DLLCLBK void opcPreStep (double simt, double simdt, double mjd)
 			g_Graph[1]->SetTitle (cbuf);
 			InvalidateRect (GetDlgItem (g_hDlg, IDC_TIMESTEP), NULL, TRUE);
 		}
+		if (bShowGraph[2]) {
+			g_bStats = g_Prof->Stats (NSTATFRAME, g_binw, g_Stats);
+			if (g_bStats) {
+				// adapt the bin width so that the 99th percentile falls into
+				// the upper part of the histogram
+				static const double binw[9] = {0.1, 0.2, 0.25, 0.5, 1.0, 2.0, 2.5, 5.0, 10.0};
+				double w = g_Stats.p99*1.5/FP_NBIN;
+				for (int i = 0; i < 9; i++)
+					if (binw[i] >= w || i == 8) { g_binw = binw[i]; break; }
+			}
+			InvalidateRect (GetDlgItem (g_hDlg, IDC_HISTOGRAM), NULL, TRUE);
+		}
+		if (bShowGraph[3])
+			UpdateCallbackList (g_hDlg);
 		g_T      = syst;
 		g_simT   = simt;
 		g_fcount = 0;
@@ -110,7 +165,9 @@ void OpenDlgClbk (void *context)
 
 void ArrangeGraphs (HWND hDlg)
 {
+	static const int id[4] = {IDC_FRAMERATE, IDC_TIMESTEP, IDC_HISTOGRAM, IDC_TOPLIST};
 	static int hdrofs = 0;
+	int i, n, y;
 	RECT r;
 	GetClientRect (hDlg, &r);
 	if (!hdrofs) {
@@ -121,12 +178,50 @@ void ArrangeGraphs (HWND hDlg)
 	int h = r.bottom-hdrofs;
 	int w = r.right;
 
-	SetWindowPos (GetDlgItem (hDlg, IDC_FRAMERATE), 0,
-	  			  0, hdrofs, w, (bShowGraph[1] ? h/2 : h),
-				  SWP_NOZORDER | SWP_NOCOPYBITS | (bShowGraph[0] ? SWP_SHOWWINDOW : SWP_HIDEWINDOW));
-	SetWindowPos (GetDlgItem (hDlg, IDC_TIMESTEP), 0,
-		          0, hdrofs + (bShowGraph[0] ? h/2 : 0), w, (bShowGraph[0] ? h - h/2 : h),
-				  SWP_NOZORDER | SWP_NOCOPYBITS | (bShowGraph[1] ? SWP_SHOWWINDOW : SWP_HIDEWINDOW));
+	// stack the visible graphs vertically
+	for (i = n = 0; i < 4; i++)
+		if (bShowGraph[i]) n++;
+	int gh0 = (n ? h/n : h);
+	for (i = 0, y = hdrofs; i < 4; i++) {
+		int gh = 0;
+		if (bShowGraph[i]) gh = (--n ? gh0 : hdrofs+h-y); // last graph takes the remainder
+		SetWindowPos (GetDlgItem (hDlg, id[i]), 0, 0, y, w, (gh ? gh : h),
+			SWP_NOZORDER | SWP_NOCOPYBITS | (bShowGraph[i] ? SWP_SHOWWINDOW : SWP_HIDEWINDOW));
+		y += gh;
+	}
+}
+
+// List the most expensive instrumented callbacks over the last second
+
+void UpdateCallbackList (HWND hDlg)
+{
+	static FRAMEPROF_SCOPESTATS stats[NTOPSCOPE];
+	char cbuf[256];
+	int i, n = g_Prof->QueryScopes (1.0, stats, NTOPSCOPE);
+	HWND hList = GetDlgItem (hDlg, IDC_TOPLIST);
+	int top = SendMessage (hList, LB_GETTOPINDEX, 0, 0);
+
+	SendMessage (hList, WM_SETREDRAW, FALSE, 0);
+	SendMessage (hList, LB_RESETCONTENT, 0, 0);
+	SendMessage (hList, LB_ADDSTRING, 0, (LPARAM)"Callback\tms/frame\t% frame\tmax ms\tcalls");
+	for (i = 0; i < n; i++) {
+		sprintf (cbuf, "%s\t%0.3f\t%0.1f\t%0.3f\t%u", stats[i].name, stats[i].perframe,
+			stats[i].share*100.0, stats[i].max, stats[i].calls);
+		SendMessage (hList, LB_ADDSTRING, 0, (LPARAM)cbuf);
+	}
+	if (!n) SendMessage (hList, LB_ADDSTRING, 0, (LPARAM)"(no instrumented callbacks)");
+	SendMessage (hList, LB_SETTOPINDEX, top, 0);
+	SendMessage (hList, WM_SETREDRAW, TRUE, 0);
+	InvalidateRect (hList, NULL, TRUE);
+}
+
+void ExportTrace (HWND hDlg)
+{
+	char cbuf[256];
+	int n = g_Prof->ExportTrace (tracefile);
+	if (n >= 0) sprintf (cbuf, "%d trace events written to %s", n, tracefile);
+	else        sprintf (cbuf, "Could not write %s", tracefile);
+	MessageBox (hDlg, cbuf, "Orbiter Performance Meter", MB_OK | (n >= 0 ? MB_ICONINFORMATION : MB_ICONWARNING));
 }
 
 // =================================================================================
@@ -148,9 +243,17 @@ BOOL CALLBACK MsgProc (HWND hDlg, UINT uMsg, WPARAM wParam, LPARAM lParam)
 		g_Graph[1] = new Graph(1);
 		g_Graph[1]->SetYLabel ("dt");
 		SetWindowLong (GetDlgItem (hDlg, IDC_TIMESTEP), 0, 1);
+		SetWindowLong (GetDlgItem (hDlg, IDC_HISTOGRAM), 0, 2);
+		g_bStats = false;
 		bDisplay = true;
 		SendDlgItemMessage (hDlg, IDC_SHOW_FRAMERATE, BM_SETCHECK, bShowGraph[0] ? BST_CHECKED : BST_UNCHECKED, 0);
 		SendDlgItemMessage (hDlg, IDC_SHOW_TIMESTEP,  BM_SETCHECK, bShowGraph[1] ? BST_CHECKED : BST_UNCHECKED, 0);
+		SendDlgItemMessage (hDlg, IDC_SHOW_HISTOGRAM, BM_SETCHECK, bShowGraph[2] ? BST_CHECKED : BST_UNCHECKED, 0);
+		SendDlgItemMessage (hDlg, IDC_SHOW_TOPLIST,   BM_SETCHECK, bShowGraph[3] ? BST_CHECKED : BST_UNCHECKED, 0);
+		{
+			static int tabstop[4] = {120, 160, 195, 230};
+			SendDlgItemMessage (hDlg, IDC_TOPLIST, LB_SETTABSTOPS, 4, (LPARAM)tabstop);
+		}
 		ArrangeGraphs (hDlg);
 		} return TRUE;
 	case WM_DESTROY:               // destroy dialog box
@@ -182,11 +285,83 @@ BOOL CALLBACK MsgProc (HWND hDlg, UINT uMsg, WPARAM wParam, LPARAM lParam)
 				SendDlgItemMessage (hDlg, IDC_SHOW_TIMESTEP,  BM_SETCHECK, bShowGraph[1] ? BST_CHECKED : BST_UNCHECKED, 0);
 			}
 			return 0;
+		case IDC_SHOW_HISTOGRAM: // show/hide frame time histogram
+			if (HIWORD (wParam) == BN_CLICKED) {
+				bShowGraph[2] = !bShowGraph[2];
+				ArrangeGraphs (hDlg);
+				SendDlgItemMessage (hDlg, IDC_SHOW_HISTOGRAM, BM_SETCHECK, bShowGraph[2] ? BST_CHECKED : BST_UNCHECKED, 0);
+			}
+			return 0;
+		case IDC_SHOW_TOPLIST:   // show/hide callback cost list
+			if (HIWORD (wParam) == BN_CLICKED) {
+				bShowGraph[3] = !bShowGraph[3];
+				ArrangeGraphs (hDlg);
+				SendDlgItemMessage (hDlg, IDC_SHOW_TOPLIST, BM_SETCHECK, bShowGraph[3] ? BST_CHECKED : BST_UNCHECKED, 0);
+				if (bShowGraph[3]) UpdateCallbackList (hDlg);
+			}
+			return 0;
+		case IDC_EXPORT:         // write Chrome trace file
+			if (HIWORD (wParam) == BN_CLICKED)
+				ExportTrace (hDlg);
+			return 0;
 		}
 	}
 	return oapiDefDialogProc (hDlg, uMsg, wParam, lParam);
 }
 
+// =================================================================================
+// Frame time histogram
+// =================================================================================
+
+void DrawHistogram (HDC hDC, int w, int h)
+{
+	int    x0 = w/10,   x1 = w-w/20, dx = x1-x0;
+	int    y0 = h-h/10, y1 = h/5,    dy = y0-y1;
+	DWORD i, bmax = 0;
+	char cbuf[256];
+
+	HFONT pfont = (HFONT)SelectObject (hDC, GetStockObject (ANSI_VAR_FONT));
+	SetTextAlign (hDC, TA_CENTER);
+	if (g_bStats) {
+		sprintf (cbuf, "p50 %0.1f  p95 %0.1f  p99 %0.1f  max %0.1f ms", g_Stats.p50, g_Stats.p95, g_Stats.p99, g_Stats.max);
+		TextOut (hDC, w/2, 0, cbuf, strlen(cbuf));
+
+		for (i = 0; i <= FP_NBIN; i++)
+			if (g_Stats.bin[i] > bmax) bmax = g_Stats.bin[i];
+
+		// bars (the last bar collects frames beyond the histogram range)
+		HBRUSH hBrush = CreateSolidBrush (0x0000ff);
+		HBRUSH hBrushOvf = CreateSolidBrush (0x000080);
+		for (i = 0; i <= FP_NBIN; i++) {
+			if (!g_Stats.bin[i]) continue;
+			RECT r;
+			r.left   = x0 + (dx*i)/(FP_NBIN+1);
+			r.right  = x0 + (dx*(i+1))/(FP_NBIN+1);
+			r.top    = y0 - (int)((dy*g_Stats.bin[i])/bmax);
+			r.bottom = y0;
+			if (r.right-r.left > 2) r.right--;
+			FillRect (hDC, &r, i < FP_NBIN ? hBrush : hBrushOvf);
+		}
+		DeleteObject (hBrush);
+		DeleteObject (hBrushOvf);
+
+		// abscissa labels
+		for (i = 0; i <= FP_NBIN; i += FP_NBIN/4) {
+			int x = x0 + (dx*i)/(FP_NBIN+1);
+			sprintf (cbuf, "%g", i*g_Stats.binwidth);
+			TextOut (hDC, x, y0+2, cbuf, strlen(cbuf));
+		}
+		SetTextAlign (hDC, TA_RIGHT);
+		TextOut (hDC, x1, y0+2, "ms", 2);
+	}
+
+	// axes
+	SelectObject (hDC, GetStockObject (BLACK_PEN));
+	MoveToEx (hDC, x0, y1, NULL);
+	LineTo (hDC, x0, y0); LineTo (hDC, x1, y0);
+	SelectObject (hDC, pfont);
+}
+
 // =================================================================================
 // Graph canvas message handler
 // =================================================================================
@@ -205,7 +380,10 @@ long FAR PASCAL Graph_WndProc (HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lPara
 		hDC = BeginPaint (hWnd, &ps);
 		SetViewportOrgEx (hDC, 0, 0, NULL);
 		int idx = GetWindowLong (hWnd, 0);
-		if (bShowGraph[idx]) g_Graph[idx]->Refresh (hDC, gw, gh);
+		if (bShowGraph[idx]) {
+			if (idx < 2) g_Graph[idx]->Refresh (hDC, gw, gh);
+			else         DrawHistogram (hDC, gw, gh);
+		}
 		EndPaint (hWnd, &ps);
 		} break;
 	}
@@ -0,0 +1,267 @@
+// ==============================================================
+//                 ORBITER MODULE: Framerate
+//                  Part of the ORBITER SDK
+//          Copyright (C) 2003-2015 Martin Schweiger
+//                   All rights reserved
+//
+// Profiler.cpp
+// Frame time profiler implementation.
+// ==============================================================
+
+#include "Profiler.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+// ==============================================================
+
+FrameProfiler::FrameProfiler ()
+{
+	LARGE_INTEGER f;
+	QueryPerformanceFrequency (&f);
+	freq = (double)f.QuadPart;
+	LARGE_INTEGER t;
+	QueryPerformanceCounter (&t);
+	session = ((DWORD)t.QuadPart ^ (DWORD)(t.QuadPart >> 32)) | 1; // unique per instance, never 0
+	mainthread = 0;
+	frame = new LONGLONG[FP_NFRAME];
+	event = new Event[FP_NEVENT];
+	nscope = 0;
+	InitializeCriticalSection (&cs);
+	Reset();
+}
+
+// --------------------------------------------------------------
+
+FrameProfiler::~FrameProfiler ()
+{
+	for (LONG i = 0; i < nscope; i++)
+		delete []scopename[i];
+	DeleteCriticalSection (&cs);
+	delete []frame;
+	delete []event;
+}
+
+// --------------------------------------------------------------
+
+void FrameProfiler::Reset ()
+{
+	for (DWORD i = 0; i < FP_NEVENT; i++)
+		event[i].seq = -1;
+	nframe = 0;
+	nevent = 0;
+}
+
+// --------------------------------------------------------------
+
+void FrameProfiler::Frame ()
+{
+	LARGE_INTEGER t;
+	QueryPerformanceCounter (&t);
+	if (!nframe) mainthread = GetCurrentThreadId();
+	frame[(DWORD)nframe & (FP_NFRAME-1)] = t.QuadPart;
+	InterlockedIncrement (&nframe); // publish the time stamp
+}
+
+// --------------------------------------------------------------
+
+int FrameProfiler::RegisterScope (const char *name)
+{
+	int i, id = -1;
+	EnterCriticalSection (&cs);
+	for (i = 0; i < nscope; i++)
+		if (!strcmp (scopename[i], name)) { id = i; break; }
+	if (id < 0 && (DWORD)nscope < FP_MAXSCOPE) {
+		scopename[nscope] = new char[strlen(name)+1];
+		strcpy (scopename[nscope], name);
+		id = nscope;
+		InterlockedIncrement (&nscope);
+	}
+	LeaveCriticalSection (&cs);
+	return id;
+}
+
+// --------------------------------------------------------------
+
+void FrameProfiler::RecordScope (int scope, LONGLONG t0)
+{
+	if (scope < 0 || scope >= nscope) return;
+	LARGE_INTEGER t1;
+	QueryPerformanceCounter (&t1);
+
+	// claim a ring slot; the sequence number marks the slot as complete
+	// once all fields have been written
+	LONG seq = InterlockedIncrement (&nevent)-1;
+	Event &e = event[(DWORD)seq & (FP_NEVENT-1)];
+	InterlockedExchange (&e.seq, -1);
+	e.scope = scope;
+	e.thread = GetCurrentThreadId();
+	e.t0 = t0;
+	e.t1 = t1.QuadPart;
+	InterlockedExchange (&e.seq, seq);
+}
+
+// --------------------------------------------------------------
+
+bool FrameProfiler::ReadEvent (DWORD i, DWORD ns, Event &e) const
+{
+	// seqlock read: the writer invalidates seq before it fills the slot,
+	// so a copy is consistent if seq was i before and after copying
+	const Event &src = event[i & (FP_NEVENT-1)];
+	if ((DWORD)src.seq != i) return false;
+	e.scope  = src.scope;
+	e.thread = src.thread;
+	e.t0     = src.t0;
+	e.t1     = src.t1;
+	MemoryBarrier();
+	if ((DWORD)src.seq != i) return false;
+	return (DWORD)e.scope < ns;
+}
+
+// --------------------------------------------------------------
+
+bool FrameProfiler::Stats (DWORD n, double binwidth, FRAMESTATS &stats) const
+{
+	DWORD i, nf = (DWORD)nframe;
+	DWORD navail = (nf < FP_NFRAME ? nf : FP_NFRAME);
+	if (navail < 2) return false;
+	if (n > navail-1) n = navail-1;
+
+	std::vector<double> dt(n);
+	double sum = 0.0, scale = 1e3/freq;
+	for (i = 0; i < n; i++) {
+		DWORD k = nf-n+i;
+		dt[i] = (double)(frame[k & (FP_NFRAME-1)] - frame[(k-1) & (FP_NFRAME-1)]) * scale;
+		sum += dt[i];
+	}
+
+	// histogram
+	memset (stats.bin, 0, sizeof(stats.bin));
+	stats.binwidth = binwidth;
+	for (i = 0; i < n; i++) {
+		DWORD b = (DWORD)(dt[i]/binwidth);
+		stats.bin[b < FP_NBIN ? b : FP_NBIN]++;
+	}
+
+	// nearest-rank percentiles
+	std::sort (dt.begin(), dt.end());
+	stats.n = n;
+	stats.mean = sum/n;
+	stats.p50 = dt[(DWORD)(0.50*(n-1)+0.5)];
+	stats.p95 = dt[(DWORD)(0.95*(n-1)+0.5)];
+	stats.p99 = dt[(DWORD)(0.99*(n-1)+0.5)];
+	stats.max = dt[n-1];
+	return true;
+}
+
+// --------------------------------------------------------------
+
+static bool ScopeCostGreater (const FRAMEPROF_SCOPESTATS &a, const FRAMEPROF_SCOPESTATS &b)
+{
+	return a.total > b.total;
+}
+
+// --------------------------------------------------------------
+
+int FrameProfiler::QueryScopes (double window, FRAMEPROF_SCOPESTATS *stats, int nmax) const
+{
+	DWORD i, nf = (DWORD)nframe, ne = (DWORD)nevent, ns = (DWORD)nscope;
+	DWORD f0 = (nf > FP_NFRAME ? nf-FP_NFRAME : 0);
+	DWORD e0 = (ne > FP_NEVENT ? ne-FP_NEVENT : 0);
+	LARGE_INTEGER now;
+	QueryPerformanceCounter (&now);
+	LONGLONG tmin = now.QuadPart - (LONGLONG)(window*freq);
+	double scale = 1e3/freq; // ticks -> milliseconds
+
+	// frames completed in the window
+	DWORD nwframe = 0;
+	LONGLONG frametime = 0;
+	for (i = nf; i > f0+1; i--) {
+		LONGLONG t0 = frame[(i-2) & (FP_NFRAME-1)], t1 = frame[(i-1) & (FP_NFRAME-1)];
+		if (t1 < tmin) break;
+		frametime += t1-t0;
+		nwframe++;
+	}
+
+	// accumulate scope events ending in the window
+	std::vector<FRAMEPROF_SCOPESTATS> acc(ns);
+	for (i = 0; i < ns; i++) {
+		memset (&acc[i], 0, sizeof(FRAMEPROF_SCOPESTATS));
+		strncpy (acc[i].name, scopename[i], 63);
+	}
+	Event e;
+	for (i = e0; i < ne; i++) {
+		if (!ReadEvent (i, ns, e) || e.t1 < tmin) continue;
+		double dt = (e.t1-e.t0)*scale;
+		FRAMEPROF_SCOPESTATS &a = acc[e.scope];
+		a.calls++;
+		a.total += dt;
+		if (dt > a.max) a.max = dt;
+	}
+
+	int n = 0;
+	std::sort (acc.begin(), acc.end(), ScopeCostGreater);
+	for (i = 0; i < ns && n < nmax && acc[i].calls; i++) {
+		acc[i].perframe = (nwframe ? acc[i].total/nwframe : 0.0);
+		acc[i].share = (frametime ? acc[i].total/(frametime*scale) : 0.0);
+		stats[n++] = acc[i];
+	}
+	return n;
+}
+
+// --------------------------------------------------------------
+
+static void WriteJsonString (FILE *f, const char *str)
+{
+	fputc ('"', f);
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\') fputc ('\\', f);
+		if ((unsigned char)*str >= 0x20) fputc (*str, f);
+	}
+	fputc ('"', f);
+}
+
+// --------------------------------------------------------------
+
+int FrameProfiler::ExportTrace (const char *fname) const
+{
+	FILE *f = fopen (fname, "wt");
+	if (!f) return -1;
+
+	DWORD i, nf = (DWORD)nframe, ne = (DWORD)nevent, ns = (DWORD)nscope;
+	DWORD f0 = (nf > FP_NFRAME ? nf-FP_NFRAME : 0);
+	DWORD e0 = (ne > FP_NEVENT ? ne-FP_NEVENT : 0);
+	double scale = 1e6/freq; // ticks -> microseconds
+	int count = 0;
+	Event e;
+
+	// time origin: earliest recorded frame or scope
+	LONGLONG tbase = (nf > f0 ? frame[f0 & (FP_NFRAME-1)] : 0);
+	for (i = e0; i < ne; i++) {
+		if (ReadEvent (i, ns, e) && (!tbase || e.t0 < tbase)) tbase = e.t0;
+	}
+
+	fprintf (f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf (f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Simulation\"}}", mainthread);
+
+	for (i = f0+1; i < nf; i++) {
+		LONGLONG t0 = frame[(i-1) & (FP_NFRAME-1)], t1 = frame[i & (FP_NFRAME-1)];
+		fprintf (f, ",\n{\"name\":\"Frame\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%0.3f,\"dur\":%0.3f,\"args\":{\"frame\":%u}}",
+			mainthread, (t0-tbase)*scale, (t1-t0)*scale, i);
+		count++;
+	}
+	for (i = e0; i < ne; i++) {
+		if (!ReadEvent (i, ns, e)) continue; // overwritten or still being written
+		fprintf (f, ",\n{\"name\":");
+		WriteJsonString (f, scopename[e.scope]);
+		fprintf (f, ",\"cat\":\"scope\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%0.3f,\"dur\":%0.3f}",
+			e.thread, (e.t0-tbase)*scale, (e.t1-e.t0)*scale);
+		count++;
+	}
+	fprintf (f, "\n]}\n");
+
+	bool ok = !ferror (f);
+	fclose (f);
+	return (ok ? count : -1);
+}
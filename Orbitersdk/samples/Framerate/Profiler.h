@@ -0,0 +1,128 @@
+// ==============================================================
+//                 ORBITER MODULE: Framerate
+//                  Part of the ORBITER SDK
+//          Copyright (C) 2003-2015 Martin Schweiger
+//                   All rights reserved
+//
+// Profiler.h
+// Frame time profiler interface.
+//
+// Frame boundaries are time-stamped into a ring buffer by the
+// simulation thread. Named scopes registered by other modules
+// (see Common\Profile\FrameProf.h) are recorded into a second
+// ring buffer that can be written from any thread without locking.
+// ==============================================================
+
+#ifndef __PROFILER_H
+#define __PROFILER_H
+
+#include <windows.h>
+#include "Profile\FrameProf.h"
+
+const DWORD FP_NFRAME   = 8192;    ///< frame ring capacity (power of 2)
+const DWORD FP_NEVENT   = 65536;   ///< scope event ring capacity (power of 2)
+const DWORD FP_MAXSCOPE = 256;     ///< max. number of named scopes
+const DWORD FP_NBIN     = 40;      ///< number of histogram bins (excluding overflow bin)
+
+/**
+ * \brief Frame time statistics
+ * \note All times in milliseconds.
+ */
+struct FRAMESTATS {
+	DWORD  n;                ///< number of frames evaluated
+	double mean;             ///< mean frame time
+	double p50, p95, p99;    ///< frame time percentiles
+	double max;              ///< longest frame time
+	double binwidth;         ///< histogram bin width
+	DWORD  bin[FP_NBIN+1];   ///< histogram counts (last bin: overflow)
+};
+
+class FrameProfiler {
+public:
+	FrameProfiler ();
+	~FrameProfiler ();
+
+	/**
+	 * \brief Mark a frame boundary.
+	 * \note Must be called from the simulation thread once per frame.
+	 */
+	void Frame ();
+
+	/**
+	 * \brief Discard all recorded frames and scope events.
+	 */
+	void Reset ();
+
+	/**
+	 * \brief Register a named scope.
+	 * \return scope identifier, or -1 if the scope table is full
+	 */
+	int RegisterScope (const char *name);
+
+	/**
+	 * \brief Record a completed scope from the calling thread.
+	 * \param scope scope identifier
+	 * \param t0 scope start time [performance counter ticks]
+	 */
+	void RecordScope (int scope, LONGLONG t0);
+
+	/**
+	 * \brief Evaluate the most recent frames.
+	 * \param nframe max. number of frames to evaluate
+	 * \param binwidth histogram bin width [ms]
+	 * \param stats receives the statistics
+	 * \return false if fewer than 2 frames are available
+	 */
+	bool Stats (DWORD nframe, double binwidth, FRAMESTATS &stats) const;
+
+	/**
+	 * \brief Write the recorded frames and scopes as a Chrome trace file.
+	 * \param fname file name
+	 * \return number of trace events written, or -1 on error
+	 * \note The file can be loaded into chrome://tracing or other viewers
+	 *   that accept the Trace Event JSON format.
+	 */
+	int ExportTrace (const char *fname) const;
+
+	/**
+	 * \brief Accumulate the cost of all scopes recorded in a time window.
+	 * \param window evaluation window ending at the current time [s]
+	 * \param stats array receiving up to nmax entries
+	 * \param nmax size of the stats array
+	 * \return number of entries written
+	 * \note Entries are sorted by decreasing accumulated time. Scopes that
+	 *   were not called in the window are omitted.
+	 */
+	int QueryScopes (double window, FRAMEPROF_SCOPESTATS *stats, int nmax) const;
+
+	/**
+	 * \brief Returns the profiler session identifier (never 0).
+	 * \note Differs between profiler instances, so that clients can detect
+	 *   scope identifiers registered with an earlier instance.
+	 */
+	inline DWORD Session () const { return session; }
+
+private:
+	struct Event {
+		volatile LONG seq;     // ring sequence number of completed entry
+		int scope;             // scope identifier
+		DWORD thread;          // recording thread
+		LONGLONG t0, t1;       // start and end time [ticks]
+	};
+	// copy ring event i if it is complete, was not overwritten during
+	// the copy, and refers to one of the first ns scopes
+	bool ReadEvent (DWORD i, DWORD ns, Event &e) const;
+
+	double freq;               // performance counter frequency [Hz]
+	DWORD session;             // session identifier
+	DWORD mainthread;          // simulation thread id
+	LONGLONG *frame;           // frame time stamp ring
+	volatile LONG nframe;      // number of frame time stamps recorded
+	Event *event;              // scope event ring
+	volatile LONG nevent;      // number of scope events started
+	char *scopename[FP_MAXSCOPE]; // registered scope names
+	volatile LONG nscope;      // number of registered scopes
+	CRITICAL_SECTION cs;       // serialises scope registration
+};
+
+#endif // !__PROFILER_H
@@ -9,6 +9,11 @@
 #define IDS_TYPE                        1001
 #define IDC_SHOW_FRAMERATE              1002
 #define IDC_SHOW_TIMESTEP               1003
+#define IDC_HISTOGRAM                   1004
+#define IDC_SHOW_HISTOGRAM              1005
+#define IDC_EXPORT                      1006
+#define IDC_TOPLIST                     1007
+#define IDC_SHOW_TOPLIST                1008
 
 // Next default values for new objects
 // 
@@ -16,7 +21,7 @@
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NEXT_RESOURCE_VALUE        105
 #define _APS_NEXT_COMMAND_VALUE         40005
-#define _APS_NEXT_CONTROL_VALUE         1004
+#define _APS_NEXT_CONTROL_VALUE         1009
 #define _APS_NEXT_SYMED_VALUE           101
 #endif
 #endif
@@ -0,0 +1,674 @@
+// Headless script runner: stub implementation of the Orbiter API
+// Provides the oapi and VESSEL entry points referenced by LuaInterpreter.
+// The functions the script libraries use to query and control vessels
+// operate on the fake vessels in Headless.h. All others do nothing and
+// return zero values, so that script calls into them behave as if the
+// feature were absent.
+
+#include "Headless.h"
+#include "MFDAPI.h"
+#include "DrawAPI.h"
+#include <stdio.h>
+#include <string.h>
+
+// ==============================================================
+// Simulated Orbiter core
+
+namespace Backend {
+	double simt = 0.0, simdt = 0.0;
+	double syst = 0.0, sysdt = 0.0;
+	double mjd = 51544.5;
+
+	static Vessel **vlist = NULL; // vessel list
+	static int nvlist = 0;        // number of vessels
+	static Vessel *focus = NULL;  // focus vessel
+}
+
+void Backend::Advance (double dt)
+{
+	simt += dt;  simdt = dt;
+	syst += dt;  sysdt = dt;
+	mjd += dt/86400.0;
+}
+
+Vessel *Backend::AddVessel (const char *name, const char *classname, bool setfocus)
+{
+	Vessel **tmp = new Vessel*[nvlist+1];
+	if (nvlist) {
+		memcpy (tmp, vlist, nvlist*sizeof(Vessel*));
+		delete []vlist;
+	}
+	vlist = tmp;
+	Vessel *v = vlist[nvlist++] = new Vessel (name, classname);
+	if (setfocus || !focus) focus = v;
+	return v;
+}
+
+void Backend::Clear ()
+{
+	for (int i = 0; i < nvlist; i++) delete vlist[i];
+	if (nvlist) {
+		delete []vlist;
+		vlist = NULL;
+		nvlist = 0;
+	}
+	focus = NULL;
+}
+
+int Backend::nVessel ()
+{
+	return nvlist;
+}
+
+Vessel *Backend::GetVessel (int i)
+{
+	return (i >= 0 && i < nvlist ? vlist[i] : NULL);
+}
+
+Vessel *Backend::FindVessel (OBJHANDLE hObj)
+{
+	for (int i = 0; i < nvlist; i++)
+		if (vlist[i] == (Vessel*)hObj) return vlist[i];
+	return NULL;
+}
+
+// ==============================================================
+// class Vessel
+
+Vessel::Vessel (const char *_name, const char *_classname)
+{
+	strncpy (name, _name, 63);  name[63] = '\0';
+	strncpy (classname, _classname, 63);  classname[63] = '\0';
+	memset (s, 0, NVSCALAR*sizeof(double));
+	memset (v, 0, NVVECTOR*sizeof(VECTOR3));
+	memset (vdef, 0, NVVECTOR*sizeof(bool));
+	memset (&el, 0, sizeof(ELEMENTS));
+	memset (&prm, 0, sizeof(ORBITPARAM));
+	memset (thlevel, 0, NTHGROUP*sizeof(double));
+	memset (adclevel, 0, NAIRCTRL*sizeof(double));
+	adcmode = 7;
+	attmode = 1;
+	navmode = 0;
+	nkey = 0;
+	ref = -1;
+	iface = new VESSEL ((OBJHANDLE)this, 1);
+}
+
+Vessel::~Vessel ()
+{
+	delete iface;
+}
+
+// ==============================================================
+// Object access
+
+DWORD oapiGetObjectCount () { return Backend::nVessel(); }
+OBJHANDLE oapiGetObjectByIndex (int index) { return (OBJHANDLE)Backend::GetVessel (index); }
+DWORD oapiGetVesselCount () { return Backend::nVessel(); }
+OBJHANDLE oapiGetVesselByIndex (int index) { return (OBJHANDLE)Backend::GetVessel (index); }
+bool oapiIsVessel (OBJHANDLE hVessel) { return Backend::FindVessel (hVessel) != NULL; }
+OBJHANDLE oapiGetFocusObject () { return (OBJHANDLE)Backend::focus; }
+OBJHANDLE oapiCameraTarget () { return (OBJHANDLE)Backend::focus; }
+
+OBJHANDLE oapiGetVesselByName (char *name)
+{
+	for (int i = 0; i < Backend::nVessel(); i++) {
+		Vessel *v = Backend::GetVessel (i);
+		if (!_stricmp (v->name, name)) return (OBJHANDLE)v;
+	}
+	return NULL;
+}
+
+OBJHANDLE oapiGetObjectByName (char *name)
+{
+	return oapiGetVesselByName (name);
+}
+
+void oapiGetObjectName (OBJHANDLE hObj, char *name, int n)
+{
+	Vessel *v = Backend::FindVessel (hObj);
+	if (n > 0) {
+		strncpy (name, v ? v->name : "", n-1);
+		name[n-1] = '\0';
+	}
+}
+
+VESSEL *oapiGetVesselInterface (OBJHANDLE hVessel)
+{
+	Vessel *v = Backend::FindVessel (hVessel);
+	return (v ? v->iface : NULL);
+}
+
+VESSEL *oapiGetFocusInterface ()
+{
+	return (Backend::focus ? Backend::focus->iface : NULL);
+}
+
+double oapiGetMass (OBJHANDLE hObj)
+{
+	Vessel *v = Backend::FindVessel (hObj);
+	return (v ? v->s[VS_MASS] : 0.0);
+}
+
+double oapiGetSize (OBJHANDLE hObj)
+{
+	Vessel *v = Backend::FindVessel (hObj);
+	return (v ? v->s[VS_SIZE] : 0.0);
+}
+
+void oapiGetGlobalPos (OBJHANDLE hObj, VECTOR3 *pos)
+{
+	Vessel *v = Backend::FindVessel (hObj);
+	*pos = (v ? v->v[VV_GLOBALPOS] : _V(0,0,0));
+}
+
+void oapiGetGlobalVel (OBJHANDLE hObj, VECTOR3 *vel)
+{
+	Vessel *v = Backend::FindVessel (hObj);
+	*vel = (v ? v->v[VV_GLOBALVEL] : _V(0,0,0));
+}
+
+void oapiGetRelativePos (OBJHANDLE hObj, OBJHANDLE hRef, VECTOR3 *pos)
+{
+	VECTOR3 p, pref;
+	oapiGetGlobalPos (hObj, &p);
+	oapiGetGlobalPos (hRef, &pref);
+	*pos = p-pref;
+}
+
+void oapiGetRelativeVel (OBJHANDLE hObj, OBJHANDLE hRef, VECTOR3 *vel)
+{
+	VECTOR3 v, vref;
+	oapiGetGlobalVel (hObj, &v);
+	oapiGetGlobalVel (hRef, &vref);
+	*vel = v-vref;
+}
+
+void oapiGetFocusGlobalPos (VECTOR3 *pos) { oapiGetGlobalPos (oapiGetFocusObject(), pos); }
+void oapiGetFocusGlobalVel (VECTOR3 *vel) { oapiGetGlobalVel (oapiGetFocusObject(), vel); }
+void oapiGetFocusRelativePos (OBJHANDLE hRef, VECTOR3 *pos) { oapiGetRelativePos (oapiGetFocusObject(), hRef, pos); }
+void oapiGetFocusRelativeVel (OBJHANDLE hRef, VECTOR3 *vel) { oapiGetRelativeVel (oapiGetFocusObject(), hRef, vel); }
+
+// scalar state of a vessel, for the oapiGetXXX (OBJHANDLE, double*) functions
+static BOOL GetVesselScalar (OBJHANDLE hVessel, int idx, double *val)
+{
+	Vessel *v = Backend::FindVessel (hVessel);
+	if (!v) return FALSE;
+	*val = v->s[idx];
+	return TRUE;
+}
+
+BOOL oapiGetAltitude (OBJHANDLE hVessel, double *alt) { return GetVesselScalar (hVessel, VS_ALTITUDE, alt); }
+BOOL oapiGetPitch (OBJHANDLE hVessel, double *pitch) { return GetVesselScalar (hVessel, VS_PITCH, pitch); }
+BOOL oapiGetBank (OBJHANDLE hVessel, double *bank) { return GetVesselScalar (hVessel, VS_BANK, bank); }
+BOOL oapiGetHeading (OBJHANDLE hVessel, double *heading) { return GetVesselScalar (hVessel, VS_YAW, heading); }
+BOOL oapiGetAirspeed (OBJHANDLE hVessel, double *airspeed) { return GetVesselScalar (hVessel, VS_AIRSPEED, airspeed); }
+BOOL oapiGetGroundspeed (OBJHANDLE hVessel, double *groundspeed) { return GetVesselScalar (hVessel, VS_GROUNDSPEED, groundspeed); }
+
+bool oapiGetAirspeedVector (OBJHANDLE hVessel, REFFRAME frame, VECTOR3 *v)
+{
+	Vessel *vs = Backend::FindVessel (hVessel);
+	if (!vs) return false;
+	*v = vs->v[VV_AIRSPEEDVECTOR];
+	return true;
+}
+
+bool oapiGetGroundspeedVector (OBJHANDLE hVessel, REFFRAME frame, VECTOR3 *vel)
+{
+	Vessel *vs = Backend::FindVessel (hVessel);
+	if (!vs) return false;
+	*vel = vs->v[VV_GROUNDSPEEDVECTOR];
+	return true;
+}
+
+void oapiGetAtm (OBJHANDLE hVessel, ATMPARAM *prm, OBJHANDLE *hAtmRef)
+{
+	Vessel *v = Backend::FindVessel (hVessel);
+	prm->T   = (v ? v->s[VS_ATMTEMPERATURE] : 0.0);
+	prm->p   = (v ? v->s[VS_ATMPRESSURE] : 0.0);
+	prm->rho = (v ? v->s[VS_ATMDENSITY] : 0.0);
+	if (hAtmRef) *hAtmRef = NULL;
+}
+
+// ==============================================================
+// Simulation time
+
+double oapiGetSimTime () { return Backend::simt; }
+double oapiGetSimStep () { return Backend::simdt; }
+double oapiGetSysTime () { return Backend::syst; }
+double oapiGetSysStep () { return Backend::sysdt; }
+double oapiGetSimMJD () { return Backend::mjd; }
+double oapiGetSysMJD () { return Backend::mjd; }
+double oapiTime2MJD (double simt) { return Backend::mjd + (simt-Backend::simt)/86400.0; }
+double oapiGetTimeAcceleration () { return 1.0; }
+
+bool oapiSetSimMJD (double mjd, int pmode)
+{
+	Backend::mjd = mjd;
+	return true;
+}
+
+// ==============================================================
+// Miscellaneous
+
+char *oapiDebugString ()
+{
+	static char dbgstr[256] = "";
+	return dbgstr;
+}
+
+NOTEHANDLE oapiCreateAnnotation (bool exclusive, double size, const VECTOR3 &col)
+{
+	static int note;
+	return (NOTEHANDLE)&note;
+}
+
+bool oapiDelAnnotation (NOTEHANDLE hNote) { return true; }
+
+// ==============================================================
+// class VESSEL
+
+VESSEL::VESSEL (OBJHANDLE hVessel, int fmodel)
+{
+	vessel = (Vessel*)hVessel;
+	flightmodel = (short)fmodel;
+	version = 1;
+}
+
+const OBJHANDLE VESSEL::GetHandle () const { return (OBJHANDLE)vessel; }
+char *VESSEL::GetName () const { return vessel->name; }
+char *VESSEL::GetClassName () const { return vessel->classname; }
+int VESSEL::GetFlightModel () const { return flightmodel; }
+bool VESSEL::GetEnableFocus () const { return true; }
+
+double VESSEL::GetMass () const { return vessel->s[VS_MASS]; }
+double VESSEL::GetSize () const { return vessel->s[VS_SIZE]; }
+double VESSEL::GetAltitude () const { return vessel->s[VS_ALTITUDE]; }
+double VESSEL::GetPitch () const { return vessel->s[VS_PITCH]; }
+double VESSEL::GetBank () const { return vessel->s[VS_BANK]; }
+double VESSEL::GetYaw () const { return vessel->s[VS_YAW]; }
+double VESSEL::GetAirspeed () const { return vessel->s[VS_AIRSPEED]; }
+double VESSEL::GetGroundspeed () const { return vessel->s[VS_GROUNDSPEED]; }
+double VESSEL::GetAOA () const { return vessel->s[VS_AOA]; }
+double VESSEL::GetSlipAngle () const { return vessel->s[VS_SLIPANGLE]; }
+double VESSEL::GetDynPressure () const { return vessel->s[VS_DYNPRESSURE]; }
+double VESSEL::GetMachNumber () const { return vessel->s[VS_MACHNUMBER]; }
+double VESSEL::GetAtmDensity () const { return vessel->s[VS_ATMDENSITY]; }
+double VESSEL::GetAtmPressure () const { return vessel->s[VS_ATMPRESSURE]; }
+double VESSEL::GetAtmTemperature () const { return vessel->s[VS_ATMTEMPERATURE]; }
+
+void VESSEL::GetGlobalPos (VECTOR3 &pos) const { pos = vessel->v[VV_GLOBALPOS]; }
+void VESSEL::GetGlobalVel (VECTOR3 &vel) const { vel = vessel->v[VV_GLOBALVEL]; }
+void VESSEL::GetAngularVel (VECTOR3 &avel) const { avel = vessel->v[VV_ANGVEL]; }
+void VESSEL::SetAngularVel (const VECTOR3 &avel) const { vessel->v[VV_ANGVEL] = avel; }
+void VESSEL::GetRelativePos (OBJHANDLE hRef, VECTOR3 &pos) const { oapiGetRelativePos ((OBJHANDLE)vessel, hRef, &pos); }
+void VESSEL::GetRelativeVel (OBJHANDLE hRef, VECTOR3 &vel) const { oapiGetRelativeVel ((OBJHANDLE)vessel, hRef, &vel); }
+
+void VESSEL::GetRotationMatrix (MATRIX3 &R) const
+{
+	R = _M(1,0,0, 0,1,0, 0,0,1);
+}
+
+bool VESSEL::GetAirspeedVector (REFFRAME frame, VECTOR3 &v) const
+{
+	v = vessel->v[VV_AIRSPEEDVECTOR];
+	return true;
+}
+
+bool VESSEL::GetGroundspeedVector (REFFRAME frame, VECTOR3 &v) const
+{
+	v = vessel->v[VV_GROUNDSPEEDVECTOR];
+	return true;
+}
+
+// force vectors are only available if the scenario defines them
+bool VESSEL::GetWeightVector (VECTOR3 &G) const
+{
+	G = vessel->v[VV_WEIGHTVECTOR];
+	return vessel->vdef[VV_WEIGHTVECTOR];
+}
+
+bool VESSEL::GetThrustVector (VECTOR3 &T) const
+{
+	T = vessel->v[VV_THRUSTVECTOR];
+	return vessel->vdef[VV_THRUSTVECTOR];
+}
+
+bool VESSEL::GetLiftVector (VECTOR3 &L) const
+{
+	L = vessel->v[VV_LIFTVECTOR];
+	return vessel->vdef[VV_LIFTVECTOR];
+}
+
+bool VESSEL::GetElements (OBJHANDLE hRef, ELEMENTS &el, ORBITPARAM *prm, double mjd_ref, int frame) const
+{
+	el = vessel->el;
+	if (prm) *prm = vessel->prm;
+	return true;
+}
+
+double VESSEL::GetThrusterGroupLevel (THGROUP_TYPE thgt) const
+{
+	return (thgt >= 0 && thgt < NTHGROUP ? vessel->thlevel[thgt] : 0.0);
+}
+
+void VESSEL::SetThrusterGroupLevel (THGROUP_TYPE thgt, double level) const
+{
+	if (thgt >= 0 && thgt < NTHGROUP)
+		vessel->thlevel[thgt] = (level < 0.0 ? 0.0 : level > 1.0 ? 1.0 : level);
+}
+
+void VESSEL::IncThrusterGroupLevel (THGROUP_TYPE thgt, double dlevel) const
+{
+	SetThrusterGroupLevel (thgt, GetThrusterGroupLevel (thgt) + dlevel);
+}
+
+void VESSEL::IncThrusterGroupLevel_SingleStep (THGROUP_TYPE thgt, double dlevel) const
+{
+	IncThrusterGroupLevel (thgt, dlevel);
+}
+
+double VESSEL::GetControlSurfaceLevel (AIRCTRL_TYPE type) const
+{
+	return (type >= 0 && type < NAIRCTRL ? vessel->adclevel[type] : 0.0);
+}
+
+void VESSEL::SetControlSurfaceLevel (AIRCTRL_TYPE type, double level) const
+{
+	if (type >= 0 && type < NAIRCTRL)
+		vessel->adclevel[type] = (level < -1.0 ? -1.0 : level > 1.0 ? 1.0 : level);
+}
+
+DWORD VESSEL::GetADCtrlMode () const { return vessel->adcmode; }
+void VESSEL::SetADCtrlMode (DWORD mode) const { vessel->adcmode = mode; }
+int VESSEL::GetAttitudeMode () const { return vessel->attmode; }
+
+bool VESSEL::SetAttitudeMode (int mode) const
+{
+	if (mode < 0 || mode > 2) return false;
+	vessel->attmode = mode;
+	return true;
+}
+
+bool VESSEL::ActivateNavmode (int mode)
+{
+	if (mode < NAVMODE_KILLROT || mode > NAVMODE_HOLDALT) return false;
+	vessel->navmode |= (1 << mode);
+	return true;
+}
+
+bool VESSEL::DeactivateNavmode (int mode)
+{
+	if (!GetNavmodeState (mode)) return false;
+	vessel->navmode &= ~(1 << mode);
+	return true;
+}
+
+bool VESSEL::GetNavmodeState (int mode)
+{
+	return (mode >= NAVMODE_KILLROT && mode <= NAVMODE_HOLDALT && (vessel->navmode & (1 << mode)) != 0);
+}
+
+int VESSEL::SendBufferedKey (DWORD key, bool down, char *kstate)
+{
+	if (vessel->nkey == MAXKEY) return 0;
+	vessel->key[vessel->nkey++] = key;
+	return 1;
+}
+
+// ==============================================================
+// Unsupported functions
+// The remaining entry points referenced by LuaInterpreter. Output
+// arguments are cleared where the function returns no status.
+
+void oapiAnnotationSetColour (NOTEHANDLE hNote, const VECTOR3 &col) {}
+void oapiAnnotationSetPos (NOTEHANDLE hNote, double x1, double y1, double x2, double y2) {}
+void oapiAnnotationSetSize (NOTEHANDLE hNote, double size) {}
+void oapiAnnotationSetText (NOTEHANDLE hNote, char *note) {}
+double oapiCameraAperture () { return 0.0; }
+void oapiCameraAttach (OBJHANDLE hObj, int mode) {}
+void oapiCameraGlobalDir (VECTOR3 *gdir) { *gdir = _V(0,0,0); }
+void oapiCameraGlobalPos (VECTOR3 *gpos) { *gpos = _V(0,0,0); }
+void oapiCameraSetAperture (double aperture) {}
+bool oapiDeleteVessel (OBJHANDLE hVessel, OBJHANDLE hAlternativeCameraTarget) { return false; }
+int oapiEditMeshGroup (DEVMESHHANDLE hMesh, DWORD grpidx, GROUPEDITSPEC *ges) { return 0; }
+void oapiEquToGlobal (OBJHANDLE hObj, double lng, double lat, double rad, VECTOR3 *glob) { *glob = _V(0,0,0); }
+double oapiGetEmptyMass (OBJHANDLE hVessel) { return 0.0; }
+double oapiGetFuelMass (OBJHANDLE hVessel) { return 0.0; }
+double oapiGetInducedDrag (double cl, double A, double e) { return 0.0; }
+double oapiGetMaxFuelMass (OBJHANDLE hVessel) { return 0.0; }
+int oapiGetMeshGroup (DEVMESHHANDLE hMesh, DWORD grpidx, GROUPREQUESTSPEC *grs) { return 0; }
+DWORD oapiGetNavChannel (NAVHANDLE hNav) { return 0; }
+int oapiGetNavData (NAVHANDLE hNav, NAVDATA *data) { return 0; }
+int oapiGetNavDescr (NAVHANDLE hNav, char *descr, int maxlen) { return 0; }
+void oapiGetNavPos (NAVHANDLE hNav, VECTOR3 *gpos) { *gpos = _V(0,0,0); }
+float oapiGetNavRange (NAVHANDLE hNav) { return 0.0f; }
+double oapiGetNavSignal (NAVHANDLE hNav, const VECTOR3 &gpos) { return 0.0; }
+DWORD oapiGetNavType (NAVHANDLE hNav) { return 0; }
+bool oapiGetPause () { return false; }
+PROPELLANT_HANDLE oapiGetPropellantHandle (OBJHANDLE hVessel, DWORD idx) { return NULL; }
+double oapiGetPropellantMass (PROPELLANT_HANDLE ph) { return 0.0; }
+double oapiGetPropellantMaxMass (PROPELLANT_HANDLE ph) { return 0.0; }
+double oapiGetWaveDrag (double M, double M1, double M2, double M3, double cmax) { return 0.0; }
+MESHGROUP *oapiMeshGroup (DEVMESHHANDLE hMesh, DWORD idx) { return NULL; }
+bool oapiOpenHelp (HELPCONTEXT *hcontext) { return false; }
+void oapiOpenInputBoxEx (const char *title, bool (*Clbk_enter)(void*,char*,void*), bool (*Clbk_cancel)(void*,char*,void*), char *buf, int vislen, void *usrdata, DWORD flags) {}
+void oapiOpenMFD (int mode, int mfd) {}
+double oapiOrthodome (double lng1, double lat1, double lng2, double lat2) { return 0.0; }
+void oapiSetEmptyMass (OBJHANDLE hVessel, double mass) {}
+bool oapiSetHUDMode (int mode) { return false; }
+void oapiSetPanelBlink (VECTOR3 v[4]) {}
+void oapiSetPause (bool pause) {}
+void oapiSetTimeAcceleration (double warp) {}
+void oapiWriteLogV (const char *format, ...) {}
+
+BOOL oapiGetEquPos (OBJHANDLE hVessel, double *longitude, double *latitude, double *radius)
+{
+	*longitude = 0.0;
+	*latitude = 0.0;
+	*radius = 0.0;
+	return FALSE;
+}
+
+void oapiGlobalToEqu (OBJHANDLE hObj, const VECTOR3 &glob, double *lng, double *lat, double *rad)
+{
+	*lng = 0.0;
+	*lat = 0.0;
+	*rad = 0.0;
+}
+
+ANIMATIONCOMPONENT_HANDLE VESSEL::AddAnimationComponent (UINT anim, double state0, double state1, MGROUP_TRANSFORM *trans, ANIMATIONCOMPONENT_HANDLE parent) const { return NULL; }
+UINT VESSEL::AddExhaust (THRUSTER_HANDLE th, double lscale, double wscale, SURFHANDLE tex) const { return 0; }
+UINT VESSEL::AddExhaust (THRUSTER_HANDLE th, double lscale, double wscale, const VECTOR3 &pos, const VECTOR3 &dir, SURFHANDLE tex) const { return 0; }
+UINT VESSEL::AddExhaust (THRUSTER_HANDLE th, double lscale, double wscale, double lofs, SURFHANDLE tex) const { return 0; }
+PSTREAM_HANDLE VESSEL::AddExhaustStream (THRUSTER_HANDLE th, PARTICLESTREAMSPEC *pss) const { return NULL; }
+PSTREAM_HANDLE VESSEL::AddExhaustStream (THRUSTER_HANDLE th, const VECTOR3 &pos, PARTICLESTREAMSPEC *pss) const { return NULL; }
+UINT VESSEL::AddMesh (MESHHANDLE hMesh, const VECTOR3 *ofs) const { return 0; }
+UINT VESSEL::AddMesh (const char *meshname, const VECTOR3 *ofs) const { return 0; }
+LightEmitter *VESSEL::AddPointLight (const VECTOR3 &pos, double range, double att0, double att1, double att2, COLOUR4 diffuse, COLOUR4 specular, COLOUR4 ambient) const { return NULL; }
+LightEmitter *VESSEL::AddSpotLight (const VECTOR3 &pos, const VECTOR3 &dir, double range, double att0, double att1, double att2, double umbra, double penumbra, COLOUR4 diffuse, COLOUR4 specular, COLOUR4 ambient) const { return NULL; }
+bool VESSEL::AttachChild (OBJHANDLE child, ATTACHMENTHANDLE attachment, ATTACHMENTHANDLE child_attachment) const { return false; }
+DWORD VESSEL::AttachmentCount (bool toparent) const { return 0; }
+void VESSEL::ClearAttachments () const {}
+void VESSEL::ClearLightEmitters () const {}
+void VESSEL::ClearMeshes (bool retain_anim) const {}
+void VESSEL::ClearPropellantResources () const {}
+void VESSEL::ClearThrusterDefinitions () const {}
+AIRFOILHANDLE VESSEL::CreateAirfoil3 (AIRFOIL_ORIENTATION align, const VECTOR3 &ref, AirfoilCoeffFuncEx cf, void *context, double c, double S, double A) const { return NULL; }
+UINT VESSEL::CreateAnimation (double initial_state) const { return 0; }
+ATTACHMENTHANDLE VESSEL::CreateAttachment (bool toparent, const VECTOR3 &pos, const VECTOR3 &dir, const VECTOR3 &rot, const char *id, bool loose) const { return NULL; }
+CTRLSURFHANDLE VESSEL::CreateControlSurface3 (AIRCTRL_TYPE type, double area, double dCl, const VECTOR3 &ref, int axis, double delay, UINT anim) const { return NULL; }
+DOCKHANDLE VESSEL::CreateDock (const VECTOR3 &pos, const VECTOR3 &dir, const VECTOR3 &rot) const { return NULL; }
+PROPELLANT_HANDLE VESSEL::CreatePropellantResource (double maxmass, double mass, double efficiency) const { return NULL; }
+THRUSTER_HANDLE VESSEL::CreateThruster (const VECTOR3 &pos, const VECTOR3 &dir, double maxth0, PROPELLANT_HANDLE hp, double isp0, double isp_ref, double p_ref) const { return NULL; }
+THGROUP_HANDLE VESSEL::CreateThrusterGroup (THRUSTER_HANDLE *th, int nth, THGROUP_TYPE thgt) const { return NULL; }
+bool VESSEL::DelAirfoil (AIRFOILHANDLE hAirfoil) const { return false; }
+bool VESSEL::DelAnimation (UINT anim) const { return false; }
+bool VESSEL::DelAttachment (ATTACHMENTHANDLE attachment) const { return false; }
+bool VESSEL::DelDock (DOCKHANDLE hDock) const { return false; }
+bool VESSEL::DelExhaust (UINT idx) const { return false; }
+bool VESSEL::DelLightEmitter (LightEmitter *le) const { return false; }
+bool VESSEL::DelMesh (UINT idx, bool retain_anim) const { return false; }
+void VESSEL::DelPropellantResource (PROPELLANT_HANDLE &ph) const {}
+bool VESSEL::DelThruster (THRUSTER_HANDLE &th) const { return false; }
+bool VESSEL::DelThrusterGroup (THGROUP_HANDLE thg, bool delth) const { return false; }
+bool VESSEL::DelThrusterGroup (THGROUP_TYPE thgt, bool delth) const { return false; }
+bool VESSEL::DetachChild (ATTACHMENTHANDLE attachment, double vel) const { return false; }
+UINT VESSEL::DockCount () const { return 0; }
+void VESSEL::EnableIDS (DOCKHANDLE hDock, bool bEnable) const {}
+void VESSEL::EnableTransponder (bool enable) const {}
+bool VESSEL::GetAirfoilParam (AIRFOILHANDLE hAirfoil, VECTOR3 *ref, AirfoilCoeffFunc *cf, void **context, double *c, double *S, double *A) const { return false; }
+const OBJHANDLE VESSEL::GetAtmRef () const { return NULL; }
+ATTACHMENTHANDLE VESSEL::GetAttachmentHandle (bool toparent, DWORD i) const { return NULL; }
+const char *VESSEL::GetAttachmentId (ATTACHMENTHANDLE attachment) const { return NULL; }
+DWORD VESSEL::GetAttachmentIndex (ATTACHMENTHANDLE attachment) const { return 0; }
+OBJHANDLE VESSEL::GetAttachmentStatus (ATTACHMENTHANDLE attachment) const { return NULL; }
+void VESSEL::GetCameraOffset (VECTOR3 &co) const { co = _V(0,0,0); }
+void VESSEL::GetCrossSections (VECTOR3 &cs) const { cs = _V(0,0,0); }
+int VESSEL::GetDamageModel () const { return 0; }
+DEVMESHHANDLE VESSEL::GetDevMesh (VISHANDLE vis, UINT idx) const { return NULL; }
+DOCKHANDLE VESSEL::GetDockHandle (UINT n) const { return NULL; }
+OBJHANDLE VESSEL::GetDockStatus (DOCKHANDLE hDock) const { return NULL; }
+double VESSEL::GetEmptyMass () const { return 0.0; }
+DWORD VESSEL::GetExhaustCount () const { return 0; }
+DWORD VESSEL::GetFlightStatus () const { return 0; }
+double VESSEL::GetGravityGradientDamping () const { return 0.0; }
+const OBJHANDLE VESSEL::GetGravityRef () const { return NULL; }
+THRUSTER_HANDLE VESSEL::GetGroupThruster (THGROUP_HANDLE thg, DWORD idx) const { return NULL; }
+THRUSTER_HANDLE VESSEL::GetGroupThruster (THGROUP_TYPE thgt, DWORD idx) const { return NULL; }
+DWORD VESSEL::GetGroupThrusterCount (THGROUP_HANDLE thg) const { return 0; }
+DWORD VESSEL::GetGroupThrusterCount (THGROUP_TYPE thgt) const { return 0; }
+NAVHANDLE VESSEL::GetIDS (DOCKHANDLE hDock) const { return NULL; }
+const LightEmitter *VESSEL::GetLightEmitter (DWORD i) const { return NULL; }
+UINT VESSEL::GetMeshCount () const { return 0; }
+bool VESSEL::GetMeshOffset (UINT idx, VECTOR3 &ofs) const { return false; }
+DWORD VESSEL::GetNavChannel (DWORD n) const { return 0; }
+DWORD VESSEL::GetNavCount () const { return 0; }
+NAVHANDLE VESSEL::GetNavSource (DWORD n) const { return NULL; }
+void VESSEL::GetPMI (VECTOR3 &pmi) const { pmi = _V(0,0,0); }
+double VESSEL::GetPitchMomentScale () const { return 0.0; }
+DWORD VESSEL::GetPropellantCount () const { return 0; }
+double VESSEL::GetPropellantEfficiency (PROPELLANT_HANDLE ph) const { return 0.0; }
+double VESSEL::GetPropellantFlowrate (PROPELLANT_HANDLE ph) const { return 0.0; }
+PROPELLANT_HANDLE VESSEL::GetPropellantHandleByIndex (DWORD idx) const { return NULL; }
+double VESSEL::GetPropellantMass (PROPELLANT_HANDLE ph) const { return 0.0; }
+double VESSEL::GetPropellantMaxMass (PROPELLANT_HANDLE ph) const { return 0.0; }
+void VESSEL::GetRotDrag (VECTOR3 &rd) const { rd = _V(0,0,0); }
+const OBJHANDLE VESSEL::GetSurfaceRef () const { return NULL; }
+DWORD VESSEL::GetThrusterCount () const { return 0; }
+void VESSEL::GetThrusterDir (THRUSTER_HANDLE th, VECTOR3 &dir) const { dir = _V(0,0,0); }
+THGROUP_HANDLE VESSEL::GetThrusterGroupHandle (THGROUP_TYPE thgt) const { return NULL; }
+double VESSEL::GetThrusterGroupLevel (THGROUP_HANDLE thg) const { return 0.0; }
+THRUSTER_HANDLE VESSEL::GetThrusterHandleByIndex (DWORD idx) const { return NULL; }
+double VESSEL::GetThrusterIsp (THRUSTER_HANDLE th) const { return 0.0; }
+double VESSEL::GetThrusterIsp (THRUSTER_HANDLE th, double p_ref) const { return 0.0; }
+double VESSEL::GetThrusterIsp0 (THRUSTER_HANDLE th) const { return 0.0; }
+double VESSEL::GetThrusterLevel (THRUSTER_HANDLE th) const { return 0.0; }
+double VESSEL::GetThrusterMax (THRUSTER_HANDLE th) const { return 0.0; }
+double VESSEL::GetThrusterMax (THRUSTER_HANDLE th, double p_ref) const { return 0.0; }
+double VESSEL::GetThrusterMax0 (THRUSTER_HANDLE th) const { return 0.0; }
+void VESSEL::GetThrusterRef (THRUSTER_HANDLE th, VECTOR3 &pos) const { pos = _V(0,0,0); }
+PROPELLANT_HANDLE VESSEL::GetThrusterResource (THRUSTER_HANDLE th) const { return NULL; }
+double VESSEL::GetTotalPropellantFlowrate () const { return 0.0; }
+double VESSEL::GetTotalPropellantMass () const { return 0.0; }
+NAVHANDLE VESSEL::GetTransponder () const { return NULL; }
+double VESSEL::GetTrimScale () const { return 0.0; }
+THGROUP_HANDLE VESSEL::GetUserThrusterGroupHandleByIndex (DWORD idx) const { return NULL; }
+double VESSEL::GetWingAspect () const { return 0.0; }
+double VESSEL::GetWingEffectiveness () const { return 0.0; }
+double VESSEL::GetYawMomentScale () const { return 0.0; }
+bool VESSEL::GroundContact () const { return false; }
+void VESSEL::IncThrusterGroupLevel (THGROUP_HANDLE thg, double dlevel) const {}
+void VESSEL::IncThrusterGroupLevel_SingleStep (THGROUP_HANDLE thg, double dlevel) const {}
+void VESSEL::IncThrusterLevel (THRUSTER_HANDLE th, double dlevel) const {}
+void VESSEL::IncThrusterLevel_SingleStep (THRUSTER_HANDLE th, double dlevel) const {}
+void VESSEL::InitNavRadios (DWORD nnav) const {}
+UINT VESSEL::InsertMesh (MESHHANDLE hMesh, UINT idx, const VECTOR3 *ofs) const { return 0; }
+UINT VESSEL::InsertMesh (const char *meshname, UINT idx, const VECTOR3 *ofs) const { return 0; }
+DWORD VESSEL::LightEmitterCount () const { return 0; }
+bool VESSEL::SetAnimation (UINT anim, double state) const { return false; }
+void VESSEL::SetAttachmentParams (ATTACHMENTHANDLE attachment, const VECTOR3 &pos, const VECTOR3 &dir, const VECTOR3 &rot) const {}
+void VESSEL::SetCW (double cw_z_pos, double cw_z_neg, double cw_x, double cw_y) const {}
+void VESSEL::SetCameraOffset (const VECTOR3 &co) const {}
+void VESSEL::SetCrossSections (const VECTOR3 &cs) const {}
+void VESSEL::SetDockParams (DOCKHANDLE hDock, const VECTOR3 &pos, const VECTOR3 &dir, const VECTOR3 &rot) const {}
+void VESSEL::SetDockParams (const VECTOR3 &pos, const VECTOR3 &dir, const VECTOR3 &rot) const {}
+bool VESSEL::SetElements (OBJHANDLE hRef, const ELEMENTS &el, ORBITPARAM *prm, double mjd_ref, int frame) const { return false; }
+void VESSEL::SetEmptyMass (double m) const {}
+void VESSEL::SetEnableFocus (bool enable) const {}
+bool VESSEL::SetGravityGradientDamping (double damp) const { return false; }
+bool VESSEL::SetIDSChannel (DOCKHANDLE hDock, DWORD ch) const { return false; }
+bool VESSEL::SetNavChannel (DWORD n, DWORD ch) const { return false; }
+void VESSEL::SetPMI (const VECTOR3 &pmi) const {}
+void VESSEL::SetPitchMomentScale (double scale) const {}
+void VESSEL::SetPropellantEfficiency (PROPELLANT_HANDLE ph, double efficiency) const {}
+void VESSEL::SetPropellantMass (PROPELLANT_HANDLE ph, double mass) const {}
+void VESSEL::SetPropellantMaxMass (PROPELLANT_HANDLE ph, double maxmass) const {}
+void VESSEL::SetRotDrag (const VECTOR3 &rd) const {}
+void VESSEL::SetSize (double size) const {}
+void VESSEL::SetThrusterDir (THRUSTER_HANDLE th, const VECTOR3 &dir) const {}
+void VESSEL::SetThrusterIsp (THRUSTER_HANDLE th, double isp) const {}
+void VESSEL::SetThrusterIsp (THRUSTER_HANDLE th, double isp0, double isp_ref, double p_ref) const {}
+void VESSEL::SetThrusterLevel (THRUSTER_HANDLE th, double level) const {}
+void VESSEL::SetThrusterMax0 (THRUSTER_HANDLE th, double maxth0) const {}
+void VESSEL::SetThrusterRef (THRUSTER_HANDLE th, const VECTOR3 &pos) const {}
+void VESSEL::SetThrusterResource (THRUSTER_HANDLE th, PROPELLANT_HANDLE ph) const {}
+void VESSEL::SetTouchdownPoints (const VECTOR3 &pt1, const VECTOR3 &pt2, const VECTOR3 &pt3) const {}
+bool VESSEL::SetTransponderChannel (DWORD ch) const { return false; }
+void VESSEL::SetTrimScale (double scale) const {}
+void VESSEL::SetVisibilityLimit (double vislimit, double spotlimit) const {}
+void VESSEL::SetWingAspect (double aspect) const {}
+void VESSEL::SetWingEffectiveness (double eff) const {}
+void VESSEL::SetYawMomentScale (double scale) const {}
+bool VESSEL::ShiftMesh (UINT idx, const VECTOR3 &ofs) const { return false; }
+void VESSEL::ShiftMeshes (const VECTOR3 &ofs) const {}
+bool VESSEL::Undock (UINT n, const OBJHANDLE exclude) const { return false; }
+
+void VESSEL::GetAttachmentParams (ATTACHMENTHANDLE attachment, VECTOR3 &pos, VECTOR3 &dir, VECTOR3 &rot) const
+{
+	pos = _V(0,0,0);
+	dir = _V(0,0,0);
+	rot = _V(0,0,0);
+}
+
+void VESSEL::GetCW (double &cw_z_pos, double &cw_z_neg, double &cw_x, double &cw_y) const
+{
+	cw_z_pos = 0.0;
+	cw_z_neg = 0.0;
+	cw_x = 0.0;
+	cw_y = 0.0;
+}
+
+void VESSEL::GetDockParams (DOCKHANDLE hDock, VECTOR3 &pos, VECTOR3 &dir, VECTOR3 &rot) const
+{
+	pos = _V(0,0,0);
+	dir = _V(0,0,0);
+	rot = _V(0,0,0);
+}
+
+void VESSEL::GetTouchdownPoints (VECTOR3 &pt1, VECTOR3 &pt2, VECTOR3 &pt3) const
+{
+	pt1 = _V(0,0,0);
+	pt2 = _V(0,0,0);
+	pt3 = _V(0,0,0);
+}
+
+void LightEmitter::Activate (bool act) {}
+VECTOR3 LightEmitter::GetDirection () const { return _V(0,0,0); }
+double LightEmitter::GetIntensity () const { return 0.0; }
+bool LightEmitter::IsActive () const { return false; }
+void LightEmitter::SetDirection (const VECTOR3 &d) {}
+void LightEmitter::SetIntensity (double in) {}
+void LightEmitter::SetPosition (const VECTOR3 &p) {}
+
+void PointLight::SetAttenuation (double att0, double att1, double att2) {}
+void PointLight::SetRange (double _range) {}
+
+void SpotLight::SetAperture (double _umbra, double _penumbra) {}
+
+void MFD::InvalidateButtons () {}
+void MFD::InvalidateDisplay () {}
+
+oapi::Font *MFD2::GetDefaultFont (DWORD fontidx) const { return NULL; }
+oapi::Pen *MFD2::GetDefaultPen (DWORD colidx, DWORD intens, DWORD style) const { return NULL; }
+void MFD2::Title (oapi::Sketchpad *skp, const char *title) const {}
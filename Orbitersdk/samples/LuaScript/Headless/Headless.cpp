@@ -0,0 +1,798 @@
+// Headless Lua script runner
+//
+// Runs Orbiter scripts outside the simulator. The program links the
+// script interpreter (LuaInterpreter\Interpreter.cpp) against the stub
+// Orbiter API in Backend.cpp, passes the scenario commands through the
+// interpreter's command queue (Interpreter::PostCmd/RunQueue) once per
+// frame, and reports the per-frame execution time, memory use and
+// garbage collector activity of the interpreter.
+//
+// Usage (from the Orbiter root folder, which contains Script\oapi_init.lua):
+//   Utils\Headless <scenario> [options]
+//
+// Options:
+//   -n <frames>      number of frames (default: scenario.frames or 1000)
+//   -dt <step>       simulation time step [s] (default: scenario.dt or 0.02)
+//   -budget <ms>     execution time budget per cycle (see Interpreter::SetBudget)
+//   -gcpause <p>     garbage collector pause [%]
+//   -gcstepmul <m>   garbage collector step multiplier [%]
+//   -gcstep <ms>     per-cycle incremental GC step (see Interpreter::SetGC)
+//   -csv <file>      write per-frame statistics to file
+//   -q               suppress terminal output of the scripts
+//
+// A scenario is a Lua file returning a table with fields
+//   vessels  list of fake vessel definitions (see below)
+//   cmd      command to execute, as typed into the console
+//   post     list of further commands {frame=n, cmd=...} posted
+//            before frame n (optional)
+//   frames   default number of frames
+//   dt       default time step [s]
+//   step     function (stub, simt, simdt) applying the scripted
+//            vessel dynamics before each interpreter cycle (optional)
+//   check    function (stub) returning true if the run produced the
+//            expected result, and a message (optional)
+//
+// The scenario is executed in the interpreter's Lua state, so step and
+// check have access to the script globals and constant tables.
+//
+// Fake vessels are defined by tables of the form
+//   {name='GL-01', class='DeltaGlider', focus=true, state={altitude=1000, ...}}
+// The state fields are the quantities of v:get_state (mass, size,
+// altitude, pitch, bank, yaw, airspeed, groundspeed, aoa, slipangle,
+// dynpressure, machnumber, atmdensity, atmpressure, atmtemperature,
+// and the vectors globalpos, globalvel, angvel, airspeedvector,
+// groundspeedvector, weightvector, thrustvector, liftvector), given as
+// values or as functions returning the value. Orbital elements are
+// taken from the tables state.el and state.prm (fields of ELEMENTS and
+// ORBITPARAM). Other keys are rejected, since only these quantities
+// reach the scripts through the stub API. The state is read once per
+// frame, after the step function. Thruster group and control surface levels set by the
+// scripts are copied to state.thlevel[grp] and state.adclevel[ctrl],
+// and keys sent with v:send_bufferedkey are appended to state.keys.
+//
+// The table 'stub' passed to step and check contains the terminal
+// output of the scripts (stub.output, one entry per line) and the
+// completed commands (stub.cmds, entries {cmd=..., status=...} with
+// status 0 on success). Before check is called, the interpreter's
+// budget and memory statistics are added as stub.bstats and stub.mstats
+// (fields as returned by proc.get_budgetstats and proc.get_memstats).
+//
+// The run stops early once all commands have completed and no jobs are
+// left. The exit code is nonzero if a command or a background job
+// raised an error, or if the scenario check failed.
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Interpreter.h"
+#include "Headless.h"
+
+static const char *SCENARIO_REG = "headless.scenario"; // registry: scenario table
+static const char *STUB_REG = "headless.stub";         // registry: table passed to step and check
+static const char *SENTINEL_MT = "headless.sentinel";  // metatable of the GC sentinel
+
+// scenario state keys, in the order of VSCALAR and VVECTOR
+static const char *skey[NVSCALAR] = {
+	"mass", "size", "altitude", "pitch", "bank", "yaw",
+	"airspeed", "groundspeed", "aoa", "slipangle", "dynpressure",
+	"machnumber", "atmdensity", "atmpressure", "atmtemperature"
+};
+static const char *vkey[NVVECTOR] = {
+	"globalpos", "globalvel", "angvel", "airspeedvector", "groundspeedvector",
+	"weightvector", "thrustvector", "liftvector"
+};
+
+// a scenario command
+struct POSTCMD {
+	int frame;       // frame before which the command is posted
+	char *cmd;       // command string
+	int status;      // execution status, once completed
+};
+
+static POSTCMD *post = NULL;  // scenario commands, in order of posting
+static int npost = 0;         // number of scenario commands
+static int *cmpl = NULL;      // indices of the completed commands, in order of completion
+static int ncmpl = 0;         // number of completed commands
+static int nflush = 0;        // number of completed commands copied to stub.cmds
+
+// ==============================================================
+// class HeadlessInterpreter
+
+class HeadlessInterpreter: public Interpreter {
+public:
+	HeadlessInterpreter (bool _quiet);
+	~HeadlessInterpreter ();
+	void LoadAPI ();
+	void term_strout (const char *str, bool iserr=false);
+	void FlushOutput ();
+	inline int nError () const { return nerror; }
+
+protected:
+	static int termOut (lua_State *L);
+	static int noteSetText (lua_State *L);
+	static int noteSetPos (lua_State *L);
+	static int noteSetSize (lua_State *L);
+	static int noteSetColour (lua_State *L);
+
+private:
+	void AddLine (const char *str, int len);
+
+	static NOTEHANDLE hnote; // default screen annotation
+
+	bool quiet;      // suppress terminal output
+	int nerror;      // number of background job errors
+	char **line;     // terminal lines not yet copied to stub.output
+	int nline;       // number of entries in line
+	int nlinebuf;    // length of the line buffer
+};
+
+NOTEHANDLE HeadlessInterpreter::hnote = NULL;
+
+HeadlessInterpreter::HeadlessInterpreter (bool _quiet): Interpreter ()
+{
+	is_term = true;
+	quiet = _quiet;
+	nerror = 0;
+	line = NULL;
+	nline = nlinebuf = 0;
+}
+
+HeadlessInterpreter::~HeadlessInterpreter ()
+{
+	for (int i = 0; i < nline; i++) delete []line[i];
+	if (nlinebuf) delete []line;
+}
+
+void HeadlessInterpreter::LoadAPI ()
+{
+	Interpreter::LoadAPI();
+
+	static const struct luaL_reg termLib [] = {
+		{"out", termOut},
+		{NULL, NULL}
+	};
+	luaL_openlib (L, "term", termLib, 0);
+
+	// the simulator's script environment provides a default screen
+	// annotation as library 'note' (used e.g. by Atlantis/launch.lua)
+	static const struct luaL_reg noteLib [] = {
+		{"set_text", noteSetText},
+		{"set_pos", noteSetPos},
+		{"set_size", noteSetSize},
+		{"set_colour", noteSetColour},
+		{NULL, NULL}
+	};
+	if (!hnote) hnote = ::oapiCreateAnnotation (true, 1.0, _V(1,0.8,0.6));
+	luaL_openlib (L, "note", noteLib, 0);
+}
+
+void HeadlessInterpreter::term_strout (const char *str, bool iserr)
+{
+	// split into lines
+	const char *s;
+	for (;;) {
+		s = strchr (str, '\n');
+		if (!s) {
+			AddLine (str, strlen (str));
+			break;
+		}
+		AddLine (str, s-str);
+		str = s+1;
+	}
+}
+
+void HeadlessInterpreter::AddLine (const char *str, int len)
+{
+	if (!quiet) printf ("%.*s\n", len, str);
+
+	// oapi_init.lua reports failed background jobs as "job <id>: <error>"
+	if (!strncmp (str, "job ", 4)) {
+		const char *s = str+4;
+		if (*s >= '0' && *s <= '9') {
+			while (*s >= '0' && *s <= '9') s++;
+			if (!strncmp (s, ": ", 2) && strncmp (s+2, "prio=", 5)) nerror++;
+		}
+	}
+
+	// The line may come from a running coroutine, so it is buffered
+	// here and copied into the Lua state after the cycle.
+	if (nline == nlinebuf) {
+		char **tmp = new char*[nlinebuf += 64];
+		if (nline) {
+			memcpy (tmp, line, nline*sizeof(char*));
+			delete []line;
+		}
+		line = tmp;
+	}
+	line[nline] = new char[len+1];
+	memcpy (line[nline], str, len);
+	line[nline++][len] = '\0';
+}
+
+void HeadlessInterpreter::FlushOutput ()
+{
+	if (!nline) return;
+	lua_getfield (L, LUA_REGISTRYINDEX, STUB_REG);
+	lua_getfield (L, -1, "output");
+	int n = lua_objlen (L, -1);
+	for (int i = 0; i < nline; i++) {
+		lua_pushstring (L, line[i]);
+		lua_rawseti (L, -2, ++n);
+		delete []line[i];
+	}
+	lua_pop (L, 2);
+	nline = 0;
+}
+
+int HeadlessInterpreter::termOut (lua_State *L)
+{
+	Interpreter *interp = GetInterpreter (L);
+	interp->term_out (L);
+	return 0;
+}
+
+int HeadlessInterpreter::noteSetText (lua_State *L)
+{
+	oapiAnnotationSetText (hnote, (char*)lua_tostringex (L, 1));
+	return 0;
+}
+
+int HeadlessInterpreter::noteSetPos (lua_State *L)
+{
+	oapiAnnotationSetPos (hnote, lua_tonumber (L,1), lua_tonumber (L,2), lua_tonumber (L,3), lua_tonumber (L,4));
+	return 0;
+}
+
+int HeadlessInterpreter::noteSetSize (lua_State *L)
+{
+	oapiAnnotationSetSize (hnote, lua_tonumber (L,1));
+	return 0;
+}
+
+int HeadlessInterpreter::noteSetColour (lua_State *L)
+{
+	VECTOR3 col;
+	lua_getfield (L, 1, "r");
+	col.x = lua_tonumber (L, -1);  lua_pop (L, 1);
+	lua_getfield (L, 1, "g");
+	col.y = lua_tonumber (L, -1);  lua_pop (L, 1);
+	lua_getfield (L, 1, "b");
+	col.z = lua_tonumber (L, -1);  lua_pop (L, 1);
+	oapiAnnotationSetColour (hnote, col);
+	return 0;
+}
+
+// ==============================================================
+// Command completion
+
+static void CmdDone (SCRIPTCMD *hCmd, int status, void *context)
+{
+	POSTCMD *pc = (POSTCMD*)context;
+	pc->status = status;
+	cmpl[ncmpl++] = pc-post;
+}
+
+// copy newly completed commands to stub.cmds
+static void FlushCmds (lua_State *L)
+{
+	if (nflush == ncmpl) return;
+	lua_getfield (L, LUA_REGISTRYINDEX, STUB_REG);
+	lua_getfield (L, -1, "cmds");
+	for (; nflush < ncmpl; nflush++) {
+		POSTCMD *pc = post + cmpl[nflush];
+		lua_createtable (L, 0, 2);
+		lua_pushstring (L, pc->cmd);
+		lua_setfield (L, -2, "cmd");
+		lua_pushinteger (L, pc->status);
+		lua_setfield (L, -2, "status");
+		lua_rawseti (L, -2, nflush+1);
+	}
+	lua_pop (L, 2);
+}
+
+// ==============================================================
+// Garbage collector sentinel
+// A finalised userdata counts completed collection cycles and re-arms
+// itself, until the interpreter is shut down.
+
+static int ngc = 0;           // completed collection cycles
+static bool gcarm = true;     // re-arm the sentinel
+
+static void ArmSentinel (lua_State *L)
+{
+	lua_newuserdata (L, 1);
+	luaL_getmetatable (L, SENTINEL_MT);
+	lua_setmetatable (L, -2);
+	lua_pop (L, 1);
+}
+
+static int SentinelGC (lua_State *L)
+{
+	ngc++;
+	if (gcarm) ArmSentinel (L);
+	return 0;
+}
+
+// ==============================================================
+// Scenario
+
+struct SCENARIO {
+	const char *fname;  // scenario file
+	int nframe;         // number of frames (0: scenario default)
+	double dt;          // time step (0: scenario default)
+};
+
+// is 'key' a field of the scenario vessel state tables?
+static bool IsStateKey (const char *key)
+{
+	static const char *other[5] = {"el", "prm", "thlevel", "adclevel", "keys"};
+	int i;
+	for (i = 0; i < NVSCALAR; i++)
+		if (!strcmp (key, skey[i])) return true;
+	for (i = 0; i < NVVECTOR; i++)
+		if (!strcmp (key, vkey[i])) return true;
+	for (i = 0; i < 5; i++)
+		if (!strcmp (key, other[i])) return true;
+	return false;
+}
+
+// Load the scenario file, create the fake vessels and the command list
+// (protected call, argument: SCENARIO*)
+static int ScenarioLoad (lua_State *L)
+{
+	SCENARIO *scn = (SCENARIO*)lua_touserdata (L, 1);
+	int i, n;
+
+	if (luaL_loadfile (L, scn->fname)) lua_error (L);
+	lua_call (L, 0, 1);
+	if (!lua_istable (L, -1)) luaL_error (L, "%s: scenario table expected", scn->fname);
+	lua_pushvalue (L, -1);
+	lua_setfield (L, LUA_REGISTRYINDEX, SCENARIO_REG);
+	int sidx = lua_gettop (L);
+
+	if (!scn->nframe) {
+		lua_getfield (L, sidx, "frames");
+		scn->nframe = (lua_isnumber (L, -1) ? lua_tointeger (L, -1) : 1000);
+		lua_pop (L, 1);
+	}
+	if (!scn->dt) {
+		lua_getfield (L, sidx, "dt");
+		scn->dt = (lua_isnumber (L, -1) ? lua_tonumber (L, -1) : 0.02);
+		lua_pop (L, 1);
+	}
+
+	// the table passed to step and check
+	lua_createtable (L, 0, 4);
+	lua_newtable (L);
+	lua_setfield (L, -2, "output");
+	lua_newtable (L);
+	lua_setfield (L, -2, "cmds");
+	lua_setfield (L, LUA_REGISTRYINDEX, STUB_REG);
+
+	// fake vessels
+	lua_getfield (L, sidx, "vessels");
+	if (lua_istable (L, -1)) {
+		n = lua_objlen (L, -1);
+		for (i = 1; i <= n; i++) {
+			char cbuf[64];
+			lua_rawgeti (L, -1, i);
+			lua_getfield (L, -1, "name");
+			if (lua_isstring (L, -1)) strncpy (cbuf, lua_tostring (L, -1), 63), cbuf[63] = '\0';
+			else sprintf (cbuf, "vessel%d", i);
+			lua_getfield (L, -2, "class");
+			lua_getfield (L, -3, "focus");
+			Vessel *v = Backend::AddVessel (cbuf, lua_isstring (L, -2) ? lua_tostring (L, -2) : "",
+				lua_toboolean (L, -1) != 0);
+			lua_pop (L, 3);
+
+			lua_getfield (L, -1, "state");
+			if (!lua_istable (L, -1)) {
+				lua_pop (L, 1);
+				lua_newtable (L);
+				lua_pushvalue (L, -1);
+				lua_setfield (L, -3, "state");
+			}
+			static const char *ctrl[3] = {"thlevel", "adclevel", "keys"};
+			for (int j = 0; j < 3; j++) {
+				lua_getfield (L, -1, ctrl[j]);
+				if (!lua_istable (L, -1)) {
+					lua_newtable (L);
+					lua_setfield (L, -3, ctrl[j]);
+				}
+				lua_pop (L, 1);
+			}
+			// the state is read through the Orbiter API, so a key the
+			// backend doesn't provide would be silently ignored
+			for (lua_pushnil (L); lua_next (L, -2); lua_pop (L, 1))
+				if (lua_type (L, -2) != LUA_TSTRING)
+					luaL_error (L, "%s: vessel %s: state key must be a string", scn->fname, cbuf);
+				else if (!IsStateKey (lua_tostring (L, -2)))
+					luaL_error (L, "%s: vessel %s: unknown state key '%s'", scn->fname, cbuf, lua_tostring (L, -2));
+			v->ref = luaL_ref (L, LUA_REGISTRYINDEX);
+			lua_pop (L, 1);
+		}
+	}
+	lua_pop (L, 1);
+
+	// commands: the scenario command is posted before the first frame
+	lua_getfield (L, sidx, "post");
+	n = (lua_istable (L, -1) ? lua_objlen (L, -1) : 0);
+	post = new POSTCMD[n+1];
+	cmpl = new int[n+1];
+	lua_getfield (L, sidx, "cmd");
+	if (lua_isstring (L, -1)) {
+		post[0].frame = 1;
+		post[0].cmd = _strdup (lua_tostring (L, -1));
+		npost++;
+	}
+	lua_pop (L, 1);
+	for (i = 1; i <= n; i++) {
+		lua_rawgeti (L, -1, i);
+		lua_getfield (L, -1, "cmd");
+		if (lua_isstring (L, -1)) {
+			post[npost].cmd = _strdup (lua_tostring (L, -1));
+			lua_getfield (L, -2, "frame");
+			post[npost].frame = max (1, lua_tointeger (L, -1));
+			lua_pop (L, 1);
+			npost++;
+		}
+		lua_pop (L, 2);
+	}
+	lua_pop (L, 2);
+
+	// collection cycle counter
+	luaL_newmetatable (L, SENTINEL_MT);
+	lua_pushcfunction (L, SentinelGC);
+	lua_setfield (L, -2, "__gc");
+	lua_pop (L, 1);
+	ArmSentinel (L);
+	return 0;
+}
+
+// write the control levels to the vessel state table on top of the stack
+static void PutLevels (lua_State *L, const char *name, const double *level, int n)
+{
+	lua_getfield (L, -1, name);
+	if (lua_istable (L, -1)) {
+		for (int i = 0; i < n; i++) {
+			lua_pushnumber (L, level[i]);
+			lua_rawseti (L, -2, i);
+		}
+	}
+	lua_pop (L, 1);
+}
+
+// push the state value 'name' of the vessel state table on top of the stack
+static void GetStateValue (lua_State *L, const char *name)
+{
+	lua_getfield (L, -1, name);
+	if (lua_isfunction (L, -1)) lua_call (L, 0, 1);
+}
+
+// read the fields of the table 'name' of the vessel state table on top of the stack
+static void GetStateFields (lua_State *L, const char *name, const char **field, double **val, int n)
+{
+	GetStateValue (L, name);
+	if (lua_istable (L, -1)) {
+		for (int i = 0; i < n; i++) {
+			lua_getfield (L, -1, field[i]);
+			if (lua_isnumber (L, -1)) *val[i] = lua_tonumber (L, -1);
+			lua_pop (L, 1);
+		}
+	}
+	lua_pop (L, 1);
+}
+
+// read the vessel state from the state table on top of the stack
+static void GetState (lua_State *L, Vessel *v)
+{
+	int i;
+	for (i = 0; i < NVSCALAR; i++) {
+		GetStateValue (L, skey[i]);
+		v->s[i] = lua_tonumber (L, -1);
+		lua_pop (L, 1);
+	}
+	for (i = 0; i < NVVECTOR; i++) {
+		GetStateValue (L, vkey[i]);
+		if (v->vdef[i] = (lua_istable (L, -1) || lua_isuserdata (L, -1)))
+			v->v[i] = lua_tovector (L, -1);
+		else
+			v->v[i] = _V(0,0,0);
+		lua_pop (L, 1);
+	}
+
+	static const char *elfield[6] = {"a", "e", "i", "theta", "omegab", "L"};
+	double *elval[6] = {&v->el.a, &v->el.e, &v->el.i, &v->el.theta, &v->el.omegab, &v->el.L};
+	GetStateFields (L, "el", elfield, elval, 6);
+
+	static const char *prmfield[12] = {"SMi", "PeD", "ApD", "MnA", "TrA", "MnL", "TrL", "EcA", "Lec", "T", "PeT", "ApT"};
+	double *prmval[12] = {&v->prm.SMi, &v->prm.PeD, &v->prm.ApD, &v->prm.MnA, &v->prm.TrA, &v->prm.MnL,
+		&v->prm.TrL, &v->prm.EcA, &v->prm.Lec, &v->prm.T, &v->prm.PeT, &v->prm.ApT};
+	GetStateFields (L, "prm", prmfield, prmval, 12);
+}
+
+// Exchange the vessel controls and state with the scenario and apply the
+// scripted dynamics for the current frame (protected call)
+static int ScenarioStep (lua_State *L)
+{
+	int i, k;
+
+	// controls set by the scripts in the previous cycle
+	for (i = 0; i < Backend::nVessel(); i++) {
+		Vessel *v = Backend::GetVessel (i);
+		lua_rawgeti (L, LUA_REGISTRYINDEX, v->ref);
+		PutLevels (L, "thlevel", v->thlevel, NTHGROUP);
+		PutLevels (L, "adclevel", v->adclevel, NAIRCTRL);
+		lua_getfield (L, -1, "keys");
+		if (lua_istable (L, -1)) {
+			for (k = lua_objlen (L, -1); k < v->nkey; k++) {
+				lua_pushnumber (L, v->key[k]);
+				lua_rawseti (L, -2, k+1);
+			}
+		}
+		lua_pop (L, 2);
+	}
+
+	// scripted dynamics
+	lua_getfield (L, LUA_REGISTRYINDEX, SCENARIO_REG);
+	lua_getfield (L, -1, "step");
+	if (lua_isfunction (L, -1)) {
+		lua_getfield (L, LUA_REGISTRYINDEX, STUB_REG);
+		lua_pushnumber (L, Backend::simt);
+		lua_pushnumber (L, Backend::simdt);
+		lua_call (L, 3, 0);
+	} else lua_pop (L, 1);
+	lua_pop (L, 1);
+
+	// state seen by the scripts in this cycle
+	for (i = 0; i < Backend::nVessel(); i++) {
+		Vessel *v = Backend::GetVessel (i);
+		lua_rawgeti (L, LUA_REGISTRYINDEX, v->ref);
+		GetState (L, v);
+		lua_pop (L, 1);
+	}
+	return 0;
+}
+
+struct CHECK {
+	Interpreter *interp; // interpreter instance
+	bool defined;        // scenario defines a check?
+	bool ok;             // check passed?
+	char msg[256];       // check message
+};
+
+// Run the scenario check (protected call, argument: CHECK*)
+static int ScenarioCheck (lua_State *L)
+{
+	CHECK *chk = (CHECK*)lua_touserdata (L, 1);
+	Interpreter *interp = chk->interp;
+	lua_getfield (L, LUA_REGISTRYINDEX, SCENARIO_REG);
+	lua_getfield (L, -1, "check");
+	if (!(chk->defined = lua_isfunction (L, -1))) return 0;
+
+	lua_getfield (L, LUA_REGISTRYINDEX, STUB_REG);
+	const BUDGETSTATS &bs = interp->GetBudgetStats();
+	lua_createtable (L, 0, 5);
+	lua_pushnumber (L, bs.ncycle);    lua_setfield (L, -2, "cycles");
+	lua_pushnumber (L, bs.noverrun);  lua_setfield (L, -2, "overruns");
+	lua_pushnumber (L, bs.npreempt);  lua_setfield (L, -2, "preempted");
+	lua_pushnumber (L, bs.tlast);     lua_setfield (L, -2, "tlast");
+	lua_pushnumber (L, bs.tmax);      lua_setfield (L, -2, "tmax");
+	lua_setfield (L, -2, "bstats");
+	const MEMSTATS &ms = interp->GetMemStats();
+	lua_createtable (L, 0, 9);
+	lua_pushnumber (L, ms.kbinuse);   lua_setfield (L, -2, "inuse");
+	lua_pushnumber (L, ms.kbpeak);    lua_setfield (L, -2, "peak");
+	lua_pushnumber (L, ms.kbcycle);   lua_setfield (L, -2, "alloc");
+	lua_pushnumber (L, ms.kbtotal);   lua_setfield (L, -2, "total");
+	lua_pushnumber (L, ms.nalloc);    lua_setfield (L, -2, "nalloc");
+	lua_pushnumber (L, ms.ngc);       lua_setfield (L, -2, "gccycles");
+	lua_pushnumber (L, ms.tgclast);   lua_setfield (L, -2, "gctlast");
+	lua_pushnumber (L, ms.tgcmax);    lua_setfield (L, -2, "gctmax");
+	lua_pushnumber (L, ms.tgc);       lua_setfield (L, -2, "gctime");
+	lua_setfield (L, -2, "mstats");
+
+	lua_call (L, 1, 2);
+	chk->ok = (lua_toboolean (L, -2) != 0);
+	if (lua_isstring (L, -1)) {
+		strncpy (chk->msg, lua_tostring (L, -1), 255);
+		chk->msg[255] = '\0';
+	}
+	return 0;
+}
+
+// ==============================================================
+// Statistics
+
+static int CmpDouble (const void *a, const void *b)
+{
+	double d = *(const double*)a - *(const double*)b;
+	return (d < 0.0 ? -1 : d > 0.0 ? 1 : 0);
+}
+
+static double Percentile (const double *sorted, int n, double p)
+{
+	if (!n) return 0.0;
+	int i = (int)ceil (p*n);
+	return sorted[max (1, i)-1];
+}
+
+static double MemCount (lua_State *L)
+{
+	return lua_gc (L, LUA_GCCOUNT, 0) + lua_gc (L, LUA_GCCOUNTB, 0)/1024.0;
+}
+
+// ==============================================================
+
+static void Usage ()
+{
+	fprintf (stderr, "usage: Headless <scenario> [-n frames] [-dt step] [-budget ms]\n");
+	fprintf (stderr, "       [-gcpause p] [-gcstepmul m] [-gcstep ms] [-csv file] [-q]\n");
+	exit (2);
+}
+
+int main (int argc, char *argv[])
+{
+	SCENARIO scn = {NULL, 0, 0.0};
+	double budget = 0.0;
+	int gcpause = 0, gcstepmul = 0;
+	double gcstep = 0.0;
+	bool gcset = false, quiet = false;
+	const char *csv = NULL;
+	int i, j;
+
+	for (i = 1; i < argc; i++) {
+		const char *a = argv[i];
+		if (!strcmp (a, "-q")) {
+			quiet = true;
+		} else if (a[0] == '-') {
+			if (i+1 == argc) Usage();
+			const char *val = argv[++i];
+			if      (!strcmp (a, "-n"))         scn.nframe = atoi (val);
+			else if (!strcmp (a, "-dt"))        scn.dt = atof (val);
+			else if (!strcmp (a, "-budget"))    budget = atof (val);
+			else if (!strcmp (a, "-gcpause"))   gcpause = atoi (val), gcset = true;
+			else if (!strcmp (a, "-gcstepmul")) gcstepmul = atoi (val), gcset = true;
+			else if (!strcmp (a, "-gcstep"))    gcstep = atof (val), gcset = true;
+			else if (!strcmp (a, "-csv"))       csv = val;
+			else Usage();
+		} else if (!scn.fname) {
+			scn.fname = a;
+		} else Usage();
+	}
+	if (!scn.fname) Usage();
+
+	HeadlessInterpreter *interp = new HeadlessInterpreter (quiet);
+	interp->Initialise();
+	lua_State *L = interp->GetState();
+	lua_getglobal (L, "_idle");
+	bool init = lua_isfunction (L, -1);
+	lua_pop (L, 1);
+	if (!init) {
+		fprintf (stderr, "Headless: Script\\oapi_init.lua not loaded (run from the Orbiter root folder)\n");
+		return 2;
+	}
+
+	if (lua_cpcall (L, ScenarioLoad, &scn)) {
+		fprintf (stderr, "Headless: %s\n", lua_tostring (L, -1));
+		return 2;
+	}
+	if (budget) interp->SetBudget (0, budget);
+	if (gcset) interp->SetGC (gcpause, gcstepmul, gcstep);
+
+	// frame loop
+	double *tframe = new double[scn.nframe]; // interpreter time per frame [ms]
+	double *mframe = new double[scn.nframe]; // memory after each frame [kB]
+	int *gframe = new int[scn.nframe];       // collection cycles completed during each frame
+	LARGE_INTEGER freq, t0, t1;
+	QueryPerformanceFrequency (&freq);
+	bool failed = false;
+
+	lua_gc (L, LUA_GCCOLLECT, 0);
+	ngc = 0;
+	double mem0 = MemCount (L);
+
+	int n = 0, nposted = 0;
+	for (i = 1; i <= scn.nframe; i++) {
+		for (j = 0; j < npost; j++)
+			if (post[j].frame == i) {
+				interp->PostCmd (post[j].cmd, CmdDone, post+j);
+				nposted++;
+			}
+		Backend::Advance (scn.dt);
+		if (lua_cpcall (L, ScenarioStep, 0)) {
+			fprintf (stderr, "Headless: scenario step: %s\n", lua_tostring (L, -1));
+			lua_pop (L, 1);
+			failed = true;
+			break;
+		}
+
+		int ngc0 = ngc;
+		QueryPerformanceCounter (&t0);
+		interp->RunQueue ();
+		QueryPerformanceCounter (&t1);
+		interp->PostStep (Backend::simt, Backend::simdt, Backend::mjd);
+		tframe[n] = (double)(t1.QuadPart-t0.QuadPart)*1e3/(double)freq.QuadPart;
+		mframe[n] = MemCount (L);
+		gframe[n] = ngc-ngc0;
+		n++;
+
+		interp->FlushOutput ();
+		FlushCmds (L);
+		if (nposted == npost && ncmpl == npost && !interp->nJobs()) break;
+	}
+
+	// statistics
+	if (csv) {
+		FILE *f = fopen (csv, "wt");
+		if (f) {
+			fprintf (f, "frame,simt,ms,kb,gc\n");
+			for (i = 0; i < n; i++)
+				fprintf (f, "%d,%.4f,%.4f,%.1f,%d\n", i+1, (i+1)*scn.dt, tframe[i], mframe[i], gframe[i]);
+			fclose (f);
+		} else {
+			fprintf (stderr, "Headless: cannot write %s\n", csv);
+		}
+	}
+
+	double *sorted = new double[max (n, 1)];
+	double tsum = 0.0, mmin = mem0, mmax = mem0;
+	for (i = 0; i < n; i++) {
+		sorted[i] = tframe[i];
+		tsum += tframe[i];
+		if (mframe[i] < mmin) mmin = mframe[i];
+		if (mframe[i] > mmax) mmax = mframe[i];
+	}
+	qsort (sorted, n, sizeof(double), CmpDouble);
+
+	int nfail = 0;
+	for (i = 0; i < ncmpl; i++)
+		if (post[cmpl[i]].status) nfail++;
+	if (nfail) failed = true;
+
+	const BUDGETSTATS &bs = interp->GetBudgetStats();
+	const MEMSTATS &ms = interp->GetMemStats();
+	printf ("frames:    %d (%.1f s simulated, %s)\n", n, n*scn.dt,
+		ncmpl == nposted ? "commands returned" : "command running");
+	printf ("commands:  %d completed, %d failed, %d pending\n", ncmpl, nfail, npost-ncmpl);
+	printf ("lua time:  mean %.4f ms, p50 %.4f ms, p95 %.4f ms, max %.4f ms\n",
+		n ? tsum/n : 0.0, Percentile (sorted, n, 0.5), Percentile (sorted, n, 0.95), Percentile (sorted, n, 1.0));
+	printf ("memory:    start %.1f kB, min %.1f kB, max %.1f kB, end %.1f kB\n",
+		mem0, mmin, mmax, n ? mframe[n-1] : mem0);
+	printf ("gc:        %d collection cycles (%.2f per 1000 frames)\n", ngc, n ? ngc*1e3/n : 0.0);
+	printf ("budget:    %u cycles, %u overruns, %u preempted, max %.4f ms\n",
+		bs.ncycle, bs.noverrun, bs.npreempt, bs.tmax);
+	printf ("alloc:     %.1f kB in %u allocations\n", ms.kbtotal, ms.nalloc);
+	if (ms.ngc)
+		printf ("gc step:   %u cycles, mean %.4f ms, max %.4f ms\n", ms.ngc, n ? ms.tgc/n : 0.0, ms.tgcmax);
+
+	if (interp->nError()) {
+		printf ("errors:    %d background job(s) failed\n", interp->nError());
+		failed = true;
+	}
+
+	CHECK chk = {interp, false, false, ""};
+	if (lua_cpcall (L, ScenarioCheck, &chk)) {
+		printf ("check:     FAILED (%s)\n", lua_tostring (L, -1));
+		lua_pop (L, 1);
+		failed = true;
+	} else if (chk.defined) {
+		printf ("check:     %s%s%s%s\n", chk.ok ? "passed" : "FAILED",
+			chk.msg[0] ? " (" : "", chk.msg, chk.msg[0] ? ")" : "");
+		if (!chk.ok) failed = true;
+	}
+
+	gcarm = false;
+	delete interp;
+	Backend::Clear ();
+	for (i = 0; i < npost; i++) free (post[i].cmd);
+	delete []post;
+	delete []cmpl;
+	delete []tframe;
+	delete []mframe;
+	delete []gframe;
+	delete []sorted;
+	return (failed ? 1 : 0);
+}
@@ -0,0 +1,80 @@
+// Headless script runner: simulated Orbiter core
+// The runner links LuaInterpreter against the stub implementation of the
+// Orbiter API in Backend.cpp instead of orbiter.lib. The stub provides a
+// fake simulation clock and fake vessels whose state is set by the driver
+// (Headless.cpp) from the scenario script in each frame.
+
+#ifndef __HEADLESS_H
+#define __HEADLESS_H
+
+#include "OrbiterAPI.h"
+#include "VesselAPI.h"
+
+// scalar vessel state quantities (scenario state keys, see Headless.cpp)
+enum VSCALAR {
+	VS_MASS, VS_SIZE, VS_ALTITUDE, VS_PITCH, VS_BANK, VS_YAW,
+	VS_AIRSPEED, VS_GROUNDSPEED, VS_AOA, VS_SLIPANGLE, VS_DYNPRESSURE,
+	VS_MACHNUMBER, VS_ATMDENSITY, VS_ATMPRESSURE, VS_ATMTEMPERATURE,
+	NVSCALAR
+};
+
+// vector vessel state quantities
+enum VVECTOR {
+	VV_GLOBALPOS, VV_GLOBALVEL, VV_ANGVEL, VV_AIRSPEEDVECTOR, VV_GROUNDSPEEDVECTOR,
+	VV_WEIGHTVECTOR, VV_THRUSTVECTOR, VV_LIFTVECTOR,
+	NVVECTOR
+};
+
+const int NTHGROUP = THGROUP_ATT_BACK+1;   // standard thruster groups
+const int NAIRCTRL = AIRCTRL_RUDDERTRIM+1; // control surface types
+const int MAXKEY = 256;                    // length of the buffered key log
+
+// ==============================================================
+// class Vessel
+// Fake vessel. OBJHANDLEs of vessels are pointers to Vessel instances,
+// and the VESSEL interface methods operate on the instance they are
+// attached to.
+
+class Vessel {
+public:
+	Vessel (const char *_name, const char *_classname);
+	~Vessel ();
+
+	char name[64];              // vessel name
+	char classname[64];         // vessel class name
+	VESSEL *iface;              // vessel interface
+	double s[NVSCALAR];         // scalar state
+	VECTOR3 v[NVVECTOR];        // vector state
+	bool vdef[NVVECTOR];        // vector state defined?
+	ELEMENTS el;                // osculating elements
+	ORBITPARAM prm;             // secondary orbital parameters
+	double thlevel[NTHGROUP];   // thruster group levels
+	double adclevel[NAIRCTRL];  // control surface levels
+	DWORD adcmode;              // aerodynamic control mode
+	int attmode;                // RCS mode
+	DWORD navmode;              // active navmodes (bit flags)
+	DWORD key[MAXKEY];          // buffered keys sent to the vessel
+	int nkey;                   // number of entries in key
+	int ref;                    // driver: registry reference of the scenario state table
+};
+
+// ==============================================================
+// Simulated Orbiter core
+
+namespace Backend {
+	extern double simt, simdt;  // simulation time and step [s]
+	extern double syst, sysdt;  // system time and step [s]
+	extern double mjd;          // simulation date
+
+	// advance the clock by one frame
+	void Advance (double dt);
+
+	// vessel list
+	Vessel *AddVessel (const char *name, const char *classname, bool focus = false);
+	void Clear ();
+	int nVessel ();
+	Vessel *GetVessel (int i);
+	Vessel *FindVessel (OBJHANDLE hObj);
+}
+
+#endif // !__HEADLESS_H
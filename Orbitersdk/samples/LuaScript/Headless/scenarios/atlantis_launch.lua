@@ -0,0 +1,76 @@
+-- Headless scenario: Space Shuttle ascent autopilot (Script/Atlantis/launch.lua)
+-- Runs the complete launch programme on a scripted vehicle: attitude
+-- responds to the RCS thruster groups, and the apsides are raised at
+-- a constant rate while the main engines fire. Checks that the
+-- autopilot runs through to orbit insertion.
+
+local R_Earth = 6.37101e6
+
+-- attitude (horizon frame) and angular velocity (vessel frame)
+local s = {pitch=math.pi/2, bank=0, yaw=0, av={x=0, y=0, z=0}}
+-- apsides and time to apoapsis
+local prm = {PeD=0.2*R_Earth, ApD=R_Earth, ApT=1800}
+
+local atl = {
+	name = 'STS-101',
+	class = 'Atlantis',
+	state = {
+		pitch = function () return s.pitch end,
+		bank = function () return s.bank end,
+		yaw = function () return s.yaw end,
+		aoa = 0,
+		angvel = function () return {x=s.av.x, y=s.av.y, z=s.av.z} end,
+		-- v:get_progradedir is the velocity rotated into the vessel frame,
+		-- and the fake vessel's rotation matrix is the identity
+		globalvel = function ()
+			return {x=0.05*math.sin(0.01*s.yaw), y=0.05*math.cos(0.01*s.yaw), z=1}
+		end,
+		prm = prm,
+		el = {}
+	}
+}
+
+local function wrap (a)
+	return (a + math.pi) % (2*math.pi) - math.pi
+end
+
+local function step (stub, simt, dt)
+	local th = atl.state.thlevel
+	local function lvl (grp) return th[grp] or 0 end
+	local k = 0.5  -- angular acceleration at full RCS thrust [rad/s^2]
+
+	s.av.x = s.av.x + k*(lvl(THGROUP.ATT_PITCHUP)-lvl(THGROUP.ATT_PITCHDOWN))*dt
+	s.av.y = s.av.y + k*(lvl(THGROUP.ATT_YAWLEFT)-lvl(THGROUP.ATT_YAWRIGHT))*dt
+	s.av.z = s.av.z - k*(lvl(THGROUP.ATT_BANKLEFT)-lvl(THGROUP.ATT_BANKRIGHT))*dt
+
+	-- vessel frame rotation rates seen in the horizon frame
+	local c = math.cos(s.bank)
+	s.pitch = s.pitch + s.av.x*c*dt
+	s.yaw = wrap (s.yaw - s.av.y*c*dt)
+	s.bank = wrap (s.bank - s.av.z*dt)
+
+	local main = lvl(THGROUP.MAIN)
+	prm.ApD = prm.ApD + 400*main*dt
+	prm.PeD = math.min (prm.PeD + 12.5e3*main*dt, prm.ApD)
+	prm.ApT = math.max (prm.ApT - dt, 0)
+end
+
+local function check (stub)
+	local out = stub.output
+	local done = false
+	for i=1,#out do
+		if out[i] == 'Exit launch autopilot.' then done = true end
+	end
+	return done and #atl.state.keys == 1,
+		string.format ('ApA %.0f km, PeA %.0f km, ET jettisoned: %s', (prm.ApD-R_Earth)*1e-3,
+			(prm.PeD-R_Earth)*1e-3, tostring(#atl.state.keys == 1))
+end
+
+return {
+	vessels = {atl},
+	cmd = "run('Atlantis/launch') launch()",
+	frames = 40000,
+	dt = 0.1,
+	step = step,
+	check = check
+}
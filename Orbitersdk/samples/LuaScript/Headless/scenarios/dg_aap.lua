@@ -0,0 +1,67 @@
+-- Headless scenario: DeltaGlider atmospheric autopilot (Script/DG/aap.lua)
+-- Runs the altitude, airspeed and heading autopilots on a point-mass
+-- flight model and checks that the targets are acquired.
+
+local tgtalt = 5000
+local tgtspd = 200
+local tgthdg = 90
+
+local G = 9.81
+
+-- point-mass state: altitude, airspeed, flight path slope, bank, heading
+local s = {alt=4000, spd=180, slope=0, bank=0, yaw=80*math.pi/180}
+
+local gl = {
+	name = 'GL-01',
+	class = 'DeltaGlider',
+	state = {
+		altitude = function () return s.alt end,
+		airspeed = function () return s.spd end,
+		airspeedvector = function ()
+			return {x=0, y=s.spd*math.sin(s.slope), z=s.spd*math.cos(s.slope)}
+		end,
+		bank = function () return s.bank end,
+		yaw = function () return s.yaw end,
+		pitch = function () return s.slope end
+	}
+}
+
+local function clamp (x, a, b)
+	if x < a then return a elseif x > b then return b end
+	return x
+end
+
+local function step (stub, simt, dt)
+	local st = gl.state
+	local elev = st.adclevel[AIRCTRL.ELEVATOR] or 0
+	local ail = st.adclevel[AIRCTRL.AILERON] or 0
+	local thr = st.thlevel[THGROUP.MAIN] or 0
+
+	-- thrust against quadratic drag and gravity along the path
+	local acc = 20*thr - 1e-4*s.spd*s.spd - G*math.sin(s.slope)
+	s.spd = math.max (s.spd + acc*dt, 50)
+	-- elevator sets the path rotation rate, aileron the roll rate
+	s.slope = clamp (s.slope + 0.5*elev*dt, -1.2, 1.2)
+	s.bank = clamp (s.bank - ail*dt, -1.2, 1.2)
+	-- coordinated turn
+	s.yaw = (s.yaw - G*math.tan(s.bank)/s.spd*dt) % (2*math.pi)
+	s.alt = s.alt + s.spd*math.sin(s.slope)*dt
+end
+
+local function check (stub)
+	local dalt = math.abs (s.alt-tgtalt)
+	local dspd = math.abs (s.spd-tgtspd)
+	local dhdg = math.abs ((s.yaw*180/math.pi - tgthdg + 180) % 360 - 180)
+	return dalt < 50 and dspd < 5 and dhdg < 2,
+		string.format ('alt %.0f m, airspeed %.1f m/s, heading %.1f deg', s.alt, s.spd, s.yaw*180/math.pi)
+end
+
+return {
+	vessels = {gl},
+	cmd = string.format ("run('DG/aap') setvessel('GL-01') aap.alt(%g) aap.spd(%g) aap.hdg(%g)",
+		tgtalt, tgtspd, tgthdg),
+	frames = 12000,
+	dt = 0.05,
+	step = step,
+	check = check
+}
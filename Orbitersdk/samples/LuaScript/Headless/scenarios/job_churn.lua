@@ -0,0 +1,27 @@
+-- Headless scenario: timer heap under job churn
+--
+-- Spawns and kills waiting jobs in every cycle. Checks that the timer
+-- entries of killed jobs don't accumulate in the heap, and that the
+-- timer of a surviving job still fires.
+
+return {
+	vessels = {},
+
+	cmd = [[
+		maxheap = 0
+		fired = 0
+		proc.bg (function () proc.wait_simdt (0.5) fired = fired+1 end)
+		for k=1,200 do
+			local ids = {}
+			for i=1,20 do ids[i] = proc.bg (function () proc.wait_simdt (1000) end) end
+			for i=1,20 do proc.kill (ids[i]) end
+			if #branch.timer > maxheap then maxheap = #branch.timer end
+			proc.skip()
+		end
+		proc.wait_simdt (1)
+	]],
+	frames = 400, dt = 0.02,
+	check = function (stub)
+		return maxheap < 64 and fired == 1 and branch.nlive == 0, 'max heap '..maxheap..', fired '..fired..', live '..branch.nlive
+	end
+}
@@ -0,0 +1,69 @@
+-- Headless scenario: command queue, execution budget and protected calls
+--
+-- Posts several commands (see Headless.cpp), runs a busy background job under
+-- an instruction budget, and suspends commands inside proc.pcall. Checks
+-- that
+--   - commands posted in the same frame run in order within one cycle,
+--     until one of them suspends itself or the budget is used up
+--   - a command waiting inside proc.pcall is resumed in later cycles
+--   - proc.xpcall passes the failing coroutine to the handler
+--   - the scheduler defers jobs once the cycle is over budget
+--   - vector objects reject fields other than x, y, z
+
+
+
+return {
+	vessels = {
+		{name='GL-01', class='DeltaGlider', state={
+			angvel = function () return {x=0.1, y=0.2, z=0.3} end
+		}}
+	},
+
+	cmd = [[
+		log = {}
+		proc.set_budget (20000)
+		for i=1,3 do
+			proc.bg (function ()
+				while true do
+					local s = 0
+					for k=1,5000 do s = s+k end
+					log[#log+1] = 'job'..i
+					proc.skip()
+				end
+			end)
+		end
+	]],
+
+	post = {
+		{frame=2, cmd="log[#log+1] = 'a'"},
+		{frame=2, cmd="log[#log+1] = 'b'"},
+		{frame=3, cmd=[[
+			local ok, err = proc.pcall (function ()
+				proc.wait_simdt (0.1)
+				error ('expected', 0)
+			end)
+			log[#log+1] = (not ok and err == 'expected') and 'pcall' or 'pcall failed'
+			ok, err = proc.xpcall (function ()
+				proc.skip()
+				local t = nil
+				return t.x
+			end, debug.traceback)
+			log[#log+1] = (not ok and string.find (err, 'stack traceback:\n%s*%[string') ~= nil) and 'xpcall' or 'xpcall failed'
+			local w = vessel.get_interface('GL-01'):get_angvel()
+			w.zn = 1
+			log[#log+1] = (type(w) == 'userdata' and w.zn == nil and w.y == 0.2) and 'vec' or 'vec failed'
+			for i=1,3 do proc.kill (i) end
+		]]},
+	},
+
+	frames = 100,
+	dt = 0.02,
+
+	check = function (stub)
+		local l = table.concat (log, ' ')
+		local ia, ib = string.find (l, 'a b', 1, true)
+		local deferred = stub.bstats.overruns > 0
+		local ok = #stub.cmds == 4 and ia ~= nil and string.find (l, ' pcall .*xpcall vec$') ~= nil and deferred
+		return ok, string.format ('%d commands, %d overruns', #stub.cmds, stub.bstats.overruns)
+	end
+}
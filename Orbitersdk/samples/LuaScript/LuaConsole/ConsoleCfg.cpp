@@ -34,6 +34,8 @@ int ConsoleConfig::clbkWriteConfig ()
 	FILEHANDLE hFile = oapiOpenFile (cfgfile, FILE_OUT, CONFIG);
 	if (!hFile) return 1;
 	oapiWriteItem_int (hFile, "FSIZE", fontsize);
+	oapiWriteItem_int (hFile, "BUDGET_INSTR", budget_instr);
+	oapiWriteItem_float (hFile, "BUDGET_TIME", budget_time);
 	oapiCloseFile (hFile, FILE_OUT);
 	return 0;
 }
@@ -53,17 +55,22 @@ void ConsoleConfig::CloseDialog (HWND hDlg)
 void ConsoleConfig::SetDefault ()
 {
 	fontsize = 14;
+	budget_instr = 0;
+	budget_time = 10.0;
 }
 
 bool ConsoleConfig::ReadConfig ()
 {
 	int d;
+	double t;
 	FILEHANDLE hFile = oapiOpenFile (cfgfile, FILE_IN, CONFIG);
 	if (!hFile) {
 		MessageBeep (-1);
 		return false;
 	}
 	if (oapiReadItem_int (hFile, "FSIZE", d)) fontsize = (DWORD)d;
+	if (oapiReadItem_int (hFile, "BUDGET_INSTR", d)) budget_instr = (DWORD)d;
+	if (oapiReadItem_float (hFile, "BUDGET_TIME", t)) budget_time = t;
 	oapiCloseFile (hFile, FILE_IN);
 	return true;
 }
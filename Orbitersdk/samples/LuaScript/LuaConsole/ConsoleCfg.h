@@ -21,6 +21,8 @@ public:
 
 protected:
 	DWORD fontsize;
+	DWORD budget_instr;   // interpreter instruction budget per frame (0=unlimited)
+	double budget_time;   // interpreter time budget per frame [ms] (0=unlimited)
 
 private:
 	static BOOL CALLBACK DlgProc (HWND, UINT, WPARAM, LPARAM);
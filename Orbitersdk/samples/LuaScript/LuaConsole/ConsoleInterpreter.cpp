@@ -24,16 +24,17 @@ void ConsoleInterpreter::LoadAPI ()
 
 void ConsoleInterpreter::term_strout (const char *str, bool iserr)
 {
-	if (strchr (str, '\n')) {
-		char *cbuf = new char[strlen(str)+1];
-		strcpy (cbuf, str);
-		char *s = strtok (cbuf, "\n");
-		while (s) {
-			console->AddLine (s, iserr ? 2:1);
-			s = strtok (NULL, "\n");
+	// split into lines, copying each directly into the terminal buffer
+	const char *s, *s0 = str;
+	for (;;) {
+		s = strchr (str, '\n');
+		if (!s) {
+			if (str[0] || str == s0) console->AddLine (str, iserr ? 2:1);
+			break;
 		}
-		delete []cbuf;
-	} else console->AddLine (str, iserr ? 2:1);
+		if (s > str) console->AddLine (str, iserr ? 2:1, s-str);
+		str = s+1;
+	}
 }
 
 int ConsoleInterpreter::termOut (lua_State *L)
@@ -3,7 +3,7 @@
 #include "LuaConsole.h"
 #include "ConsoleCfg.h"
 #include "resource.h"
-#include <process.h>
+#include "..\..\Common\Profile\FrameProf.h"
 
 using namespace oapi;
 
@@ -21,9 +21,11 @@ char cConsoleCmd[1024] = "\0";
 LuaConsole::LuaConsole (HINSTANCE hDLL): Module (hDLL)
 {
 	hWnd = NULL;
-	hThread = NULL;
+	hTerm = NULL;
 	interp = NULL;
 	bRefresh = false;
+	bRepaint = true;
+	dirty0 = dirty1 = 0;
 	fW = 0;
 
 	SetParams (); // may not be necessary here
@@ -33,9 +35,11 @@ LuaConsole::LuaConsole (HINSTANCE hDLL): Module (hDLL)
 		"Open a Lua script interpreter window.",
 		OpenDlgClbk, this);
 
-	// terminal history buffer
+	// terminal history buffer: all lines share a single arena
+	linebuf = new char[NLINE*NCOL];
 	for (DWORD i = 0; i < NLINE; i++) {
-		line[i].buf = NULL;
+		line[i].buf = linebuf + i*NCOL;
+		line[i].buf[0] = '\0';
 		line[i].mode = 0;
 	}
 	line0 = 0;
@@ -43,9 +47,22 @@ LuaConsole::LuaConsole (HINSTANCE hDLL): Module (hDLL)
 	tline = 0;
 	topline = 0;
 
+	// command history buffer
+	histbuf = new char[NHIST*NINP];
+	for (DWORD i = 0; i < NHIST; i++) {
+		hist[i] = histbuf + i*NINP;
+		hist[i][0] = '\0';
+	}
+	hprefix = new char[NINP];
+	hprefix[0] = '\0';
+	nprefix = 0;
+	hist0 = 0;
+	nhist = 0;
+	hline = 0;
+
 	// input buffer
-	inp = new char[1024];
-	memset (inp, 0, 1024);
+	inp = new char[NINP];
+	memset (inp, 0, NINP);
 	caret = 0;
 	ninp = 0;
 
@@ -74,9 +91,10 @@ LuaConsole::~LuaConsole ()
 	// Unregister the terminal window class
 	UnregisterClass ("ConsoleDsp", hModule);
 
-	// Delete terminal buffer
-	for (DWORD i = 0; i < NLINE; i++)
-		if (line[i].buf) delete []line[i].buf;
+	// Delete terminal and history buffers
+	delete []linebuf;
+	delete []histbuf;
+	delete []hprefix;
 
 	// Delete input buffer
 	delete []inp;
@@ -106,19 +124,8 @@ void LuaConsole::clbkSimulationStart (RenderMode mode)
 
 void LuaConsole::clbkSimulationEnd ()
 {
-	// Kill the interpreter thread
+	// Kill the interpreter
 	if (interp) {
-		if (hThread) {
-			termInterp = true;
-			interp->Terminate();
-			interp->EndExec(); // give the thread opportunity to close
-			if (WaitForSingleObject (hThread, 1000) != 0) {
-				oapiWriteLog ("LuaConsole: timeout while waiting for interpreter thread");
-				TerminateThread (hThread, 0);
-			}
-			CloseHandle (hThread);
-			hThread = NULL;
-		}
 		delete interp;
 		interp = NULL;
 	}
@@ -131,15 +138,20 @@ void LuaConsole::clbkSimulationEnd ()
 
 void LuaConsole::clbkPreStep (double simt, double simdt, double mjd)
 {
+	FRAMEPROF_CALLBACK ("LuaConsole::clbkPreStep");
 	if (interp) {
-		if (interp->IsBusy() || cConsoleCmd[0] || interp->nJobs()) { // let the interpreter do some work
-			interp->EndExec();        // orbiter hands over control
-			// At this point the interpreter is performing one cycle
-			interp->WaitExec();   // orbiter waits to get back control
+		if (cConsoleCmd[0] && !interp->IsBusy()) { // start a new command
+			interp->StartChunk (cConsoleCmd, strlen (cConsoleCmd));
+			cConsoleCmd[0] = '\0'; // free buffer
+		}
+		if (interp->IsBusy() || interp->nJobs()) { // let the interpreter do some work
+			int res = interp->Resume();
+			if (res != LUA_YIELD && res != -1)
+				bRefresh = true; // command finished: refresh terminal
 		}
 		if (bRefresh) {
 			UpdateScrollbar();
-			RefreshTerminal();
+			UpdateTerminal();
 			bRefresh = false;
 		}
 		interp->PostStep (simt, simdt, mjd);
@@ -161,7 +173,7 @@ HWND LuaConsole::Open ()
 	// get geometry information
 	SetTermGeometry (hTerm);
 
-	// create the interpreter and execution thread
+	// create the interpreter
 	if (!interp)
 		interp = CreateInterpreter ();
 
@@ -245,6 +257,8 @@ void LuaConsole::SetTermGeometry (HWND hTerm)
 	GetClientRect (hTerm, &rc);
 	int w = rc.right, h = rc.bottom;
 	tline = h/fH; // terminal lines
+	bRepaint = true;
+	dirty0 = dirty1 = 0;
 }
 
 // ==============================================================
@@ -255,33 +269,79 @@ void LuaConsole::RefreshTerminal ()
 		InvalidateRect (hTerm, NULL, TRUE);
 		UpdateWindow (hTerm);
 		PaintTerminal ();
+		bRepaint = false;
+		dirty0 = dirty1 = 0;
+	}
+}
+
+// ==============================================================
+
+void LuaConsole::UpdateTerminal ()
+{
+	if (!hTerm) return;
+	if (bRepaint) {
+		RefreshTerminal ();
+	} else {
+		// repaint only the modified rows, plus the prompt row which
+		// reflects the input buffer and interpreter state
+		int prow = nline - (topline-line0+NLINE)%NLINE;
+		if (dirty0 < dirty1)
+			PaintTerminal (dirty0, dirty1);
+		if (prow < dirty0 || prow >= dirty1)
+			PaintTerminal (prow, prow+1);
+		dirty0 = dirty1 = 0;
 	}
 }
 
 // ==============================================================
 
-void LuaConsole::PaintTerminal ()
+void LuaConsole::MarkDirty (int row0, int row1)
+{
+	row0 = max (row0, 0);
+	row1 = min (row1, tline);
+	if (row0 >= row1) return;
+	if (dirty0 >= dirty1) {
+		dirty0 = row0;
+		dirty1 = row1;
+	} else {
+		dirty0 = min (dirty0, row0);
+		dirty1 = max (dirty1, row1);
+	}
+}
+
+// ==============================================================
+
+void LuaConsole::PaintTerminal (int row0, int row1)
 {
 	if (!tline) return;
+	if (row1 < 0 || row1 > tline) row1 = tline;
+	if (row0 < 0) row0 = 0;
+	if (row0 >= row1) return;
 
 	bool bPrompt = !interp->IsBusy();
-	DWORD i, idx, x0, x, y;
-	DWORD nnline = nline;
-	if (bPrompt) nnline++;
+	int i, idx, x0, x, y;
 	HFONT pFont;
 	HDC hDC = GetDC (hTerm);
+
+	// clear the background of the repainted rows
+	RECT rc;
+	GetClientRect (hTerm, &rc);
+	if (row0) rc.top = 1+row0*fH;
+	if (row1 < tline) rc.bottom = 1+row1*fH;
+	FillRect (hDC, &rc, (HBRUSH)GetStockObject (WHITE_BRUSH));
+
 	SelectObject (hDC, GetStockObject (NULL_BRUSH));
 	SelectObject (hDC, GetStockObject (BLACK_PEN));
 	pFont = (HFONT)SelectObject (hDC, hFont);
 	SetTextColor (hDC, col[0]);
 	int pmode = 0;
 	SetBkMode (hDC, TRANSPARENT);
-	x0 = x = 2; y = 1;
+	x0 = x = 2; y = 1+row0*fH;
 	int dtop = (topline-line0+NLINE)%NLINE;
-	DWORD ndisp = min (nline-dtop,tline-1);
-	for (i = 0; i < ndisp; i++) {
+	int ndisp = min (min (nline-dtop,tline-1), row1);
+	for (i = row0; i < ndisp; i++) {
 		idx = (topline+i)%NLINE;
-		if (!i || line[idx].mode != pmode) {
+		if (i == row0 || line[idx].mode != pmode) {
 			pmode = line[idx].mode;
 			SetTextColor (hDC, col[pmode]);
 			x = (!pmode ? x0+fW : x0);
@@ -290,8 +350,9 @@ void LuaConsole::PaintTerminal ()
 		TextOut (hDC, x, y, line[idx].buf, strlen(line[idx].buf));
 		y += fH;
 	}
-	if (bPrompt && nline-dtop >= 0 && nline-dtop < tline) {
+	if (bPrompt && nline-dtop >= row0 && nline-dtop < row1) {
 		x = x0+fW;
+		y = 1+(nline-dtop)*fH;
 		if (pmode) SetTextColor (hDC, col[0]);
 		TextOut (hDC, x0, y, "%", 1);
 		if (inp[0])
@@ -307,20 +368,26 @@ void LuaConsole::PaintTerminal ()
 
 // ==============================================================
 
-void LuaConsole::AddLine (const char *str, int mode)
+void LuaConsole::AddLine (const char *str, int mode, int len)
 {
 	int idx = (line0+nline)%NLINE;
 	LineSpec *ln = line + idx;
-	if (ln->buf) delete []ln->buf;
-	int ncol = strlen(str);
+	int ncol = (len < 0 ? strlen(str) : len);
+	if (ncol >= NCOL) ncol = NCOL-1; // truncate to line width
+	memcpy (ln->buf, str, ncol);
+	ln->buf[ncol] = '\0';
 	ln->mode = mode;
-	ln->buf = new char[ncol+1];
-	strcpy (ln->buf, str);
 	int dtop = (topline-line0+NLINE)%NLINE;
 	int ddsp = nline-dtop;
 	bool vis = (ddsp >= 0 && ddsp < tline);
-	if (nline == NLINE) line0 = (line0+1)%NLINE;
-	else nline++;
+	if (nline == NLINE) {
+		line0 = (line0+1)%NLINE;
+		if (idx == topline) { // top display line was recycled
+			topline = line0;
+			bRepaint = true;
+		}
+	} else nline++;
+	if (vis) MarkDirty (ddsp, ddsp+2); // new line and prompt row
 	if (!mode || vis) AutoScroll();
 	bRefresh = true;
 }
@@ -343,9 +410,21 @@ void LuaConsole::AutoScroll ()
 void LuaConsole::ScrollTo (int pos)
 {
 	pos = max (0, min (nline-1, pos));
+	int dpos = pos - (topline-line0+NLINE)%NLINE; // number of scrolled rows
 	pos = (pos+line0)%NLINE;
 	if (pos != topline) {
 		topline = pos;
+		if (hTerm && !bRepaint && abs(dpos) < tline) {
+			// shift the displayed rows and repaint only the exposed ones
+			ScrollWindowEx (hTerm, 0, -dpos*(int)fH, NULL, NULL, NULL, NULL, 0);
+			if (dirty0 < dirty1) {
+				dirty0 = max (dirty0-dpos, 0);
+				dirty1 = min (dirty1-dpos, tline);
+			}
+			if (dpos > 0) MarkDirty (tline-dpos-1, tline);
+			else          MarkDirty (0, 1-dpos);
+		} else
+			bRepaint = true;
 		bRefresh = true;
 	}
 }
@@ -379,46 +458,51 @@ void LuaConsole::UpdateScrollbar ()
 void LuaConsole::InputLine (const char *str)
 {
 	AddLine (str, 0);
-	hline = nline;
+	AddHistory (str);
 	strcpy (cConsoleCmd, str);
 }
 
 // ==============================================================
 
+void LuaConsole::AddHistory (const char *str)
+{
+	// skip empty commands and immediate repeats
+	if (str[0] && (!nhist || strcmp (hist[(hist0+nhist-1)%NHIST], str))) {
+		int idx = (hist0+nhist)%NHIST;
+		strncpy (hist[idx], str, NINP-1);
+		hist[idx][NINP-1] = '\0';
+		if (nhist == NHIST) hist0 = (hist0+1)%NHIST;
+		else nhist++;
+	}
+	hline = nhist;
+}
+
+// ==============================================================
+
 bool LuaConsole::ScanHistory (int step)
 {
-	DWORD ln = nline, phline = hline;
-	bool found = false;
-	if (step < 0) { // step back
-		if (!hline) return false;
-		for (--hline; hline != (DWORD)-1; hline--) {
-			ln = (line0+hline)%NLINE;
-			if (!line[ln].mode && line[ln].buf) { found = true; break; }
-		}
-	} else { // step forward
-		if (hline == nline) return false;
-		for (++hline; hline != nline; hline++) {
-			ln = (line0+hline)%NLINE;
-			if (!line[ln].mode && line[ln].buf) { found = true; break; }
-		}
+	// The contents of the input buffer at the start of a scan serve as
+	// search prefix: only commands starting with it are recalled.
+	if (hline == nhist) {
+		memcpy (hprefix, inp, ninp);
+		hprefix[nprefix = ninp] = '\0';
 	}
-	if (found) {
-		if (ln == nline) {
-			inp[0] = '\0';
-			ninp = caret = 0;
-		} else {
-			strncpy (inp, line[ln].buf, 1024);
-			ninp = caret = min (strlen (line[ln].buf), 1024);
-		}
-	} else if (step > 0) {
-		inp[0] = '\0';
-		ninp = caret = 0;
-	} else {
-		hline = phline;
+	int h;
+	for (h = hline+step; h >= 0 && h < nhist; h += step)
+		if (!strncmp (hist[(hist0+h)%NHIST], hprefix, nprefix)) break;
+
+	if (h < 0) { // no earlier match
 		return false;
+	} else if (h >= nhist) { // past the newest command: restore the prefix
+		if (hline == nhist) return false;
+		hline = nhist;
+		strcpy (inp, hprefix);
+		ninp = caret = nprefix;
+	} else {
+		hline = h;
+		strcpy (inp, hist[(hist0+h)%NHIST]);
+		ninp = caret = strlen (inp);
 	}
-
-	bRefresh = true;
 	return true;
 }
 
@@ -443,7 +527,7 @@ LRESULT WINAPI LuaConsole::TermProc (HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM
 			caret = ninp = 0;
 			return 0;
 		default:
-			if (isprint (wParam)) {
+			if (isprint (wParam) && ninp < NINP-1) {
 				for (int i = ninp; i > caret; i--)
 					inp[i] = inp[i-1];
 				inp[caret++] = (char)wParam;
@@ -453,8 +537,9 @@ LRESULT WINAPI LuaConsole::TermProc (HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM
 			}
 			break;
 		}
+		hline = nhist; // editing ends a history scan
 		AutoScroll();
-		RefreshTerminal();
+		UpdateTerminal();
 		return 0;
 	case WM_KEYDOWN:
 		switch (wParam) {
@@ -477,7 +562,7 @@ LRESULT WINAPI LuaConsole::TermProc (HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM
 		//	return 0;
 		}
 		AutoScroll();
-		RefreshTerminal();
+		UpdateTerminal();
 		return 0;
 	case WM_VSCROLL:
 		switch (LOWORD(wParam)) {
@@ -573,31 +658,9 @@ DLLCLBK void ExitModule (HINSTANCE hDLL)
 
 Interpreter *LuaConsole::CreateInterpreter ()
 {
-	unsigned int id;
-	termInterp = false;
 	interp = new ConsoleInterpreter (this);
 	interp->Initialise();
-	hThread = (HANDLE)_beginthreadex (NULL, 4096, &InterpreterThreadProc, this, 0, &id);
+	if (g_Config)
+		interp->SetBudget (g_Config->budget_instr, g_Config->budget_time);
 	return interp;
 }
-// Interpreter thread function
-unsigned int WINAPI LuaConsole::InterpreterThreadProc (LPVOID context)
-{
-	int res;
-	LuaConsole *console = (LuaConsole*)context;
-	ConsoleInterpreter *interp = (ConsoleInterpreter*)console->interp;
-
-	// interpreter loop
-	for (;;) {
-		interp->WaitExec(); // wait for execution permission
-		if (console->termInterp) break; // close thread requested
-		res = interp->RunChunk (cConsoleCmd, strlen (cConsoleCmd)); // run command from buffer
-		if (interp->Status() == 1) break; // close thread requested
-		cConsoleCmd[0] = '\0';    // free buffer
-		console->bRefresh = (res != -1); // signal terminal refresh
-		interp->EndExec();        // return control
-	}
-	interp->EndExec();  // release mutex (is this necessary?)
-	_endthreadex(0);
-	return 0;
-}
@@ -5,7 +5,10 @@
 #include "ModuleAPI.h"
 #include "ConsoleInterpreter.h"
 
-#define NLINE 100 // number of buffered lines
+#define NLINE 256  // number of buffered lines
+#define NCOL  256  // max. characters per buffered line (including terminating 0)
+#define NHIST 64   // number of buffered input commands
+#define NINP  1024 // size of input buffer
 
 class LuaConsole: public oapi::Module {
 	friend class ConsoleInterpreter;
@@ -24,7 +27,8 @@ public:
 	void SetFontSize (DWORD size);
 	void Resize (DWORD w, DWORD h);
 	void RefreshTerminal ();
-	void PaintTerminal ();
+	void UpdateTerminal ();
+	void PaintTerminal (int row0 = 0, int row1 = -1);
 
 protected:
 	bool SetParams ();
@@ -34,19 +38,18 @@ protected:
 	void ScrollTo (int pos);
 	void ScrollBy (int dpos);
 	void UpdateScrollbar ();
+	void MarkDirty (int row0, int row1);
 	LRESULT WINAPI TermProc (HWND, UINT, WPARAM, LPARAM);
 
 private:
 	static BOOL CALLBACK DlgProc (HWND, UINT, WPARAM, LPARAM);
 	static LRESULT WINAPI TermProcHook (HWND, UINT, WPARAM, LPARAM);
-	static unsigned int WINAPI InterpreterThreadProc (LPVOID context);
 	static void OpenDlgClbk (void *context); // called when user requests console window
 	Interpreter *CreateInterpreter ();
-	void AddLine (const char *str, int mode=1); // add line to buffer
+	void AddLine (const char *str, int mode=1, int len=-1); // add line to buffer
 	void InputLine (const char *str); // user input
+	void AddHistory (const char *str); // add command to input history
 	bool ScanHistory (int step); // recall previous command to input buffer
-	HANDLE hThread;    // interpreter thread handle
-	bool termInterp;
 
 	Interpreter *interp; // interpreter instance
 	HWND hWnd;      // console window handle
@@ -56,19 +59,27 @@ private:
 	DWORD dwCmd;    // custom command id
 
 	struct LineSpec { // terminal history buffer
-		char *buf;
+		char *buf;  // line text (points into line arena)
 		int mode;   // 0=input, 1=output, 2=error output
-		//bool isInp;
 	} line[NLINE];
+	char *linebuf;  // line arena (NLINE x NCOL characters)
+	char *hist[NHIST]; // command history (points into history arena)
+	char *histbuf;  // history arena (NHIST x NINP characters)
+	char *hprefix;  // search prefix for current history scan
+	int nprefix;    // length of search prefix
 	char *inp;      // input buffer
 	int line0;      // buffer index of first line
-	int hline;      // current history scan line
+	int hist0;      // history index of oldest command
+	int nhist;      // number of commands in history
+	int hline;      // current history scan position (nhist: not scanning)
 	int nline;      // number of lines in input buffer
 	int ninp;       // number of characters in input buffer
 	int tline;      // number of lines visible in terminal window
 	int topline;    // topmost displayed line
 	int caret;      // caret position in input buffer
 	bool bRefresh;  // display refresh flag
+	bool bRepaint;  // full terminal repaint required
+	int dirty0, dirty1; // range of display rows to be repainted
 	COLORREF col[3]; // colour for input/output/error text
 };
 
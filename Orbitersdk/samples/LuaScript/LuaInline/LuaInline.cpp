@@ -21,71 +21,38 @@
 #define ORBITER_MODULE
 #include "orbitersdk.h"
 #include "LuaInline.h"
+#include "..\..\Common\Profile\FrameProf.h"
 #include <direct.h>
-#include <process.h>
 
 // ==============================================================
 // class InterpreterList::Environment: implementation
 
 InterpreterList::Environment::Environment()
 {
-	cmd = NULL;
 	singleCmd = false;
-	hThread = NULL;
 	interp = CreateInterpreter ();
 }
 
 InterpreterList::Environment::~Environment()
 {
-	if (interp) {
-		if (hThread) {
-			termInterp = true;
-			interp->Terminate();
-			interp->EndExec(); // give the thread opportunity to close
-
-			if (WaitForSingleObject (hThread, 1000) != 0) {
-				oapiWriteLog("LuaInline: timeout while waiting for interpreter thread");
-				TerminateThread (hThread, 0);
-			}
-			CloseHandle (hThread);
-		}
-		delete interp;
-	}
+	if (interp) delete interp;
 }
 
 Interpreter *InterpreterList::Environment::CreateInterpreter ()
 {
-	unsigned id;
-	termInterp = false;
 	interp = new Interpreter ();
 	interp->Initialise();
-	hThread = (HANDLE)_beginthreadex (NULL, 4096, &InterpreterThreadProc, this, 0, &id);
 	return interp;
 }
 
-unsigned int WINAPI InterpreterList::Environment::InterpreterThreadProc (LPVOID context)
+void InterpreterList::Environment::Step ()
 {
-	InterpreterList::Environment *env = (InterpreterList::Environment*)context;
-	Interpreter *interp = env->interp;
+	if (interp->Status() == 1) return; // interpreter terminated
 
-	// interpreter loop
-	for (;;) {
-		interp->WaitExec(); // wait for execution permission
-		if (env->termInterp) break; // close thread requested
-		if (env->cmd) {
-			interp->RunChunk (env->cmd, strlen (env->cmd)); // run command from buffer
-			delete []env->cmd;
-			env->cmd = 0;
-			if (env->singleCmd) break;
-		} else {
-			interp->RunChunk ("", 0); // idle loop
-		}
-		if (interp->Status() == 1) break;
-		interp->EndExec();  // return control
-	}
-	interp->EndExec();  // return mutex (is this necessary?)
-	_endthreadex(0);
-	return 0;
+	// run queued commands and pending tasks
+	int res = interp->RunQueue();
+	if (res != LUA_YIELD && res != -1 && singleCmd)
+		interp->Terminate();
 }
 
 
@@ -109,16 +76,13 @@ void InterpreterList::clbkSimulationEnd ()
 
 void InterpreterList::clbkPostStep (double simt, double simdt, double mjd)
 {
+	FRAMEPROF_CALLBACK ("LuaInline::clbkPostStep");
 	DWORD i;
 	for (i = 0; i < nlist; i++) // prune all finished interpreters
 		if (!list[i]->interp) DelInterpreter (list[i--]);
 
-	for (i = 0; i < nlist; i++) { // let the interpreter do some work
-		if (list[i]->interp->IsBusy() || list[i]->cmd || list[i]->interp->nJobs()) {
-			list[i]->interp->EndExec();
-			list[i]->interp->WaitExec();
-		}
-	}
+	for (i = 0; i < nlist; i++) // let the interpreter do some work
+		list[i]->Step();
 }
 
 InterpreterList::Environment *InterpreterList::AddInterpreter ()
@@ -192,8 +156,10 @@ DLLCLBK INTERPRETERHANDLE opcRunInterpreter (const char *cmd)
 {
 	if (g_IList) {
 		InterpreterList::Environment *env = g_IList->AddInterpreter();
-		env->cmd = new char[strlen(cmd)+10];
-		sprintf (env->cmd, "run('%s')", cmd);
+		char *str = new char[strlen(cmd)+10];
+		sprintf (str, "run('%s')", cmd);
+		env->interp->PostCmd (str);
+		delete []str;
 		return (INTERPRETERHANDLE)env;
 	} else {
 		return NULL;
@@ -203,39 +169,26 @@ DLLCLBK INTERPRETERHANDLE opcRunInterpreter (const char *cmd)
 DLLCLBK bool opcAsyncScriptCmd (INTERPRETERHANDLE hInterp, const char *cmd)
 {
 	InterpreterList::Environment *env = (InterpreterList::Environment*)hInterp;
-	char *str;
-	if (env->cmd) { // command still waiting: append new command
-		str = new char[strlen(env->cmd)+strlen(cmd)+2];
-		strcpy(str,env->cmd);
-		strcat(str,";");
-		strcat(str,cmd);
-		char *tmp = env->cmd;
-		env->cmd = str;
-		delete []tmp;
-	} else {
-		str = new char[strlen(cmd)+1];
-		strcpy (str, cmd);
-		env->cmd = str;
-	}
+	// queue the command without waiting for the interpreter. It is executed
+	// in the next postStep cycle, after any previously queued commands
+	env->interp->PostCmd (cmd);
 	return true;
 }
 
+// Queue a command and return a completion handle (see Interpreter::PostCmd).
+// The handle must be released with ScriptCmdRelease.
+DLLCLBK SCRIPTCMD *opcPostScriptCmd (INTERPRETERHANDLE hInterp, const char *cmd, SCRIPTCMDCLBK clbk, void *context)
+{
+	InterpreterList::Environment *env = (InterpreterList::Environment*)hInterp;
+	return env->interp->PostCmd (cmd, clbk, context, true);
+}
+
 DLLCLBK bool opcExecScriptCmd (INTERPRETERHANDLE hInterp, const char *cmd)
 {
 	InterpreterList::Environment *env = (InterpreterList::Environment*)hInterp;
-	char *str = new char[strlen(cmd)+1];
-	char *cmd_async = 0;
-	strcpy (str, cmd);
-	if (env->cmd) // asynchronous request is waiting
-		cmd_async = env->cmd;
-	env->cmd = str;
-	while (env->cmd) {
-		// wait until command has been executed
-		env->interp->EndExec();
-		env->interp->WaitExec();
-	}
-	if (cmd_async) // restore the asynchronous request
-		env->cmd = cmd_async;
+	// run the command to completion on the calling thread. A pending
+	// asynchronous task is left suspended and continues in the next cycle
+	env->interp->RunChunk (cmd, strlen (cmd));
 	return true;
 }
 
@@ -8,12 +8,198 @@
 VESSEL *vfocus = (VESSEL*)0x1;
 NOTEHANDLE Interpreter::hnote = NULL;
 
+static const DWORD BUDGET_HOOKSTEP = 1000;         // instructions between budget checks
+static const char *PREEMPT_REG = "interp.preempt"; // registry: preemptible job threads
+static LONGLONG tickfreq = 0;                      // performance counter frequency [Hz]
+
 // ============================================================================
 // nonmember functions
 
+// metatables of the vector and matrix object types
+static const char *VECTOR_MT = "VECTOR.vtable";
+static const char *MATRIX_MT = "MATRIX.vtable";
+
+// metatable of mesh vertex buffer objects (see oapi.map_meshgroup)
+static const char *MESHVTX_MT = "MESHVTX.vtable";
+
+// A mesh vertex buffer object holds a copy of the vertex list of a mesh
+// group. Scripts read and modify it in place, and commit the changes back
+// to the mesh with a single oapiEditMeshGroup call. The vertex array is
+// stored in the same userdata block as the header.
+struct MESHVTX {
+	DEVMESHHANDLE hMesh; // mesh instance
+	DWORD grp;           // group index
+	DWORD nvtx;          // number of vertices
+	DWORD dirty;         // GRPEDIT flags of modified vertex components
+	NTVERTEX vtx[1];     // vertex list (allocated to size)
+};
+
+// returns a pointer to the data of userdata object 'idx' if its metatable is
+// 'mtname', or NULL otherwise
+static void *lua_toobject (lua_State *L, int idx, const char *mtname)
+{
+	void *p = lua_touserdata (L, idx);
+	if (p && !lua_islightuserdata (L, idx) && lua_getmetatable (L, idx)) {
+		luaL_getmetatable (L, mtname);
+		if (!lua_rawequal (L, -1, -2)) p = 0;
+		lua_pop (L, 2);
+		return p;
+	}
+	return 0;
+}
+
+static inline VECTOR3 *lua_tovectorobj (lua_State *L, int idx)
+{
+	return (VECTOR3*)lua_toobject (L, idx, VECTOR_MT);
+}
+
+static inline MATRIX3 *lua_tomatrixobj (lua_State *L, int idx)
+{
+	return (MATRIX3*)lua_toobject (L, idx, MATRIX_MT);
+}
+
+static inline MESHVTX *lua_tomeshvtx (lua_State *L, int idx)
+{
+	return (MESHVTX*)lua_toobject (L, idx, MESHVTX_MT);
+}
+
+// returns the number of components of the vertex field named at stack
+// position 'idx' ('pos', 'nml' or 'tex'), its float offset in NTVERTEX and
+// the corresponding GRPEDIT flags, or 0 if the name is not recognised
+static int lua_tovtxfield (lua_State *L, int idx, int *ofs, DWORD *flag)
+{
+	const char *name = lua_tostring (L, idx);
+	if (!name) return 0;
+	if (!strcmp (name, "pos")) { *ofs = 0; *flag = GRPEDIT_VTXCRD; return 3; }
+	if (!strcmp (name, "nml")) { *ofs = 3; *flag = GRPEDIT_VTXNML; return 3; }
+	if (!strcmp (name, "tex")) { *ofs = 6; *flag = GRPEDIT_VTXTEX; return 2; }
+	return 0;
+}
+
+// ============================================================================
+// Lua memory allocator
+// Each interpreter allocates its Lua memory from a private heap. Small blocks
+// (vectors, small tables, closures, short strings) are taken from size-class
+// free lists that are refilled from pages of the heap, so that the allocation
+// churn of running scripts does not go through the general-purpose heap.
+// Freed small blocks are kept for reuse in their class. All memory is
+// released at once when the interpreter is destroyed.
+
+static const size_t ARENA_GRAIN    = 16;      // size class granularity [bytes]
+static const size_t ARENA_NCLASS   = 16;      // number of size classes
+static const size_t ARENA_MAXSMALL = ARENA_GRAIN*ARENA_NCLASS; // largest small block [bytes]
+static const size_t ARENA_PAGE     = 0x10000; // small block page size [bytes]
+
+struct LuaArena {
+	HANDLE hHeap;                  // private heap (not serialised)
+	void *freelist[ARENA_NCLASS];  // free small blocks, by size class
+	char *page;                    // unused part of the current page
+	size_t pagefree;               // size of the unused part [bytes]
+	size_t inuse;                  // bytes in use
+	size_t peak;                   // max. bytes in use
+	double total;                  // bytes allocated since creation
+	DWORD nalloc;                  // number of allocations since creation
+};
+
+static inline size_t arena_class (size_t size)
+{
+	return (size-1)/ARENA_GRAIN;
+}
+
+static LuaArena *arena_create ()
+{
+	// an interpreter is only ever used by one thread at a time
+	HANDLE hHeap = HeapCreate (HEAP_NO_SERIALIZE, ARENA_PAGE, 0);
+	if (!hHeap) return NULL;
+	LuaArena *a = new LuaArena;
+	memset (a, 0, sizeof(LuaArena));
+	a->hHeap = hHeap;
+	return a;
+}
+
+static void arena_destroy (LuaArena *a)
+{
+	HeapDestroy (a->hHeap); // releases all pages and large blocks
+	delete a;
+}
+
+// return the unused part of the current page to the free lists
+static void arena_retire_page (LuaArena *a)
+{
+	if (a->pagefree >= ARENA_GRAIN && a->pagefree <= ARENA_MAXSMALL) {
+		size_t rc = arena_class (a->pagefree);
+		*(void**)a->page = a->freelist[rc];
+		a->freelist[rc] = a->page;
+	}
+	a->pagefree = 0;
+}
+
+// Turn a large block into page space, keeping its head as a small block
+// of the given size. Used if a large block cannot be shrunk into a new
+// small block: the block is then never returned to the heap by itself.
+// The tail becomes the current page if it is larger than the unused part
+// of that page. Otherwise it stays unused until the arena is destroyed.
+static void arena_adopt (LuaArena *a, void *p, size_t psize, size_t size)
+{
+	size_t bsize = (arena_class (size)+1)*ARENA_GRAIN;
+	size_t rest = (psize-bsize)/ARENA_GRAIN*ARENA_GRAIN;
+	if (rest > a->pagefree) {
+		arena_retire_page (a);
+		a->page = (char*)p + bsize;
+		a->pagefree = rest;
+	}
+}
+
+static void *arena_alloc (LuaArena *a, size_t size)
+{
+	if (size > ARENA_MAXSMALL)
+		return HeapAlloc (a->hHeap, 0, size);
+
+	size_t c = arena_class (size);
+	void *p = a->freelist[c];
+	if (p) {
+		a->freelist[c] = *(void**)p;
+		return p;
+	}
+	size_t bsize = (c+1)*ARENA_GRAIN;
+	if (a->pagefree < bsize) {
+		char *page = (char*)HeapAlloc (a->hHeap, 0, ARENA_PAGE);
+		if (!page) return NULL;
+		arena_retire_page (a);
+		a->page = page;
+		a->pagefree = ARENA_PAGE;
+	}
+	p = a->page;
+	a->page += bsize;
+	a->pagefree -= bsize;
+	return p;
+}
+
+static void arena_free (LuaArena *a, void *p, size_t size)
+{
+	if (size > ARENA_MAXSMALL) {
+		HeapFree (a->hHeap, 0, p);
+	} else {
+		size_t c = arena_class (size);
+		*(void**)p = a->freelist[c];
+		a->freelist[c] = p;
+	}
+}
+
+// panic function (replaces the one installed by luaL_newstate)
+static int lua_panic (lua_State *L)
+{
+	const char *msg = lua_tostring (L, -1);
+	oapiWriteLogV ("Lua: unprotected error in call to Lua API (%s)", msg ? msg : "?");
+	return 0;
+}
+
 VECTOR3 lua_tovector (lua_State *L, int idx)
 {
-	VECTOR3 vec;
+	VECTOR3 vec, *pv = lua_tovectorobj (L, idx);
+	if (pv) return *pv;
+
+	// table with x, y, z fields
 	lua_getfield (L, idx, "x");
 	vec.x = lua_tonumber (L, -1); lua_pop (L,1);
 	lua_getfield (L, idx, "y");
@@ -28,7 +214,13 @@ VECTOR3 lua_tovector (lua_State *L, int idx)
 
 Interpreter::Interpreter ()
 {
-	L = luaL_newstate();  // create new Lua context
+	arena = arena_create();
+	if (arena) {          // create new Lua context
+		L = lua_newstate (LuaAlloc, this);
+		lua_atpanic (L, lua_panic);
+	} else {
+		L = luaL_newstate();
+	}
 	is_busy = false;      // waiting for input
 	is_term = false;      // no attached terminal by default
 	jobs = 0;             // background jobs
@@ -36,9 +228,34 @@ Interpreter::Interpreter ()
 	term_verbose = 0;     // verbosity level
 	postfunc = 0;
 	postcontext = 0;
+	task = NULL;          // no pending task
+	taskref = LUA_NOREF;
+	cmdpost = NULL;       // no queued commands
+	cmdfirst = cmdlast = NULL;
+	cmdcur = NULL;
+	bninstr = 0;          // no execution budget
+	btmax = 0;
+	bstep = BUDGET_HOOKSTEP;
+	binstr = 0;
+	bt0 = 0;
+	boverrun = false;
+	memset (&bstats, 0, sizeof(BUDGETSTATS));
+	gctmax = 0;           // no per-cycle GC step
+	gcpause = 200;        // Lua default
+	gckb0 = 0.0;
+	gcactive = false;
+	memset (&mstats, 0, sizeof(MEMSTATS));
+	if (!tickfreq) {
+		LARGE_INTEGER f;
+		QueryPerformanceFrequency (&f);
+		tickfreq = f.QuadPart;
+	}
 	// store interpreter context in the registry
 	lua_pushlightuserdata (L, this);
 	lua_setfield (L, LUA_REGISTRYINDEX, "interp");
+	// background job functions (defined by the startup script)
+	cbNbranch.Bind (L, LUA_GLOBALSINDEX, "_nbranch");
+	cbIdle.Bind (L, LUA_GLOBALSINDEX, "_idle");
 
 	hExecMutex = CreateMutex (NULL, TRUE, NULL);
 	hWaitMutex = CreateMutex (NULL, FALSE, NULL);
@@ -46,7 +263,17 @@ Interpreter::Interpreter ()
 
 Interpreter::~Interpreter ()
 {
+	// discard commands that have not been executed
+	FetchCmds ();
+	if (cmdcur) CompleteCmd (cmdcur, -1);
+	while (cmdfirst) {
+		SCRIPTCMD *hCmd = cmdfirst;
+		cmdfirst = cmdfirst->next;
+		CompleteCmd (hCmd, -1);
+	}
+
 	lua_close (L);
+	if (arena) arena_destroy (arena);
 
 	if (hExecMutex) CloseHandle (hExecMutex);
 	if (hWaitMutex) CloseHandle (hWaitMutex);
@@ -71,7 +298,7 @@ int Interpreter::Status () const
 
 bool Interpreter::IsBusy () const
 {
-	return is_busy;
+	return is_busy || task != NULL;
 }
 
 void Interpreter::Terminate ()
@@ -151,17 +378,15 @@ const char *Interpreter::lua_tostringex (lua_State *L, int idx, char *cbuf)
 
 void Interpreter::lua_pushvector (lua_State *L, const VECTOR3 &vec)
 {
-	lua_createtable (L, 0, 3);
-	lua_pushnumber (L, vec.x);
-	lua_setfield (L, -2, "x");
-	lua_pushnumber (L, vec.y);
-	lua_setfield (L, -2, "y");
-	lua_pushnumber (L, vec.z);
-	lua_setfield (L, -2, "z");
+	VECTOR3 *pv = (VECTOR3*)lua_newuserdata (L, sizeof(VECTOR3));
+	*pv = vec;
+	luaL_getmetatable (L, VECTOR_MT);
+	lua_setmetatable (L, -2);
 }
 
 int Interpreter::lua_isvector (lua_State *L, int idx)
 {
+	if (lua_tovectorobj (L, idx)) return 1;
 	if (!lua_istable (L, idx)) return 0;
 	static char fieldname[3] = {'x','y','z'};
 	static char field[2] = "x";
@@ -189,21 +414,18 @@ int Interpreter::lua_isvector (lua_State *L, int idx)
 
 void Interpreter::lua_pushmatrix (lua_State *L, const MATRIX3 &mat)
 {
-	lua_createtable(L,0,9);
-	lua_pushnumber(L,mat.m11);  lua_setfield(L,-2,"m11");
-	lua_pushnumber(L,mat.m12);  lua_setfield(L,-2,"m12");
-	lua_pushnumber(L,mat.m13);  lua_setfield(L,-2,"m13");
-	lua_pushnumber(L,mat.m21);  lua_setfield(L,-2,"m21");
-	lua_pushnumber(L,mat.m22);  lua_setfield(L,-2,"m22");
-	lua_pushnumber(L,mat.m23);  lua_setfield(L,-2,"m23");
-	lua_pushnumber(L,mat.m31);  lua_setfield(L,-2,"m31");
-	lua_pushnumber(L,mat.m32);  lua_setfield(L,-2,"m32");
-	lua_pushnumber(L,mat.m33);  lua_setfield(L,-2,"m33");
+	MATRIX3 *pm = (MATRIX3*)lua_newuserdata (L, sizeof(MATRIX3));
+	*pm = mat;
+	luaL_getmetatable (L, MATRIX_MT);
+	lua_setmetatable (L, -2);
 }
 
 MATRIX3 Interpreter::lua_tomatrix (lua_State *L, int idx)
 {
-	MATRIX3 mat;
+	MATRIX3 mat, *pm = lua_tomatrixobj (L, idx);
+	if (pm) return *pm;
+
+	// table with m11 ... m33 fields
 	lua_getfield (L, idx, "m11");  mat.m11 = lua_tonumber (L, -1);  lua_pop (L,1);
 	lua_getfield (L, idx, "m12");  mat.m12 = lua_tonumber (L, -1);  lua_pop (L,1);
 	lua_getfield (L, idx, "m13");  mat.m13 = lua_tonumber (L, -1);  lua_pop (L,1);
@@ -218,6 +440,7 @@ MATRIX3 Interpreter::lua_tomatrix (lua_State *L, int idx)
 
 int Interpreter::lua_ismatrix (lua_State *L, int idx)
 {
+	if (lua_tomatrixobj (L, idx)) return 1;
 	if (!lua_istable (L, idx)) return 0;
 	static char *fieldname[9] = {"m11","m12","m13","m21","m22","m23","m31","m32","m33"};
 	int i, ii, n;
@@ -259,6 +482,121 @@ COLOUR4 Interpreter::lua_torgba (lua_State *L, int idx)
 	return col;
 }
 
+// quantities available to batch state queries (v:get_state, oapi.get_state)
+enum STATEKEY {
+	// any object
+	SK_MASS, SK_SIZE, SK_GLOBALPOS, SK_GLOBALVEL,
+	// vessels only
+	SK_ALTITUDE, SK_PITCH, SK_BANK, SK_YAW, SK_ANGVEL, SK_ROTATIONMATRIX,
+	SK_AIRSPEED, SK_AIRSPEEDVECTOR, SK_GROUNDSPEED, SK_GROUNDSPEEDVECTOR,
+	SK_AOA, SK_SLIPANGLE, SK_DYNPRESSURE, SK_MACHNUMBER,
+	SK_ATMDENSITY, SK_ATMPRESSURE, SK_ATMTEMPERATURE,
+	SK_WEIGHTVECTOR, SK_THRUSTVECTOR, SK_LIFTVECTOR,
+	SK_ELEVATOR, SK_AILERON, SK_RUDDER,
+	SK_MAINTHRUST, SK_RETROTHRUST, SK_HOVERTHRUST,
+	NSTATEKEY
+};
+static const char *statekey[NSTATEKEY] = {
+	"mass", "size", "globalpos", "globalvel",
+	"altitude", "pitch", "bank", "yaw", "angvel", "rotationmatrix",
+	"airspeed", "airspeedvector", "groundspeed", "groundspeedvector",
+	"aoa", "slipangle", "dynpressure", "machnumber",
+	"atmdensity", "atmpressure", "atmtemperature",
+	"weightvector", "thrustvector", "liftvector",
+	"elevator", "aileron", "rudder",
+	"mainthrust", "retrothrust", "hoverthrust"
+};
+static const char *STATEKEY_REG = "STATE.keys"; // registry: key name -> STATEKEY
+
+bool Interpreter::lua_getstate (lua_State *L, int qidx, int sidx, OBJHANDLE hObj, VESSEL *v)
+{
+	enum { TP_NIL, TP_NUMBER, TP_VECTOR, TP_MATRIX } tp;
+	double d = 0.0;
+	VECTOR3 vec;
+	MATRIX3 mat;
+	int i, key;
+
+	// reference frame for airspeed and groundspeed vectors
+	lua_getfield (L, qidx, "frame");
+	REFFRAME frame = (REFFRAME)lua_tointeger (L, -1);
+	lua_pop (L, 1);
+
+	lua_getfield (L, LUA_REGISTRYINDEX, STATEKEY_REG);
+	int kidx = lua_gettop (L);
+
+	for (i = 1;; i++) {
+		lua_rawgeti (L, qidx, i);          // key name
+		if (lua_isnil (L, -1)) { lua_pop (L, 2); break; }
+		lua_pushvalue (L, -1);
+		lua_rawget (L, kidx);              // key id
+		key = (lua_isnumber (L, -1) ? lua_tointeger (L, -1) : -1);
+		lua_pop (L, 1);
+		if (key < 0) { lua_pop (L, 2); return false; }
+
+		tp = TP_NUMBER;
+		if (key >= SK_ALTITUDE && !v) {
+			tp = TP_NIL;
+		} else switch (key) {
+		case SK_MASS:              d = oapiGetMass (hObj); break;
+		case SK_SIZE:              d = oapiGetSize (hObj); break;
+		case SK_GLOBALPOS:         oapiGetGlobalPos (hObj, &vec); tp = TP_VECTOR; break;
+		case SK_GLOBALVEL:         oapiGetGlobalVel (hObj, &vec); tp = TP_VECTOR; break;
+		case SK_ALTITUDE:          d = v->GetAltitude(); break;
+		case SK_PITCH:             d = v->GetPitch(); break;
+		case SK_BANK:              d = v->GetBank(); break;
+		case SK_YAW:               d = v->GetYaw(); break;
+		case SK_ANGVEL:            v->GetAngularVel (vec); tp = TP_VECTOR; break;
+		case SK_ROTATIONMATRIX:    v->GetRotationMatrix (mat); tp = TP_MATRIX; break;
+		case SK_AIRSPEED:          d = v->GetAirspeed(); break;
+		case SK_AIRSPEEDVECTOR:    v->GetAirspeedVector (frame, vec); tp = TP_VECTOR; break;
+		case SK_GROUNDSPEED:       d = v->GetGroundspeed(); break;
+		case SK_GROUNDSPEEDVECTOR: v->GetGroundspeedVector (frame, vec); tp = TP_VECTOR; break;
+		case SK_AOA:               d = v->GetAOA(); break;
+		case SK_SLIPANGLE:         d = v->GetSlipAngle(); break;
+		case SK_DYNPRESSURE:       d = v->GetDynPressure(); break;
+		case SK_MACHNUMBER:        d = v->GetMachNumber(); break;
+		case SK_ATMDENSITY:        d = v->GetAtmDensity(); break;
+		case SK_ATMPRESSURE:       d = v->GetAtmPressure(); break;
+		case SK_ATMTEMPERATURE:    d = v->GetAtmTemperature(); break;
+		case SK_WEIGHTVECTOR:      tp = (v->GetWeightVector (vec) ? TP_VECTOR : TP_NIL); break;
+		case SK_THRUSTVECTOR:      tp = (v->GetThrustVector (vec) ? TP_VECTOR : TP_NIL); break;
+		case SK_LIFTVECTOR:        tp = (v->GetLiftVector (vec) ? TP_VECTOR : TP_NIL); break;
+		case SK_ELEVATOR:          d = v->GetControlSurfaceLevel (AIRCTRL_ELEVATOR); break;
+		case SK_AILERON:           d = v->GetControlSurfaceLevel (AIRCTRL_AILERON); break;
+		case SK_RUDDER:            d = v->GetControlSurfaceLevel (AIRCTRL_RUDDER); break;
+		case SK_MAINTHRUST:        d = v->GetThrusterGroupLevel (THGROUP_MAIN); break;
+		case SK_RETROTHRUST:       d = v->GetThrusterGroupLevel (THGROUP_RETRO); break;
+		case SK_HOVERTHRUST:       d = v->GetThrusterGroupLevel (THGROUP_HOVER); break;
+		}
+
+		// key name is on top of the stack: push the value and store
+		switch (tp) {
+		case TP_NIL:
+			lua_pushnil (L);
+			break;
+		case TP_NUMBER:
+			lua_pushnumber (L, d);
+			break;
+		case TP_VECTOR: {
+			lua_pushvalue (L, -1);
+			lua_rawget (L, sidx);
+			VECTOR3 *pv = lua_tovectorobj (L, -1);
+			if (pv) *pv = vec;
+			else { lua_pop (L, 1); lua_pushvector (L, vec); }
+			} break;
+		case TP_MATRIX: {
+			lua_pushvalue (L, -1);
+			lua_rawget (L, sidx);
+			MATRIX3 *pm = lua_tomatrixobj (L, -1);
+			if (pm) *pm = mat;
+			else { lua_pop (L, 1); lua_pushmatrix (L, mat); }
+			} break;
+		}
+		lua_rawset (L, sidx);
+	}
+	return true;
+}
+
 void Interpreter::lua_pushvessel (lua_State *L, VESSEL *v)
 {
 	lua_pushlightuserdata(L,v);         // use object pointer as key
@@ -403,6 +741,7 @@ int Interpreter::ProcessChunk (const char *chunk, int n)
 int Interpreter::RunChunk (const char *chunk, int n)
 {
 	int res = 0;
+	BeginCycle();
 	if (chunk[0]) {
 		is_busy = true;
 		// run command
@@ -411,14 +750,75 @@ int Interpreter::RunChunk (const char *chunk, int n)
 		if (res && is_term)
 			term_strout ("Execution error.");
 		// check for leftover background jobs
-		lua_getfield (L, LUA_GLOBALSINDEX, "_nbranch");
+		cbNbranch.Push();
 		lua_call (L, 0, 1);
 		jobs = lua_tointeger (L, -1);
 		lua_pop (L, 1);
 		is_busy = false;
 	} else {
 		// idle loop: execute background jobs
-		lua_getfield (L, LUA_GLOBALSINDEX, "_idle");
+		cbIdle.Push();
+		lua_call (L, 0, 1);
+		jobs = lua_tointeger (L, -1);
+		lua_pop (L, 1);
+		res = -1;
+	}
+	EndCycle();
+	return res;
+}
+
+int Interpreter::StartChunk (const char *chunk, int n)
+{
+	EndTask();
+	if (cmdcur) { // a queued command was running as the task
+		CompleteCmd (cmdcur, -1);
+		cmdcur = NULL;
+	}
+
+	// create the task coroutine and anchor it in the registry
+	task = lua_newthread (L);
+	taskref = luaL_ref (L, LUA_REGISTRYINDEX);
+
+	int res = luaL_loadbuffer (task, chunk, n, "line");
+	if (res) {
+		if (is_term)
+			term_strout ("Execution error.");
+		EndTask();
+		return res;
+	}
+
+	// identify the task as the script trunk (see proc.skip)
+	lua_pushthread (task);
+	lua_setfield (task, LUA_GLOBALSINDEX, "_trunk");
+	return 0;
+}
+
+int Interpreter::Resume ()
+{
+	BeginCycle();
+	int res = ResumeTask();
+	EndCycle();
+	return res;
+}
+
+int Interpreter::ResumeTask ()
+{
+	int res;
+	if (task) {
+		// continue the task until it returns or suspends itself
+		res = lua_resume (task, 0);
+		if (res == LUA_YIELD) return res;
+		if (res && is_term)
+			term_strout ("Execution error.");
+		EndTask();
+		// check for leftover background jobs
+		cbNbranch.Push();
+		lua_call (L, 0, 1);
+		jobs = lua_tointeger (L, -1);
+		lua_pop (L, 1);
+	} else {
+		// idle loop: execute background jobs
+		cbIdle.Push();
 		lua_call (L, 0, 1);
 		jobs = lua_tointeger (L, -1);
 		lua_pop (L, 1);
@@ -427,6 +827,295 @@ int Interpreter::RunChunk (const char *chunk, int n)
 	return res;
 }
 
+SCRIPTCMD *Interpreter::PostCmd (const char *cmd, SCRIPTCMDCLBK clbk, void *context, bool handle)
+{
+	size_t len = strlen (cmd);
+	SCRIPTCMD *hCmd = (SCRIPTCMD*)HeapAlloc (GetProcessHeap(), 0, sizeof(SCRIPTCMD)+len);
+	if (!hCmd) return NULL;
+	memcpy (hCmd->cmd, cmd, len+1);
+	hCmd->clbk = clbk;
+	hCmd->context = context;
+	hCmd->refs = (handle ? 2 : 1);
+	hCmd->done = 0;
+	hCmd->status = 0;
+
+	// Push onto the posting stack. The consumer only ever removes the
+	// complete stack (see FetchCmds), so the push is safe against any
+	// number of concurrent producers without ABA issues.
+	SCRIPTCMD *head;
+	do {
+		head = cmdpost;
+		hCmd->next = head;
+	} while (InterlockedCompareExchangePointer ((PVOID volatile*)&cmdpost, hCmd, head) != head);
+
+	return (handle ? hCmd : NULL);
+}
+
+void Interpreter::FetchCmds ()
+{
+	SCRIPTCMD *hCmd = (SCRIPTCMD*)InterlockedExchangePointer ((PVOID volatile*)&cmdpost, NULL);
+	if (!hCmd) return;
+
+	// the posting stack is in reverse order
+	SCRIPTCMD *first = NULL, *last = hCmd, *next;
+	for (; hCmd; hCmd = next) {
+		next = hCmd->next;
+		hCmd->next = first;
+		first = hCmd;
+	}
+	if (cmdlast) cmdlast->next = first;
+	else cmdfirst = first;
+	cmdlast = last;
+}
+
+void Interpreter::CompleteCmd (SCRIPTCMD *hCmd, int status)
+{
+	hCmd->status = status;
+	InterlockedExchange (&hCmd->done, 1);
+	if (hCmd->clbk)
+		hCmd->clbk (hCmd, status, hCmd->context);
+	ScriptCmdRelease (hCmd);
+}
+
+int Interpreter::RunQueue ()
+{
+	FetchCmds ();
+
+	int res = -1;
+	bool run = false;
+	for (;;) {
+		if (!task && cmdfirst) { // start the next queued command
+			SCRIPTCMD *hCmd = cmdfirst;
+			if (!(cmdfirst = cmdfirst->next)) cmdlast = NULL;
+			int err = StartChunk (hCmd->cmd, strlen (hCmd->cmd));
+			if (err) {
+				CompleteCmd (hCmd, err);
+				res = err;
+				continue;
+			}
+			cmdcur = hCmd;
+		} else if (run || (!task && !jobs)) {
+			break;
+		}
+		// the commands of one call share a single cycle and its budget
+		if (!run) BeginCycle();
+		res = ResumeTask ();
+		run = true;
+		if (res == LUA_YIELD) break;  // task continues in the next cycle
+		if (cmdcur) {
+			CompleteCmd (cmdcur, res == -1 ? 0 : res);
+			cmdcur = NULL;
+		}
+		if (boverrun) break;          // remaining commands wait for the next cycle
+	}
+	if (run) EndCycle();
+	return res;
+}
+
+void Interpreter::SetBudget (DWORD ninstr, double tmax)
+{
+	bninstr = ninstr;
+	btmax = (LONGLONG)(tmax*1e-3*tickfreq);
+	// threads inherit the hook of the thread that creates them, so
+	// install it on the main state and the pending task
+	bstep = (ninstr && ninstr < BUDGET_HOOKSTEP ? ninstr : BUDGET_HOOKSTEP);
+	if (bninstr || btmax) {
+		lua_sethook (L, BudgetHook, LUA_MASKCOUNT, bstep);
+		if (task) lua_sethook (task, BudgetHook, LUA_MASKCOUNT, bstep);
+	} else {
+		lua_sethook (L, NULL, 0, 0);
+		if (task) lua_sethook (task, NULL, 0, 0);
+	}
+}
+
+void Interpreter::BeginCycle ()
+{
+	LARGE_INTEGER t;
+	QueryPerformanceCounter (&t);
+	bt0 = t.QuadPart;
+	binstr = 0;
+	boverrun = false;
+}
+
+void Interpreter::EndCycle ()
+{
+	StepGC ();
+
+	LARGE_INTEGER t;
+	QueryPerformanceCounter (&t);
+	bstats.ncycle++;
+	bstats.tlast = (double)(t.QuadPart-bt0)*1e3/tickfreq;
+	if (bstats.tlast > bstats.tmax) bstats.tmax = bstats.tlast;
+	if (boverrun) bstats.noverrun++;
+
+	if (arena) {
+		double kbtotal = arena->total/1024.0;
+		mstats.kbcycle = kbtotal-mstats.kbtotal;
+		mstats.kbtotal = kbtotal;
+		mstats.kbinuse = arena->inuse/1024.0;
+		mstats.kbpeak = arena->peak/1024.0;
+		mstats.nalloc = arena->nalloc;
+	} else {
+		mstats.kbinuse = lua_gc (L, LUA_GCCOUNT, 0) + lua_gc (L, LUA_GCCOUNTB, 0)/1024.0;
+		if (mstats.kbinuse > mstats.kbpeak) mstats.kbpeak = mstats.kbinuse;
+	}
+}
+
+void Interpreter::SetGC (int pause, int stepmul, double tstep)
+{
+	if (pause > 0) {
+		gcpause = pause;
+		lua_gc (L, LUA_GCSETPAUSE, pause);
+	}
+	if (stepmul > 0)
+		lua_gc (L, LUA_GCSETSTEPMUL, stepmul);
+	gctmax = (LONGLONG)(tstep*1e-3*tickfreq);
+}
+
+void Interpreter::StepGC ()
+{
+	mstats.tgclast = 0.0;
+	if (!gctmax) return;
+
+	// the step is limited by the time left in the cycle budget
+	LARGE_INTEGER t;
+	QueryPerformanceCounter (&t);
+	LONGLONG t0 = t.QuadPart, tmax = gctmax;
+	if (btmax && btmax-(t0-bt0) < tmax) tmax = btmax-(t0-bt0);
+	if (tmax <= 0) return;
+
+	if (!gcactive) {
+		// start a collection once memory use has grown by half the
+		// pause margin, ahead of the automatic collector
+		double kb = lua_gc (L, LUA_GCCOUNT, 0);
+		if (kb < gckb0*(1.0 + (gcpause-100)*0.005)) return;
+		gcactive = true;
+	}
+
+	// each LUA_GCSTEP with size 0 performs one basic collector step
+	do {
+		if (lua_gc (L, LUA_GCSTEP, 0)) { // collection cycle completed
+			gcactive = false;
+			gckb0 = lua_gc (L, LUA_GCCOUNT, 0);
+			mstats.ngc++;
+			break;
+		}
+		QueryPerformanceCounter (&t);
+	} while (t.QuadPart-t0 < tmax);
+
+	QueryPerformanceCounter (&t);
+	mstats.tgclast = (double)(t.QuadPart-t0)*1e3/tickfreq;
+	mstats.tgc += mstats.tgclast;
+	if (mstats.tgclast > mstats.tgcmax) mstats.tgcmax = mstats.tgclast;
+}
+
+void *Interpreter::LuaAlloc (void *ud, void *ptr, size_t osize, size_t nsize)
+{
+	LuaArena *a = ((Interpreter*)ud)->arena;
+	void *p;
+
+	if (!nsize) {                        // free
+		if (ptr) {
+			arena_free (a, ptr, osize);
+			a->inuse -= osize;
+		}
+		return NULL;
+	}
+	if (!ptr) {                          // allocate
+		if (!(p = arena_alloc (a, nsize))) return NULL;
+		a->nalloc++;
+	} else {                             // resize
+		bool osmall = (osize <= ARENA_MAXSMALL), nsmall = (nsize <= ARENA_MAXSMALL);
+		if (osmall && nsmall && arena_class (osize) == arena_class (nsize)) {
+			p = ptr;                     // block already fits
+		} else if (!osmall && !nsmall) {
+			p = HeapReAlloc (a->hHeap, 0, ptr, nsize);
+		} else if (p = arena_alloc (a, nsize)) {
+			memcpy (p, ptr, osize < nsize ? osize : nsize);
+			arena_free (a, ptr, osize);
+		}
+		if (!p) {
+			// Lua assumes that shrinking a block cannot fail: keep the
+			// old block. A small block is later freed into the smaller
+			// class. A large block shrunk to a small size becomes page
+			// space, so that it never enters a small-class free list as
+			// a heap block.
+			if (nsize > osize) return NULL;
+			if (!osmall && nsmall) arena_adopt (a, ptr, osize, nsize);
+			p = ptr;
+		}
+		a->inuse -= osize;
+	}
+	a->inuse += nsize;
+	if (a->inuse > a->peak) a->peak = a->inuse;
+	if (nsize > osize) a->total += nsize-osize;
+	return p;
+}
+
+bool Interpreter::OverBudget () const
+{
+	if (bninstr && binstr >= bninstr) return true;
+	if (btmax) {
+		LARGE_INTEGER t;
+		QueryPerformanceCounter (&t);
+		if (t.QuadPart-bt0 >= btmax) return true;
+	}
+	return false;
+}
+
+// Lua 5.1 cannot yield across a C function or a metamethod call, and the
+// call chain is not exposed through the API. Only accept stacks made of
+// plain Lua calls: every frame above the bottom one must be a Lua function
+// called by name from another Lua function.
+static bool lua_canyield (lua_State *L)
+{
+	lua_Debug ar, next;
+	for (int level = 0; lua_getstack (L, level, &ar); level++) {
+		lua_getinfo (L, "Sn", &ar);
+		if (ar.what[0] != 'L' && ar.what[0] != 'm') return false; // C function or tail call
+		if (!lua_getstack (L, level+1, &next)) break;              // bottom of the stack
+		if (!ar.namewhat[0]) return false;                         // called from a metamethod or C
+		if (ar.name && ar.name[0] == '(') return false;            // generic 'for' iterator
+	}
+	return true;
+}
+
+void Interpreter::BudgetHook (lua_State *L, lua_Debug *ar)
+{
+	Interpreter *interp = GetInterpreter (L);
+	if (!interp->bninstr && !interp->btmax) return; // budget disabled
+	interp->binstr += interp->bstep;
+	if (!interp->OverBudget()) return;
+	interp->boverrun = true;
+
+	// only the task and the background jobs can be suspended: the
+	// scheduler resumes them in the next cycle. Otherwise the check is
+	// repeated at the next hook event.
+	bool preempt = (L == interp->task);
+	if (!preempt) {
+		lua_getfield (L, LUA_REGISTRYINDEX, PREEMPT_REG);
+		lua_pushthread (L);
+		lua_rawget (L, -2);
+		preempt = (lua_toboolean (L, -1) != 0);
+		lua_pop (L, 2);
+	}
+	if (preempt && lua_canyield (L)) {
+		interp->bstats.npreempt++;
+		lua_yield (L, 0);
+	}
+}
+
+void Interpreter::EndTask ()
+{
+	if (task) {
+		lua_pushnil (L);
+		lua_setfield (L, LUA_GLOBALSINDEX, "_trunk");
+		luaL_unref (L, LUA_REGISTRYINDEX, taskref);
+		task = NULL;
+		taskref = LUA_NOREF;
+	}
+}
+
 void Interpreter::term_out (lua_State *L, bool iserr)
 {
 	const char *str = lua_tostringex (L,-1);
@@ -439,6 +1128,7 @@ void Interpreter::LoadAPI ()
 	static const struct luaL_reg glob[] = {
 		{"help", help},
 		//{"api", help_api},
+		{"loadfile", loadfile},  // replaces the base library version
 		{NULL, NULL}
 	};
 	for (int i = 0; glob[i].name; i++) {
@@ -471,13 +1161,76 @@ void Interpreter::LoadAPI ()
 	};
 	luaL_openlib (L, "mat", matLib, 0);
 
+	// Vector and matrix objects. The library functions are also
+	// available as methods, e.g. v:length()
+	static const struct luaL_reg vecMeta[] = {
+		{"__newindex", vec_newindex},
+		{"__add", vec_add},
+		{"__sub", vec_sub},
+		{"__mul", vec_mul},
+		{"__div", vec_div},
+		{"__unm", vec_unm},
+		{"__eq", vec_eq},
+		{"__tostring", vec_tostring},
+		{NULL, NULL}
+	};
+	luaL_newmetatable (L, VECTOR_MT);
+	lua_getglobal (L, "vec");
+	lua_pushcclosure (L, vec_index, 1);
+	lua_setfield (L, -2, "__index");
+	luaL_openlib (L, NULL, vecMeta, 0);
+	lua_pop (L, 1);
+
+	static const struct luaL_reg matMeta[] = {
+		{"__newindex", mat_newindex},
+		{"__mul", mat_mulop},
+		{"__eq", mat_eq},
+		{"__tostring", vec_tostring},
+		{NULL, NULL}
+	};
+	luaL_newmetatable (L, MATRIX_MT);
+	lua_getglobal (L, "mat");
+	lua_pushcclosure (L, mat_index, 1);
+	lua_setfield (L, -2, "__index");
+	luaL_openlib (L, NULL, matMeta, 0);
+	lua_pop (L, 1);
+
+	// Mesh vertex buffer objects
+	static const struct luaL_reg vtxMeta[] = {
+		{"__len", vtx_size},
+		{"size", vtx_size},
+		{"read", vtx_read},
+		{"write", vtx_write},
+		{"commit", vtx_commit},
+		{NULL, NULL}
+	};
+	luaL_newmetatable (L, MESHVTX_MT);
+	lua_pushvalue (L, -1);
+	lua_setfield (L, -2, "__index");
+	luaL_openlib (L, NULL, vtxMeta, 0);
+	lua_pop (L, 1);
+
 	// Load the process library
 	static const struct luaL_reg procLib[] = {
 		{"Frameskip", procFrameskip},
+		{"Preemptible", procPreemptible},
+		{"Overrun", procOverrun},
+		{"set_budget", procSetBudget},
+		{"get_budgetstats", procGetBudgetStats},
+		{"set_gc", procSetGC},
+		{"get_memstats", procGetMemStats},
 		{NULL, NULL}
 	};
 	luaL_openlib (L, "proc", procLib, 0);
 
+	// threads that may be suspended by the execution budget (weak keys)
+	lua_newtable (L);
+	lua_createtable (L, 0, 1);
+	lua_pushstring (L, "k");
+	lua_setfield (L, -2, "__mode");
+	lua_setmetatable (L, -2);
+	lua_setfield (L, LUA_REGISTRYINDEX, PREEMPT_REG);
+
 	// Load the oapi library
 	static const struct luaL_reg oapiLib[] = {
 		{"get_objhandle", oapiGetObjectHandle},
@@ -517,6 +1270,7 @@ void Interpreter::LoadAPI ()
 		{"get_globalvel", oapi_get_globalvel},
 		{"get_relativepos", oapi_get_relativepos},
 		{"get_relativevel", oapi_get_relativevel},
+		{"get_state", oapi_get_state},
 
 		// vessel functions
 		{"get_propellanthandle", oapi_get_propellanthandle},
@@ -560,6 +1314,9 @@ void Interpreter::LoadAPI ()
 		{"create_animationcomponent", oapi_create_animationcomponent},
 		{"del_animationcomponent", oapi_del_animationcomponent},
 
+		// mesh functions
+		{"map_meshgroup", oapi_map_meshgroup},
+
 		// instrument panel functions
 		{"open_mfd", oapi_open_mfd},
 		{"set_hudmode", oapi_set_hudmode},
@@ -573,6 +1330,14 @@ void Interpreter::LoadAPI ()
 	};
 	luaL_openlib (L, "oapi", oapiLib, 0);
 
+	// key lookup table for batch state queries
+	lua_createtable (L, 0, NSTATEKEY);
+	for (int i = 0; i < NSTATEKEY; i++) {
+		lua_pushinteger (L, i);
+		lua_setfield (L, -2, statekey[i]);
+	}
+	lua_setfield (L, LUA_REGISTRYINDEX, STATEKEY_REG);
+
 	// Load the (dummy) term library
 	static const struct luaL_reg termLib[] = {
 		{"out", termOut},
@@ -769,6 +1534,7 @@ void Interpreter::LoadVesselAPI ()
 		{"get_relativepos", v_get_relativepos},
 		{"get_relativevel", v_get_relativevel},
 		{"get_rotationmatrix", v_get_rotationmatrix},
+		{"get_state", v_get_state},
 
 		// atmospheric parameters
 		{"get_atmref", v_get_atmref},
@@ -934,6 +1700,7 @@ void Interpreter::LoadVesselAPI ()
 		{"shift_mesh", v_shift_mesh},
 		{"shift_meshes", v_shift_meshes},
 		{"get_meshoffset", v_get_meshoffset},
+		{"get_devmesh", v_get_devmesh},
 
 		// animation methods
 		{"create_animation", v_create_animation},
@@ -1180,7 +1947,136 @@ void Interpreter::LoadAnnotationAPI ()
 
 void Interpreter::LoadStartupScript ()
 {
-	luaL_dofile (L, "Script\\oapi_init.lua");
+	if (!lua_loadfilecached (L, "Script\\oapi_init.lua"))
+		lua_pcall (L, 0, LUA_MULTRET, 0);
+}
+
+// ============================================================================
+// Bytecode cache
+
+static const char *LUACACHE_DIR = "Cache\\Lua";
+static const char LUACACHE_MAGIC[8] = {'O','R','B','L','U','A','C','2'};
+
+struct LUACACHE_HEADER {
+	char magic[8];      // LUACACHE_MAGIC
+	DWORD luaversion;   // LUA_VERSION_NUM of the compiler
+	FILETIME mtime;     // modification time of the source file
+	DWORD size;         // size of the source file
+	DWORD nbytecode;    // size of the bytecode following the header
+	char source[MAX_PATH]; // normalised source path (see LuaCacheSource)
+};
+
+struct LUACACHE_WRITER {
+	FILE *f;
+	DWORD n;
+};
+
+static int LuaCacheWriter (lua_State *L, const void *p, size_t sz, void *ud)
+{
+	LUACACHE_WRITER *w = (LUACACHE_WRITER*)ud;
+	if (fwrite (p, 1, sz, w->f) != sz) return 1;
+	w->n += (DWORD)sz;
+	return 0;
+}
+
+// normalised source path of a script: full path in lower case, which
+// identifies the cache entry
+static bool LuaCacheSource (const char *fname, char *source)
+{
+	DWORD n = GetFullPathName (fname, MAX_PATH, source, NULL);
+	if (!n || n >= MAX_PATH) return false;
+	_strlwr (source);
+	return true;
+}
+
+// cache file name for a script: the file name, followed by a hash of the
+// normalised source path, so that all entries live in a single directory
+// and scripts of the same name don't evict each other. The entry is
+// still only used if the source path stored in its header matches.
+static void LuaCachePath (const char *fname, const char *source, char *path)
+{
+	DWORD hash = 2166136261u; // FNV-1a
+	for (const char *c = source; *c; c++)
+		hash = (hash ^ (BYTE)*c) * 16777619u;
+	const char *name = fname + strlen(fname);
+	while (name > fname && name[-1] != '\\' && name[-1] != '/' && name[-1] != ':') name--;
+	_snprintf (path, MAX_PATH, "%s\\%.*s_%08x.luac", LUACACHE_DIR, MAX_PATH/2, name, hash);
+	path[MAX_PATH-1] = '\0';
+	_strlwr (path + strlen(LUACACHE_DIR)+1);
+}
+
+int Interpreter::lua_loadfilecached (lua_State *L, const char *fname)
+{
+	WIN32_FILE_ATTRIBUTE_DATA fad;
+	LUACACHE_HEADER hdr;
+	char source[MAX_PATH], path[MAX_PATH], tmp[MAX_PATH], chunkname[MAX_PATH+1];
+	FILE *f;
+
+	if (!fname || strlen(fname) >= MAX_PATH ||
+		!GetFileAttributesEx (fname, GetFileExInfoStandard, &fad) ||
+		!LuaCacheSource (fname, source))
+		return luaL_loadfile (L, fname); // no cache: report errors as usual
+	LuaCachePath (fname, source, path);
+	sprintf (chunkname, "@%s", fname);
+
+	// try the cache entry
+	if (f = fopen (path, "rb")) {
+		bool valid = (fread (&hdr, sizeof(hdr), 1, f) == 1 &&
+			!memcmp (hdr.magic, LUACACHE_MAGIC, 8) && hdr.luaversion == LUA_VERSION_NUM &&
+			!CompareFileTime (&hdr.mtime, &fad.ftLastWriteTime) && hdr.size == fad.nFileSizeLow &&
+			hdr.nbytecode && !strncmp (hdr.source, source, MAX_PATH));
+		char *buf = (valid ? new char[hdr.nbytecode] : 0);
+		if (valid) valid = (fread (buf, 1, hdr.nbytecode, f) == hdr.nbytecode);
+		fclose (f);
+		if (valid) {
+			int res = luaL_loadbuffer (L, buf, hdr.nbytecode, chunkname);
+			delete []buf;
+			if (!res) return 0;
+			lua_pop (L, 1); // invalid bytecode: recompile
+		} else if (buf)
+			delete []buf;
+	}
+
+	// compile the source and renew the cache entry. The entry is written
+	// to a temporary file which then replaces it, so that an interrupted
+	// or concurrent write never leaves a truncated entry behind.
+	int res = luaL_loadfile (L, fname);
+	if (res) return res;
+	CreateDirectory ("Cache", NULL);
+	CreateDirectory (LUACACHE_DIR, NULL);
+	if (!GetTempFileName (LUACACHE_DIR, "luc", 0, tmp)) return 0;
+	bool ok = false;
+	if (f = fopen (tmp, "wb")) {
+		memset (&hdr, 0, sizeof(hdr));
+		memcpy (hdr.magic, LUACACHE_MAGIC, 8);
+		hdr.luaversion = LUA_VERSION_NUM;
+		hdr.mtime = fad.ftLastWriteTime;
+		hdr.size = fad.nFileSizeLow;
+		strcpy (hdr.source, source);
+		LUACACHE_WRITER w = {f, 0};
+		ok = (fwrite (&hdr, sizeof(hdr), 1, f) == 1 && // placeholder until the size is known
+			!lua_dump (L, LuaCacheWriter, &w) && w.n);
+		if (ok) {
+			hdr.nbytecode = w.n;
+			ok = (!fseek (f, 0, SEEK_SET) && fwrite (&hdr, sizeof(hdr), 1, f) == 1);
+		}
+		if (fclose (f)) ok = false;
+	}
+	if (!ok || !MoveFileEx (tmp, path, MOVEFILE_REPLACE_EXISTING))
+		DeleteFile (tmp);
+	return 0;
+}
+
+int Interpreter::loadfile (lua_State *L)
+{
+	// loadfile ([filename]): as the base library version, but cached
+	const char *fname = luaL_optstring (L, 1, NULL);
+	if (lua_loadfilecached (L, fname)) {
+		lua_pushnil (L);
+		lua_insert (L, -2); // nil, error message
+		return 2;
+	}
+	return 1;
 }
 
 bool Interpreter::InitialiseVessel (lua_State *L, VESSEL *v)
@@ -1552,6 +2448,214 @@ int Interpreter::mat_mmul (lua_State *L)
 	return 1;
 }
 
+// ============================================================================
+// vector and matrix object metamethods
+
+// returns the component index for key 'idx' (1-based integer or name), or -1
+static int lua_tocomponent (lua_State *L, int idx, int ncmp)
+{
+	int i = -1;
+	if (lua_type (L, idx) == LUA_TNUMBER) {
+		i = lua_tointeger (L, idx)-1;
+	} else if (lua_type (L, idx) == LUA_TSTRING) {
+		size_t len;
+		const char *key = lua_tolstring (L, idx, &len);
+		if (ncmp == 3) { // vector: x, y, z
+			if (len == 1) i = key[0]-'x';
+		} else {         // matrix: m11 ... m33
+			if (len == 3 && key[0] == 'm' && key[1] >= '1' && key[1] <= '3' && key[2] >= '1' && key[2] <= '3')
+				i = (key[1]-'1')*3 + (key[2]-'1');
+		}
+	}
+	return (i >= 0 && i < ncmp ? i : -1);
+}
+
+int Interpreter::vec_index (lua_State *L)
+{
+	VECTOR3 *v = (VECTOR3*)lua_touserdata (L, 1);
+	int i = lua_tocomponent (L, 2, 3);
+	if (i >= 0) lua_pushnumber (L, v->data[i]);
+	else        lua_gettable (L, lua_upvalueindex(1)); // vector library method
+	return 1;
+}
+
+int Interpreter::vec_newindex (lua_State *L)
+{
+	VECTOR3 *v = (VECTOR3*)lua_touserdata (L, 1);
+	int i = lua_tocomponent (L, 2, 3);
+	ASSERT_SYNTAX (i >= 0, "Invalid vector component (expected x, y or z)");
+	ASSERT_SYNTAX (lua_isnumber (L,3), "Argument 3: expected number");
+	v->data[i] = lua_tonumber (L,3);
+	return 0;
+}
+
+int Interpreter::vec_unm (lua_State *L)
+{
+	lua_pushvector (L, -lua_tovector (L,1));
+	return 1;
+}
+
+int Interpreter::vec_eq (lua_State *L)
+{
+	// only called for two objects sharing the same __eq method
+	VECTOR3 *va = lua_tovectorobj (L,1), *vb = lua_tovectorobj (L,2);
+	lua_pushboolean (L, va && vb && va->x == vb->x && va->y == vb->y && va->z == vb->z);
+	return 1;
+}
+
+int Interpreter::vec_tostring (lua_State *L)
+{
+	char cbuf[256];
+	lua_pushstring (L, lua_tostringex (L, 1, cbuf));
+	return 1;
+}
+
+int Interpreter::mat_index (lua_State *L)
+{
+	MATRIX3 *m = (MATRIX3*)lua_touserdata (L, 1);
+	int i = lua_tocomponent (L, 2, 9);
+	if (i >= 0) lua_pushnumber (L, m->data[i]);
+	else        lua_gettable (L, lua_upvalueindex(1)); // matrix library method
+	return 1;
+}
+
+int Interpreter::mat_newindex (lua_State *L)
+{
+	MATRIX3 *m = (MATRIX3*)lua_touserdata (L, 1);
+	int i = lua_tocomponent (L, 2, 9);
+	ASSERT_SYNTAX (i >= 0, "Invalid matrix component (expected m11 ... m33)");
+	ASSERT_SYNTAX (lua_isnumber (L,3), "Argument 3: expected number");
+	m->data[i] = lua_tonumber (L,3);
+	return 0;
+}
+
+int Interpreter::mat_mulop (lua_State *L)
+{
+	if (lua_ismatrix (L,1)) {
+		MATRIX3 m = lua_tomatrix (L,1);
+		if (lua_ismatrix (L,2)) {
+			lua_pushmatrix (L, mul (m, lua_tomatrix (L,2)));
+		} else if (lua_isvector (L,2)) {
+			lua_pushvector (L, mul (m, lua_tovector (L,2)));
+		} else {
+			ASSERT_SYNTAX (lua_isnumber(L,2), "Argument 2: expected matrix, vector or number");
+			lua_pushmatrix (L, m * lua_tonumber (L,2));
+		}
+	} else {
+		ASSERT_SYNTAX (lua_isnumber(L,1), "Argument 1: expected matrix or number");
+		lua_pushmatrix (L, lua_tomatrix (L,2) * lua_tonumber (L,1));
+	}
+	return 1;
+}
+
+int Interpreter::mat_eq (lua_State *L)
+{
+	MATRIX3 *ma = lua_tomatrixobj (L,1), *mb = lua_tomatrixobj (L,2);
+	bool eq = (ma && mb);
+	for (int i = 0; eq && i < 9; i++)
+		eq = (ma->data[i] == mb->data[i]);
+	lua_pushboolean (L, eq);
+	return 1;
+}
+
+// ============================================================================
+// mesh vertex buffer methods
+// Vertex indices are zero-based, like mesh and group indices.
+// Bulk data are passed as flat arrays of vertex components, e.g.
+// {x0,y0,z0, x1,y1,z1, ...} for 'pos'.
+
+int Interpreter::vtx_size (lua_State *L)
+{
+	MESHVTX *vb = lua_tomeshvtx (L,1);
+	ASSERT_SYNTAX(vb, "Invalid vertex buffer object");
+	lua_pushinteger (L, vb->nvtx);
+	return 1;
+}
+
+int Interpreter::vtx_read (lua_State *L)
+{
+	// vb:read (field [, first [, count [, stride [, data]]]])
+	MESHVTX *vb = lua_tomeshvtx (L,1);
+	ASSERT_SYNTAX(vb, "Invalid vertex buffer object");
+	int ofs;
+	DWORD flag;
+	int ncmp = lua_tovtxfield (L, 2, &ofs, &flag);
+	ASSERT_SYNTAX(ncmp, "Argument 1: expected 'pos', 'nml' or 'tex'");
+	int first  = (lua_isnumber (L,3) ? lua_tointeger (L,3) : 0);
+	int stride = (lua_isnumber (L,5) ? max (1, lua_tointeger (L,5)) : 1);
+	ASSERT_SYNTAX(first >= 0, "Argument 2: index out of range");
+	int count = ((int)vb->nvtx > first ? ((int)vb->nvtx-first+stride-1)/stride : 0);
+	if (lua_isnumber (L,4)) count = max (0, min (count, lua_tointeger (L,4)));
+
+	// fill a caller-supplied table if available
+	if (lua_istable (L,6)) lua_settop (L,6);
+	else {
+		lua_settop (L,5);
+		lua_createtable (L, count*ncmp, 0);
+	}
+	int i, j, k = 1;
+	const NTVERTEX *vtx = vb->vtx + first;
+	for (i = 0; i < count; i++, vtx += stride) {
+		const float *p = &vtx->x + ofs;
+		for (j = 0; j < ncmp; j++) {
+			lua_pushnumber (L, p[j]);
+			lua_rawseti (L, -2, k++);
+		}
+	}
+	return 1;
+}
+
+int Interpreter::vtx_write (lua_State *L)
+{
+	// vb:write (field, data [, first [, stride]])
+	MESHVTX *vb = lua_tomeshvtx (L,1);
+	ASSERT_SYNTAX(vb, "Invalid vertex buffer object");
+	int ofs;
+	DWORD flag;
+	int ncmp = lua_tovtxfield (L, 2, &ofs, &flag);
+	ASSERT_SYNTAX(ncmp, "Argument 1: expected 'pos', 'nml' or 'tex'");
+	ASSERT_SYNTAX(lua_istable (L,3), "Argument 2: invalid type (expected table)");
+	int first  = (lua_isnumber (L,4) ? lua_tointeger (L,4) : 0);
+	int stride = (lua_isnumber (L,5) ? max (1, lua_tointeger (L,5)) : 1);
+	ASSERT_SYNTAX(first >= 0, "Argument 3: index out of range");
+	int count = ((int)vb->nvtx > first ? ((int)vb->nvtx-first+stride-1)/stride : 0);
+	count = min (count, (int)lua_objlen (L,3)/ncmp);
+
+	int i, j, k = 1;
+	NTVERTEX *vtx = vb->vtx + first;
+	for (i = 0; i < count; i++, vtx += stride) {
+		float *p = &vtx->x + ofs;
+		for (j = 0; j < ncmp; j++) {
+			lua_rawgeti (L, 3, k++);
+			p[j] = (float)lua_tonumber (L,-1);
+			lua_pop (L,1);
+		}
+	}
+	if (count) vb->dirty |= flag;
+	lua_pushinteger (L, count);
+	return 1;
+}
+
+int Interpreter::vtx_commit (lua_State *L)
+{
+	// vb:commit ()
+	MESHVTX *vb = lua_tomeshvtx (L,1);
+	ASSERT_SYNTAX(vb, "Invalid vertex buffer object");
+	int res = 0;
+	if (vb->dirty) {
+		GROUPEDITSPEC ges;
+		ges.flags = vb->dirty;
+		ges.UsrFlag = 0;
+		ges.Vtx = vb->vtx;
+		ges.nVtx = vb->nvtx;
+		ges.vIdx = NULL;
+		res = oapiEditMeshGroup (vb->hMesh, vb->grp, &ges);
+		vb->dirty = 0;
+	}
+	lua_pushboolean (L, res == 0);
+	return 1;
+}
+
 // ============================================================================
 // process library functions
 
@@ -1561,10 +2665,80 @@ int Interpreter::procFrameskip (lua_State *L)
 	// This should be called in the loop of any "wait"-type function
 
 	Interpreter *interp = GetInterpreter(L);
+	if (L == interp->task && interp->status != 1)
+		return lua_yield (L, 0); // scheduled task: suspend until next Resume
 	interp->frameskip (L);
 	return 0;
 }
 
+int Interpreter::procPreemptible (lua_State *L)
+{
+	// mark a job coroutine as suspendable by the execution budget
+	ASSERT_SYNTAX (lua_isthread (L,1), "Argument 1: invalid type (expected thread)");
+	lua_getfield (L, LUA_REGISTRYINDEX, PREEMPT_REG);
+	lua_pushvalue (L, 1);
+	lua_pushboolean (L, 1);
+	lua_rawset (L, -3);
+	return 0;
+}
+
+int Interpreter::procOverrun (lua_State *L)
+{
+	// true if the current cycle has used up its execution budget
+	Interpreter *interp = GetInterpreter(L);
+	lua_pushboolean (L, interp->boverrun || ((interp->bninstr || interp->btmax) && interp->OverBudget()));
+	return 1;
+}
+
+int Interpreter::procSetBudget (lua_State *L)
+{
+	// proc.set_budget (ninstr, tmax_ms)
+	ASSERT_SYNTAX (lua_isnumber (L,1), "Argument 1: invalid type (expected number)");
+	double tmax = (lua_isnumber (L,2) ? lua_tonumber (L,2) : 0.0);
+	GetInterpreter(L)->SetBudget ((DWORD)lua_tointeger (L,1), tmax);
+	return 0;
+}
+
+int Interpreter::procGetBudgetStats (lua_State *L)
+{
+	const BUDGETSTATS &bs = GetInterpreter(L)->bstats;
+	lua_createtable (L, 0, 5);
+	lua_pushnumber (L, bs.ncycle);    lua_setfield (L, -2, "cycles");
+	lua_pushnumber (L, bs.noverrun);  lua_setfield (L, -2, "overruns");
+	lua_pushnumber (L, bs.npreempt);  lua_setfield (L, -2, "preempted");
+	lua_pushnumber (L, bs.tlast);     lua_setfield (L, -2, "tlast");
+	lua_pushnumber (L, bs.tmax);      lua_setfield (L, -2, "tmax");
+	GetInterpreter(L)->term_echo(L);
+	return 1;
+}
+
+int Interpreter::procSetGC (lua_State *L)
+{
+	// proc.set_gc (pause, stepmul [, tstep_ms])
+	ASSERT_SYNTAX (lua_isnumber (L,1), "Argument 1: invalid type (expected number)");
+	ASSERT_SYNTAX (lua_isnumber (L,2), "Argument 2: invalid type (expected number)");
+	double tstep = (lua_isnumber (L,3) ? lua_tonumber (L,3) : 0.0);
+	GetInterpreter(L)->SetGC (lua_tointeger (L,1), lua_tointeger (L,2), tstep);
+	return 0;
+}
+
+int Interpreter::procGetMemStats (lua_State *L)
+{
+	const MEMSTATS &ms = GetInterpreter(L)->mstats;
+	lua_createtable (L, 0, 9);
+	lua_pushnumber (L, ms.kbinuse);   lua_setfield (L, -2, "inuse");
+	lua_pushnumber (L, ms.kbpeak);    lua_setfield (L, -2, "peak");
+	lua_pushnumber (L, ms.kbcycle);   lua_setfield (L, -2, "alloc");
+	lua_pushnumber (L, ms.kbtotal);   lua_setfield (L, -2, "total");
+	lua_pushnumber (L, ms.nalloc);    lua_setfield (L, -2, "nalloc");
+	lua_pushnumber (L, ms.ngc);       lua_setfield (L, -2, "gccycles");
+	lua_pushnumber (L, ms.tgclast);   lua_setfield (L, -2, "gctlast");
+	lua_pushnumber (L, ms.tgcmax);    lua_setfield (L, -2, "gctmax");
+	lua_pushnumber (L, ms.tgc);       lua_setfield (L, -2, "gctime");
+	GetInterpreter(L)->term_echo(L);
+	return 1;
+}
+
 // ============================================================================
 // oapi library functions
 
@@ -1910,6 +3084,40 @@ int Interpreter::oapi_get_relativevel (lua_State *L)
 	return 1;
 }
 
+int Interpreter::oapi_get_state (lua_State *L)
+{
+	// oapi.get_state (objlist, query [, states])
+	// fills states[i] with the quantities in 'query' for object objlist[i]
+	ASSERT_SYNTAX (lua_istable (L,1), "Argument 1: invalid type (expected table)");
+	ASSERT_SYNTAX (lua_istable (L,2), "Argument 2: invalid type (expected table)");
+	if (!lua_istable (L,3)) {
+		lua_settop (L,2);
+		lua_createtable (L, lua_objlen (L,1), 0);
+	} else lua_settop (L,3);
+	int i, n = lua_objlen (L,1);
+	for (i = 1; i <= n; i++) {
+		lua_rawgeti (L, 1, i);
+		OBJHANDLE hObj = (lua_islightuserdata (L,-1) ? lua_toObject (L,-1) : 0);
+		lua_pop (L,1);
+		if (!hObj) {
+			lua_pushboolean (L,0);
+			lua_rawseti (L, 3, i);
+			continue;
+		}
+		lua_rawgeti (L, 3, i);
+		if (!lua_istable (L,-1)) {
+			lua_pop (L,1);
+			lua_newtable (L);
+			lua_pushvalue (L,-1);
+			lua_rawseti (L, 3, i);
+		}
+		VESSEL *v = (oapiIsVessel (hObj) ? oapiGetVesselInterface (hObj) : 0);
+		ASSERT_SYNTAX (lua_getstate (L, 2, lua_gettop(L), hObj, v), "Argument 2: unknown state key");
+		lua_pop (L,1);
+	}
+	return 1;
+}
+
 int Interpreter::oapi_get_propellanthandle (lua_State *L)
 {
 	OBJHANDLE hObj;
@@ -2474,6 +3682,47 @@ int Interpreter::oapi_del_animationcomponent (lua_State *L)
 	return 0;
 }
 
+int Interpreter::oapi_map_meshgroup (lua_State *L)
+{
+	// oapi.map_meshgroup (hmesh, grp [, nvtx])
+	ASSERT_LIGHTUSERDATA(L,1);
+	DEVMESHHANDLE hMesh = (DEVMESHHANDLE)lua_touserdata(L,1);
+	ASSERT_NUMBER(L,2);
+	DWORD grp = (DWORD)lua_tointeger(L,2);
+
+	// The vertex count is taken from the group. The optional nvtx
+	// argument can only reduce it.
+	MESHGROUP *mg = oapiMeshGroup (hMesh, grp);
+	if (!mg) {
+		lua_pushnil (L);
+		return 1;
+	}
+	DWORD nvtx = mg->nVtx;
+	if (lua_isnumber(L,3))
+		nvtx = min (nvtx, (DWORD)max (0, lua_tointeger(L,3)));
+	if (!nvtx) {
+		lua_pushnil (L);
+		return 1;
+	}
+
+	MESHVTX *vb = (MESHVTX*)lua_newuserdata (L, sizeof(MESHVTX) + (nvtx-1)*sizeof(NTVERTEX));
+	GROUPREQUESTSPEC grs;
+	memset (&grs, 0, sizeof(GROUPREQUESTSPEC));
+	grs.Vtx = vb->vtx;
+	grs.nVtx = nvtx;
+	if (oapiGetMeshGroup (hMesh, grp, &grs) != 0) {
+		lua_pushnil (L);
+		return 1;
+	}
+	vb->hMesh = hMesh;
+	vb->grp = grp;
+	vb->nvtx = min (nvtx, grs.nVtx);
+	vb->dirty = 0;
+	luaL_getmetatable (L, MESHVTX_MT);
+	lua_setmetatable (L, -2);
+	return 1;
+}
+
 int Interpreter::oapi_open_mfd (lua_State *L)
 {
 	ASSERT_NUMBER(L,1);
@@ -2872,7 +4121,7 @@ void AirfoilFunc (VESSEL *v, double aoa, double M, double Re,
 
 	AirfoilContext *ac = (AirfoilContext*)context;
 	lua_State *L = ac->L;                             // interpreter instance
-	lua_getfield (L, LUA_GLOBALSINDEX, ac->funcname); // the callback function
+	ac->func.Push();                                  // the callback function
 
 	// push callback arguments
 	lua_pushlightuserdata (L, v->GetHandle());  // vessel handle
@@ -2953,6 +4202,20 @@ int Interpreter::v_get_rotationmatrix (lua_State *L)
 	return 1;
 }
 
+int Interpreter::v_get_state (lua_State *L)
+{
+	// v:get_state (query [, state])
+	VESSEL *v = lua_tovessel (L,1);
+	ASSERT_SYNTAX(v, "Invalid vessel object");
+	ASSERT_SYNTAX (lua_istable (L,2), "Argument 1: invalid type (expected table)");
+	if (!lua_istable (L,3)) {
+		lua_settop (L,2);
+		lua_newtable (L);
+	} else lua_settop (L,3);
+	ASSERT_SYNTAX (lua_getstate (L, 2, 3, v->GetHandle(), v), "Argument 1: unknown state key");
+	return 1;
+}
+
 int Interpreter::v_get_atmref (lua_State *L)
 {
 	VESSEL *v = lua_tovessel (L,1);
@@ -3105,8 +4368,20 @@ int Interpreter::v_create_airfoil (lua_State *L)
 	ASSERT_SYNTAX(lua_isnumber(L,7), "Argument 6: invalid type (expected number)");
 	double A = lua_tonumber(L,7);
 	AirfoilContext *ac = new AirfoilContext;
-	ac->L = L;
+	ac->L = GetInterpreter(L)->L; // main context: L may be a task coroutine
 	strncpy (ac->funcname, funcname, 127);
+	// the callback is looked up in the environment of the calling script
+	// function (vessels sharing an interpreter have private environments)
+	lua_Debug ar;
+	if (lua_getstack (L, 1, &ar) && lua_getinfo (L, "f", &ar)) {
+		lua_getfenv (L, -1);
+		lua_remove (L, -2);
+	} else {
+		lua_pushvalue (L, LUA_GLOBALSINDEX);
+	}
+	lua_xmove (L, ac->L, 1);
+	ac->func.Bind (ac->L, -1, funcname);
+	lua_pop (ac->L, 1);
 	AIRFOILHANDLE ha = v->CreateAirfoil3 (ao, ref, AirfoilFunc, ac, c, S, A);
 	lua_pushlightuserdata (L, ha);
 	return 1;
@@ -3120,7 +4395,10 @@ int Interpreter::v_del_airfoil (lua_State *L)
 	AIRFOILHANDLE ha = (AIRFOILHANDLE)lua_touserdata(L,2);
 	AirfoilContext *ac;
 	if (v->GetAirfoilParam (ha, 0, 0, (void**)&ac, 0, 0, 0)) {
-		if (ac) delete ac; // delete the context buffer before deleting the airfoil
+		if (ac) { // delete the context buffer before deleting the airfoil
+			ac->func.Release();
+			delete ac;
+		}
 	}
 	bool ok = v->DelAirfoil (ha);
 	lua_pushboolean (L, ok?1:0);
@@ -3163,9 +4441,16 @@ int Interpreter::v_get_cw (lua_State *L)
 	VECTOR3 cw;
 	double cw_zn;
 	v->GetCW (cw.z, cw_zn, cw.x, cw.y);
-	lua_pushvector(L,cw);
-	lua_pushnumber(L,cw_zn);
-	lua_setfield(L,-2,"zn");
+	// plain table: vector objects only accept the x, y, z fields
+	lua_createtable (L, 0, 4);
+	lua_pushnumber (L, cw.x);
+	lua_setfield (L, -2, "x");
+	lua_pushnumber (L, cw.y);
+	lua_setfield (L, -2, "y");
+	lua_pushnumber (L, cw.z);
+	lua_setfield (L, -2, "z");
+	lua_pushnumber (L, cw_zn);
+	lua_setfield (L, -2, "zn");
 	return 1;
 }
 
@@ -3174,10 +4459,21 @@ int Interpreter::v_set_cw (lua_State *L)
 	ASSERT_SYNTAX(lua_gettop (L) >= 2, "Too few arguments");
 	VESSEL *v = lua_tovessel (L,1);
 	ASSERT_SYNTAX(v, "Invalid vessel object");
-	ASSERT_SYNTAX(lua_istable(L,2), "Argument 1: invalid type (expected table)");
+	ASSERT_SYNTAX(lua_isvector(L,2) || lua_istable(L,2), "Argument 1: invalid type (expected vector or table)");
 	VECTOR3 cw = lua_tovector (L,2);
-	lua_getfield(L,2,"zn");
-	double zn = lua_tonumber(L,-1);
+	double zn;
+	if (lua_istable(L,2)) {
+		// table as returned by get_cw, with the zn field
+		lua_getfield(L,2,"zn");
+		zn = lua_tonumber(L,-1);
+	} else if (lua_isnumber(L,3)) {
+		// vector object, with zn as separate argument
+		zn = lua_tonumber(L,3);
+	} else {
+		// vector object: keep the current zn coefficient
+		double z, x, y;
+		v->GetCW (z, zn, x, y);
+	}
 	v->SetCW (cw.z, zn, cw.x, cw.y);
 	return 0;
 }
@@ -5169,6 +6465,21 @@ int Interpreter::v_get_meshoffset (lua_State *L)
 	return 1;
 }
 
+int Interpreter::v_get_devmesh (lua_State *L)
+{
+	// v:get_devmesh (vis, idx)
+	VESSEL *v = lua_tovessel(L,1);
+	ASSERT_SYNTAX(v, "Invalid vessel object");
+	ASSERT_MTDLIGHTUSERDATA(L,2);
+	VISHANDLE vis = (VISHANDLE)lua_touserdata(L,2);
+	ASSERT_MTDNUMBER(L,3);
+	UINT idx = (UINT)lua_tointeger(L,3);
+	DEVMESHHANDLE hMesh = v->GetDevMesh (vis, idx);
+	if (hMesh) lua_pushlightuserdata (L, hMesh);
+	else lua_pushnil (L);
+	return 1;
+}
+
 int Interpreter::v_create_animation (lua_State *L)
 {
 	VESSEL *v = lua_tovessel(L,1);
@@ -2,6 +2,7 @@
 #define ORBITER_MODULE
 #include "orbitersdk.h"
 #include "LuaMFD.h"
+#include "..\..\Common\Profile\FrameProf.h"
 
 // ==============================================================
 // Global variables
@@ -163,14 +164,11 @@ void ScriptMFD::Update (HDC hDC)
 		nchar = (W-fw/2)/fw;
 		nline = (H-yofs-fh/2)/fh;
 	}
-	DWORD nbuf = env->interp->LineCount();
-	MFDInterpreter::LineSpec *ls = env->interp->FirstLine();
+	DWORD i, nbuf = env->interp->LineCount();
 	int xofs = fw/2;
 	COLORREF col = 0;
-	for (; ls && nbuf > nline; ls = ls->next) { // skip lines scrolled out of sight
-		nbuf--;
-	}
-	for (; ls; ls = ls->next) {
+	for (i = (nbuf > nline ? nbuf-nline : 0); i < nbuf; i++) { // skip lines scrolled out of sight
+		const MFDInterpreter::LineSpec *ls = env->interp->Line (i);
 		if (ls->col != col) {
 			col = ls->col;
 			SetTextColor (hDC, col);
@@ -216,6 +214,7 @@ DLLCLBK void ExitModule (HINSTANCE hDLL)
 
 DLLCLBK void opcPostStep (double simt, double simdt, double mjd)
 {
+	FRAMEPROF_CALLBACK ("LuaMFD::opcPostStep");
 	if (g_IList) {
 		g_IList->Update (simt, simdt, mjd);
 	}
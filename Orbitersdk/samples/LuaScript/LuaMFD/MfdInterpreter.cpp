@@ -1,5 +1,4 @@
 #include "MfdInterpreter.h"
-#include <process.h>
 
 // ==============================================================
 // MFD interpreter class implementation
@@ -7,7 +6,7 @@
 MFDInterpreter::MFDInterpreter (): Interpreter ()
 {
 	is_term = true;
-	lineFirst = lineLast = NULL;
+	line0 = 0;
 	nline = 0;
 }
 
@@ -78,21 +77,12 @@ int MFDInterpreter::termSetVerbosity (lua_State *L)
 
 void MFDInterpreter::AddLine (const char *line, COLORREF col)
 {
-	LineSpec *ls = new LineSpec;
+	LineSpec *ls = this->line + (line0+nline)%NLINE;
 	strncpy (ls->buf, line, NCHAR);
 	ls->buf[NCHAR-1] = '\0';
 	ls->col = col;
-	ls->prev = lineLast;
-	ls->next = NULL;
-	if (lineLast) lineLast->next = ls;
-	lineLast = ls;
-	if (!lineFirst) lineFirst = ls;
-	if (++nline > NLINE) {   // max line buffer size reached: drop first line
-		LineSpec *tmp = lineFirst;
-		lineFirst = lineFirst->next;
-		delete tmp;
-		nline--;
-	}
+	if (nline < NLINE) nline++;
+	else line0 = (line0+1)%NLINE; // max line buffer size reached: overwrite first line
 }
 
 
@@ -107,45 +97,19 @@ InterpreterList::Environment::Environment (OBJHANDLE hV)
 
 InterpreterList::Environment::~Environment()
 {
-	if (interp) {
-		if (hThread) {
-			TerminateThread (hThread, 0);
-			CloseHandle (hThread);
-		}
+	if (interp)
 		delete interp;
-	}
 }
 
 MFDInterpreter *InterpreterList::Environment::CreateInterpreter (OBJHANDLE hV)
 {
-	unsigned int id;
 	interp = new MFDInterpreter ();
 	interp->Initialise();
+	interp->SetBudget (0, MFD_BUDGET_TIME);
 	interp->SetSelf (hV);
-	hThread = (HANDLE)_beginthreadex (NULL, 4096, &InterpreterThreadProc, this, 0, &id);
 	return interp;
 }
 
-// Interpreter thread function
-unsigned int WINAPI InterpreterList::Environment::InterpreterThreadProc (LPVOID context)
-{
-	InterpreterList::Environment *env = (InterpreterList::Environment*)context;
-	MFDInterpreter *interp = (MFDInterpreter*)env->interp;
-
-	// interpreter loop
-	for (;;) {
-		interp->WaitExec(); // wait for execution permission
-		if (interp->Status() == 1) break; // close thread requested
-		interp->RunChunk (env->cmd, strlen (env->cmd)); // run command from buffer
-		if (interp->Status() == 1) break;
-		env->cmd[0] = '\0'; // free buffer
-		interp->EndExec();  // return control
-	}
-	interp->EndExec();  // release mutex (is this necessary?)
-	_endthreadex(0);
-	return 0;
-}
-
 // ==============================================================
 // Interpreter repository implementation
 
@@ -165,10 +129,12 @@ void InterpreterList::Update (double simt, double simdt, double mjd)
 	for (i = 0; i < nlist; i++) {
 		for (j = 0; j < list[i].nenv; j++) {
 			Environment *env = list[i].env[j];
-			if (env->interp->IsBusy() || env->cmd[0] || env->interp->nJobs()) { // let the interpreter do some work
-				env->interp->EndExec();
-				env->interp->WaitExec();
+			if (env->cmd[0] && !env->interp->IsBusy()) { // start a new command
+				env->interp->StartChunk (env->cmd, strlen (env->cmd));
+				env->cmd[0] = '\0'; // free buffer
 			}
+			if (env->interp->IsBusy() || env->interp->nJobs()) // let the interpreter do some work
+				env->interp->Resume();
 			env->interp->PostStep (simt, simdt, mjd);
 		}
 	}
@@ -5,6 +5,7 @@
 
 #define NCHAR 80 // characters per line in console buffer
 #define NLINE 50 // number of buffered lines
+#define MFD_BUDGET_TIME 2.0 // default interpreter time budget per frame [ms]
 
 class InterpreterList;
 
@@ -16,14 +17,13 @@ public:
 	struct LineSpec {
 		char buf[NCHAR];
 		COLORREF col;
-		LineSpec *prev, *next;
 	};
 
 	MFDInterpreter ();
 	void SetSelf (OBJHANDLE hV);
 	void LoadAPI();
 	void AddLine (const char *line, COLORREF col);
-	inline LineSpec *FirstLine() const { return lineFirst; }
+	inline const LineSpec *Line (DWORD i) const { return line + (line0+i)%NLINE; } // i-th oldest line
 	inline DWORD LineCount() const { return nline; }
 	void term_strout (const char *str, bool iserr=false);
 	void term_out (lua_State *L, bool iserr=false);
@@ -34,8 +34,9 @@ protected:
 	static int termSetVerbosity (lua_State *L);
 
 private:
-	LineSpec *lineFirst, *lineLast;
-	DWORD nline;
+	LineSpec line[NLINE]; // line ring buffer
+	DWORD line0;          // ring index of oldest line
+	DWORD nline;          // number of buffered lines
 };
 
 // ==============================================================
@@ -48,9 +49,7 @@ public:
 		~Environment();
 		MFDInterpreter *CreateInterpreter (OBJHANDLE hV);
 		MFDInterpreter *interp;
-		HANDLE hThread;
 		char cmd[1024];
-		static unsigned int WINAPI InterpreterThreadProc (LPVOID context);
 	};
 	struct VesselInterp {
 		OBJHANDLE hVessel;
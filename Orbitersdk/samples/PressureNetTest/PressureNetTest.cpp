@@ -0,0 +1,178 @@
+// ==============================================================
+//               ORBITER MODULE: PressureNetTest
+//                  Part of the ORBITER SDK
+//          Copyright (C) 2001-2015 Martin Schweiger
+//                   All rights reserved
+//
+// PressureNetTest.cpp
+// Command line test for the lumped-volume pressure network
+// (see Common/Vessel/PressureNet.h).
+//
+// Checks:
+//   - a closed network (cabin, airlock, docked compartment) with
+//     random valve settings conserves its gas at 10000x time
+//     acceleration (200 s steps), and its pressures stay within
+//     the initial range
+//   - an open network (cabin and airlock with supply and ambient
+//     reservoirs) gives the same state for any step length as a
+//     fine explicit reference integration
+//   - a regulator never overshoots its pressure, and fills a volume
+//     in the analytic time
+//
+// Usage: PressureNetTest
+// Returns 0 if all checks pass, 1 otherwise.
+// ==============================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "..\Common\Vessel\PressureNet.h"
+
+static const double DT_MAX = 200.0;  // step length at 10000x and 50 fps [s]
+
+// --------------------------------------------------------------
+// Closed network: gas amount and pressure bounds
+
+static bool CheckClosed ()
+{
+	PressureNetwork net;
+	int n[3], i, k;
+	n[0] = net.AddVolume (24.0, 100e3);  // cabin
+	n[1] = net.AddVolume (4.0, 20e3);    // airlock
+	n[2] = net.AddVolume (2.0, 0.0);     // docked compartment
+	int v1 = net.AddValve (n[0], n[1]);
+	int v2 = net.AddValve (n[1], n[2]);
+
+	double m0 = net.Amount(), dm, dmmax = 0.0, pmin = 1e100, pmax = -1e100;
+	srand (3);
+	for (i = 0; i < 100000; i++) {
+		// closed, nearly closed or open valves: conductances over 7 orders of magnitude
+		net.SetConductance (v1, (rand()%3) * (rand()%2 ? 0.2 : 1e3));
+		net.SetConductance (v2, (rand()%3) * (rand()%2 ? 0.2 : 500.0));
+		net.Step (DT_MAX);
+		if ((dm = fabs (net.Amount()-m0)/m0) > dmmax) dmmax = dm;
+		for (k = 0; k < 3; k++) {
+			double p = net.Pressure (n[k]);
+			if (p < pmin) pmin = p;
+			if (p > pmax) pmax = p;
+		}
+	}
+	bool ok = (dmmax <= 1e-10 && pmin >= 0.0 && pmax <= 100e3*(1.0+1e-9));
+	printf ("%s  closed network, dt=%gs: rel. drift %0.3g, p = %g .. %g Pa\n",
+		ok ? "PASS" : "FAIL", DT_MAX, dmmax, pmin, pmax);
+	return ok;
+}
+
+// --------------------------------------------------------------
+// Open network: step length independence
+
+static void OpenNetwork (PressureNetwork &net, int &cabin, int &lock)
+{
+	cabin = net.AddVolume (24.0, 100e3);
+	lock  = net.AddVolume (4.0, 0.0);
+	int amb = net.AddReservoir (50e3);
+	int sup = net.AddReservoir (400e3);
+	net.AddValve (cabin, lock, 0.2);
+	net.AddValve (lock, amb, 0.2);
+	net.AddValve (sup, cabin, 0.05);
+}
+
+static bool CheckStepLength ()
+{
+	const double T = 60.0;
+	const int nref = 600000;
+	int i;
+
+	// reference: explicit integration with a small step
+	double pc = 100e3, pa = 0.0, h = T/nref;
+	for (i = 0; i < nref; i++) {
+		double fc = 0.2*(pa-pc) + 0.05*(400e3-pc);
+		double fa = 0.2*(pc-pa) + 0.2*(50e3-pa);
+		pc += h*fc/24.0;
+		pa += h*fa/4.0;
+	}
+
+	bool ok = true;
+	const double dt[] = {0.02, 0.2, 2.0, 20.0, 60.0};
+	const int ndt = sizeof(dt)/sizeof(dt[0]);
+	for (i = 0; i < ndt; i++) {
+		PressureNetwork net;
+		int cabin, lock, n = (int)floor (T/dt[i]+0.5);
+		OpenNetwork (net, cabin, lock);
+		for (int j = 0; j < n; j++) net.Step (dt[i]);
+		double ec = fabs (net.Pressure (cabin)-pc), ea = fabs (net.Pressure (lock)-pa);
+		bool res = (ec <= 1.0 && ea <= 1.0);
+		printf ("%s  open network, dt=%gs: cabin %0.1f Pa (ref %0.1f), airlock %0.1f Pa (ref %0.1f)\n",
+			res ? "PASS" : "FAIL", dt[i], net.Pressure (cabin), pc, net.Pressure (lock), pa);
+		ok = ok && res;
+	}
+
+	// at 10000x the network settles, but never leaves the reservoir range
+	PressureNetwork net;
+	int cabin, lock;
+	double pmin = 1e100, pmax = -1e100;
+	OpenNetwork (net, cabin, lock);
+	for (i = 0; i < 1000; i++) {
+		net.Step (DT_MAX);
+		double p[2] = {net.Pressure (cabin), net.Pressure (lock)};
+		for (int k = 0; k < 2; k++) {
+			if (p[k] < pmin) pmin = p[k];
+			if (p[k] > pmax) pmax = p[k];
+		}
+	}
+	bool res = (pmin >= 0.0 && pmax <= 400e3);
+	printf ("%s  open network, dt=%gs: p = %g .. %g Pa\n",
+		res ? "PASS" : "FAIL", DT_MAX, pmin, pmax);
+	return ok && res;
+}
+
+// --------------------------------------------------------------
+// Regulator: no overshoot, analytic fill time
+
+static bool CheckRegulator ()
+{
+	const double V = 24.0, C = 0.05, p0 = 50e3, ps = 400e3, preg = 100e3;
+	int i;
+
+	PressureNetwork net;
+	int cabin = net.AddVolume (V, p0);
+	int sup = net.AddReservoir (ps);
+	net.SetRegulator (net.AddValve (sup, cabin, C), preg);
+	double pmax = 0.0;
+	for (i = 0; i < 1000; i++) {
+		net.Step (DT_MAX);
+		if (net.Pressure (cabin) > pmax) pmax = net.Pressure (cabin);
+	}
+	bool ok1 = (pmax <= preg*(1.0+1e-9) && fabs (net.Pressure (cabin)-preg) <= 1e-6*preg);
+	printf ("%s  regulator, dt=%gs: p = %g Pa, max. %g Pa (set %g Pa)\n",
+		ok1 ? "PASS" : "FAIL", DT_MAX, net.Pressure (cabin), pmax, preg);
+
+	// fill time: dp/dt = C/V (ps-p)  =>  t = V/C ln((ps-p0)/(ps-preg))
+	const double dt = 0.02;
+	PressureNetwork net2;
+	cabin = net2.AddVolume (V, p0);
+	sup = net2.AddReservoir (ps);
+	net2.SetRegulator (net2.AddValve (sup, cabin, C), preg);
+	double t0 = V/C * log ((ps-p0)/(ps-preg)), t = 0.0;
+	for (i = 1; net2.Pressure (cabin) < preg*(1.0-1e-9) && t < 10.0*t0; i++) {
+		net2.Step (dt);
+		t = i*dt;
+	}
+	bool ok2 = (fabs (t-t0) <= 2.0*dt);
+	printf ("%s  regulator, dt=%gs: fill time %g s (analytic %g s)\n",
+		ok2 ? "PASS" : "FAIL", dt, t, t0);
+	return ok1 && ok2;
+}
+
+// --------------------------------------------------------------
+
+int main (int argc, char *argv[])
+{
+	int nfail = 0;
+	if (!CheckClosed ()) nfail++;
+	if (!CheckStepLength ()) nfail++;
+	if (!CheckRegulator ()) nfail++;
+
+	printf (nfail ? "%d check(s) failed\n" : "all checks passed\n", nfail);
+	return nfail ? 1 : 0;
+}
@@ -0,0 +1,78 @@
+// ==============================================================
+//                 ORBITER MODULE: RecConvert
+//                  Part of the ORBITER SDK
+//          Copyright (C) 2001-2015 Martin Schweiger
+//                   All rights reserved
+//
+// RecConvert.cpp
+// Command line tool for converting the text playback streams
+// under Flights/ (.pos, .att, .atc, system.dat) to the binary
+// flight recorder format (see Common/Recorder/FlightRec.h).
+//
+// Usage: RecConvert [-d] [-v] file [file ...]
+//   -d  delta-compress position and attitude samples (lossy)
+//   -v  verify the converted stream: every record is compared with
+//       the source sample (time, frame, values or event string)
+// The binary stream is written to <file>.rec
+// ==============================================================
+
+#include <stdio.h>
+#include <string.h>
+#include "..\Common\Recorder\FlightRec.h"
+
+// --------------------------------------------------------------
+// Check a converted stream: each record must match the source
+// sample, and a time lookup must return a sample with the
+// requested time.
+
+static bool Verify (const char *src, const char *fname)
+{
+	FlightRecReader rec;
+	if (!rec.Open (fname)) {
+		printf ("  cannot map %s\n", fname);
+		return false;
+	}
+
+	DWORD i, nseek = 0;
+	for (i = 0; i < rec.NumSamples(); i++) {
+		double t = rec.Time (i);
+		if (rec.Time (rec.Find (t)) != t) nseek++;
+	}
+	int nerr = FlightRecVerify (src, fname);
+	if (nerr < 0) {
+		printf ("  cannot read %s\n", src);
+		return false;
+	}
+	printf ("  t = %g .. %g, %d mismatches, %d seek errors\n", rec.T0(), rec.T1(), nerr, nseek);
+	return nerr == 0 && nseek == 0;
+}
+
+// --------------------------------------------------------------
+
+int main (int argc, char *argv[])
+{
+	DWORD flags = 0;
+	bool verify = false;
+	int i, n, nerr = 0;
+	char dst[1024];
+
+	for (i = 1; i < argc; i++) {
+		if      (!strcmp (argv[i], "-d")) flags |= FLIGHTREC_DELTA;
+		else if (!strcmp (argv[i], "-v")) verify = true;
+		else {
+			_snprintf (dst, 1024, "%s.rec", argv[i]);
+			dst[1023] = '\0';
+			n = FlightRecConvert (argv[i], dst, flags);
+			if (n < 0) {
+				printf ("%s: conversion failed\n", argv[i]);
+				nerr++;
+			} else {
+				printf ("%s -> %s: %d samples\n", argv[i], dst, n);
+				if (verify && !Verify (argv[i], dst)) nerr++;
+			}
+		}
+	}
+	if (argc < 2)
+		printf ("Usage: RecConvert [-d] [-v] file [file ...]\n");
+	return nerr ? 1 : 0;
+}
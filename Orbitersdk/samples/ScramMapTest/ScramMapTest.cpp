@@ -0,0 +1,95 @@
+// ==============================================================
+//                ORBITER MODULE: ScramMapTest
+//                  Part of the ORBITER SDK
+//          Copyright (C) 2001-2015 Martin Schweiger
+//                   All rights reserved
+//
+// ScramMapTest.cpp
+// Command line test for the DeltaGlider scramjet intake map
+// (see DeltaGlider/ScramIntake.h).
+//
+// The interpolated intake flow is compared with the full model
+// over the map's Mach number range, for a set of atmospheres.
+// Checks:
+//   - the map deviates from the model by at most 0.03% of the
+//     maximum mass flow
+//   - the map is never negative, and zero beyond the upper
+//     Mach limit
+//   - switching between atmospheres recomputes the map
+//
+// Usage: ScramMapTest
+// Returns 0 if all checks pass, 1 otherwise.
+// ==============================================================
+
+#include <stdio.h>
+#include <math.h>
+#include "..\DeltaGlider\ScramIntake.h"
+
+static const double MAXDEV = 3e-4;  // max. deviation (fraction of max. mass flow)
+static const double DM = 1e-3;      // Mach number sampling step
+
+// specific heat ratios of the atmospheres in Config/ (Earth, Mars,
+// Venus, gas giants, Titan), and a monatomic gas. Io (gamma < 1) is
+// left out: the intake model is not defined for it.
+static const double GAMMA[] = {1.4, 1.2941, 1.2857, 1.3333, 1.3941, 1.6667};
+static const int NGAMMA = sizeof(GAMMA)/sizeof(GAMMA[0]);
+
+// --------------------------------------------------------------
+// Compare the map with the model for one atmosphere
+
+static bool CheckMap (const ScramIntake &intake, double gamma)
+{
+	const double mmax = ScramIntake::MaxMach();
+	double m, q0, q1, dq, dqmax = 0.0, qmax = 0.0, qmin = 0.0;
+
+	for (m = 0.0; m < mmax; m += DM) {
+		q0 = ScramIntake::Model (gamma, m);
+		q1 = intake.Flow (gamma, m);
+		if ((dq = fabs (q1-q0)) > dqmax) dqmax = dq;
+		if (q0 > qmax) qmax = q0;
+		if (q1 < qmin) qmin = q1;
+	}
+	double qend = intake.Flow (gamma, mmax) + intake.Flow (gamma, mmax+1.0);
+
+	bool ok = (dqmax <= MAXDEV*qmax && qmin >= 0.0 && qend == 0.0);
+	printf ("%s  gamma=%g: max. deviation %0.4f%%, min. %g, beyond M=%g: %g\n",
+		ok ? "PASS" : "FAIL", gamma, dqmax/qmax*100.0, qmin, mmax, qend);
+	return ok;
+}
+
+// --------------------------------------------------------------
+// Alternate between atmospheres: each lookup must match the map
+// of its own atmosphere
+
+static bool CheckSwitch (const ScramIntake &intake)
+{
+	const double m = 0.5*ScramIntake::MaxMach();
+	double q[NGAMMA];
+	int i, k, nerr = 0;
+
+	for (i = 0; i < NGAMMA; i++) {
+		ScramIntake ref;
+		q[i] = ref.Flow (GAMMA[i], m);
+	}
+	for (k = 0; k < 3; k++)
+		for (i = 0; i < NGAMMA; i++)
+			if (intake.Flow (GAMMA[i], m) != q[i]) nerr++;
+
+	printf ("%s  atmosphere switch: %d mismatches\n", nerr ? "FAIL" : "PASS", nerr);
+	return nerr == 0;
+}
+
+// --------------------------------------------------------------
+
+int main (int argc, char *argv[])
+{
+	ScramIntake intake;
+	int i, nfail = 0;
+
+	for (i = 0; i < NGAMMA; i++)
+		if (!CheckMap (intake, GAMMA[i])) nfail++;
+	if (!CheckSwitch (intake)) nfail++;
+
+	printf (nfail ? "%d check(s) failed\n" : "all checks passed\n", nfail);
+	return nfail ? 1 : 0;
+}
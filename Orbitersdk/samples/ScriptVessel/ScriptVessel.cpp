@@ -13,24 +13,32 @@
 // This class creates an interpreter instance, loads a vessel class-
 // specific script and and implements the VESSEL2 callback functions
 // by calling corresponding script functions.
+//
+// If the vessel configuration file contains "ShareInterpreter = TRUE",
+// all vessels of the class share a single interpreter instance. The
+// class script is compiled once and run for each vessel in a private
+// environment table, which falls back to the interpreter globals for
+// the API libraries.
 // ==============================================================
 
 #define STRICT
 #define ORBITER_MODULE
 
-extern "C" {
-#include "Lua\lua.h"
-}
 #include "orbitersdk.h"
+#include "Interpreter.h"
+#include "..\Common\Profile\FrameProf.h"
 
-const int NCLBK        = 4;
+const int NCLBK        = 6;
 const int SETCLASSCAPS = 0;
 const int POSTCREATION = 1;
 const int PRESTEP      = 2;
 const int POSTSTEP     = 3;
+const int VISCREATED   = 4;
+const int VISDESTROYED = 5;
 
 const char *CLBKNAME[NCLBK] = {
-	"setclasscaps", "postcreation", "prestep", "poststep"
+	"clbk_setclasscaps", "clbk_postcreation", "clbk_prestep", "clbk_poststep",
+	"clbk_visualcreated", "clbk_visualdestroyed"
 };
 
 // Calculate lift coefficient [Cl] as a function of aoa (angle of attack) over -Pi ... Pi
@@ -49,6 +57,89 @@ double LiftCoeff (double aoa)
 	return CL[i] + (aoa-AOA[i])*SCL[i];
 }
 
+// ==============================================================
+// Interpreter shared by all vessels of a script class
+// ==============================================================
+
+struct ScriptClass {
+	char script[256];          // class script file name
+	INTERPRETERHANDLE hInterp; // shared interpreter instance
+	int chunkref;              // registry reference to compiled class script
+	int nref;                  // number of vessels using the interpreter
+	FrameProfScopeRef fpscope[2]; // frame profiler scopes for clbkPreStep/clbkPostStep
+	ScriptClass *next;
+};
+
+static ScriptClass *g_ScriptClass = NULL; // list of shared script classes
+
+// --------------------------------------------------------------
+// Name the frame profiler scopes of a script class, so that the
+// step callback cost is attributed to the class script
+// --------------------------------------------------------------
+static void SetProfScopes (FrameProfScopeRef *fpscope, const char *script)
+{
+	char name[300];
+	sprintf (name, "%s::clbkPreStep", script);
+	fpscope[0].SetName (name);
+	sprintf (name, "%s::clbkPostStep", script);
+	fpscope[1].SetName (name);
+}
+
+// --------------------------------------------------------------
+// Return the shared interpreter for a class script, creating
+// it on first use
+// --------------------------------------------------------------
+static ScriptClass *AcquireScriptClass (const char *script)
+{
+	ScriptClass *sc;
+	for (sc = g_ScriptClass; sc; sc = sc->next)
+		if (!_stricmp (sc->script, script)) break;
+
+	if (!sc) {
+		char path[256];
+		sc = new ScriptClass;
+		strncpy (sc->script, script, 255); sc->script[255] = '\0';
+		sc->hInterp = oapiCreateInterpreter();
+		sc->nref = 0;
+		SetProfScopes (sc->fpscope, sc->script);
+		sc->next = g_ScriptClass;
+		g_ScriptClass = sc;
+
+		// compile the class script once, through the interpreter's
+		// loadfile (which uses the bytecode cache)
+		lua_State *L = oapiGetLua (sc->hInterp);
+		sprintf (path, "Config/Vessels/%s", script);
+		lua_getglobal (L, "loadfile");
+		lua_pushstring (L, path);
+		lua_call (L, 1, 2);
+		if (lua_isnil (L, -2)) {
+			oapiWriteLogV ("ScriptVessel: %s", lua_tostring (L, -1));
+			lua_pop (L, 2);
+			sc->chunkref = LUA_NOREF;
+		} else {
+			lua_pop (L, 1);
+			sc->chunkref = luaL_ref (L, LUA_REGISTRYINDEX);
+		}
+	}
+	sc->nref++;
+	return sc;
+}
+
+// --------------------------------------------------------------
+// Release a shared interpreter. The interpreter is deleted
+// together with its last vessel.
+// --------------------------------------------------------------
+static void ReleaseScriptClass (ScriptClass *sc)
+{
+	if (--sc->nref) return;
+
+	ScriptClass **psc;
+	for (psc = &g_ScriptClass; *psc != sc; psc = &(*psc)->next);
+	*psc = sc->next;
+	oapiDelInterpreter (sc->hInterp);
+	delete sc;
+}
+
 // ==============================================================
 // ScriptVessel class interface
 // ==============================================================
@@ -61,13 +152,20 @@ public:
 	void clbkPostCreation ();
 	void clbkPreStep (double simt, double simdt, double mjd);
 	void clbkPostStep (double simt, double simdt, double mjd);
+	void clbkVisualCreated (VISHANDLE vis, int refcount);
+	void clbkVisualDestroyed (VISHANDLE vis, int refcount);
 
 protected:
+	bool LoadSharedScript (const char *script);
+
 	INTERPRETERHANDLE hInterp;
 	lua_State *L;
+	ScriptClass *sc;   // shared script class (or NULL if the interpreter is private)
+	int envref;        // registry reference to the vessel's script environment
+	FrameProfScopeRef ownscope[2]; // profiler scopes of a private interpreter
+	FrameProfScopeRef *fpscope;    // profiler scopes of the script class
 
-	bool bclbk[NCLBK];
-	char func[256];
+	LuaCallback clbk[NCLBK]; // script callback functions
 };
 
 // ==============================================================
@@ -75,16 +173,68 @@ protected:
 // ==============================================================
 ScriptVessel::ScriptVessel (OBJHANDLE hVessel, int flightmodel): VESSEL2 (hVessel, flightmodel)
 {
-	// create the interpreter instance to run the vessel script
-	hInterp = oapiCreateInterpreter();
-	L = oapiGetLua (hInterp);
-	strcpy (func, "clbk_");
+	// the interpreter instance is assigned when the class script is loaded
+	hInterp = NULL;
+	L = NULL;
+	sc = NULL;
+	envref = LUA_NOREF;
+	fpscope = ownscope;
 }
 
 ScriptVessel::~ScriptVessel ()
 {
-	// delete the interpreter instance
-	oapiDelInterpreter (hInterp);
+	if (sc) {
+		// release the vessel environment and the shared interpreter
+		for (int i = 0; i < NCLBK; i++) clbk[i].Release();
+		luaL_unref (L, LUA_REGISTRYINDEX, envref);
+		ReleaseScriptClass (sc);
+	} else if (hInterp) {
+		// delete the interpreter instance
+		oapiDelInterpreter (hInterp);
+	}
+}
+
+// --------------------------------------------------------------
+// Run the compiled class script in a new environment for this
+// vessel
+// --------------------------------------------------------------
+bool ScriptVessel::LoadSharedScript (const char *script)
+{
+	sc = AcquireScriptClass (script);
+	fpscope = sc->fpscope;
+	hInterp = sc->hInterp;
+	L = oapiGetLua (hInterp);
+
+	// vessel environment: private globals, with fallback to the interpreter globals
+	lua_newtable (L);
+	lua_newtable (L);
+	lua_pushvalue (L, LUA_GLOBALSINDEX);
+	lua_setfield (L, -2, "__index");
+	lua_setmetatable (L, -2);
+
+	// Define the vessel instance
+	lua_pushlightuserdata (L, GetHandle());  // push vessel handle
+	lua_setfield (L, -2, "hVessel");
+	lua_getfield (L, LUA_GLOBALSINDEX, "vessel");
+	lua_getfield (L, -1, "get_interface");
+	lua_remove (L, -2);
+	lua_pushlightuserdata (L, GetHandle());
+	lua_call (L, 1, 1);
+	lua_setfield (L, -2, "vi");
+	envref = luaL_ref (L, LUA_REGISTRYINDEX);
+
+	if (sc->chunkref == LUA_NOREF) return false;
+
+	// Run the class script in the vessel environment
+	lua_rawgeti (L, LUA_REGISTRYINDEX, sc->chunkref);
+	lua_rawgeti (L, LUA_REGISTRYINDEX, envref);
+	lua_setfenv (L, -2);
+	if (lua_pcall (L, 0, 0, 0)) {
+		oapiWriteLogV ("ScriptVessel: %s", lua_tostring (L, -1));
+		lua_pop (L, 1);
+		return false;
+	}
+	return true;
 }
 
 // ==============================================================
@@ -97,67 +247,98 @@ ScriptVessel::~ScriptVessel ()
 void ScriptVessel::clbkSetClassCaps (FILEHANDLE cfg)
 {
 	char script[256], cmd[256];
+	bool share = false;
 	int i;
 
-	// Load the vessel script
 	oapiReadItem_string (cfg, "Script", script);
-	sprintf (cmd, "run_global('Config/Vessels/%s')", script);
-	oapiExecScriptCmd (hInterp, cmd);
+	oapiReadItem_bool (cfg, "ShareInterpreter", share);
 
-	// Define the vessel instance
-	lua_pushlightuserdata (L, GetHandle());  // push vessel handle
-	lua_setfield (L, LUA_GLOBALSINDEX, "hVessel");
-	strcpy (cmd, "vi = vessel.get_interface(hVessel)");
-	oapiExecScriptCmd (hInterp, cmd);
-
-	// check for defined callback functions in script
-	for (i = 0; i < NCLBK; i++) {
-		strcpy (func+5, CLBKNAME[i]);
-		lua_getfield (L, LUA_GLOBALSINDEX, func);
-		bclbk[i] = (lua_isfunction (L,-1) != 0);
-		lua_pop(L,1);
+	if (share) {
+		// Load the vessel script into the shared interpreter
+		LoadSharedScript (script);
+	} else {
+		// create the interpreter instance to run the vessel script
+		SetProfScopes (ownscope, script);
+		hInterp = oapiCreateInterpreter();
+		L = oapiGetLua (hInterp);
+
+		// Load the vessel script
+		sprintf (cmd, "run_global('Config/Vessels/%s')", script);
+		oapiExecScriptCmd (hInterp, cmd);
+
+		// Define the vessel instance
+		lua_pushlightuserdata (L, GetHandle());  // push vessel handle
+		lua_setfield (L, LUA_GLOBALSINDEX, "hVessel");
+		strcpy (cmd, "vi = vessel.get_interface(hVessel)");
+		oapiExecScriptCmd (hInterp, cmd);
+
+		// the script environment is the global table
+		lua_pushvalue (L, LUA_GLOBALSINDEX);
+		envref = luaL_ref (L, LUA_REGISTRYINDEX);
 	}
 
+	// bind the callback functions in the script environment
+	lua_rawgeti (L, LUA_REGISTRYINDEX, envref);
+	for (i = 0; i < NCLBK; i++)
+		clbk[i].Bind (L, -1, CLBKNAME[i]);
+	lua_pop (L, 1);
+
 	// Run the SetClassCaps function
-	if (bclbk[SETCLASSCAPS]) {
-		strcpy (func+5, "setclasscaps");
-		lua_getfield (L, LUA_GLOBALSINDEX, func);
+	if (clbk[SETCLASSCAPS].Push()) {
 		lua_pushlightuserdata (L, cfg);
 		lua_call (L, 1, 0);
-	}
+	} else lua_pop (L, 1);
 }
 
 void ScriptVessel::clbkPostCreation ()
 {
-	if (bclbk[POSTCREATION]) {
-		strcpy (func+5, "postcreation");
-		lua_getfield (L, LUA_GLOBALSINDEX, func);
+	if (clbk[POSTCREATION].Push()) {
 		lua_call (L, 0, 0);
-	}
+	} else lua_pop (L, 1);
 }
 
 void ScriptVessel::clbkPreStep (double simt, double simdt, double mjd)
 {
-	if (bclbk[PRESTEP]) {
-		strcpy (func+5, "prestep");
-		lua_getfield (L, LUA_GLOBALSINDEX, func);
+	FrameProfScope fps (fpscope[0]);
+	if (clbk[PRESTEP].Push()) {
 		lua_pushnumber(L,simt);
 		lua_pushnumber(L,simdt);
 		lua_pushnumber(L,mjd);
 		lua_call (L, 3, 0);
-	}
+	} else lua_pop (L, 1);
 }
 
 void ScriptVessel::clbkPostStep (double simt, double simdt, double mjd)
 {
-	if (bclbk[POSTSTEP]) {
-		strcpy (func+5, "poststep");
-		lua_getfield (L, LUA_GLOBALSINDEX, func);
+	FrameProfScope fps (fpscope[1]);
+	if (clbk[POSTSTEP].Push()) {
 		lua_pushnumber(L,simt);
 		lua_pushnumber(L,simdt);
 		lua_pushnumber(L,mjd);
 		lua_call (L, 3, 0);
-	}
+	} else lua_pop (L, 1);
+}
+
+// --------------------------------------------------------------
+// The visual handle gives the script access to the mesh instances
+// of the vessel (v:get_devmesh) while the visual exists
+// --------------------------------------------------------------
+void ScriptVessel::clbkVisualCreated (VISHANDLE vis, int refcount)
+{
+	if (clbk[VISCREATED].Push()) {
+		lua_pushlightuserdata(L,vis);
+		lua_pushnumber(L,refcount);
+		lua_call (L, 2, 0);
+	} else lua_pop (L, 1);
+}
+
+void ScriptVessel::clbkVisualDestroyed (VISHANDLE vis, int refcount)
+{
+	if (clbk[VISDESTROYED].Push()) {
+		lua_pushlightuserdata(L,vis);
+		lua_pushnumber(L,refcount);
+		lua_call (L, 2, 0);
+	} else lua_pop (L, 1);
 }
 
 // ==============================================================
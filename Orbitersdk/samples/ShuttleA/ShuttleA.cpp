@@ -25,6 +25,7 @@
 #include "adictrl.h"
 #include "auxpodctrl.h"
 #include "InstrVs.h"
+#include "..\Common\Profile\FrameProf.h"
 #include "resource.h"
 #include <math.h>
 #include <stdio.h>
@@ -1428,6 +1429,7 @@ void ShuttleA::clbkPostCreation ()
 // --------------------------------------------------------------
 void ShuttleA::clbkPostStep (double simt, double simdt, double mjd)
 {
+	FRAMEPROF_CALLBACK ("ShuttleA::clbkPostStep");
 	// Update attitude reference frame
 	attref->PostStep (simt, simdt, mjd);
 
@@ -31,8 +31,10 @@ function airspeed ()
     return v:get_airspeed()
 end
 
-function slope ()
-    as = v:get_airspeedvector(REFFRAME.HORIZON)
+function slope (as)
+    if as == nil then
+        as = v:get_airspeedvector(REFFRAME.HORIZON)
+    end
     xz = math.sqrt (as.x^2 + as.z^2)
     sl = math.atan2 (as.y, xz)
     return sl
@@ -52,10 +54,13 @@ function alt_ap (alt)
     aap.tgtalt = alt
     local dslope0 = 0
     local dslope_rate
+    local q = {'altitude','airspeedvector','elevator', frame=REFFRAME.HORIZON}
+    local s = {}
     while true do
         if aap.tgtalt ~= nil then
             local dt = oapi.get_simstep()
-            alt = altitude()
+            v:get_state(q,s)
+            alt = s.altitude
             dalt = aap.tgtalt-alt
             tgt_slope = RAD*1e-2 * dalt
 	        if tgt_slope > aap.maxasc*RAD then
@@ -63,7 +68,7 @@ function alt_ap (alt)
 	        elseif tgt_slope < aap.maxdsc*RAD then
 		        tgt_slope = aap.maxdsc*RAD
 	        end
-            dslope = tgt_slope-slope()
+            dslope = tgt_slope-slope(s.airspeedvector)
             if dslope0 == 0 then
                 dslope_rate = 0
             else
@@ -71,8 +76,7 @@ function alt_ap (alt)
             end
             dslope0 = dslope
             delev = (dslope*0.1 + dslope_rate)*(dt*10.0)
-            elev = v:get_adclevel(AIRCTRL.ELEVATOR)
-            elev = elev+delev;
+            elev = s.elevator+delev;
             if elev > 1 then elev = 1 elseif elev < -1 then elev = -1 end
             v:set_adclevel(AIRCTRL.ELEVATOR,elev)
         end
@@ -93,16 +97,18 @@ function spd_ap (spd)
     local acc, dpsd
     local alpha = 1
     local beta = 1
+    local q = {'airspeed','mainthrust'}
+    local s = {}
     while true do
         if aap.tgtspd ~= nil then
             local dt = oapi.get_simstep()
-            spd = airspeed()
+            v:get_state(q,s)
+            spd = s.airspeed
             acc = (spd-spd0)/dt
             spd0 = spd
             dspd = aap.tgtspd-spd
             dthrott = (dspd*alpha - acc*beta)*dt
-            thrott = v:get_thrustergrouplevel (THGROUP.MAIN)
-            v:set_thrustergrouplevel (THGROUP.MAIN, thrott+dthrott)
+            v:set_thrustergrouplevel (THGROUP.MAIN, s.mainthrust+dthrott)
         end
 	    proc.skip()
     end
@@ -118,9 +124,12 @@ note: does not terminate (run as background job and kill
 function bank_ap (bnk)
     aap.tgtbnk = bnk
     local bnk0 = v:get_bank()
+    local q = {'bank','aileron'}
+    local s = {}
     while true do
         local dt = oapi.get_simstep()
-        bnk = v:get_bank()
+        v:get_state(q,s)
+        bnk = s.bank
         dbnk = bnk-bnk0
         if dbnk < -PI then dbnk = dbnk+2*PI elseif dbnk > PI then dbnk = dbnk-2*PI end -- phase unwrap
         rate = dbnk/dt
@@ -128,8 +137,7 @@ function bank_ap (bnk)
         dbnk = aap.tgtbnk*RAD - bnk
         if dbnk < -PI then dbnk = dbnk+2*PI elseif dbnk > PI then dbnk = dbnk-2*PI end -- phase unwrap
         dail = (-dbnk*0.1 + rate*0.3)*(dt*5.0) -- the damping term should really depend on atmospheric density
-        ail = v:get_adclevel(AIRCTRL.AILERON)
-        ail = ail+dail
+        ail = s.aileron+dail
         if ail > 1 then ail = 1 elseif ail < -1 then ail = -1 end
         v:set_adclevel(AIRCTRL.AILERON,ail)
         proc.skip()
@@ -147,9 +155,12 @@ function heading_ap (hdg)
     aap.tgthdg = hdg
     local hdg0 = v:get_yaw()
     local tgtbank = v:get_bank()
+    local q = {'yaw','bank'}
+    local s = {}
     while true do
         local dt = oapi.get_simstep()
-        hdg = v:get_yaw()
+        v:get_state(q,s)
+        hdg = s.yaw
         dhdg = hdg-hdg0
         if dhdg < -PI then dhdg = dhdg+2*PI elseif dhdg > PI then dhdg = dhdg-2*PI end -- phase unwrap
         rate = dhdg/dt
@@ -157,7 +168,7 @@ function heading_ap (hdg)
         dhdg = aap.tgthdg*RAD - hdg
         if dhdg < -PI then dhdg = dhdg+2*PI elseif dhdg > PI then dhdg = dhdg-2*PI end -- phase unwrap
         dbank = (-dhdg*100 + rate*1000)*dt
-        tgtbank = v:get_bank() + dbank
+        tgtbank = s.bank + dbank
         if tgtbank > 0.3*PI then tgtbank = 0.3*PI elseif tgtbank < -0.3*PI then tgtbank = -0.3*PI end
         aap.tgtbnk = tgtbank*DEG
         proc.skip()
@@ -23,40 +23,306 @@ ktable = {Q=0x10, W=0x11, E=0x12, R=0x13, T=0x14, Y=0x15, U=0x16, I=0x17,
 
 
 -- execute a script in the 'Script' folder (.lua extension is assumed)
+-- (scripts are loaded and called as Lua functions rather than via
+-- dofile, so that they can suspend themselves with proc.skip)
 function run (script)
-  dofile('Script/'..script..'.lua')
+  local f = assert (loadfile('Script/'..script..'.lua'))
+  f()
 end
 
 -- execute a script in the Orbiter root folder
 function run_global (script)
-  dofile(script)
+  local f = assert (loadfile(script))
+  f()
+end
+
+-- -------------------------------------------------
+-- Protected calls for tasks and jobs
+-- Lua cannot yield across the built-in pcall, so a
+-- command (running as coroutine '_trunk') or a job
+-- cannot call proc.skip or a wait function inside a
+-- protected call, and the execution budget cannot
+-- suspend it there. proc.pcall and proc.xpcall run the
+-- function as a coroutine of its own and pass its
+-- yields on to the caller. They cost a coroutine per
+-- call, so use them only where the protected code must
+-- be able to wait; pcall and xpcall are unchanged.
+-- Inside the protected function, coroutine.running()
+-- returns the wrapper coroutine.
+-- A command still cannot be suspended from inside a
+-- metamethod, a 'for' iterator or a function called
+-- from C (e.g. a table.sort comparator): proc.skip
+-- raises an 'attempt to yield across metamethod/C-call
+-- boundary' error there.
+-- -------------------------------------------------
+
+local pcall_caller = setmetatable ({}, {__mode='k'}) -- coroutine -> caller
+
+-- the coroutine on whose behalf th is running: th itself,
+-- or the caller of the outermost proc.pcall
+
+local function caller_of (th)
+	while th ~= nil and pcall_caller[th] ~= nil do
+		th = pcall_caller[th]
+	end
+	return th
+end
+
+-- A coroutine that died from an error keeps its stack, so the
+-- handler can still inspect the error location through co.
+
+local function pcall_resume (co, h, ok, ...)
+	if not ok then
+		if h == nil then return false, ... end
+		if h == debug.traceback then return false, debug.traceback (co, (...)) end
+		return false, h ((...), co)
+	end
+	if coroutine.status (co) == 'dead' then return true, ... end
+	return pcall_resume (co, h, coroutine.resume (co, coroutine.yield (...)))
+end
+
+-- Protected call of f(...). Returns like pcall, but f may
+-- suspend the calling task or job. Called from the main
+-- thread, this is the built-in pcall.
+
+function proc.pcall (f, ...)
+	local th = coroutine.running()
+	if th == nil then return pcall (f, ...) end
+	local ok, co = pcall (coroutine.create, f)
+	if not ok then return pcall (f, ...) end -- C function or callable object
+	pcall_caller[co] = th
+	return pcall_resume (co, nil, coroutine.resume (co, ...))
+end
+
+-- Protected call of f(...) with error handler h. Returns like
+-- xpcall, but f may suspend the calling task or job. h is called
+-- as h(msg, co), where co is the coroutine in which the error was
+-- raised; debug.traceback is applied to co. Called from the main
+-- thread, this is the built-in xpcall.
+
+function proc.xpcall (f, h, ...)
+	local th = coroutine.running()
+	local args, nargs = {...}, select ('#', ...)
+	local function g () return f (unpack (args, 1, nargs)) end
+	if th == nil then return xpcall (g, h) end
+	local ok, co = pcall (coroutine.create, f)
+	if not ok then return xpcall (g, h) end -- C function or callable object
+	pcall_caller[co] = th
+	return pcall_resume (co, h, coroutine.resume (co, ...))
 end
 
 -- -------------------------------------------------
 -- Branch management
 -- Branch threads are stored in table 'branch' with
--- counter 'branch.count'
+-- counter 'branch.count'. Each branch has a scheduling
+-- record in 'branch.info' (priority, wait condition
+-- and CPU accounting).
+-- Branches that call proc.skip are resumed in every
+-- cycle, in order of decreasing priority. Branches
+-- waiting for a simulation time are kept in a timer
+-- heap and are not resumed until the time is reached.
+-- Branches waiting for a condition are not resumed
+-- until the scheduler finds the condition satisfied.
+-- Jobs exceeding the interpreter's execution budget
+-- (proc.set_budget) are suspended and resumed in the
+-- next cycle.
 -- -------------------------------------------------
 
 branch = {}
 branch.count = 0
 branch.nslot = 0
+branch.info = {}                      -- scheduling records, by job id
+branch.byth = setmetatable ({}, {__mode='k'}) -- coroutine -> record
+branch.ready = {}                     -- records to resume in the next cycle
+branch.timer = {}                     -- min-heap of {t, rec, seq} entries
+branch.nlive = 0                      -- number of valid timer entries
 
--- Create a new branch coroutine, store it in the branch
--- table, and execute its first cycle
+-- timer heap operations
+-- A record has at most one valid timer entry, the one whose seq
+-- matches the record's. Entries of rescheduled or killed jobs become
+-- stale. They are dropped when they reach the top of the heap, and
+-- the heap is compacted once they make up more than half of it.
 
-function proc.bg (func,...)
-	-- first, collect all dead branches
-	for i=1,branch.nslot do
-		if branch[i] ~= nil then
-			if coroutine.status(branch[i]) == 'dead' then
-				branch[i] = nil
-				branch.count = branch.count-1
+local function timer_cmp (a, b)
+	return a.t < b.t
+end
+
+local function timer_valid (e)
+	return branch.info[e.b.id] == e.b and e.b.seq == e.seq
+end
+
+-- invalidate the pending timer entry of record b
+
+local function timer_drop (b)
+	b.seq = b.seq+1
+	if b.timed then
+		b.timed = false
+		branch.nlive = branch.nlive-1
+	end
+end
+
+local function timer_compact ()
+	local h, n = branch.timer, 0
+	for i=1,#h do
+		if timer_valid (h[i]) then
+			n = n+1
+			h[n] = h[i]
+		end
+	end
+	for i=#h,n+1,-1 do h[i] = nil end
+	table.sort (h, timer_cmp) -- a sorted array is a valid heap
+end
+
+local function timer_push (t, b)
+	if #branch.timer >= 32 and #branch.timer > 2*branch.nlive then timer_compact() end
+	local h = branch.timer
+	local e = {t=t, b=b, seq=b.seq}
+	b.timed = true
+	branch.nlive = branch.nlive+1
+	local i = #h+1
+	while i > 1 do
+		local p = math.floor(i/2)
+		if h[p].t <= t then break end
+		h[i] = h[p]
+		i = p
+	end
+	h[i] = e
+end
+
+local function timer_pop ()
+	local h = branch.timer
+	local n = #h
+	local top, last = h[1], h[n]
+	h[n] = nil
+	n = n-1
+	local i = 1
+	while true do
+		local c = 2*i
+		if c > n then break end
+		if c < n and h[c+1].t < h[c].t then c = c+1 end
+		if last.t <= h[c].t then break end
+		h[i] = h[c]
+		i = c
+	end
+	if n > 0 then h[i] = last end
+	return top
+end
+
+local function ready_cmp (a, b)
+	if a.prio ~= b.prio then return a.prio > b.prio end
+	return a.id < b.id
+end
+
+-- release the slot of job 'id'
+
+local function branch_remove (id)
+	local b = branch.info[id]
+	if b ~= nil then timer_drop (b) end
+	branch.byth[branch[id]] = nil
+	branch[id] = nil
+	branch.info[id] = nil
+	branch.count = branch.count-1
+	while (branch.nslot > 0) and (branch[branch.nslot] == nil) do
+		branch.nslot = branch.nslot-1
+	end
+end
+
+-- resume the job with record b for one cycle and
+-- reschedule it according to how it suspended itself
+
+local function branch_resume (b, ...)
+	local th = b.th
+	timer_drop (b)               -- invalidates pending timers
+	b.wake = nil
+	b.cond = nil
+	local t0 = os.clock()
+	local ok, err = coroutine.resume (th, ...)
+	b.cpu = b.cpu + (os.clock()-t0)
+	b.nres = b.nres+1
+	if branch.info[b.id] ~= b then return end -- killed itself
+	if coroutine.status(th) == 'dead' then
+		if not ok then term.out ('job '..b.id..': '..tostring(err)) end
+		branch_remove (b.id)
+	elseif b.wake ~= nil then
+		timer_push (b.wake, b)
+	elseif b.cond ~= nil then
+		timer_push (oapi.get_simtime()+b.period, b)
+	else
+		branch.ready[#branch.ready+1] = b
+	end
+end
+
+-- execute one scheduler cycle
+
+local function branch_cycle ()
+	local t = oapi.get_simtime()
+	local ready = branch.ready
+	branch.ready = {}
+
+	-- collect expired timers; waiting conditions are re-checked
+	-- here, so the job is only resumed once the condition is met
+	local h, recheck = branch.timer, {}
+	while h[1] ~= nil and h[1].t <= t do
+		local e = timer_pop ()
+		local b = e.b
+		if timer_valid (e) then
+			b.timed = false
+			branch.nlive = branch.nlive-1
+			if b.cond == nil then
+				ready[#ready+1] = b
+			else
+				local ok, res = pcall (b.cond)
+				if not ok then
+					term.out ('job '..b.id..': '..tostring(res))
+					branch_remove (b.id)
+				elseif res then
+					ready[#ready+1] = b
+				else
+					recheck[#recheck+1] = b
+				end
+			end
+		end
+	end
+	for i=1,#recheck do
+		timer_push (t+recheck[i].period, recheck[i])
+	end
+
+	-- once the cycle has used up the interpreter's execution
+	-- budget, the remaining jobs are deferred to the next cycle
+	table.sort (ready, ready_cmp)
+	for i=1,#ready do
+		local b = ready[i]
+		if branch.info[b.id] == b then
+			if proc.Overrun() then
+				branch.ready[#branch.ready+1] = b
+			else
+				branch_resume (b)
 			end
 		end
 	end
+end
+
+-- Suspend the calling job until the simulation time reaches
+-- 'wake', or until cond() returns true (checked every 'period'
+-- seconds of simulation time). Returns false if the caller is
+-- not a job, in which case the caller must poll. A job waiting
+-- for cond() is only resumed after cond() returned true.
 
-	-- check if there is a free slot
+local function branch_wait (wake, cond, period)
+	local b = branch.byth[caller_of (coroutine.running())]
+	if b == nil then return false end
+	b.wake = wake
+	b.cond = cond
+	b.period = period or 0
+	coroutine.yield()
+	return true
+end
+
+-- Create a new branch coroutine, store it in the branch
+-- table, and execute its first cycle
+
+function proc.bg (func,...)
+	-- find a free slot
 	local slot = 0
 	for i=1,branch.nslot do
 		if branch[i] == nil then
@@ -73,9 +339,13 @@ function proc.bg (func,...)
 
 	-- create the new branch
 	local th = coroutine.create (func)
+	local b = {id=slot, th=th, prio=0, cpu=0, nres=0, seq=0}
 	branch[slot] = th
+	branch.info[slot] = b
+	branch.byth[th] = b
 	branch.count = branch.count+1
-	coroutine.resume (th,...)
+	proc.Preemptible (th) -- may be suspended by the execution budget
+	branch_resume (b, ...)
 	term.out ('job id='..slot..' ('..branch.count..' jobs)')
 	return slot
 end
@@ -85,27 +355,60 @@ end
 
 function proc.kill (n)
 	if branch[n] ~= nil then
-		branch[n] = nil
-		branch.count = branch.count-1
-		while (branch.nslot > 0) and (branch[branch.nslot] == nil) do
-			branch.nslot = branch.nslot-1
-		end
+		branch_remove (n)
 		term.out ('job '..n..' killed ('..branch.count..' jobs left)')
 	end
 end
 
+-- Set the priority of job n. In each cycle, jobs with higher
+-- priority are resumed first (default: 0)
+
+function proc.set_priority (n, prio)
+	if branch.info[n] ~= nil then
+		branch.info[n].prio = prio
+	end
+end
+
+-- Return the scheduling record of job n: priority, CPU time
+-- used [s], number of cycles executed, and wait state
+
+function proc.stat (n)
+	local b = branch.info[n]
+	if b == nil then return nil end
+	local state = 'ready'
+	if b.wake ~= nil then state = 'wait_time'
+	elseif b.cond ~= nil then state = 'wait_cond' end
+	return {prio=b.prio, cpu=b.cpu, cycles=b.nres, state=state}
+end
+
+-- List all jobs with their scheduling records
+
+function proc.list ()
+	for i=1,branch.nslot do
+		local s = proc.stat(i)
+		if s ~= nil then
+			term.out (string.format ('job %d: prio=%d cpu=%.3fs cycles=%d %s', i, s.prio, s.cpu, s.cycles, s.state))
+		end
+	end
+end
+
 -- Time skip: branches yield, the main trunk resumes all
 -- coroutines for a single cycle, then calls proc.Frameskip
--- to pass control back to orbiter for a new simulation cycle
+-- to pass control back to orbiter for a new simulation cycle.
+-- A command scheduled by the interpreter runs as coroutine
+-- '_trunk', which is suspended by proc.Frameskip. Inside
+-- proc.pcall, the trunk is suspended through the pcall
+-- coroutine instead.
 
 function proc.skip ()
-	if coroutine.running() == nil then  -- we are in the main trunk
-		for i=1,branch.nslot do
-			if branch[i] ~= nil then
-				coroutine.resume (branch[i])
-			end
+	local th = caller_of (coroutine.running())
+	if th == nil or th == _trunk then  -- we are in the main trunk
+		branch_cycle()
+		if th ~= nil and th ~= coroutine.running() then
+			coroutine.yield() -- suspend the trunk through the protected call
+		else
+			proc.Frameskip() -- hand control to orbiter for one cycle
 		end
-		proc.Frameskip() -- hand control to orbiter for one cycle
             if wait_exit ~= nil then
                 error()   -- return to caller immediately
             end
@@ -116,48 +419,57 @@ end
 
 -- -------------------------------------------------
 -- A few waiting functions
+-- Called from a job, these suspend the job until the
+-- wait is over. Called from the main trunk, they poll
+-- once per cycle.
 -- -------------------------------------------------
 
 -- wait for simulation time t
 function proc.wait_simtime (t)
-    while oapi.get_simtime() < t do proc.skip() end
+    while oapi.get_simtime() < t do
+        if not branch_wait (t) then proc.skip() end
+    end
 end
 
 -- wait for simulation interval dt
 function proc.wait_simdt (dt)
-    local t1 = oapi.get_simtime()+dt
-    while oapi.get_simtime() < t1 do proc.skip() end
+    proc.wait_simtime (oapi.get_simtime()+dt)
+end
+
+-- wait until f() returns true, checking every 'period'
+-- seconds of simulation time (default: every cycle)
+function proc.wait_until (f, period)
+    if f() or branch_wait (nil, f, period) then return end
+    repeat proc.skip() until f()
 end
 
 -- wait for system time t
 function proc.wait_systime (t)
-    while oapi.get_systime() < t do proc.skip() end
+    proc.wait_until (function () return oapi.get_systime() >= t end)
 end
 
 -- wait for system interval dt
 function proc.wait_sysdt (dt)
-    local t1 = oapi.get_systime()+dt
-    while oapi.get_systime() < t1 do proc.skip() end
+    proc.wait_systime (oapi.get_systime()+dt)
 end
 
 -- wait for f() >= tgt
 function proc.wait_ge (f, tgt, ...)
-    while f(unpack(arg)) < tgt do proc.skip() end
+    local args = {...}
+    proc.wait_until (function () return f(unpack(args)) >= tgt end)
 end
 
 -- wait for f() <= tgt
 function proc.wait_le (f, tgt, ...)
-    while f(unpack(arg)) > tgt do proc.skip() end
+    local args = {...}
+    proc.wait_until (function () return f(unpack(args)) <= tgt end)
 end
 
 -- wait for input
 function proc.wait_input (title)
     oapi.open_inputbox (title)
-    local ans = oapi.receive_input ()
-    while ans == nil do
-        proc.skip()
-        ans = oapi.receive_input ()
-    end
+    local ans
+    proc.wait_until (function () ans = oapi.receive_input (); return ans ~= nil end)
     return ans
 end
 
@@ -169,11 +481,7 @@ end
 -- background jobs to continue executing)
 
 function _idle ()
-	for i=1,branch.nslot do
-		if branch[i] ~= nil then
-			coroutine.resume (branch[i])
-		end
-	end
+	branch_cycle()
 	return branch.count
 end
 